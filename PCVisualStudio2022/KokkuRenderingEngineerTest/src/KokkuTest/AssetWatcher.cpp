@@ -0,0 +1,57 @@
+#include "AssetWatcher.h"
+
+#include <stdio.h>
+
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+void AssetWatcher::Init(float pollInterval)
+{
+    mFileCount = 0;
+    mPollInterval = pollInterval;
+    mSincePoll = 0.0f;
+}
+
+bool AssetWatcher::Add(ResourceDirectory dir, const char* pFileName, uint32_t userData)
+{
+    if (mFileCount == MAX_FILES)
+    {
+        LOGF(eWARNING, "Hot reload watches %u files, %s is left out", MAX_FILES, pFileName);
+        return false;
+    }
+
+    WatchedAsset& file = mFiles[mFileCount++];
+    file.mDir = dir;
+    snprintf(file.mName, sizeof(file.mName), "%s", pFileName);
+    file.mUserData = userData;
+    file.mLoadedTime = fsGetLastModifiedTime(dir, pFileName);
+    file.mSeenTime = file.mLoadedTime;
+    return true;
+}
+
+uint32_t AssetWatcher::Update(float deltaTime, uint32_t* pOutUserData, uint32_t maxCount)
+{
+    mSincePoll += deltaTime;
+    if (mSincePoll < mPollInterval)
+        return 0;
+    mSincePoll = 0.0f;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < mFileCount; ++i)
+    {
+        WatchedAsset& file = mFiles[i];
+        const time_t  time = fsGetLastModifiedTime(file.mDir, file.mName);
+        const bool    settled = time == file.mSeenTime;
+        file.mSeenTime = time;
+
+        // Missing while it's being replaced, or still being written
+        if (time <= 0 || !settled || time == file.mLoadedTime || count == maxCount)
+            continue;
+
+        file.mLoadedTime = time;
+        pOutUserData[count++] = file.mUserData;
+        LOGF(eINFO, "Hot reload: %s changed", file.mName);
+    }
+    return count;
+}
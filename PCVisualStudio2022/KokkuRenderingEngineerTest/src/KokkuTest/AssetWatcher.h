@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+#include <Utilities/Interfaces/IFileSystem.h>
+
+// Polls the modification time of asset files for hot reload. A change is reported once the time differs from the
+// version in use and stayed the same over a whole poll interval, so a file the cooker or the shader compiler is
+// still writing is picked up after it's complete.
+
+struct WatchedAsset
+{
+    ResourceDirectory mDir;
+    char mName[128];
+    uint32_t mUserData;
+    // Of the version in use, and as seen by the last poll
+    time_t mLoadedTime;
+    time_t mSeenTime;
+};
+
+class AssetWatcher
+{
+public:
+    static const uint32_t MAX_FILES = 64;
+
+private:
+    WatchedAsset mFiles[MAX_FILES] = {};
+    uint32_t mFileCount = 0;
+    float mPollInterval = 0.25f;
+    float mSincePoll = 0.0f;
+
+public:
+    void Init(float pollInterval);
+
+    // The file's current time is the version in use. False once MAX_FILES are watched.
+    bool Add(ResourceDirectory dir, const char* pFileName, uint32_t userData);
+
+    // Polls once the interval is over, writes the userData of up to maxCount changed files and returns their count.
+    // Every change is reported once, the new version counts as the one in use from then on.
+    uint32_t Update(float deltaTime, uint32_t* pOutUserData, uint32_t maxCount);
+
+    uint32_t GetFileCount() const { return mFileCount; }
+};
@@ -0,0 +1,251 @@
+#include "CameraPath.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+void CameraPath::Exit()
+{
+    tf_free(pKeys);
+    pKeys = NULL;
+    mKeyCount = 0;
+    mKeyCapacity = 0;
+    mSegmentCount = 0;
+}
+
+bool CameraPath::Load(ResourceDirectory dir, const char* pFileName)
+{
+    Exit();
+
+    FileStream stream = {};
+    if (!fsOpenStreamFromPath(dir, pFileName, FM_READ, &stream))
+    {
+        LOGF(eERROR, "Can't open the camera path %s", pFileName);
+        return false;
+    }
+
+    // Segments read since the last key start at the next one
+    uint32_t pendingSegments = 0;
+    uint32_t lineNumber = 0;
+    bool     valid = true;
+    char     line[256];
+    while (valid && !fsStreamAtEnd(&stream))
+    {
+        ssize_t length = fsReadFromStreamLine(&stream, line, sizeof(line));
+        ++lineNumber;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        if (length <= 0 || line[0] == '#')
+            continue;
+
+        CameraPathKey key;
+        if (strncmp(line, "segment ", 8) == 0)
+        {
+            valid = AddSegment(line + 8, 0.0f);
+            ++pendingSegments;
+        }
+        else if (sscanf(line, "key %f %f %f %f %f %f", &key.mTime, &key.mPosition[0], &key.mPosition[1], &key.mPosition[2],
+                        &key.mRotation[0], &key.mRotation[1]) == 6)
+        {
+            valid = mKeyCount == 0 || key.mTime >= pKeys[mKeyCount - 1].mTime;
+            AddKey(key.mTime, key.mPosition, key.mRotation);
+            for (; pendingSegments > 0; --pendingSegments)
+                mSegments[mSegmentCount - pendingSegments].mStartTime = key.mTime;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+    fsCloseStream(&stream);
+
+    if (!valid || mKeyCount == 0)
+    {
+        LOGF(eERROR, "Camera path %s: %s at line %u", pFileName, mKeyCount == 0 ? "no keys" : "bad line", lineNumber);
+        Exit();
+        return false;
+    }
+
+    // Trailing segments without keys would be empty
+    mSegmentCount -= pendingSegments;
+
+    if (mSegmentCount == 0 || mSegments[0].mStartTime > pKeys[0].mTime)
+    {
+        const uint32_t count = mSegmentCount < MAX_SEGMENTS ? mSegmentCount : MAX_SEGMENTS - 1;
+        memmove(&mSegments[1], &mSegments[0], count * sizeof(CameraPathSegment));
+        mSegmentCount = count + 1;
+        snprintf(mSegments[0].mName, sizeof(mSegments[0].mName), "%s", pFileName);
+        mSegments[0].mStartTime = pKeys[0].mTime;
+    }
+    return true;
+}
+
+bool CameraPath::Save(ResourceDirectory dir, const char* pFileName) const
+{
+    FileStream stream = {};
+    if (!fsOpenStreamFromPath(dir, pFileName, FM_WRITE, &stream))
+    {
+        LOGF(eWARNING, "Can't write the camera path %s", pFileName);
+        return false;
+    }
+
+    fsPrintToStream(&stream, "# KokkuTest camera path: key <seconds> <x> <y> <z> <pitch> <yaw>\n");
+    uint32_t segment = 0;
+    for (uint32_t i = 0; i < mKeyCount; ++i)
+    {
+        const CameraPathKey& key = pKeys[i];
+        for (; segment < mSegmentCount && mSegments[segment].mStartTime <= key.mTime; ++segment)
+            fsPrintToStream(&stream, "segment %s\n", mSegments[segment].mName);
+        fsPrintToStream(&stream, "key %.4f %.4f %.4f %.4f %.5f %.5f\n", key.mTime, key.mPosition[0], key.mPosition[1], key.mPosition[2],
+                        key.mRotation[0], key.mRotation[1]);
+    }
+    fsCloseStream(&stream);
+
+    LOGF(eINFO, "Camera path: %u keys, %u segments written to %s", mKeyCount, mSegmentCount, pFileName);
+    return true;
+}
+
+void CameraPath::AddKey(float time, const float* pPosition, const float* pRotation)
+{
+    if (mKeyCount == mKeyCapacity)
+    {
+        mKeyCapacity = mKeyCapacity > 0 ? mKeyCapacity * 2 : 1024;
+        pKeys = (CameraPathKey*)tf_realloc(pKeys, mKeyCapacity * sizeof(CameraPathKey));
+    }
+
+    CameraPathKey& key = pKeys[mKeyCount++];
+    key.mTime = time;
+    memcpy(key.mPosition, pPosition, sizeof(key.mPosition));
+    memcpy(key.mRotation, pRotation, sizeof(key.mRotation));
+}
+
+bool CameraPath::AddSegment(const char* pName, float startTime)
+{
+    if (mSegmentCount == MAX_SEGMENTS)
+        return false;
+
+    CameraPathSegment& segment = mSegments[mSegmentCount++];
+    snprintf(segment.mName, sizeof(segment.mName), "%s", pName);
+    segment.mStartTime = startTime;
+    return true;
+}
+
+void CameraPath::Sample(float time, float* pPosition, float* pRotation) const
+{
+    // Last key at or before time
+    uint32_t first = 0;
+    uint32_t last = mKeyCount;
+    while (last - first > 1)
+    {
+        const uint32_t middle = (first + last) / 2;
+        if (pKeys[middle].mTime <= time)
+            first = middle;
+        else
+            last = middle;
+    }
+
+    const CameraPathKey& a = pKeys[first];
+    const CameraPathKey& b = pKeys[first + 1 < mKeyCount ? first + 1 : first];
+    float t = b.mTime > a.mTime ? (time - a.mTime) / (b.mTime - a.mTime) : 0.0f;
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+    // The controller's yaw is continuous, recorded paths need no wrap around here
+    for (int i = 0; i < 3; ++i)
+        pPosition[i] = a.mPosition[i] + (b.mPosition[i] - a.mPosition[i]) * t;
+    for (int i = 0; i < 2; ++i)
+        pRotation[i] = a.mRotation[i] + (b.mRotation[i] - a.mRotation[i]) * t;
+}
+
+bool CameraPathReplay::Init(ResourceDirectory dir, const char* pFileName, float timestep, uint32_t warmupFrames)
+{
+    Exit();
+
+    if (timestep <= 0.0f || !mPath.Load(dir, pFileName))
+        return false;
+
+    snprintf(mName, sizeof(mName), "%s", pFileName);
+    mTimestep = timestep;
+    mWarmupFrames = warmupFrames;
+    mStepCount = (uint32_t)floorf(mPath.GetDuration() / timestep) + 1;
+    mNextStep = 0;
+    mPendingStep = UINT32_MAX;
+    mFramesRecorded = 0;
+    pCpuFrameTimes = (float*)tf_calloc(mStepCount, sizeof(float));
+    pGpuFrameTimes = (float*)tf_calloc(mStepCount, sizeof(float));
+
+    LOGF(eINFO, "[CameraPath] Replaying %s: %.2f s in %u steps of %.2f ms, %u segments", pFileName, mPath.GetDuration(), mStepCount,
+         timestep * 1000.0f, mPath.GetSegmentCount());
+    return true;
+}
+
+void CameraPathReplay::Exit()
+{
+    mPath.Exit();
+    tf_free(pCpuFrameTimes);
+    tf_free(pGpuFrameTimes);
+    pCpuFrameTimes = NULL;
+    pGpuFrameTimes = NULL;
+    mStepCount = 0;
+    mFramesRecorded = 0;
+}
+
+void CameraPathReplay::Step(float* pPosition, float* pRotation)
+{
+    if (mWarmupFrames > 0)
+    {
+        --mWarmupFrames;
+        mPendingStep = UINT32_MAX;
+        mPath.Sample(mPath.GetStartTime(), pPosition, pRotation);
+        return;
+    }
+
+    mPendingStep = mNextStep < mStepCount ? mNextStep++ : UINT32_MAX;
+    const float step = (float)(mPendingStep != UINT32_MAX ? mPendingStep : mStepCount - 1);
+    mPath.Sample(mPath.GetStartTime() + step * mTimestep, pPosition, pRotation);
+}
+
+void CameraPathReplay::AddFrame(float cpuMs, float gpuMs)
+{
+    if (mPendingStep == UINT32_MAX)
+        return;
+
+    pCpuFrameTimes[mPendingStep] = cpuMs;
+    pGpuFrameTimes[mPendingStep] = gpuMs;
+    mPendingStep = UINT32_MAX;
+    ++mFramesRecorded;
+}
+
+static void reportFrameTimes(const char* pName, const float* pCpuFrameTimes, const float* pGpuFrameTimes, uint32_t count)
+{
+    const FrameTimeStats cpu = FrameBenchmark::ComputeStats(pCpuFrameTimes, count);
+    const FrameTimeStats gpu = FrameBenchmark::ComputeStats(pGpuFrameTimes, count);
+    LOGF(eINFO, "[CameraPath] %s: %u frames", pName, count);
+    LOGF(eINFO, "[CameraPath]     CPU frame ms: avg %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f", cpu.mAvg, cpu.mP50, cpu.mP95, cpu.mP99,
+         cpu.mMax);
+    LOGF(eINFO, "[CameraPath]     GPU frame ms: avg %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f", gpu.mAvg, gpu.mP50, gpu.mP95, gpu.mP99,
+         gpu.mMax);
+}
+
+void CameraPathReplay::Report() const
+{
+    reportFrameTimes(mName, pCpuFrameTimes, pGpuFrameTimes, mFramesRecorded);
+
+    // Steps are in time order, so every segment is a contiguous run of them
+    for (uint32_t s = 0; s < mPath.GetSegmentCount(); ++s)
+    {
+        const CameraPathSegment& segment = mPath.GetSegment(s);
+        const uint32_t begin = (uint32_t)ceilf((segment.mStartTime - mPath.GetStartTime()) / mTimestep);
+        uint32_t       end = mFramesRecorded;
+        if (s + 1 < mPath.GetSegmentCount())
+        {
+            const uint32_t next = (uint32_t)ceilf((mPath.GetSegment(s + 1).mStartTime - mPath.GetStartTime()) / mTimestep);
+            end = next < end ? next : end;
+        }
+        if (begin < end)
+            reportFrameTimes(segment.mName, pCpuFrameTimes + begin, pGpuFrameTimes + begin, end - begin);
+    }
+}
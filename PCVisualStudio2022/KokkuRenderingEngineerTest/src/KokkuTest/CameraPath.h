@@ -0,0 +1,98 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Utilities/Interfaces/IFileSystem.h>
+
+#include "FrameBenchmark.h"
+
+// Camera fly-throughs for repeatable benchmarks. A path is a list of timed camera poses (position and the FPS
+// controller's pitch/yaw) split into named segments, stored as text so recorded paths can be renamed and trimmed:
+//
+//   # comment
+//   segment Exterior orbit
+//   key <seconds> <x> <y> <z> <pitch> <yaw>
+//
+// A segment starts at the next key. Keys before the first segment belong to one named after the file.
+
+struct CameraPathKey
+{
+    float mTime;
+    float mPosition[3];
+    float mRotation[2];
+};
+
+struct CameraPathSegment
+{
+    char mName[64];
+    float mStartTime;
+};
+
+class CameraPath
+{
+public:
+    static const uint32_t MAX_SEGMENTS = 32;
+
+private:
+    CameraPathKey* pKeys = NULL;
+    uint32_t mKeyCount = 0;
+    uint32_t mKeyCapacity = 0;
+    CameraPathSegment mSegments[MAX_SEGMENTS] = {};
+    uint32_t mSegmentCount = 0;
+
+public:
+    void Exit();
+
+    // Replaces the path, false (and an empty path) on a missing file or a malformed line
+    bool Load(ResourceDirectory dir, const char* pFileName);
+    bool Save(ResourceDirectory dir, const char* pFileName) const;
+
+    // Keys must come in time order
+    void AddKey(float time, const float* pPosition, const float* pRotation);
+    // Starts a segment at time, false once MAX_SEGMENTS are used
+    bool AddSegment(const char* pName, float startTime);
+
+    uint32_t GetKeyCount() const { return mKeyCount; }
+    float GetStartTime() const { return mKeyCount > 0 ? pKeys[0].mTime : 0.0f; }
+    float GetDuration() const { return mKeyCount > 0 ? pKeys[mKeyCount - 1].mTime - pKeys[0].mTime : 0.0f; }
+    uint32_t GetSegmentCount() const { return mSegmentCount; }
+    const CameraPathSegment& GetSegment(uint32_t index) const { return mSegments[index]; }
+
+    // Linear between the keys around time, clamped to the first and last key
+    void Sample(float time, float* pPosition, float* pRotation) const;
+};
+
+// Plays a path back at a fixed timestep, one step per frame whatever the frame took, and collects the frame times
+// of every step. The first warmupFrames frames hold the first pose and aren't recorded.
+class CameraPathReplay
+{
+private:
+    CameraPath mPath;
+    char mName[64] = {};
+    float mTimestep = 0.0f;
+    uint32_t mWarmupFrames = 0;
+    uint32_t mStepCount = 0;
+    uint32_t mNextStep = 0;
+    // Step of the pose handed out last, UINT32_MAX during the warmup
+    uint32_t mPendingStep = UINT32_MAX;
+    uint32_t mFramesRecorded = 0;
+    float* pCpuFrameTimes = NULL;
+    float* pGpuFrameTimes = NULL;
+
+public:
+    bool Init(ResourceDirectory dir, const char* pFileName, float timestep, uint32_t warmupFrames);
+    void Exit();
+
+    bool IsActive() const { return mStepCount > 0; }
+    bool IsFinished() const { return IsActive() && mFramesRecorded == mStepCount; }
+    float GetTimestep() const { return mTimestep; }
+
+    // Pose of the frame about to be drawn
+    void Step(float* pPosition, float* pRotation);
+    // Times of the frame drawn with the last Step() pose. The GPU time is the profiler's latest, a few frames
+    // behind, which only blurs the segment borders.
+    void AddFrame(float cpuMs, float gpuMs);
+
+    // Whole path and then every segment
+    void Report() const;
+};
@@ -1,41 +1,593 @@
 #include "CastleScene.h"
+#include "MeshSimplify.h"
+#include "Tangents.h"
 
-void CastleScene::Load(const GeometryLoadDesc* pTemplate, bool transparentFlags)
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/ITime.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// The cooked blobs are handed to the GPU as these types
+static_assert(sizeof(CookedSceneDraw) == sizeof(IndirectDrawIndexArguments), "CookedSceneDraw must match IndirectDrawIndexArguments");
+static_assert(sizeof(CookedSceneBounds) == sizeof(BoundingBox), "CookedSceneBounds must match BoundingBox");
+
+// Octahedral R16G16_UNORM, the inverse of encodeDir in The-Forge's shader library
+static void decodeNormal(uint32_t packed, float* pOut)
 {
-    GeometryLoadDesc loadDesc = *pTemplate;
+    float x = (packed & 0xFFFF) / 65535.0f * 2.0f - 1.0f;
+    float y = (packed >> 16) / 65535.0f * 2.0f - 1.0f;
+    const float z = 1.0f - fabsf(x) - fabsf(y);
+    if (z < 0.0f)
+    {
+        const float wrappedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float wrappedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = wrappedX;
+        y = wrappedY;
+    }
+    const float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+    pOut[0] = x * invLength;
+    pOut[1] = y * invLength;
+    pOut[2] = z * invLength;
+}
 
-    VertexLayout vertexLayout = {};
+static float halfToFloat(uint16_t half)
+{
+    const uint32_t exponent = (half >> 10) & 0x1F;
+    const uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0)
+    {
+        const float value = mantissa / 16777216.0f;
+        return half & 0x8000 ? -value : value;
+    }
+
+    const uint32_t bits = ((uint32_t)(half & 0x8000) << 16) | (exponent == 31 ? 0x7F800000 : (exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void CastleScene::getVertexLayout(CastleVertexFormat format, bool positionsOnly, VertexLayout* pOutLayout)
+{
+    const bool interleaved = format == CASTLE_VERTEX_FORMAT_INTERLEAVED;
+    const uint32_t attribCount = positionsOnly ? 1 : VERTEX_STREAM_COUNT;
+
+    *pOutLayout = {};
+    pOutLayout->mAttribCount = attribCount;
+    pOutLayout->mBindingCount = interleaved ? 1 : attribCount;
+    pOutLayout->mAttribs[0].mSemantic = SEMANTIC_POSITION;
+    pOutLayout->mAttribs[0].mFormat =
+        format == CASTLE_VERTEX_FORMAT_FLOAT ? TinyImageFormat_R32G32B32_SFLOAT : TinyImageFormat_R16G16B16A16_UNORM;
+    pOutLayout->mAttribs[1].mSemantic = SEMANTIC_NORMAL;
+    pOutLayout->mAttribs[1].mFormat = TinyImageFormat_R16G16_UNORM;
+    pOutLayout->mAttribs[2].mSemantic = SEMANTIC_TEXCOORD0;
+    pOutLayout->mAttribs[2].mFormat = TinyImageFormat_R16G16_SFLOAT;
+    pOutLayout->mAttribs[3].mSemantic = SEMANTIC_TANGENT;
+    pOutLayout->mAttribs[3].mFormat = TinyImageFormat_R8G8B8A8_SNORM;
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < attribCount; ++i)
+    {
+        VertexAttrib& attrib = pOutLayout->mAttribs[i];
+        const uint32_t size = TinyImageFormat_BitSizeOfBlock(attrib.mFormat) / 8;
+        attrib.mLocation = i;
+        attrib.mBinding = interleaved ? 0 : i;
+        attrib.mOffset = interleaved ? offset : 0;
+        offset += size;
+        if (!interleaved)
+            pOutLayout->mBindings[i].mStride = size;
+    }
+
+    // The position only layout still steps over the rest of the interleaved vertex
+    if (interleaved)
+        pOutLayout->mBindings[0].mStride = getVertexSize(format, false);
+}
+
+const char* CastleScene::getVertexFormatName(CastleVertexFormat format)
+{
+    static const char* names[CASTLE_VERTEX_FORMAT_COUNT] = { "float", "quantized", "interleaved" };
+    return names[format];
+}
+
+uint32_t CastleScene::getVertexSize(CastleVertexFormat format, bool positionsOnly)
+{
+    const uint32_t positionSize = format == CASTLE_VERTEX_FORMAT_FLOAT ? 12 : 8;
+    if (format == CASTLE_VERTEX_FORMAT_INTERLEAVED)
+        return positionSize + 12;
+    return positionsOnly ? positionSize : positionSize + 12;
+}
+
+const char* CastleScene::getSceneFormatName(CastleSceneFormat format)
+{
+    static const char* names[CASTLE_SCENE_FORMAT_COUNT] = { "bin", "cooked" };
+    return names[format];
+}
+
+const char* CastleScene::getSceneFileName(CastleSceneFormat format)
+{
+    static const char* names[CASTLE_SCENE_FORMAT_COUNT] = { "castle.bin", "castle.kscene" };
+    return names[format];
+}
+
+void CastleScene::Load(const GeometryLoadDesc* pTemplate, bool transparentFlags, CastleVertexFormat vertexFormat, CastleSceneFormat sceneFormat)
+{
+    const int64_t startUSec = getUSec(true);
+
+    mSceneFormat = sceneFormat;
+    if (mSceneFormat == CASTLE_SCENE_FORMAT_COOKED && !loadCooked())
+    {
+        LOGF(eWARNING, "Falling back to %s", getSceneFileName(CASTLE_SCENE_FORMAT_BIN));
+        mSceneFormat = CASTLE_SCENE_FORMAT_BIN;
+    }
+    if (mSceneFormat == CASTLE_SCENE_FORMAT_BIN)
+        loadBin(pTemplate);
+
+    const int64_t geometryUSec = getUSec(true);
+    mGeometryLoadMs = (geometryUSec - startUSec) / 1000.0f;
+
+    uint32_t* rebasedIndices = (uint32_t*)tf_calloc(geom->mIndexCount, sizeof(uint32_t));
+    buildMeshlets(rebasedIndices);
+    if (mSceneFormat == CASTLE_SCENE_FORMAT_BIN)
+        buildTangents(rebasedIndices);
 
-    vertexLayout.mAttribCount = 3;
-    vertexLayout.mBindingCount = 3;
-    vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
-    vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
-    vertexLayout.mAttribs[0].mBinding = 0;
-    vertexLayout.mAttribs[0].mLocation = 0;
-    vertexLayout.mAttribs[1].mSemantic = SEMANTIC_NORMAL;
-    vertexLayout.mAttribs[1].mFormat = TinyImageFormat_R16G16_UNORM;
-    vertexLayout.mAttribs[1].mBinding = 1;
-    vertexLayout.mAttribs[1].mLocation = 1;
-    vertexLayout.mAttribs[2].mSemantic = SEMANTIC_TEXCOORD0;
-    vertexLayout.mAttribs[2].mFormat = TinyImageFormat_R16G16_SFLOAT;
-    vertexLayout.mAttribs[2].mBinding = 2;
-    vertexLayout.mAttribs[2].mLocation = 2;
+    mVertexFormat = vertexFormat;
+    addPackedVertexBuffer();
+    buildLods(rebasedIndices);
+    tf_free(rebasedIndices);
+
+    // Nothing reads the source vertices past this point
+    closeCooked();
+    pSourcePositions = NULL;
+    pSourceIndices = NULL;
+
+    mBuildMs = (getUSec(true) - geometryUSec) / 1000.0f;
+    LOGF(eINFO, "Castle loaded from %s: geometry %.2f ms, bounds, meshlets, tangents and LODs %.2f ms", getFileName(),
+         mGeometryLoadMs, mBuildMs);
+}
+
+void CastleScene::loadBin(const GeometryLoadDesc* pTemplate)
+{
+    GeometryLoadDesc loadDesc = *pTemplate;
 
+    // The file is always loaded with float positions, they are the source of the quantized layouts.
+    // It has no tangents, buildTangents adds them.
+    VertexLayout vertexLayout = {};
+    getVertexLayout(CASTLE_VERTEX_FORMAT_FLOAT, false, &vertexLayout);
+    vertexLayout.mAttribCount = COOKED_SCENE_STREAM_TANGENT;
+    vertexLayout.mBindingCount = COOKED_SCENE_STREAM_TANGENT;
     loadDesc.pVertexLayout = &vertexLayout;
 
     loadDesc.pFileName = "castle.bin";
+    // Keep a CPU copy of the vertices and indices for the submesh bounds and the tangents
+    loadDesc.mFlags |= GEOMETRY_LOAD_FLAG_SHADOWED;
+    // The visibility buffer resolve and the vertex packing fetch the vertex streams as raw buffers
+    loadDesc.mFlags |= GEOMETRY_LOAD_FLAG_STRUCTURED_BUFFERS;
     loadDesc.ppGeometryData = &geomData;
     loadDesc.ppGeometry = &geom;
 
-    addResource(&loadDesc, NULL);
+    addResource(&loadDesc, &mLoadToken);
+    // The shadow copy is filled by the load itself
+    waitForToken(&mLoadToken);
+
+    pSourcePositions = (const float*)geomData->pShadow->pAttributes[SEMANTIC_POSITION];
+    pSourceIndices = geomData->pShadow->pIndices;
+    computeSubmeshBounds();
+}
+
+bool CastleScene::loadCooked()
+{
+    const char* fileName = pCookedFileName ? pCookedFileName : getSceneFileName(CASTLE_SCENE_FORMAT_COOKED);
+    if (!fsOpenStreamFromPath(RD_MESHES, fileName, FM_READ, &mCookedStream))
+    {
+        LOGF(eWARNING, "%s not found, run KokkuSceneCooker", fileName);
+        return false;
+    }
+
+    // Mapped, the blobs go from the page cache to the upload buffers without a copy in between
+    size_t size = 0;
+    const void* data = NULL;
+    if (!fsStreamMemoryMap(&mCookedStream, &size, &data))
+    {
+        const ssize_t fileSize = fsGetStreamFileSize(&mCookedStream);
+        size = fileSize > 0 ? (size_t)fileSize : 0;
+        pCookedCopy = tf_malloc(size);
+        size = fsReadFromStream(&mCookedStream, pCookedCopy, size);
+        data = pCookedCopy;
+    }
+
+    CookedScene scene;
+    if (const char* error = cookedSceneParse(data, size, &scene))
+    {
+        LOGF(eWARNING, "%s: %s", fileName, error);
+        closeCooked();
+        return false;
+    }
+    const CookedSceneHeader& header = *scene.pHeader;
+
+    // Laid out like the Geometry The-Forge allocates, draw args right behind it
+    geom = (Geometry*)tf_calloc(1, sizeof(Geometry) + sizeof(IndirectDrawIndexArguments) * header.mDrawCount);
+    geom->pDrawArgs = (IndirectDrawIndexArguments*)(geom + 1);
+    memcpy(geom->pDrawArgs, scene.pDraws, sizeof(IndirectDrawIndexArguments) * header.mDrawCount);
+    geom->mDrawArgCount = header.mDrawCount;
+    geom->mIndexCount = header.mIndexCount;
+    geom->mVertexCount = header.mVertexCount;
+    geom->mIndexType = header.mIndexSize == 2 ? INDEX_TYPE_UINT16 : INDEX_TYPE_UINT32;
+    // The tangents go to pTangentBuffer like the ones generated for castle.bin
+    geom->mVertexBufferCount = COOKED_SCENE_STREAM_TANGENT;
+
+    // Same usage as GEOMETRY_LOAD_FLAG_STRUCTURED_BUFFERS gives the castle.bin buffers
+    static const char* streamNames[COOKED_SCENE_STREAM_COUNT] = { "Castle positions", "Castle normals", "Castle uvs", "Castle tangents" };
+    for (uint32_t i = 0; i < COOKED_SCENE_STREAM_COUNT; ++i)
+    {
+        BufferLoadDesc vertexDesc = {};
+        vertexDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_BUFFER_RAW;
+        vertexDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        vertexDesc.mDesc.mStartState = RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+        vertexDesc.mDesc.mElementCount = header.mVertexStreams[i].mSize / sizeof(uint32_t);
+        vertexDesc.mDesc.mStructStride = sizeof(uint32_t);
+        vertexDesc.mDesc.mSize = header.mVertexStreams[i].mSize;
+        vertexDesc.mDesc.pName = streamNames[i];
+        vertexDesc.pData = scene.pVertexStreams[i];
+        vertexDesc.ppBuffer = i == COOKED_SCENE_STREAM_TANGENT ? &pTangentBuffer : &geom->pVertexBuffers[i];
+        addResource(&vertexDesc, &mLoadToken);
+        if (i != COOKED_SCENE_STREAM_TANGENT)
+            geom->mVertexStrides[i] = gCookedSceneStrides[i];
+    }
+
+    BufferLoadDesc indexDesc = {};
+    indexDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_INDEX_BUFFER | DESCRIPTOR_TYPE_BUFFER_RAW;
+    indexDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    indexDesc.mDesc.mStartState = RESOURCE_STATE_INDEX_BUFFER;
+    // Raw views count 32-bit words, an odd number of 16-bit indices still ends inside the blob padding
+    indexDesc.mDesc.mElementCount = (header.mIndices.mSize + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    indexDesc.mDesc.mStructStride = sizeof(uint32_t);
+    indexDesc.mDesc.mSize = header.mIndices.mSize;
+    indexDesc.mDesc.pName = "Castle indices";
+    indexDesc.pData = scene.pIndices;
+    indexDesc.ppBuffer = &geom->pIndexBuffer;
+    addResource(&indexDesc, &mLoadToken);
+
+    pSubmeshBounds = (BoundingBox*)tf_malloc(sizeof(BoundingBox) * header.mDrawCount);
+    memcpy(pSubmeshBounds, scene.pBounds, sizeof(BoundingBox) * header.mDrawCount);
+    boundingBoxReset(&mBounds);
+    for (uint32_t i = 0; i < header.mDrawCount; ++i)
+    {
+        boundingBoxExpand(&mBounds, pSubmeshBounds[i].mMin);
+        boundingBoxExpand(&mBounds, pSubmeshBounds[i].mMax);
+    }
+
+    pMaterials = (CookedSceneMaterial*)tf_malloc(sizeof(CookedSceneMaterial) * header.mDrawCount);
+    memcpy(pMaterials, scene.pMaterials, sizeof(CookedSceneMaterial) * header.mDrawCount);
 
-    //waitForToken(&token);
-    waitForAllResourceLoads();
+    pSourcePositions = (const float*)scene.pVertexStreams[COOKED_SCENE_STREAM_POSITION];
+    pSourceIndices = scene.pIndices;
 
+    return true;
+}
+
+void CastleScene::closeCooked()
+{
+    // Closing the stream unmaps the file
+    if (mCookedStream.pIO)
+        fsCloseStream(&mCookedStream);
+    mCookedStream = {};
+    tf_free(pCookedCopy);
+    pCookedCopy = NULL;
+}
+
+void CastleScene::addPackedVertexBuffer()
+{
+    for (uint32_t i = 0; i < VERTEX_STREAM_COUNT; ++i)
+    {
+        const bool tangents = i == COOKED_SCENE_STREAM_TANGENT;
+        pVertexBuffers[i] = tangents ? pTangentBuffer : geom->pVertexBuffers[i];
+        mVertexStrides[i] = tangents ? gCookedSceneStrides[i] : geom->mVertexStrides[i];
+        mAttributeOffsets[i] = 0;
+    }
+    mVertexBufferCount = VERTEX_STREAM_COUNT;
+
+    if (mVertexFormat == CASTLE_VERTEX_FORMAT_FLOAT)
+        return;
+
+    // 16-bit steps across the bounds of the whole castle, so seam copies of a vertex still quantize alike
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const float extent = mBounds.mMax[i] - mBounds.mMin[i];
+        mPositionScale[i] = extent > FLT_EPSILON ? extent : 1.0f;
+        mPositionOffset[i] = mBounds.mMin[i];
+    }
+
+    // Positions alone, or the whole interleaved vertex
+    const uint32_t vertexSize = getVertexSize(mVertexFormat, true);
+    BufferLoadDesc packedDesc = {};
+    packedDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_BUFFER_RAW | DESCRIPTOR_TYPE_RW_BUFFER_RAW;
+    packedDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    packedDesc.mDesc.mStartState = RESOURCE_STATE_UNORDERED_ACCESS;
+    packedDesc.mDesc.mElementCount = geom->mVertexCount * vertexSize / sizeof(uint32_t);
+    packedDesc.mDesc.mStructStride = sizeof(uint32_t);
+    packedDesc.mDesc.mSize = (uint64_t)geom->mVertexCount * vertexSize;
+    packedDesc.mDesc.pName = "Castle packed vertices";
+    packedDesc.ppBuffer = &pPackedVertexBuffer;
+    addResource(&packedDesc, &mLoadToken);
+
+    pVertexBuffers[0] = pPackedVertexBuffer;
+    mVertexStrides[0] = vertexSize;
+    if (mVertexFormat == CASTLE_VERTEX_FORMAT_INTERLEAVED)
+    {
+        for (uint32_t i = 1; i < VERTEX_STREAM_COUNT; ++i)
+        {
+            pVertexBuffers[i] = pPackedVertexBuffer;
+            mVertexStrides[i] = vertexSize;
+        }
+        mAttributeOffsets[1] = 8;
+        mAttributeOffsets[2] = 12;
+        mAttributeOffsets[3] = 16;
+        mVertexBufferCount = 1;
+    }
+
+    LOGF(eINFO, "Castle vertex format %s: %u bytes per vertex, %u per position only vertex", getVertexFormatName(mVertexFormat),
+         getVertexSize(mVertexFormat, false), getVertexSize(mVertexFormat, true));
 }
 
 void CastleScene::Unload()
 {
-    removeResource(geom);
-    removeResource(geomData);
+    tf_free(pSubmeshBounds);
+    pSubmeshBounds = NULL;
+
+    removeResource(pMeshletBuffer);
+    removeResource(pMeshletIndexBuffer);
+    tf_free(pMeshlets);
+    pMeshlets = NULL;
+    mMeshletCount = 0;
+
+    if (pPackedVertexBuffer)
+        removeResource(pPackedVertexBuffer);
+    pPackedVertexBuffer = NULL;
+    removeResource(pTangentBuffer);
+    pTangentBuffer = NULL;
+    mVertexFormat = CASTLE_VERTEX_FORMAT_FLOAT;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        mPositionScale[i] = 1.0f;
+        mPositionOffset[i] = 0.0f;
+    }
+
+    removeResource(pLodStartBuffer);
+    tf_free(pLodDrawArgs);
+    pLodDrawArgs = NULL;
+    mLodCount = 1;
+
+    if (geomData)
+    {
+        removeResource(geom);
+        removeResource(geomData);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < geom->mVertexBufferCount; ++i)
+            removeResource(geom->pVertexBuffers[i]);
+        removeResource(geom->pIndexBuffer);
+        tf_free(geom);
+    }
+    geom = NULL;
+    geomData = NULL;
+    tf_free(pMaterials);
+    pMaterials = NULL;
+}
+
+void CastleScene::computeSubmeshBounds()
+{
+    pSubmeshBounds = (BoundingBox*)tf_calloc(geom->mDrawArgCount, sizeof(BoundingBox));
+
+    const uint8_t* positions = (const uint8_t*)pSourcePositions;
+    const uint32_t positionStride = sizeof(float) * 3;
+    const void* indices = pSourceIndices;
+    const bool indices16 = geom->mIndexType == INDEX_TYPE_UINT16;
+
+    for (uint32_t i = 0; i < geom->mDrawArgCount; ++i)
+    {
+        const IndirectDrawIndexArguments& args = geom->pDrawArgs[i];
+        BoundingBox& bounds = pSubmeshBounds[i];
+        boundingBoxReset(&bounds);
+
+        for (uint32_t j = 0; j < args.mIndexCount; ++j)
+        {
+            const uint32_t index = args.mStartIndex + j;
+            const uint32_t vertex = (indices16 ? ((const uint16_t*)indices)[index] : ((const uint32_t*)indices)[index]) + args.mVertexOffset;
+            boundingBoxExpand(&bounds, (const float*)(positions + vertex * positionStride));
+        }
+    }
+
+    boundingBoxReset(&mBounds);
+    for (uint32_t i = 0; i < geom->mDrawArgCount; ++i)
+    {
+        boundingBoxExpand(&mBounds, pSubmeshBounds[i].mMin);
+        boundingBoxExpand(&mBounds, pSubmeshBounds[i].mMax);
+    }
+}
+
+void CastleScene::buildMeshlets(uint32_t* pOutRebasedIndices)
+{
+    const float* positions = pSourcePositions;
+    const uint32_t positionStride = sizeof(float) * 3;
+    const void* indices = pSourceIndices;
+    const bool indices16 = geom->mIndexType == INDEX_TYPE_UINT16;
+
+    uint32_t maxMeshlets = 0;
+    for (uint32_t i = 0; i < geom->mDrawArgCount; ++i)
+        maxMeshlets += meshletBuildBound(geom->pDrawArgs[i].mIndexCount / 3);
+
+    pMeshlets = (Meshlet*)tf_calloc(maxMeshlets, sizeof(Meshlet));
+
+    // Meshlets keep the triangle order, so the meshlet index buffer is the castle index buffer widened and rebased
+    mMeshletCount = 0;
+    for (uint32_t i = 0; i < geom->mDrawArgCount; ++i)
+    {
+        const IndirectDrawIndexArguments& args = geom->pDrawArgs[i];
+        uint32_t* drawIndices = pOutRebasedIndices + args.mStartIndex;
+        for (uint32_t j = 0; j < args.mIndexCount; ++j)
+        {
+            const uint32_t index = args.mStartIndex + j;
+            drawIndices[j] = (indices16 ? ((const uint16_t*)indices)[index] : ((const uint32_t*)indices)[index]) + args.mVertexOffset;
+        }
+
+        mMeshletCount += meshletBuild(drawIndices, args.mIndexCount, positions, positionStride, i, args.mStartIndex, pMeshlets + mMeshletCount);
+    }
+
+    BufferLoadDesc meshletDesc = {};
+    meshletDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    meshletDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    meshletDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    meshletDesc.mDesc.mElementCount = mMeshletCount;
+    meshletDesc.mDesc.mStructStride = sizeof(Meshlet);
+    meshletDesc.mDesc.mSize = sizeof(Meshlet) * mMeshletCount;
+    meshletDesc.mDesc.pName = "Castle meshlets";
+    meshletDesc.pData = pMeshlets;
+    meshletDesc.ppBuffer = &pMeshletBuffer;
+    addResource(&meshletDesc, &mLoadToken);
+}
+
+void CastleScene::buildTangents(const uint32_t* pRebasedIndices)
+{
+    // The way KokkuSceneCooker generates them for castle.kscene, from the castle.bin shadow copy. It holds the
+    // attributes in the formats of the layout they were loaded with.
+    const uint32_t vertexCount = geom->mVertexCount;
+    const uint32_t* packedNormals = (const uint32_t*)geomData->pShadow->pAttributes[SEMANTIC_NORMAL];
+    const uint32_t* packedUVs = (const uint32_t*)geomData->pShadow->pAttributes[SEMANTIC_TEXCOORD0];
+
+    float* normals = (float*)tf_malloc(sizeof(float) * 3 * vertexCount);
+    float* uvs = (float*)tf_malloc(sizeof(float) * 2 * vertexCount);
+    float* tangents = (float*)tf_malloc(sizeof(float) * 4 * vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        decodeNormal(packedNormals[i], normals + i * 3);
+        uvs[i * 2 + 0] = halfToFloat((uint16_t)(packedUVs[i] & 0xFFFF));
+        uvs[i * 2 + 1] = halfToFloat((uint16_t)(packedUVs[i] >> 16));
+    }
+    tangentsGenerate(pRebasedIndices, geom->mIndexCount, pSourcePositions, normals, uvs, vertexCount, tangents);
+
+    uint32_t* packedTangents = (uint32_t*)tf_malloc(sizeof(uint32_t) * vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+        packedTangents[i] = tangentEncode(tangents + i * 4);
+
+    // Same usage as the streams of geom
+    BufferLoadDesc tangentDesc = {};
+    tangentDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_BUFFER_RAW;
+    tangentDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    tangentDesc.mDesc.mStartState = RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+    tangentDesc.mDesc.mElementCount = vertexCount;
+    tangentDesc.mDesc.mStructStride = sizeof(uint32_t);
+    tangentDesc.mDesc.mSize = sizeof(uint32_t) * vertexCount;
+    tangentDesc.mDesc.pName = "Castle tangents";
+    tangentDesc.pData = packedTangents;
+    tangentDesc.ppBuffer = &pTangentBuffer;
+    addResource(&tangentDesc, &mLoadToken);
+
+    // castle.bin is the slow path already, the wait keeps the tangents local
+    waitForToken(&mLoadToken);
+    tf_free(packedTangents);
+    tf_free(tangents);
+    tf_free(uvs);
+    tf_free(normals);
+}
+
+void CastleScene::buildLods(const uint32_t* pRebasedIndices)
+{
+    const float* positions = pSourcePositions;
+    const uint32_t positionStride = sizeof(float) * 3;
+    const uint32_t drawCount = geom->mDrawArgCount;
+
+    // The levels aim at half of the one before, so twice LOD 0 usually holds the whole chain. It grows when a draw
+    // simplifies less, before each level by the room meshSimplify needs for its output.
+    uint32_t indexCapacity = geom->mIndexCount * 2;
+    uint32_t* indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * indexCapacity);
+    memcpy(indices, pRebasedIndices, sizeof(uint32_t) * geom->mIndexCount);
+    uint32_t indexCount = geom->mIndexCount;
+
+    pLodDrawArgs = (IndirectDrawIndexArguments*)tf_calloc(drawCount * MAX_LODS, sizeof(IndirectDrawIndexArguments));
+    float* drawErrors = (float*)tf_calloc(drawCount * MAX_LODS, sizeof(float));
+    uint32_t* drawLodCounts = (uint32_t*)tf_calloc(drawCount, sizeof(uint32_t));
+
+    mLodCount = 1;
+    for (uint32_t i = 0; i < drawCount; ++i)
+    {
+        IndirectDrawIndexArguments* args = pLodDrawArgs + i * MAX_LODS;
+        args[0] = { geom->pDrawArgs[i].mIndexCount, 1, geom->pDrawArgs[i].mStartIndex, 0, 0 };
+
+        // Each level simplifies the one before and adds its error on top, which bounds the distance to LOD 0
+        uint32_t lod = 1;
+        for (; lod < MAX_LODS; ++lod)
+        {
+            const IndirectDrawIndexArguments& prev = args[lod - 1];
+            if (indexCount + prev.mIndexCount > indexCapacity)
+            {
+                indexCapacity = indexCapacity * 2 > indexCount + prev.mIndexCount ? indexCapacity * 2 : indexCount + prev.mIndexCount;
+                indices = (uint32_t*)tf_realloc(indices, sizeof(uint32_t) * indexCapacity);
+            }
+            float error = 0.0f;
+            const uint32_t count = meshSimplify(indices + prev.mStartIndex, prev.mIndexCount, positions, positionStride, geom->mVertexCount,
+                                                prev.mIndexCount / 2, FLT_MAX, indices + indexCount, &error);
+            if (count == 0 || count > prev.mIndexCount / 10 * 9)
+                break;
+
+            args[lod] = { count, 1, indexCount, 0, 0 };
+            drawErrors[i * MAX_LODS + lod] = drawErrors[i * MAX_LODS + lod - 1] + error;
+            indexCount += count;
+        }
+        drawLodCounts[i] = lod;
+        mLodCount = lod > mLodCount ? lod : mLodCount;
+    }
+
+    uint32_t* lodStarts = (uint32_t*)tf_calloc(drawCount * MAX_LODS, sizeof(uint32_t));
+    for (uint32_t lod = 0; lod < mLodCount; ++lod)
+    {
+        mLodErrors[lod] = 0.0f;
+        mLodTriangleCounts[lod] = 0;
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            const uint32_t last = drawLodCounts[i] - 1;
+            if (lod > last)
+            {
+                pLodDrawArgs[i * MAX_LODS + lod] = pLodDrawArgs[i * MAX_LODS + last];
+                drawErrors[i * MAX_LODS + lod] = drawErrors[i * MAX_LODS + last];
+            }
+            mLodErrors[lod] = fmaxf(mLodErrors[lod], drawErrors[i * MAX_LODS + lod]);
+            mLodTriangleCounts[lod] += pLodDrawArgs[i * MAX_LODS + lod].mIndexCount / 3;
+            lodStarts[i * MAX_LODS + lod] = pLodDrawArgs[i * MAX_LODS + lod].mStartIndex;
+        }
+        LOGF(eINFO, "Castle LOD %u: %u triangles, error %.4f", lod, mLodTriangleCounts[lod], mLodErrors[lod]);
+    }
+
+    BufferLoadDesc indexDesc = {};
+    indexDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_INDEX_BUFFER;
+    indexDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    indexDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE | RESOURCE_STATE_INDEX_BUFFER;
+    indexDesc.mDesc.mElementCount = indexCount;
+    indexDesc.mDesc.mStructStride = sizeof(uint32_t);
+    indexDesc.mDesc.mSize = sizeof(uint32_t) * indexCount;
+    indexDesc.mDesc.pName = "Castle meshlet and LOD indices";
+    indexDesc.pData = indices;
+    indexDesc.ppBuffer = &pMeshletIndexBuffer;
+    addResource(&indexDesc, &mLoadToken);
+
+    BufferLoadDesc startDesc = {};
+    startDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    startDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    startDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    startDesc.mDesc.mElementCount = drawCount * MAX_LODS;
+    startDesc.mDesc.mStructStride = sizeof(uint32_t);
+    startDesc.mDesc.mSize = sizeof(uint32_t) * drawCount * MAX_LODS;
+    startDesc.mDesc.pName = "Castle LOD start indices";
+    startDesc.pData = lodStarts;
+    startDesc.ppBuffer = &pLodStartBuffer;
+    addResource(&startDesc, &mLoadToken);
+
+    // Also covers the geometry, packed vertex and meshlet uploads before Load closes the cooked file
+    waitForToken(&mLoadToken);
+    tf_free(lodStarts);
+    tf_free(drawLodCounts);
+    tf_free(drawErrors);
+    tf_free(indices);
 }
@@ -1,19 +1,167 @@
 #pragma once
 #include <Graphics/Interfaces/IGraphics.h>
 #include <Resources/ResourceLoader/Interfaces/IResourceLoader.h>
+#include <Utilities/Interfaces/IFileSystem.h>
+
+#include "CookedScene.h"
+#include "Culling.h"
+#include "Meshlets.h"
 
 // Type definitions
 
+// Castle vertex stream layouts, picked at load time. The quantized layouts store positions as 16-bit UNORM
+// relative to the castle bounds, getPositionScale()/getPositionOffset() map them back to object space.
+enum CastleVertexFormat
+{
+    // float3 position, R16G16_UNORM octahedral normal, R16G16_SFLOAT uv and R8G8B8A8_SNORM tangent (w = bitangent
+    // sign) in four streams, 24 bytes per vertex
+    CASTLE_VERTEX_FORMAT_FLOAT,
+    // R16G16B16A16_UNORM position, normal, uv and tangent streams as above, 20 bytes per vertex
+    CASTLE_VERTEX_FORMAT_QUANTIZED,
+    // The quantized position, normal, uv and tangent interleaved in a single 20 byte stream
+    CASTLE_VERTEX_FORMAT_INTERLEAVED,
+    CASTLE_VERTEX_FORMAT_COUNT
+};
+
+// File the castle geometry is read from
+enum CastleSceneFormat
+{
+    // castle.bin through The-Forge's geometry loader (AssetPipelineCMD output)
+    CASTLE_SCENE_FORMAT_BIN,
+    // castle.kscene memory mapped and uploaded blob by blob, falls back to castle.bin when missing or stale
+    CASTLE_SCENE_FORMAT_COOKED,
+    CASTLE_SCENE_FORMAT_COUNT
+};
+
 class CastleScene
 {
+public:
+    // Length of the LOD chain, LOD 0 included. Must match CASTLE_MAX_LODS in visibilityResolve.frag
+    static const uint32_t MAX_LODS = 8;
+    // Position, normal, uv and tangent
+    static const uint32_t VERTEX_STREAM_COUNT = 4;
+
 private:
-    Geometry* geom;
-    GeometryData* geomData;
+    Geometry* geom = NULL;
+    // NULL for the cooked format, whose geom and buffers CastleScene owns itself
+    GeometryData* geomData = NULL;
+    CastleSceneFormat mSceneFormat = CASTLE_SCENE_FORMAT_BIN;
+    const char* pCookedFileName = NULL;
+
+    // CPU positions (float3) and indices of geom while loading: the castle.bin shadow copy or the mapped castle.kscene
+    const float* pSourcePositions = NULL;
+    const void* pSourceIndices = NULL;
+    // Kept open until Load is done with the blobs, pCookedCopy only when the file could not be mapped
+    FileStream mCookedStream = {};
+    void* pCookedCopy = NULL;
+    // Every resource the scene adds, Load only waits on its own uploads so it can run next to other loads
+    SyncToken mLoadToken = {};
+    // Texture names of each draw, NULL for castle.bin which has none
+    CookedSceneMaterial* pMaterials = NULL;
+
+    // Duration of the last Load: file to GPU buffers, and the bounds, meshlets and LODs built from it
+    float mGeometryLoadMs = 0.0f;
+    float mBuildMs = 0.0f;
+
+    // The streams the castle is drawn with. geom always holds the float position, normal and uv streams and
+    // pTangentBuffer the tangents, castle.bin has none so they are generated at load. The quantized layouts draw from
+    // pPackedVertexBuffer, which the app fills from them once with castleVertexPack.comp. The interleaved layout
+    // repeats its single stream in every slot so the visibility resolve finds each attribute at its offset.
+    CastleVertexFormat mVertexFormat = CASTLE_VERTEX_FORMAT_FLOAT;
+    Buffer* pTangentBuffer = NULL;
+    Buffer* pPackedVertexBuffer = NULL;
+    Buffer* pVertexBuffers[VERTEX_STREAM_COUNT] = {};
+    uint32_t mVertexStrides[VERTEX_STREAM_COUNT] = {};
+    uint32_t mAttributeOffsets[VERTEX_STREAM_COUNT] = {};
+    uint32_t mVertexBufferCount = 0;
+    // Object space position = offset + scale * stored position, identity for the float layout
+    float mPositionScale[3] = { 1.0f, 1.0f, 1.0f };
+    float mPositionOffset[3] = {};
+
+    // Object space bounds of each draw arg, built from the shadow copy at load time
+    BoundingBox* pSubmeshBounds = NULL;
+    // Union of the submesh bounds
+    BoundingBox mBounds = {};
+
+    // Meshlets of all draws, CPU copy for the reference culling and GPU buffers for meshletCull.comp.
+    // The meshlet index buffer holds 32-bit indices already rebased with each draw's mVertexOffset: the castle
+    // index buffer first (LOD 0, which the meshlets index), then the simplified LODs.
+    Meshlet* pMeshlets = NULL;
+    uint32_t mMeshletCount = 0;
+    Buffer* pMeshletBuffer = NULL;
+    Buffer* pMeshletIndexBuffer = NULL;
+
+    // LOD chain of every draw, [draw * MAX_LODS + lod] into the meshlet index buffer with a zero vertex offset.
+    // Each level halves the one before, draws with a shorter chain repeat their last level up to mLodCount.
+    uint32_t mLodCount = 1;
+    IndirectDrawIndexArguments* pLodDrawArgs = NULL;
+    // Object space error of each level over all draws, the largest distance the surface moved from LOD 0
+    float mLodErrors[MAX_LODS] = {};
+    uint32_t mLodTriangleCounts[MAX_LODS] = {};
+    // The mStartIndex of every pLodDrawArgs entry, the visibility resolve finds its triangles with it
+    Buffer* pLodStartBuffer = NULL;
+
+    void loadBin(const GeometryLoadDesc* pTemplate);
+    bool loadCooked();
+    void closeCooked();
+    void computeSubmeshBounds();
+    void buildMeshlets(uint32_t* pOutRebasedIndices);
+    void buildLods(const uint32_t* pRebasedIndices);
+    void buildTangents(const uint32_t* pRebasedIndices);
+    void addPackedVertexBuffer();
 
 public:
+    // The single declaration of the castle vertex layouts. Position only layouts feed the visibility buffer and
+    // depth prepass, they bind the first stream alone.
+    static void getVertexLayout(CastleVertexFormat format, bool positionsOnly, VertexLayout* pOutLayout);
+    static const char* getVertexFormatName(CastleVertexFormat format);
+    // Bytes fetched per vertex by the full and the position only layout
+    static uint32_t getVertexSize(CastleVertexFormat format, bool positionsOnly);
+    static const char* getSceneFormatName(CastleSceneFormat format);
+    // File name inside RD_MESHES
+    static const char* getSceneFileName(CastleSceneFormat format);
+
     Geometry* getGeometry() { return geom; }
+    // The format actually loaded, after any fallback
+    CastleSceneFormat getSceneFormat() const { return mSceneFormat; }
+    // Cooked file inside RD_MESHES loaded in place of castle.kscene, such as a KokkuMeshCooker --synthetic grid.
+    // NULL for castle.kscene. Set before Load, the string has to outlive the scene.
+    void setCookedFileName(const char* pFileName) { pCookedFileName = pFileName; }
+    // The file actually loaded, after any fallback
+    const char* getFileName() const
+    {
+        return mSceneFormat == CASTLE_SCENE_FORMAT_COOKED && pCookedFileName ? pCookedFileName : getSceneFileName(mSceneFormat);
+    }
+    const CookedSceneMaterial* getMaterials() const { return pMaterials; }
+    float getGeometryLoadMs() const { return mGeometryLoadMs; }
+    float getBuildMs() const { return mBuildMs; }
+    const BoundingBox* getSubmeshBounds() const { return pSubmeshBounds; }
+    const BoundingBox& getBounds() const { return mBounds; }
+
+    const Meshlet* getMeshlets() const { return pMeshlets; }
+    uint32_t getMeshletCount() const { return mMeshletCount; }
+    Buffer* getMeshletBuffer() { return pMeshletBuffer; }
+    Buffer* getMeshletIndexBuffer() { return pMeshletIndexBuffer; }
+
+    uint32_t getLodCount() const { return mLodCount; }
+    const IndirectDrawIndexArguments& getLodDrawArgs(uint32_t draw, uint32_t lod) const { return pLodDrawArgs[draw * MAX_LODS + lod]; }
+    float getLodError(uint32_t lod) const { return mLodErrors[lod]; }
+    uint32_t getLodTriangleCount(uint32_t lod) const { return mLodTriangleCounts[lod]; }
+    Buffer* getLodStartBuffer() { return pLodStartBuffer; }
 
-    void Load(const GeometryLoadDesc* pTemplate, bool transparentFlags);
+    CastleVertexFormat getVertexFormat() const { return mVertexFormat; }
+    // NULL for the float layout, otherwise written by castleVertexPack.comp before the first draw
+    Buffer* getPackedVertexBuffer() { return pPackedVertexBuffer; }
+    uint32_t getVertexBufferCount(bool positionsOnly) const { return positionsOnly ? 1 : mVertexBufferCount; }
+    // Tangent stream of the float layout, a source of the packed layouts like geom's streams
+    Buffer* getTangentBuffer() { return pTangentBuffer; }
+    // Position, normal, uv and tangent stream, with their byte strides and offsets
+    Buffer** getVertexBuffers() { return pVertexBuffers; }
+    const uint32_t* getVertexStrides() const { return mVertexStrides; }
+    const uint32_t* getAttributeOffsets() const { return mAttributeOffsets; }
+    const float* getPositionScale() const { return mPositionScale; }
+    const float* getPositionOffset() const { return mPositionOffset; }
+
+    void Load(const GeometryLoadDesc* pTemplate, bool transparentFlags, CastleVertexFormat vertexFormat, CastleSceneFormat sceneFormat);
     void Unload();
 };
-
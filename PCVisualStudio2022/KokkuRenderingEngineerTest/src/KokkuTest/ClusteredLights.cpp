@@ -0,0 +1,259 @@
+#include "ClusteredLights.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CLUSTER_SSE2 1
+#endif
+
+// Screen and depth mapping shared by both range paths
+struct ClusterMapping
+{
+    // tile = ndc * scale + bias, y flipped so tile row 0 is the top of the screen
+    float mTileScale[2];
+    float mTileBias[2];
+    // Far end of slices 0 to CLUSTER_SLICES - 2, a depth's slice is the number of these it is past
+    float mSliceEnds[CLUSTER_SLICES - 1];
+};
+
+void clusterShaderParams(const ClusterCamera* pCamera, ClusterShaderParams* pOutParams)
+{
+    const uint32_t tileWidth = (pCamera->mWidth + CLUSTER_TILES_X - 1) / CLUSTER_TILES_X;
+    const uint32_t tileHeight = (pCamera->mHeight + CLUSTER_TILES_Y - 1) / CLUSTER_TILES_Y;
+    pOutParams->mInvTileSize[0] = 1.0f / (float)tileWidth;
+    pOutParams->mInvTileSize[1] = 1.0f / (float)tileHeight;
+
+    // Exponential slices: the same depth ratio from one slice to the next
+    pOutParams->mSliceScale = (float)CLUSTER_SLICES / logf(pCamera->mFar / pCamera->mNear);
+    pOutParams->mSliceBias = -logf(pCamera->mNear) * pOutParams->mSliceScale;
+}
+
+static void clusterMapping(const ClusterCamera* pCamera, ClusterMapping* pOutMapping)
+{
+    ClusterShaderParams params;
+    clusterShaderParams(pCamera, &params);
+
+    // Pixels from NDC, then tiles from pixels like the shader does
+    pOutMapping->mTileScale[0] = 0.5f * (float)pCamera->mWidth * params.mInvTileSize[0];
+    pOutMapping->mTileBias[0] = pOutMapping->mTileScale[0];
+    pOutMapping->mTileScale[1] = -0.5f * (float)pCamera->mHeight * params.mInvTileSize[1];
+    pOutMapping->mTileBias[1] = -pOutMapping->mTileScale[1];
+
+    // Inverse of the shader's log mapping, so both agree on where the slices end
+    for (uint32_t i = 0; i < CLUSTER_SLICES - 1; ++i)
+        pOutMapping->mSliceEnds[i] = expf(((float)(i + 1) - params.mSliceBias) / params.mSliceScale);
+}
+
+static float clampTile(float tile, float maxTile) { return tile < 0.0f ? 0.0f : (tile > maxTile ? maxTile : tile); }
+
+static void lightRangeScalar(const ClusterCamera* pCamera, const ClusterMapping* pMapping, const PointLight* pLight, uint8_t* pOutRange,
+                             uint8_t* pOutVisible)
+{
+    const float* m = pCamera->mView;
+    const float* p = pLight->mPosition;
+    const float  r = pLight->mRadius;
+    // Same operations in the same order as the SSE2 loop, so both give the same ranges to the bit
+    const float  vx = (m[0] * p[0] + m[4] * p[1]) + (m[8] * p[2] + m[12]);
+    const float  vy = (m[1] * p[0] + m[5] * p[1]) + (m[9] * p[2] + m[13]);
+    const float  vz = (m[2] * p[0] + m[6] * p[1]) + (m[10] * p[2] + m[14]);
+
+    // The view space box of the sphere, cut to the depth range
+    const float zNear = fmaxf(vz - r, pCamera->mNear);
+    const float zFar = fminf(vz + r, pCamera->mFar);
+    const float invZNear = 1.0f / zNear;
+    const float invZFar = 1.0f / zFar;
+
+    // Its NDC extent: each side is widest at one of the two depths
+    const float xMin = fminf((vx - r) * invZNear, (vx - r) * invZFar) * pCamera->mProjScale[0];
+    const float xMax = fmaxf((vx + r) * invZNear, (vx + r) * invZFar) * pCamera->mProjScale[0];
+    const float yMin = fminf((vy - r) * invZNear, (vy - r) * invZFar) * pCamera->mProjScale[1];
+    const float yMax = fmaxf((vy + r) * invZNear, (vy + r) * invZFar) * pCamera->mProjScale[1];
+
+    const float tileXMin = xMin * pMapping->mTileScale[0] + pMapping->mTileBias[0];
+    const float tileXMax = xMax * pMapping->mTileScale[0] + pMapping->mTileBias[0];
+    // The y mapping flips, the top of the box is the first tile row
+    const float tileYMin = yMax * pMapping->mTileScale[1] + pMapping->mTileBias[1];
+    const float tileYMax = yMin * pMapping->mTileScale[1] + pMapping->mTileBias[1];
+
+    *pOutVisible = zNear < zFar && tileXMax >= 0.0f && tileXMin < (float)CLUSTER_TILES_X && tileYMax >= 0.0f &&
+                   tileYMin < (float)CLUSTER_TILES_Y;
+
+    uint8_t sliceMin = 0;
+    uint8_t sliceMax = 0;
+    for (uint32_t i = 0; i < CLUSTER_SLICES - 1; ++i)
+    {
+        sliceMin += zNear >= pMapping->mSliceEnds[i];
+        sliceMax += zFar >= pMapping->mSliceEnds[i];
+    }
+
+    pOutRange[0] = (uint8_t)clampTile(tileXMin, CLUSTER_TILES_X - 1);
+    pOutRange[1] = (uint8_t)clampTile(tileXMax, CLUSTER_TILES_X - 1);
+    pOutRange[2] = (uint8_t)clampTile(tileYMin, CLUSTER_TILES_Y - 1);
+    pOutRange[3] = (uint8_t)clampTile(tileYMax, CLUSTER_TILES_Y - 1);
+    pOutRange[4] = sliceMin;
+    pOutRange[5] = sliceMax;
+}
+
+void clusterLightRangesScalar(const ClusterCamera* pCamera, const PointLight* pLights, uint32_t firstLight, uint32_t lightCount,
+                              ClusterBinScratch* pScratch)
+{
+    ClusterMapping mapping;
+    clusterMapping(pCamera, &mapping);
+
+    for (uint32_t i = firstLight; i < firstLight + lightCount; ++i)
+        lightRangeScalar(pCamera, &mapping, &pLights[i], pScratch->mRanges[i], &pScratch->mVisible[i]);
+}
+
+#if defined(CLUSTER_SSE2)
+static __m128 clampTile4(__m128 tile, float maxTile) { return _mm_min_ps(_mm_max_ps(tile, _mm_setzero_ps()), _mm_set1_ps(maxTile)); }
+#endif
+
+void clusterLightRanges(const ClusterCamera* pCamera, const PointLight* pLights, uint32_t lightCount, ClusterBinScratch* pScratch)
+{
+    uint32_t first = 0;
+#if defined(CLUSTER_SSE2)
+    ClusterMapping mapping;
+    clusterMapping(pCamera, &mapping);
+
+    const float* m = pCamera->mView;
+    const __m128 nearPlane = _mm_set1_ps(pCamera->mNear);
+    const __m128 farPlane = _mm_set1_ps(pCamera->mFar);
+    const __m128 projScaleX = _mm_set1_ps(pCamera->mProjScale[0]);
+    const __m128 projScaleY = _mm_set1_ps(pCamera->mProjScale[1]);
+    const __m128 tileScaleX = _mm_set1_ps(mapping.mTileScale[0]);
+    const __m128 tileBiasX = _mm_set1_ps(mapping.mTileBias[0]);
+    const __m128 tileScaleY = _mm_set1_ps(mapping.mTileScale[1]);
+    const __m128 tileBiasY = _mm_set1_ps(mapping.mTileBias[1]);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; first + 4 <= lightCount; first += 4)
+    {
+        // Position and radius of 4 lights, transposed to x, y, z, r
+        __m128 px = _mm_loadu_ps(pLights[first + 0].mPosition);
+        __m128 py = _mm_loadu_ps(pLights[first + 1].mPosition);
+        __m128 pz = _mm_loadu_ps(pLights[first + 2].mPosition);
+        __m128 r = _mm_loadu_ps(pLights[first + 3].mPosition);
+        _MM_TRANSPOSE4_PS(px, py, pz, r);
+
+        const __m128 vx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), px), _mm_mul_ps(_mm_set1_ps(m[4]), py)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8]), pz), _mm_set1_ps(m[12])));
+        const __m128 vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1]), px), _mm_mul_ps(_mm_set1_ps(m[5]), py)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[9]), pz), _mm_set1_ps(m[13])));
+        const __m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), px), _mm_mul_ps(_mm_set1_ps(m[6]), py)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[10]), pz), _mm_set1_ps(m[14])));
+
+        const __m128 zNear = _mm_max_ps(_mm_sub_ps(vz, r), nearPlane);
+        const __m128 zFar = _mm_min_ps(_mm_add_ps(vz, r), farPlane);
+        const __m128 invZNear = _mm_div_ps(one, zNear);
+        const __m128 invZFar = _mm_div_ps(one, zFar);
+
+        const __m128 left = _mm_sub_ps(vx, r);
+        const __m128 right = _mm_add_ps(vx, r);
+        const __m128 bottom = _mm_sub_ps(vy, r);
+        const __m128 top = _mm_add_ps(vy, r);
+        const __m128 xMin = _mm_mul_ps(_mm_min_ps(_mm_mul_ps(left, invZNear), _mm_mul_ps(left, invZFar)), projScaleX);
+        const __m128 xMax = _mm_mul_ps(_mm_max_ps(_mm_mul_ps(right, invZNear), _mm_mul_ps(right, invZFar)), projScaleX);
+        const __m128 yMin = _mm_mul_ps(_mm_min_ps(_mm_mul_ps(bottom, invZNear), _mm_mul_ps(bottom, invZFar)), projScaleY);
+        const __m128 yMax = _mm_mul_ps(_mm_max_ps(_mm_mul_ps(top, invZNear), _mm_mul_ps(top, invZFar)), projScaleY);
+
+        const __m128 tileXMin = _mm_add_ps(_mm_mul_ps(xMin, tileScaleX), tileBiasX);
+        const __m128 tileXMax = _mm_add_ps(_mm_mul_ps(xMax, tileScaleX), tileBiasX);
+        const __m128 tileYMin = _mm_add_ps(_mm_mul_ps(yMax, tileScaleY), tileBiasY);
+        const __m128 tileYMax = _mm_add_ps(_mm_mul_ps(yMin, tileScaleY), tileBiasY);
+
+        __m128 visible = _mm_cmplt_ps(zNear, zFar);
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(tileXMax, _mm_setzero_ps()));
+        visible = _mm_and_ps(visible, _mm_cmplt_ps(tileXMin, _mm_set1_ps((float)CLUSTER_TILES_X)));
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(tileYMax, _mm_setzero_ps()));
+        visible = _mm_and_ps(visible, _mm_cmplt_ps(tileYMin, _mm_set1_ps((float)CLUSTER_TILES_Y)));
+        const int visibleMask = _mm_movemask_ps(visible);
+
+        // Compare masks are -1, so subtracting them counts the slice ends each depth is past
+        __m128i sliceMin = _mm_setzero_si128();
+        __m128i sliceMax = _mm_setzero_si128();
+        for (uint32_t i = 0; i < CLUSTER_SLICES - 1; ++i)
+        {
+            const __m128 sliceEnd = _mm_set1_ps(mapping.mSliceEnds[i]);
+            sliceMin = _mm_sub_epi32(sliceMin, _mm_castps_si128(_mm_cmpge_ps(zNear, sliceEnd)));
+            sliceMax = _mm_sub_epi32(sliceMax, _mm_castps_si128(_mm_cmpge_ps(zFar, sliceEnd)));
+        }
+
+        // Clamped to the grid the truncating conversion is a floor
+        int32_t ranges[6][4];
+        _mm_storeu_si128((__m128i*)ranges[0], _mm_cvttps_epi32(clampTile4(tileXMin, CLUSTER_TILES_X - 1)));
+        _mm_storeu_si128((__m128i*)ranges[1], _mm_cvttps_epi32(clampTile4(tileXMax, CLUSTER_TILES_X - 1)));
+        _mm_storeu_si128((__m128i*)ranges[2], _mm_cvttps_epi32(clampTile4(tileYMin, CLUSTER_TILES_Y - 1)));
+        _mm_storeu_si128((__m128i*)ranges[3], _mm_cvttps_epi32(clampTile4(tileYMax, CLUSTER_TILES_Y - 1)));
+        _mm_storeu_si128((__m128i*)ranges[4], sliceMin);
+        _mm_storeu_si128((__m128i*)ranges[5], sliceMax);
+
+        for (uint32_t l = 0; l < 4; ++l)
+        {
+            for (uint32_t i = 0; i < 6; ++i)
+                pScratch->mRanges[first + l][i] = (uint8_t)ranges[i][l];
+            pScratch->mVisible[first + l] = (visibleMask >> l) & 1;
+        }
+    }
+#endif
+
+    clusterLightRangesScalar(pCamera, pLights, first, lightCount - first, pScratch);
+}
+
+void clusterScatterLights(uint32_t lightCount, ClusterBinScratch* pScratch, uint32_t* pOutClusters, uint32_t* pOutIndices,
+                          ClusterBinStats* pOutStats)
+{
+    memset(pScratch->mCounts, 0, sizeof(pScratch->mCounts));
+    memset(pScratch->mWritten, 0, sizeof(pScratch->mWritten));
+
+    pOutStats->mVisibleLights = 0;
+    for (uint32_t l = 0; l < lightCount; ++l)
+    {
+        if (!pScratch->mVisible[l])
+            continue;
+
+        ++pOutStats->mVisibleLights;
+        const uint8_t* range = pScratch->mRanges[l];
+        for (uint32_t z = range[4]; z <= range[5]; ++z)
+            for (uint32_t y = range[2]; y <= range[3]; ++y)
+                for (uint32_t x = range[0]; x <= range[1]; ++x)
+                    ++pScratch->mCounts[(z * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x];
+    }
+
+    // Clusters past the index budget keep what still fits
+    uint32_t offset = 0;
+    pOutStats->mDroppedIndices = 0;
+    for (uint32_t c = 0; c < CLUSTER_COUNT; ++c)
+    {
+        const uint32_t space = CLUSTER_MAX_LIGHT_INDICES - offset;
+        const uint32_t count = pScratch->mCounts[c] < space ? pScratch->mCounts[c] : space;
+        pOutStats->mDroppedIndices += pScratch->mCounts[c] - count;
+        pScratch->mCounts[c] = count;
+        pScratch->mOffsets[c] = offset;
+        pOutClusters[c * 2 + 0] = offset;
+        pOutClusters[c * 2 + 1] = count;
+        offset += count;
+    }
+    pOutStats->mIndexCount = offset;
+
+    // Same walk again, lights go in ascending order within each cluster
+    for (uint32_t l = 0; l < lightCount; ++l)
+    {
+        if (!pScratch->mVisible[l])
+            continue;
+
+        const uint8_t* range = pScratch->mRanges[l];
+        for (uint32_t z = range[4]; z <= range[5]; ++z)
+            for (uint32_t y = range[2]; y <= range[3]; ++y)
+                for (uint32_t x = range[0]; x <= range[1]; ++x)
+                {
+                    const uint32_t c = (z * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x;
+                    if (pScratch->mWritten[c] < pScratch->mCounts[c])
+                        pScratch->mIndices[pScratch->mOffsets[c] + pScratch->mWritten[c]++] = l;
+                }
+    }
+
+    // The scatter above stays in cached memory, the GPU buffer gets one linear copy
+    memcpy(pOutIndices, pScratch->mIndices, offset * sizeof(uint32_t));
+}
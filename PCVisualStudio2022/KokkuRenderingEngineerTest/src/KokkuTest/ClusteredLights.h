@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+
+// CPU light binning for clustered forward shading. The view frustum is split into CLUSTER_TILES_X x CLUSTER_TILES_Y
+// screen tiles and CLUSTER_SLICES exponential depth slices, and every cluster gets the list of point lights whose
+// bounds overlap it. No renderer types here, like Culling.h.
+
+// Must match the defines in castleShading.h.fsl
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+
+#define CLUSTER_MAX_LIGHTS 4096
+// Lights past this many (cluster, light) pairs are dropped from the clusters that overflow
+#define CLUSTER_MAX_LIGHT_INDICES (256 * 1024)
+
+// Same layout as the lights buffer in castleShading.h.fsl: two float4 per light
+struct PointLight
+{
+    float mPosition[3];
+    float mRadius;
+    float mColor[3];
+    float mIntensity;
+};
+
+struct ClusterCamera
+{
+    // World to view, column-major like mat4. View space looks down +z.
+    float mView[16];
+    // Projection scale of view x and y, [0][0] and [1][1] of the projection matrix
+    float mProjScale[2];
+    float mNear;
+    float mFar;
+    uint32_t mWidth;
+    uint32_t mHeight;
+};
+
+// Constants the shader needs to find a pixel's cluster
+struct ClusterShaderParams
+{
+    // Pixel to tile
+    float mInvTileSize[2];
+    // slice = log(viewDepth) * mSliceScale + mSliceBias
+    float mSliceScale;
+    float mSliceBias;
+};
+
+struct ClusterBinStats
+{
+    uint32_t mVisibleLights;
+    uint32_t mIndexCount;
+    uint32_t mDroppedIndices;
+};
+
+// Working memory of the binning, large enough for CLUSTER_MAX_LIGHTS
+struct ClusterBinScratch
+{
+    // Inclusive cluster range of each light: min x, max x, min y, max y, min slice, max slice
+    uint8_t  mRanges[CLUSTER_MAX_LIGHTS][6];
+    uint8_t  mVisible[CLUSTER_MAX_LIGHTS];
+    uint32_t mCounts[CLUSTER_COUNT];
+    uint32_t mOffsets[CLUSTER_COUNT];
+    uint32_t mWritten[CLUSTER_COUNT];
+    uint32_t mIndices[CLUSTER_MAX_LIGHT_INDICES];
+};
+
+void clusterShaderParams(const ClusterCamera* pCamera, ClusterShaderParams* pOutParams);
+
+// Binning runs in two stages, so the cost of each can be timed on its own:
+// clusterLightRanges finds the cluster range of every light, 4 lights at a time with SSE2 where available.
+void clusterLightRanges(const ClusterCamera* pCamera, const PointLight* pLights, uint32_t lightCount, ClusterBinScratch* pScratch);
+
+// Scalar version of clusterLightRanges for lights [firstLight, firstLight + lightCount). Takes the lights the SIMD
+// loop leaves over and is its reference.
+void clusterLightRangesScalar(const ClusterCamera* pCamera, const PointLight* pLights, uint32_t firstLight, uint32_t lightCount,
+                              ClusterBinScratch* pScratch);
+
+// clusterScatterLights fills pOutClusters with an (offset, count) pair per cluster into pOutIndices, which takes up
+// to CLUSTER_MAX_LIGHT_INDICES light indices. Both may be write-combined GPU memory, they are written once in order.
+// Cost grows with the number of (cluster, light) pairs, not with the screen resolution.
+void clusterScatterLights(uint32_t lightCount, ClusterBinScratch* pScratch, uint32_t* pOutClusters, uint32_t* pOutIndices,
+                          ClusterBinStats* pOutStats);
@@ -0,0 +1,58 @@
+#include "CookedScene.h"
+
+#include <string.h>
+
+// The blob lies inside the file, starts aligned and holds exactly expectedSize bytes
+static bool checkBlob(const CookedSceneBlob& blob, uint64_t fileSize, uint64_t expectedSize)
+{
+    return blob.mOffset % COOKED_SCENE_ALIGNMENT == 0 && blob.mSize == expectedSize && blob.mOffset <= fileSize &&
+           blob.mSize <= fileSize - blob.mOffset;
+}
+
+const char* cookedSceneParse(const void* pData, size_t size, CookedScene* pOut)
+{
+    memset(pOut, 0, sizeof(*pOut));
+
+    const uint8_t* bytes = (const uint8_t*)pData;
+    const CookedSceneHeader* header = (const CookedSceneHeader*)pData;
+    if (size < sizeof(CookedSceneHeader) || header->mMagic != COOKED_SCENE_MAGIC)
+        return "not a cooked scene";
+    if (header->mVersion != COOKED_SCENE_VERSION)
+        return "cooked scene version mismatch, re-run KokkuSceneCooker";
+    if (header->mFileSize != size)
+        return "cooked scene is truncated";
+    if (header->mIndexSize != 2 && header->mIndexSize != 4)
+        return "cooked scene has an unknown index size";
+
+    for (uint32_t i = 0; i < COOKED_SCENE_STREAM_COUNT; ++i)
+    {
+        if (!checkBlob(header->mVertexStreams[i], size, (uint64_t)header->mVertexCount * gCookedSceneStrides[i]))
+            return "cooked scene vertex stream out of bounds";
+        pOut->pVertexStreams[i] = bytes + header->mVertexStreams[i].mOffset;
+    }
+    if (!checkBlob(header->mIndices, size, (uint64_t)header->mIndexCount * header->mIndexSize) ||
+        !checkBlob(header->mDraws, size, (uint64_t)header->mDrawCount * sizeof(CookedSceneDraw)) ||
+        !checkBlob(header->mBounds, size, (uint64_t)header->mDrawCount * sizeof(CookedSceneBounds)) ||
+        !checkBlob(header->mMaterials, size, (uint64_t)header->mDrawCount * sizeof(CookedSceneMaterial)))
+        return "cooked scene blob out of bounds";
+
+    pOut->pHeader = header;
+    pOut->pIndices = bytes + header->mIndices.mOffset;
+    pOut->pDraws = (const CookedSceneDraw*)(bytes + header->mDraws.mOffset);
+    pOut->pBounds = (const CookedSceneBounds*)(bytes + header->mBounds.mOffset);
+    pOut->pMaterials = (const CookedSceneMaterial*)(bytes + header->mMaterials.mOffset);
+
+    // Only the draw ranges, the indices themselves are trusted like the ones in castle.bin
+    for (uint32_t i = 0; i < header->mDrawCount; ++i)
+    {
+        const CookedSceneDraw& draw = pOut->pDraws[i];
+        if ((uint64_t)draw.mStartIndex + draw.mIndexCount > header->mIndexCount || draw.mVertexOffset > header->mVertexCount)
+            return "cooked scene draw out of bounds";
+
+        const CookedSceneMaterial& material = pOut->pMaterials[i];
+        if (!memchr(material.mName, 0, COOKED_SCENE_NAME_SIZE) || !memchr(material.mAlbedo, 0, COOKED_SCENE_NAME_SIZE) ||
+            !memchr(material.mBump, 0, COOKED_SCENE_NAME_SIZE))
+            return "cooked scene material name not terminated";
+    }
+    return NULL;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// castle.kscene, the cooked castle written by KokkuSceneCooker. A header followed by blobs laid out the way the
+// GPU buffers want them, so the app memory maps the file and uploads every blob straight from the mapping.
+// No renderer types here, the cooker includes this header and checks its output with cookedSceneParse.
+//
+// Version 2 stores the CASTLE_VERTEX_FORMAT_FLOAT streams: float3 positions, R16G16_UNORM octahedral normals,
+// R16G16_SFLOAT uvs and R8G8B8A8_SNORM tangents (see Tangents.h), each in its own blob. Bump the version whenever
+// the layout changes, older files are refused.
+
+static const uint32_t COOKED_SCENE_MAGIC = 0x4E43534B; // "KSCN"
+static const uint32_t COOKED_SCENE_VERSION = 2;
+// Every blob starts on this boundary, which keeps them on separate cache lines and satisfies any buffer alignment
+static const uint32_t COOKED_SCENE_ALIGNMENT = 256;
+static const uint32_t COOKED_SCENE_NAME_SIZE = 64;
+
+enum CookedSceneStream
+{
+    COOKED_SCENE_STREAM_POSITION,
+    COOKED_SCENE_STREAM_NORMAL,
+    COOKED_SCENE_STREAM_TEXCOORD,
+    COOKED_SCENE_STREAM_TANGENT,
+    COOKED_SCENE_STREAM_COUNT
+};
+
+// Byte strides of the version 2 streams
+static const uint32_t gCookedSceneStrides[COOKED_SCENE_STREAM_COUNT] = { 12, 4, 4, 4 };
+
+struct CookedSceneBlob
+{
+    uint64_t mOffset;
+    uint64_t mSize;
+};
+
+// Same layout as IndirectDrawIndexArguments, indices are relative to mVertexOffset
+struct CookedSceneDraw
+{
+    uint32_t mIndexCount;
+    uint32_t mInstanceCount;
+    uint32_t mStartIndex;
+    uint32_t mVertexOffset;
+    uint32_t mStartInstance;
+};
+
+// Same layout as BoundingBox, object space
+struct CookedSceneBounds
+{
+    float mMin[3];
+    float mMax[3];
+};
+
+// Texture file names of a draw, matched against the castle texture tables by the app
+struct CookedSceneMaterial
+{
+    char mName[COOKED_SCENE_NAME_SIZE];
+    char mAlbedo[COOKED_SCENE_NAME_SIZE];
+    char mBump[COOKED_SCENE_NAME_SIZE];
+};
+
+struct CookedSceneHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mFileSize;
+    uint32_t mVertexCount;
+    uint32_t mIndexCount;
+    // 2 or 4 bytes
+    uint32_t mIndexSize;
+    uint32_t mDrawCount;
+    CookedSceneBlob mVertexStreams[COOKED_SCENE_STREAM_COUNT];
+    CookedSceneBlob mIndices;
+    // mDrawCount entries each
+    CookedSceneBlob mDraws;
+    CookedSceneBlob mBounds;
+    CookedSceneBlob mMaterials;
+};
+
+// Views into a parsed file, valid as long as its data
+struct CookedScene
+{
+    const CookedSceneHeader* pHeader;
+    const void* pVertexStreams[COOKED_SCENE_STREAM_COUNT];
+    const void* pIndices;
+    const CookedSceneDraw* pDraws;
+    const CookedSceneBounds* pBounds;
+    const CookedSceneMaterial* pMaterials;
+};
+
+// Checks the magic, version, blob sizes and offsets and that every draw stays inside the index and vertex blobs.
+// Blobs are as aligned as pData is, page aligned for a mapped file. Returns NULL or what is wrong.
+const char* cookedSceneParse(const void* pData, size_t size, CookedScene* pOut);
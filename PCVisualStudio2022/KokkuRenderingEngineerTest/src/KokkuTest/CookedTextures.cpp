@@ -0,0 +1,79 @@
+#include "CookedTextures.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Copies the next tab separated field of [pCursor, pEnd) into pOut, returns false when the line ran out
+static bool readField(const char** ppCursor, const char* pEnd, char* pOut, size_t outSize)
+{
+    const char* cursor = *ppCursor;
+    if (cursor >= pEnd)
+        return false;
+
+    const char* fieldEnd = cursor;
+    while (fieldEnd < pEnd && *fieldEnd != '\t')
+        ++fieldEnd;
+
+    const size_t len = (size_t)(fieldEnd - cursor);
+    if (len == 0 || len >= outSize)
+        return false;
+
+    memcpy(pOut, cursor, len);
+    pOut[len] = '\0';
+    *ppCursor = fieldEnd < pEnd ? fieldEnd + 1 : fieldEnd;
+    return true;
+}
+
+uint32_t cookedTexturesParse(const char* pText, size_t size, CookedTextureInfo* pEntries, uint32_t maxEntries)
+{
+    uint32_t    count = 0;
+    const char* cursor = pText;
+    const char* end = pText + size;
+    while (cursor < end && count < maxEntries)
+    {
+        const char* lineEnd = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!lineEnd)
+            lineEnd = end;
+        const char* next = lineEnd < end ? lineEnd + 1 : end;
+        if (lineEnd > cursor && lineEnd[-1] == '\r')
+            --lineEnd;
+
+        if (lineEnd == cursor || *cursor == '#')
+        {
+            cursor = next;
+            continue;
+        }
+
+        CookedTextureInfo info = {};
+        char              colorSpace[16];
+        char              numbers[3][16];
+        if (readField(&cursor, lineEnd, info.mFileName, sizeof(info.mFileName)) &&
+            readField(&cursor, lineEnd, info.mFormat, sizeof(info.mFormat)) &&
+            readField(&cursor, lineEnd, colorSpace, sizeof(colorSpace)) && readField(&cursor, lineEnd, numbers[0], sizeof(numbers[0])) &&
+            readField(&cursor, lineEnd, numbers[1], sizeof(numbers[1])) && readField(&cursor, lineEnd, numbers[2], sizeof(numbers[2])))
+        {
+            info.mSrgb = strcmp(colorSpace, "srgb") == 0;
+            info.mWidth = (uint32_t)strtoul(numbers[0], NULL, 10);
+            info.mHeight = (uint32_t)strtoul(numbers[1], NULL, 10);
+            info.mMipCount = (uint32_t)strtoul(numbers[2], NULL, 10);
+            if (readField(&cursor, lineEnd, info.mArrayFileName, sizeof(info.mArrayFileName)) &&
+                readField(&cursor, lineEnd, numbers[0], sizeof(numbers[0])))
+                info.mLayer = (uint32_t)strtoul(numbers[0], NULL, 10);
+            else
+                info.mArrayFileName[0] = '\0';
+            pEntries[count++] = info;
+        }
+        cursor = next;
+    }
+    return count;
+}
+
+const CookedTextureInfo* cookedTexturesFind(const CookedTextureInfo* pEntries, uint32_t count, const char* pFileName)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (strcmp(pEntries[i].mFileName, pFileName) == 0)
+            return &pEntries[i];
+    }
+    return NULL;
+}
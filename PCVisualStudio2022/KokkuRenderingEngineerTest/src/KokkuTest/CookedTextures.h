@@ -0,0 +1,26 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Reader for CookedTextures.meta, the manifest KokkuTextureCooker writes next to the cooked DDS files.
+// One tab separated line per texture: file, format, colorspace (srgb/linear), width, height, mips, then for a
+// texture packed into a texture array the array's file and the layer. The arrays have lines of their own.
+
+struct CookedTextureInfo
+{
+    char     mFileName[128];
+    char     mFormat[16];
+    bool     mSrgb;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mMipCount;
+    // Empty when the texture is a file of its own
+    char     mArrayFileName[128];
+    uint32_t mLayer;
+};
+
+// Returns the number of entries written to pEntries, skipping comments and malformed lines
+uint32_t cookedTexturesParse(const char* pText, size_t size, CookedTextureInfo* pEntries, uint32_t maxEntries);
+
+// NULL when the file is not in the manifest
+const CookedTextureInfo* cookedTexturesFind(const CookedTextureInfo* pEntries, uint32_t count, const char* pFileName);
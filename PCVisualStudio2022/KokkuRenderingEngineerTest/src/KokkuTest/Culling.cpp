@@ -0,0 +1,196 @@
+#include "Culling.h"
+
+#include <float.h>
+#include <math.h>
+
+void boundingBoxReset(BoundingBox* pBox)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        pBox->mMin[i] = FLT_MAX;
+        pBox->mMax[i] = -FLT_MAX;
+    }
+}
+
+void boundingBoxExpand(BoundingBox* pBox, const float* pPoint)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        pBox->mMin[i] = fminf(pBox->mMin[i], pPoint[i]);
+        pBox->mMax[i] = fmaxf(pBox->mMax[i], pPoint[i]);
+    }
+}
+
+static void setPlane(float* pPlane, const float* a, const float* b, float sign)
+{
+    for (int i = 0; i < 4; ++i)
+        pPlane[i] = a[i] + sign * b[i];
+
+    const float len = sqrtf(pPlane[0] * pPlane[0] + pPlane[1] * pPlane[1] + pPlane[2] * pPlane[2]);
+    if (len > 0.0f)
+    {
+        for (int i = 0; i < 4; ++i)
+            pPlane[i] /= len;
+    }
+}
+
+void frustumFromMatrix(const float* pMatrix, Frustum* pOutFrustum)
+{
+    // Gribb/Hartmann plane extraction, rows of the column-major matrix
+    float rows[4][4];
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            rows[r][c] = pMatrix[c * 4 + r];
+
+    const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    setPlane(pOutFrustum->mPlanes[0], rows[3], rows[0], 1.0f);  // left
+    setPlane(pOutFrustum->mPlanes[1], rows[3], rows[0], -1.0f); // right
+    setPlane(pOutFrustum->mPlanes[2], rows[3], rows[1], 1.0f);  // bottom
+    setPlane(pOutFrustum->mPlanes[3], rows[3], rows[1], -1.0f); // top
+    setPlane(pOutFrustum->mPlanes[4], zero, rows[2], 1.0f);     // z >= 0
+    setPlane(pOutFrustum->mPlanes[5], rows[3], rows[2], -1.0f); // z <= w
+}
+
+bool frustumIntersectsBox(const Frustum* pFrustum, const BoundingBox* pBox)
+{
+    float center[3];
+    float extents[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        center[i] = (pBox->mMax[i] + pBox->mMin[i]) * 0.5f;
+        extents[i] = (pBox->mMax[i] - pBox->mMin[i]) * 0.5f;
+    }
+
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = pFrustum->mPlanes[p];
+        const float  distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+        const float  radius = fabsf(plane[0]) * extents[0] + fabsf(plane[1]) * extents[1] + fabsf(plane[2]) * extents[2];
+        if (distance + radius < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+bool frustumIntersectsSphere(const Frustum* pFrustum, const float* pCenter, float radius)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = pFrustum->mPlanes[p];
+        if (plane[0] * pCenter[0] + plane[1] * pCenter[1] + plane[2] * pCenter[2] + plane[3] < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t hiZLevelCount(uint32_t depthWidth, uint32_t depthHeight)
+{
+    uint32_t count = 1;
+    uint32_t width = (depthWidth + 1) / 2;
+    uint32_t height = (depthHeight + 1) / 2;
+    while ((width > 1 || height > 1) && count < HIZ_MAX_LEVELS)
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        ++count;
+    }
+    return count;
+}
+
+void hiZLevelSize(uint32_t depthWidth, uint32_t depthHeight, uint32_t level, uint32_t* pOutWidth, uint32_t* pOutHeight)
+{
+    uint32_t width = (depthWidth + 1) / 2;
+    uint32_t height = (depthHeight + 1) / 2;
+    for (uint32_t i = 0; i < level; ++i)
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    *pOutWidth = width;
+    *pOutHeight = height;
+}
+
+void hiZDownsample(const float* pSrc, uint32_t srcWidth, uint32_t srcHeight, float* pDst)
+{
+    // Rounding the size up means the last texel of an odd level only covers one source texel
+    const uint32_t dstWidth = (srcWidth + 1) / 2;
+    const uint32_t dstHeight = (srcHeight + 1) / 2;
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const uint32_t y0 = y * 2;
+        const uint32_t y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const uint32_t x0 = x * 2;
+            const uint32_t x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+            const float    top = fminf(pSrc[y0 * srcWidth + x0], pSrc[y0 * srcWidth + x1]);
+            const float    bottom = fminf(pSrc[y1 * srcWidth + x0], pSrc[y1 * srcWidth + x1]);
+            pDst[y * dstWidth + x] = fminf(top, bottom);
+        }
+    }
+}
+
+bool hiZIntersectsBox(const HiZPyramid* pPyramid, const float* pObjectToClip, const BoundingBox* pBox)
+{
+    // Screen rect (0..1, y down) and nearest depth of the projected corners
+    float minUV[2] = { 1.0f, 1.0f };
+    float maxUV[2] = { 0.0f, 0.0f };
+    float nearestDepth = 0.0f;
+    for (int c = 0; c < 8; ++c)
+    {
+        const float corner[3] = { (c & 1) ? pBox->mMax[0] : pBox->mMin[0], (c & 2) ? pBox->mMax[1] : pBox->mMin[1],
+                                  (c & 4) ? pBox->mMax[2] : pBox->mMin[2] };
+        float       clip[4];
+        for (int r = 0; r < 4; ++r)
+            clip[r] = pObjectToClip[0 * 4 + r] * corner[0] + pObjectToClip[1 * 4 + r] * corner[1] + pObjectToClip[2 * 4 + r] * corner[2] +
+                      pObjectToClip[3 * 4 + r];
+
+        if (clip[3] <= 1e-5f)
+            return true;
+
+        const float u = clip[0] / clip[3] * 0.5f + 0.5f;
+        const float v = 0.5f - clip[1] / clip[3] * 0.5f;
+        minUV[0] = fminf(minUV[0], u);
+        minUV[1] = fminf(minUV[1], v);
+        maxUV[0] = fmaxf(maxUV[0], u);
+        maxUV[1] = fmaxf(maxUV[1], v);
+        nearestDepth = fmaxf(nearestDepth, clip[2] / clip[3]);
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        minUV[i] = fminf(fmaxf(minUV[i], 0.0f), 1.0f);
+        maxUV[i] = fminf(fmaxf(maxUV[i], 0.0f), 1.0f);
+    }
+
+    // Level whose texels are at least as large as the rect, so it touches at most 2x2 of them.
+    // Level L texels cover 2^(L+1) depth pixels.
+    const float minPixels[2] = { minUV[0] * pPyramid->mViewportWidth, minUV[1] * pPyramid->mViewportHeight };
+    const float maxPixels[2] = { maxUV[0] * pPyramid->mViewportWidth, maxUV[1] * pPyramid->mViewportHeight };
+    const float extent = fmaxf(maxPixels[0] - minPixels[0], maxPixels[1] - minPixels[1]);
+    int         level = extent > 1.0f ? (int)ceilf(log2f(extent)) - 1 : 0;
+    if (level < (int)pPyramid->mFirstLevel)
+        level = (int)pPyramid->mFirstLevel;
+    if (level >= (int)(pPyramid->mFirstLevel + pPyramid->mLevelCount))
+        return true;
+
+    const uint32_t index = (uint32_t)level - pPyramid->mFirstLevel;
+    const uint32_t width = pPyramid->mWidths[index];
+    const uint32_t height = pPyramid->mHeights[index];
+    const float    texelPixels = (float)(2u << level);
+    uint32_t       x0 = (uint32_t)(minPixels[0] / texelPixels);
+    uint32_t       y0 = (uint32_t)(minPixels[1] / texelPixels);
+    uint32_t       x1 = (uint32_t)(maxPixels[0] / texelPixels);
+    uint32_t       y1 = (uint32_t)(maxPixels[1] / texelPixels);
+    x0 = x0 < width ? x0 : width - 1;
+    x1 = x1 < width ? x1 : width - 1;
+    y0 = y0 < height ? y0 : height - 1;
+    y1 = y1 < height ? y1 : height - 1;
+
+    const float* texels = pPyramid->pLevels[index];
+    const float  farthest = fminf(fminf(texels[y0 * width + x0], texels[y0 * width + x1]), fminf(texels[y1 * width + x0], texels[y1 * width + x1]));
+    return nearestDepth >= farthest;
+}
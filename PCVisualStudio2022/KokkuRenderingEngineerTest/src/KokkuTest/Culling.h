@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+
+// Plain CPU culling helpers. No renderer types here so they can be used (and checked) without a GPU.
+
+struct BoundingBox
+{
+    float mMin[3];
+    float mMax[3];
+};
+
+// Planes are stored as (nx, ny, nz, d) with normalized normals pointing inside the frustum
+struct Frustum
+{
+    float mPlanes[6][4];
+};
+
+void boundingBoxReset(BoundingBox* pBox);
+void boundingBoxExpand(BoundingBox* pBox, const float* pPoint);
+
+// pMatrix is a column-major 4x4 matrix (clip = M * v), as laid out by mat4.
+// Uses the D3D/Vulkan 0..w clip depth range, which also covers reverse-Z projections.
+void frustumFromMatrix(const float* pMatrix, Frustum* pOutFrustum);
+
+// Conservative test: returns false only when the box is completely outside one of the planes
+bool frustumIntersectsBox(const Frustum* pFrustum, const BoundingBox* pBox);
+
+// Same as frustumIntersectsBox for a sphere
+bool frustumIntersectsSphere(const Frustum* pFrustum, const float* pCenter, float radius);
+
+// Hierarchical Z pyramid, mirrors the one hiZBuild.comp builds from the depth buffer. Level 0 is half the depth
+// resolution (rounded up) and each texel keeps the farthest depth (the smallest with reverse-Z) of the 2x2 texels
+// below it, so a box is occluded when its nearest depth is below every pyramid texel it covers.
+#define HIZ_MAX_LEVELS 16
+
+struct HiZPyramid
+{
+    // Depth buffer the pyramid was built from
+    uint32_t mDepthWidth;
+    uint32_t mDepthHeight;
+    // Top-left part of it the frame rendered to, the whole buffer unless the resolution was scaled down
+    uint32_t mViewportWidth;
+    uint32_t mViewportHeight;
+    // A CPU copy may only hold the coarse end of the pyramid: pLevels[i] is level mFirstLevel + i
+    uint32_t     mFirstLevel;
+    uint32_t     mLevelCount;
+    uint32_t     mWidths[HIZ_MAX_LEVELS];
+    uint32_t     mHeights[HIZ_MAX_LEVELS];
+    const float* pLevels[HIZ_MAX_LEVELS];
+};
+
+// Levels down to and including 1x1, at most HIZ_MAX_LEVELS
+uint32_t hiZLevelCount(uint32_t depthWidth, uint32_t depthHeight);
+void     hiZLevelSize(uint32_t depthWidth, uint32_t depthHeight, uint32_t level, uint32_t* pOutWidth, uint32_t* pOutHeight);
+
+// Builds the next level from pSrc, its size comes from hiZLevelSize
+void hiZDownsample(const float* pSrc, uint32_t srcWidth, uint32_t srcHeight, float* pDst);
+
+// pObjectToClip as in frustumFromMatrix, with the camera the pyramid was built from.
+// Conservative like the frustum tests: boxes crossing the near plane or too large for the pyramid are visible.
+bool hiZIntersectsBox(const HiZPyramid* pPyramid, const float* pObjectToClip, const BoundingBox* pBox);
@@ -0,0 +1,63 @@
+#include "DynamicResolution.h"
+
+#include <math.h>
+
+// Exponential moving average weight of the newest GPU time
+static const float gSmoothing = 0.2f;
+// Below the budget by less than this, the scale stays where it is, so it doesn't oscillate around the budget
+static const float gHeadroom = 0.1f;
+// Part of the way to the estimated scale taken per change, the UI and Hi-Z cost doesn't shrink with the pixels
+static const float gDamping = 0.5f;
+// Smallest change, so a load just past the budget still moves the scale
+static const float gMinStep = 0.01f;
+
+void DynamicResolution::Init(float minScale, float maxScale)
+{
+    mMinScale = minScale;
+    mMaxScale = maxScale > minScale ? maxScale : minScale;
+    Reset();
+}
+
+void DynamicResolution::Reset()
+{
+    mScale = mMaxScale;
+    mSmoothedMs = 0.0f;
+    mFrames = 0;
+}
+
+float DynamicResolution::Update(float gpuMs, float targetMs)
+{
+    if (gpuMs <= 0.0f || targetMs <= 0.0f)
+        return mScale;
+
+    // Still the frames of the previous scale
+    if (++mFrames <= LATENCY_FRAMES)
+        return mScale;
+
+    mSmoothedMs = mFrames == LATENCY_FRAMES + 1 ? gpuMs : mSmoothedMs + (gpuMs - mSmoothedMs) * gSmoothing;
+    if (mFrames < LATENCY_FRAMES + AVERAGE_FRAMES)
+        return mScale;
+
+    const float load = mSmoothedMs / targetMs;
+    if (load <= 1.0f && load >= 1.0f - gHeadroom)
+        return mScale;
+
+    const float estimate = mScale / sqrtf(load);
+    float       scale = mScale + (estimate - mScale) * gDamping;
+    scale = load > 1.0f ? fminf(scale, mScale - gMinStep) : fmaxf(scale, mScale + gMinStep);
+    scale = scale < mMinScale ? mMinScale : (scale > mMaxScale ? mMaxScale : scale);
+    if (scale == mScale)
+        return mScale;
+
+    mScale = scale;
+    mFrames = 0;
+    return mScale;
+}
+
+void DynamicResolution::GetRenderSize(uint32_t width, uint32_t height, float scale, uint32_t* pOutWidth, uint32_t* pOutHeight)
+{
+    const uint32_t scaledWidth = (uint32_t)(width * scale + 0.5f);
+    const uint32_t scaledHeight = (uint32_t)(height * scale + 0.5f);
+    *pOutWidth = scaledWidth < 1 ? 1 : (scaledWidth > width ? width : scaledWidth);
+    *pOutHeight = scaledHeight < 1 ? 1 : (scaledHeight > height ? height : scaledHeight);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+// Dynamic resolution controller: picks the fraction of the output resolution the 3D passes render at so the
+// measured GPU frame time stays at a budget. The shading cost goes with the pixel count, the square of the scale,
+// so an over budget frame shrinks the scale by the square root of the overshoot. The GPU times come in a few
+// frames late, after every change the controller waits until the new scale is the one being measured.
+
+class DynamicResolution
+{
+public:
+    // Frames the profiler's GPU time lags behind the frame being recorded, with some margin
+    static const uint32_t LATENCY_FRAMES = 6;
+    // Frames averaged after the latency before a change is considered
+    static const uint32_t AVERAGE_FRAMES = 8;
+
+private:
+    float mMinScale = 0.5f;
+    float mMaxScale = 1.0f;
+    float mScale = 1.0f;
+    float mSmoothedMs = 0.0f;
+    // Since the last change of mScale
+    uint32_t mFrames = 0;
+
+public:
+    void Init(float minScale, float maxScale);
+    // Back to the full scale, waiting for fresh timings
+    void Reset();
+
+    // gpuMs is the latest GPU frame time, returns the scale of the frame about to be recorded
+    float Update(float gpuMs, float targetMs);
+
+    float GetScale() const { return mScale; }
+    // 0 until the first timings after a change are in
+    float GetSmoothedMs() const { return mSmoothedMs; }
+
+    // Region of a width x height target rendered at scale, at least 1x1
+    static void GetRenderSize(uint32_t width, uint32_t height, float scale, uint32_t* pOutWidth, uint32_t* pOutHeight);
+};
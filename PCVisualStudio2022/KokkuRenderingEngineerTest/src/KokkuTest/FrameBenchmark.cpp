@@ -0,0 +1,106 @@
+#include "FrameBenchmark.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+static int compareFloat(const void* a, const void* b)
+{
+    const float fa = *(const float*)a;
+    const float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// Nearest-rank percentile, 1-based
+static uint32_t percentileRank(uint32_t count, uint32_t percentile)
+{
+    const uint32_t rank = (uint32_t)(((uint64_t)count * percentile + 99) / 100);
+    return rank == 0 ? 1 : rank;
+}
+
+void FrameBenchmark::Init(uint32_t frameCount, uint32_t warmupFrameCount)
+{
+    Exit();
+
+    mFrameCount = frameCount;
+    mWarmupFrameCount = warmupFrameCount;
+    mFramesSeen = 0;
+    mFramesRecorded = 0;
+
+    if (mFrameCount == 0)
+        return;
+
+    pCpuFrameTimes = (float*)tf_calloc(mFrameCount, sizeof(float));
+    pGpuFrameTimes = (float*)tf_calloc(mFrameCount, sizeof(float));
+}
+
+void FrameBenchmark::Exit()
+{
+    tf_free(pCpuFrameTimes);
+    tf_free(pGpuFrameTimes);
+    pCpuFrameTimes = NULL;
+    pGpuFrameTimes = NULL;
+    mFrameCount = 0;
+    mFramesRecorded = 0;
+}
+
+void FrameBenchmark::AddFrame(float cpuMs, float gpuMs)
+{
+    if (!IsActive() || IsFinished())
+        return;
+
+    if (mFramesSeen++ < mWarmupFrameCount)
+        return;
+
+    pCpuFrameTimes[mFramesRecorded] = cpuMs;
+    pGpuFrameTimes[mFramesRecorded] = gpuMs;
+    ++mFramesRecorded;
+}
+
+FrameTimeStats FrameBenchmark::ComputeStats(const float* pSamples, uint32_t count)
+{
+    FrameTimeStats stats = {};
+    if (count == 0)
+        return stats;
+
+    float* sorted = (float*)tf_malloc(count * sizeof(float));
+    memcpy(sorted, pSamples, count * sizeof(float));
+    stats = ComputeStatsInPlace(sorted, count);
+    tf_free(sorted);
+    return stats;
+}
+
+FrameTimeStats FrameBenchmark::ComputeStatsInPlace(float* pSamples, uint32_t count)
+{
+    FrameTimeStats stats = {};
+    if (count == 0)
+        return stats;
+
+    float* sorted = pSamples;
+    qsort(sorted, count, sizeof(float), compareFloat);
+
+    double sum = 0.0;
+    for (uint32_t i = 0; i < count; ++i)
+        sum += sorted[i];
+
+    stats.mMin = sorted[0];
+    stats.mAvg = (float)(sum / count);
+    stats.mP50 = sorted[percentileRank(count, 50) - 1];
+    stats.mP95 = sorted[percentileRank(count, 95) - 1];
+    stats.mP99 = sorted[percentileRank(count, 99) - 1];
+    stats.mMax = sorted[count - 1];
+    return stats;
+}
+
+void FrameBenchmark::Report(const char* pName) const
+{
+    FrameTimeStats cpu = ComputeStats(pCpuFrameTimes, mFramesRecorded);
+    FrameTimeStats gpu = ComputeStats(pGpuFrameTimes, mFramesRecorded);
+
+    LOGF(eINFO, "[Benchmark] %s: %u frames (%u warmup)", pName, mFramesRecorded, mWarmupFrameCount);
+    LOGF(eINFO, "[Benchmark] CPU frame ms: min %.3f avg %.3f p99 %.3f max %.3f", cpu.mMin, cpu.mAvg, cpu.mP99, cpu.mMax);
+    LOGF(eINFO, "[Benchmark] GPU frame ms: min %.3f avg %.3f p99 %.3f max %.3f", gpu.mMin, gpu.mAvg, gpu.mP99, gpu.mMax);
+}
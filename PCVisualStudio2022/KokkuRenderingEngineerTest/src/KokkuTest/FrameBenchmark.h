@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Records CPU and GPU frame times over a fixed number of frames and reports min/avg/p99.
+// Used by the headless benchmark mode so performance changes can be compared in CI.
+
+struct FrameTimeStats
+{
+    float mMin;
+    float mAvg;
+    float mP50;
+    float mP95;
+    float mP99;
+    float mMax;
+};
+
+class FrameBenchmark
+{
+private:
+    float* pCpuFrameTimes = NULL;
+    float* pGpuFrameTimes = NULL;
+
+    uint32_t mFrameCount = 0;
+    uint32_t mWarmupFrameCount = 0;
+    uint32_t mFramesSeen = 0;
+    uint32_t mFramesRecorded = 0;
+
+public:
+    // Frames seen before warmupFrameCount are skipped, so shader compilation and resource
+    // residency don't end up in the stats.
+    void Init(uint32_t frameCount, uint32_t warmupFrameCount);
+    void Exit();
+
+    bool IsActive() const { return mFrameCount > 0; }
+    bool IsFinished() const { return IsActive() && mFramesRecorded == mFrameCount; }
+
+    void AddFrame(float cpuMs, float gpuMs);
+
+    void Report(const char* pName) const;
+
+    static FrameTimeStats ComputeStats(const float* pSamples, uint32_t count);
+    // Same stats without the copy, pSamples is left sorted
+    static FrameTimeStats ComputeStatsInPlace(float* pSamples, uint32_t count);
+};
@@ -0,0 +1,81 @@
+#include "FrameTelemetry.h"
+
+#include <math.h>
+
+#include <Utilities/Interfaces/ILog.h>
+
+void FrameTelemetry::Reset()
+{
+    mNextSample = 0;
+    mSampleCount = 0;
+    for (uint32_t m = 0; m < FRAME_TELEMETRY_METRIC_COUNT; ++m)
+    {
+        for (uint32_t b = 0; b < HISTOGRAM_BIN_COUNT; ++b)
+            mHistograms[m][b] = 0.0f;
+        mHistogramRangeMs[m] = 0.0f;
+        mHistogramPeak[m] = 0.0f;
+    }
+}
+
+void FrameTelemetry::AddFrame(const FrameTelemetrySample& sample)
+{
+    mSamples[mNextSample] = sample;
+    mNextSample = (mNextSample + 1) % RING_SIZE;
+    if (mSampleCount < RING_SIZE)
+        ++mSampleCount;
+}
+
+void FrameTelemetry::UpdateHistograms()
+{
+    for (uint32_t m = 0; m < FRAME_TELEMETRY_METRIC_COUNT; ++m)
+    {
+        float maxMs = 0.0f;
+        for (uint32_t i = 0; i < mSampleCount; ++i)
+            maxMs = mSamples[i].mMs[m] > maxMs ? mSamples[i].mMs[m] : maxMs;
+
+        // Rounding the range keeps the bins from jittering every frame
+        const float rangeMs = floorf(maxMs * 2.0f + 1.0f) * 0.5f;
+        const float binsPerMs = HISTOGRAM_BIN_COUNT / rangeMs;
+
+        float* bins = mHistograms[m];
+        for (uint32_t b = 0; b < HISTOGRAM_BIN_COUNT; ++b)
+            bins[b] = 0.0f;
+        for (uint32_t i = 0; i < mSampleCount; ++i)
+        {
+            const uint32_t bin = (uint32_t)(mSamples[i].mMs[m] * binsPerMs);
+            bins[bin < HISTOGRAM_BIN_COUNT ? bin : HISTOGRAM_BIN_COUNT - 1] += 1.0f;
+        }
+
+        float peak = 0.0f;
+        for (uint32_t b = 0; b < HISTOGRAM_BIN_COUNT; ++b)
+            peak = bins[b] > peak ? bins[b] : peak;
+
+        mHistogramRangeMs[m] = rangeMs;
+        mHistogramPeak[m] = peak;
+    }
+}
+
+FrameTimeStats FrameTelemetry::ComputeStats(FrameTelemetryMetric metric)
+{
+    // Order doesn't matter for the stats, so the ring is read as is
+    for (uint32_t i = 0; i < mSampleCount; ++i)
+        mStatsScratch[i] = mSamples[i].mMs[metric];
+    return FrameBenchmark::ComputeStatsInPlace(mStatsScratch, mSampleCount);
+}
+
+void FrameTelemetry::Report(const char* pName)
+{
+    LOGF(eINFO, "[Telemetry] %s: last %u frames", pName, mSampleCount);
+    for (uint32_t m = 0; m < FRAME_TELEMETRY_METRIC_COUNT; ++m)
+    {
+        const FrameTimeStats stats = ComputeStats((FrameTelemetryMetric)m);
+        LOGF(eINFO, "[Telemetry] %s ms: min %.3f avg %.3f p99 %.3f max %.3f", GetMetricName((FrameTelemetryMetric)m), stats.mMin,
+             stats.mAvg, stats.mP99, stats.mMax);
+    }
+}
+
+const char* FrameTelemetry::GetMetricName(FrameTelemetryMetric metric)
+{
+    static const char* names[FRAME_TELEMETRY_METRIC_COUNT] = { "Fence wait", "Acquire", "Submit", "Present interval" };
+    return names[metric];
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "FrameBenchmark.h"
+
+// Frame pacing telemetry: CPU side timings of the frame loop for the last RING_SIZE frames,
+// binned into one histogram per metric for the UI.
+
+enum FrameTelemetryMetric
+{
+    // CPU blocked on the fence of the frame whose resources are about to be reused
+    FRAME_TELEMETRY_FENCE_WAIT,
+    FRAME_TELEMETRY_ACQUIRE,
+    FRAME_TELEMETRY_SUBMIT,
+    // Time between consecutive presents (submits when headless)
+    FRAME_TELEMETRY_PRESENT_INTERVAL,
+    FRAME_TELEMETRY_METRIC_COUNT
+};
+
+struct FrameTelemetrySample
+{
+    float mMs[FRAME_TELEMETRY_METRIC_COUNT];
+};
+
+class FrameTelemetry
+{
+public:
+    static const uint32_t RING_SIZE = 512;
+    static const uint32_t HISTOGRAM_BIN_COUNT = 32;
+
+private:
+    FrameTelemetrySample mSamples[RING_SIZE] = {};
+    uint32_t mNextSample = 0;
+    uint32_t mSampleCount = 0;
+
+    float mHistograms[FRAME_TELEMETRY_METRIC_COUNT][HISTOGRAM_BIN_COUNT] = {};
+    float mHistogramRangeMs[FRAME_TELEMETRY_METRIC_COUNT] = {};
+    float mHistogramPeak[FRAME_TELEMETRY_METRIC_COUNT] = {};
+
+    // Sorted in place by ComputeStats, so computing the stats allocates nothing
+    float mStatsScratch[RING_SIZE] = {};
+
+public:
+    void Reset();
+
+    // Overwrites the oldest sample once the ring is full
+    void AddFrame(const FrameTelemetrySample& sample);
+
+    uint32_t GetSampleCount() const { return mSampleCount; }
+
+    // Rebins the ring. Not done by AddFrame, callers rebin when they show the histograms.
+    // Each histogram spans [0, range) of its metric, where the range is the largest sample
+    // rounded up to half a millisecond, so a bin is range / HISTOGRAM_BIN_COUNT wide.
+    void UpdateHistograms();
+
+    const float* GetHistogram(FrameTelemetryMetric metric) const { return mHistograms[metric]; }
+    float GetHistogramRangeMs(FrameTelemetryMetric metric) const { return mHistogramRangeMs[metric]; }
+    // Frame count of the fullest bin
+    float GetHistogramPeak(FrameTelemetryMetric metric) const { return mHistogramPeak[metric]; }
+
+    FrameTimeStats ComputeStats(FrameTelemetryMetric metric);
+
+    void Report(const char* pName);
+
+    static const char* GetMetricName(FrameTelemetryMetric metric);
+};
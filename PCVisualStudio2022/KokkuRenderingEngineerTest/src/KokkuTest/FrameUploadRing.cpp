@@ -0,0 +1,95 @@
+#include "FrameUploadRing.h"
+
+#include <string.h>
+
+#include <Resources/ResourceLoader/Interfaces/IResourceLoader.h>
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+static uint32_t alignUp(uint32_t value, uint32_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// Root CBV offsets must be multiples of the constant buffer alignment (256 on D3D12)
+static uint32_t getBlockAlignment(const Renderer* pRenderer)
+{
+    const uint32_t alignment = pRenderer->pGpu->mSettings.mUniformBufferAlignment;
+    return alignment > 256 ? alignment : 256;
+}
+
+uint32_t FrameUploadRing::GetAlignedSize(const Renderer* pRenderer, uint32_t size) { return alignUp(size, getBlockAlignment(pRenderer)); }
+
+void FrameUploadRing::Init(Renderer* pRenderer, uint32_t frameCount, uint32_t frameCapacity, const char* pName)
+{
+    mAlignment = getBlockAlignment(pRenderer);
+    mFrameCount = frameCount;
+    mFrameCapacity = alignUp(frameCapacity, mAlignment);
+
+    BufferLoadDesc ringDesc = {};
+    ringDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    ringDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+    ringDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+    ringDesc.mDesc.mSize = (uint64_t)mFrameCapacity * mFrameCount;
+    ringDesc.mDesc.pName = pName;
+    ringDesc.ppBuffer = &pBuffer;
+    addResource(&ringDesc, NULL);
+
+    mFrameStart = 0;
+    mUsed = 0;
+    mFrameOverflows = 0;
+    mLastFrameUsed = 0;
+    mLastFrameOverflows = 0;
+    mHighWater = 0;
+    mTotalOverflows = 0;
+}
+
+void FrameUploadRing::Exit()
+{
+    if (mTotalOverflows > 0)
+        LOGF(eWARNING, "Upload ring: %llu allocations didn't fit in %u KB per frame, high-water mark %u KB",
+             (unsigned long long)mTotalOverflows, mFrameCapacity / 1024, mHighWater / 1024);
+
+    if (pBuffer)
+        removeResource(pBuffer);
+    pBuffer = NULL;
+}
+
+void FrameUploadRing::BeginFrame(uint32_t frameIndex)
+{
+    // Sums up the frame before, whichever slice it used
+    mLastFrameUsed = mUsed;
+    mLastFrameOverflows = mFrameOverflows;
+    if (mUsed > mHighWater)
+        mHighWater = mUsed;
+    if (mFrameOverflows > 0 && mTotalOverflows == 0)
+        LOGF(eWARNING, "Upload ring: %u KB per frame is too small, raise --upload-ring-kb", mFrameCapacity / 1024);
+    mTotalOverflows += mFrameOverflows;
+
+    mFrameStart = (frameIndex % mFrameCount) * mFrameCapacity;
+    mUsed = 0;
+    mFrameOverflows = 0;
+}
+
+bool FrameUploadRing::Allocate(uint32_t size, FrameUploadBlock* pOut)
+{
+    const uint32_t alignedSize = alignUp(size, mAlignment);
+    if (alignedSize > mFrameCapacity - mUsed)
+    {
+        ++mFrameOverflows;
+        return false;
+    }
+
+    pOut->pBuffer = pBuffer;
+    pOut->mOffset = mFrameStart + mUsed;
+    pOut->mSize = size;
+    pOut->pCpuAddress = (uint8_t*)pBuffer->pCpuMappedAddress + pOut->mOffset;
+    mUsed += alignedSize;
+    return true;
+}
+
+bool FrameUploadRing::Upload(const void* pData, uint32_t size, FrameUploadBlock* pOut)
+{
+    if (!Allocate(size, pOut))
+        return false;
+    memcpy(pOut->pCpuAddress, pData, size);
+    return true;
+}
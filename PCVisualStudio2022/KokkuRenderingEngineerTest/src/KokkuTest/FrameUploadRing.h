@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Graphics/Interfaces/IGraphics.h>
+
+// Linear allocator for per-frame constants in one persistently mapped uniform buffer. Each frame in flight owns
+// a slice of it, reset in BeginFrame() once that frame's fence passed, so blocks need no update calls and are
+// bound as root CBVs (dynamic uniform buffers on Vulkan) at their offset.
+// An allocation that doesn't fit fails and is counted, the slice never grows behind the caller's back.
+
+struct FrameUploadBlock
+{
+    Buffer* pBuffer;
+    void* pCpuAddress;
+    // From the start of the buffer, for the DescriptorDataRange
+    uint32_t mOffset;
+    uint32_t mSize;
+};
+
+class FrameUploadRing
+{
+private:
+    Buffer* pBuffer = NULL;
+    uint32_t mFrameCount = 0;
+    uint32_t mFrameCapacity = 0;
+    uint32_t mAlignment = 0;
+
+    uint32_t mFrameStart = 0;
+    uint32_t mUsed = 0;
+    uint32_t mFrameOverflows = 0;
+
+    // Stats of the frames finished since Init()
+    uint32_t mLastFrameUsed = 0;
+    uint32_t mLastFrameOverflows = 0;
+    uint32_t mHighWater = 0;
+    uint64_t mTotalOverflows = 0;
+
+public:
+    // Room a block of size bytes takes in a slice on this GPU, for sizing frameCapacity
+    static uint32_t GetAlignedSize(const Renderer* pRenderer, uint32_t size);
+
+    // frameCapacity is rounded up to the uniform buffer alignment of the GPU
+    void Init(Renderer* pRenderer, uint32_t frameCount, uint32_t frameCapacity, const char* pName);
+    void Exit();
+
+    // Starts filling frameIndex's slice, everything allocated from it mFrameCount frames ago is dropped
+    void BeginFrame(uint32_t frameIndex);
+
+    // Aligned block of size bytes, false when the frame's slice is full
+    bool Allocate(uint32_t size, FrameUploadBlock* pOut);
+    // Allocate() and copy pData into the block
+    bool Upload(const void* pData, uint32_t size, FrameUploadBlock* pOut);
+
+    uint32_t GetAlignment() const { return mAlignment; }
+    uint32_t GetFrameCapacity() const { return mFrameCapacity; }
+    uint32_t GetLastFrameUsed() const { return mLastFrameUsed; }
+    uint32_t GetLastFrameOverflows() const { return mLastFrameOverflows; }
+    uint32_t GetHighWater() const { return mHighWater; }
+    uint64_t GetTotalOverflows() const { return mTotalOverflows; }
+};
@@ -1,4 +1,5 @@
 #include "KokkuTestApp.h"
+#include "LoadBenchmark.h"
 
 
 // Interfaces
@@ -8,6 +9,7 @@
 #include <Utilities/Interfaces/IFileSystem.h>
 #include <Utilities/Interfaces/ILog.h>
 #include <Utilities/Interfaces/ITime.h>
+#include <Utilities/Threading/ThreadSystem.h>
 
 // Renderer
 #include <Graphics/Interfaces/IGraphics.h>
@@ -17,38 +19,95 @@
 const char* pSkyBoxImageFileNames[] = { "Skybox_right1.tex",  "Skybox_left2.tex",  "Skybox_top3.tex",
                                         "Skybox_bottom4.tex", "Skybox_front5.tex", "Skybox_back6.tex" };
 
-// Generate sky box vertex buffer
-const float gSkyBoxPoints[] = {
-    10.0f,  -10.0f, -10.0f, 6.0f, // -z
-    -10.0f, -10.0f, -10.0f, 6.0f,   -10.0f, 10.0f,  -10.0f, 6.0f,   -10.0f, 10.0f,
-    -10.0f, 6.0f,   10.0f,  10.0f,  -10.0f, 6.0f,   10.0f,  -10.0f, -10.0f, 6.0f,
 
-    -10.0f, -10.0f, 10.0f,  2.0f, //-x
-    -10.0f, -10.0f, -10.0f, 2.0f,   -10.0f, 10.0f,  -10.0f, 2.0f,   -10.0f, 10.0f,
-    -10.0f, 2.0f,   -10.0f, 10.0f,  10.0f,  2.0f,   -10.0f, -10.0f, 10.0f,  2.0f,
+// Must match MESHLET_CULL_GROUPS_X in meshletCull.comp
+const uint32_t gMeshletCullGroupsX = 65535;
+// Must match CASTLE_CITY_THREADS in castleCity.comp
+const uint32_t gCastleCityThreads = 64;
+// Must match CASTLE_VERTEX_PACK_THREADS in castleVertexPack.comp
+const uint32_t gCastleVertexPackThreads = 64;
+// Must match OCCLUSION_CULL_THREADS and OCCLUSION_CULL_GROUPS_X in occlusionCull.comp
+const uint32_t gOcclusionCullThreads = 64;
+const uint32_t gOcclusionCullGroupsX = 65535;
+// Must match HIZ_BUILD_THREADS in hiZBuild.comp
+const uint32_t gHiZBuildThreads = 8;
+// Object to world scale of the castle, baked into mScaleMat
+const float gCastleScale = 100.0f;
+
+// Texture arrays holding the castle materials, CookedTextures.meta has the layer of every texture
+const char* gCastleAlbedoArrayFileName = "Castle Albedo.dds";
+const char* gCastleBumpArrayFileName = "Castle Bump.dds";
+// Textures of the castle.bin materials, castle.kscene names its own
+const char* gCastleAlbedoFileNames[] = { "Castle Exterior Texture.dds", "Castle Interior Texture.dds", "Ground and Fountain Texture.dds" };
+const char* gCastleBumpFileNames[] = { "Castle Exterior Texture Bump.dds", "Castle Interior Texture Bump.dds",
+                                       "Ground and Fountain Texture Bump.dds" };
+
+// Every shader binary a pipeline is built from, the pipeline cache is dropped when any of them changes
+const char* gPipelineShaderFileNames[] = { "skybox.vert",           "skybox.frag",           "skyboxCube.frag",    "basic.vert",
+                                           "basic.frag",            "meshletCull.comp",      "castleCity.comp",    "castleVertexPack.comp",
+                                           "visibilityBuffer.vert", "visibilityBuffer.frag", "hiZBuild.comp",      "occlusionCull.comp",
+                                           "visibilityResolve.frag", "upscale.frag" };
 
-    10.0f,  -10.0f, -10.0f, 1.0f, //+x
-    10.0f,  -10.0f, 10.0f,  1.0f,   10.0f,  10.0f,  10.0f,  1.0f,   10.0f,  10.0f,
-    10.0f,  1.0f,   10.0f,  10.0f,  -10.0f, 1.0f,   10.0f,  -10.0f, -10.0f, 1.0f,
-
-    -10.0f, -10.0f, 10.0f,  5.0f, // +z
-    -10.0f, 10.0f,  10.0f,  5.0f,   10.0f,  10.0f,  10.0f,  5.0f,   10.0f,  10.0f,
-    10.0f,  5.0f,   10.0f,  -10.0f, 10.0f,  5.0f,   -10.0f, -10.0f, 10.0f,  5.0f,
+const char* gWindowTestScripts[] = { "TestFullScreen.lua", "TestCenteredWindow.lua", "TestNonCenteredWindow.lua", "TestBorderless.lua" };
 
-    -10.0f, 10.0f,  -10.0f, 3.0f, //+y
-    10.0f,  10.0f,  -10.0f, 3.0f,   10.0f,  10.0f,  10.0f,  3.0f,   10.0f,  10.0f,
-    10.0f,  3.0f,   -10.0f, 10.0f,  10.0f,  3.0f,   -10.0f, 10.0f,  -10.0f, 3.0f,
+// Timestamp queries of the metrics export, one pool per frame in flight
+enum MetricsQuery
+{
+    METRICS_QUERY_FRAME,
+    METRICS_QUERY_CASTLE,
+    METRICS_QUERY_SKYBOX,
+    METRICS_QUERY_UI,
+    METRICS_QUERY_COUNT
+};
 
-    10.0f,  -10.0f, 10.0f,  4.0f, //-y
-    10.0f,  -10.0f, -10.0f, 4.0f,   -10.0f, -10.0f, -10.0f, 4.0f,   -10.0f, -10.0f,
-    -10.0f, 4.0f,   -10.0f, -10.0f, 10.0f,  4.0f,   10.0f,  -10.0f, 10.0f,  4.0f,
+// Init() work run on the worker pool, longest first so it starts right away
+enum InitTask
+{
+    INIT_TASK_CASTLE_SCENE,
+    INIT_TASK_CASTLE_TEXTURES,
+    INIT_TASK_SKYBOX_FACES,
+    INIT_TASK_PIPELINE_CACHE,
+    INIT_TASK_COUNT
 };
+const char* gInitTaskNames[INIT_TASK_COUNT] = { "Castle scene", "Castle textures", "Skybox faces", "Pipeline cache" };
 
+// Kind of a file watched by --hot-reload, the AssetWatcher user data is the kind << 16 | the index within the kind
+enum HotReloadAsset
+{
+    HOT_RELOAD_CASTLE_ALBEDO,
+    HOT_RELOAD_CASTLE_BUMP,
+    HOT_RELOAD_CASTLE_SCENE,
+    HOT_RELOAD_SHADER,
+};
 
-const char* gWindowTestScripts[] = { "TestFullScreen.lua", "TestCenteredWindow.lua", "TestNonCenteredWindow.lua", "TestBorderless.lua" };
+void KokkuTestApp::runInitTask(void* pUser, uint64_t index)
+{
+    KokkuTestApp* app = (KokkuTestApp*)pUser;
+    StartupTraceScope scope(&app->mStartupTrace, gInitTaskNames[index]);
+    switch (index)
+    {
+    case INIT_TASK_CASTLE_SCENE:
+        app->loadCastle();
+        break;
+    case INIT_TASK_CASTLE_TEXTURES:
+        app->loadCastleTexs();
+        break;
+    case INIT_TASK_SKYBOX_FACES:
+        app->loadSkyBoxFaces();
+        break;
+    case INIT_TASK_PIPELINE_CACHE:
+        app->mPipelineCache.Init(app->pRenderer, gPipelineShaderFileNames, TF_ARRAY_COUNT(gPipelineShaderFileNames));
+        break;
+    }
+}
 
 bool KokkuTestApp::Init()
 {
+    mStartupUSec = getUSec(true);
+    mStartupTrace.Init(mStartupUSec);
+    parseCommandLine();
+    mResolutionController.Init(0.5f, 1.0f);
+
     // FILE PATHS
     fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_SHADER_BINARIES, "CompiledShaders");
     fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_TEXTURES, "Textures");
@@ -57,56 +116,52 @@ bool KokkuTestApp::Init()
     fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_SCREENSHOTS, "Screenshots");
     fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_SCRIPTS, "Scripts");
     fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_DEBUG, "Debug");
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_PIPELINE_CACHE, "PipelineCaches");
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_OTHER_FILES, "CameraPaths");
 
     gGpuProfileToken = PROFILE_INVALID_TOKEN;
-    // window and renderer setup
-    RendererDesc settings;
-    memset(&settings, 0, sizeof(settings));
-    settings.mD3D11Supported = true;
-    settings.mGLESSupported = true;
-    initRenderer(GetName(), &settings, &pRenderer);
-    // check for init success
-    if (!pRenderer)
-        return false;
-
-    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
     {
-        QueryPoolDesc poolDesc = {};
-        poolDesc.mQueryCount = 3; // The count is 3 due to quest & multi-view use otherwise 2 is enough as we use 2 queries.
-        poolDesc.mType = QUERY_TYPE_PIPELINE_STATISTICS;
-        for (uint32_t i = 0; i < gDataBufferCount; ++i)
-        {
-            addQueryPool(pRenderer, &poolDesc, &pPipelineStatsQueryPool[i]);
-        }
-    }
-
-    QueueDesc queueDesc = {};
-    queueDesc.mType = QUEUE_TYPE_GRAPHICS;
-    queueDesc.mFlag = QUEUE_FLAG_INIT_MICROPROFILE;
-    addQueue(pRenderer, &queueDesc, &pGraphicsQueue);
+        StartupTraceScope scope(&mStartupTrace, "Renderer");
+        // window and renderer setup
+        RendererDesc settings;
+        memset(&settings, 0, sizeof(settings));
+        settings.mD3D11Supported = true;
+        settings.mGLESSupported = true;
+        initRenderer(GetName(), &settings, &pRenderer);
+        // check for init success
+        if (!pRenderer)
+            return false;
 
-    GpuCmdRingDesc cmdRingDesc = {};
-    cmdRingDesc.pQueue = pGraphicsQueue;
-    cmdRingDesc.mPoolCount = gDataBufferCount;
-    cmdRingDesc.mCmdPerPoolCount = 1;
-    cmdRingDesc.mAddSyncPrimitives = true;
-    addGpuCmdRing(pRenderer, &cmdRingDesc, &gGraphicsCmdRing);
+        QueueDesc queueDesc = {};
+        queueDesc.mType = QUEUE_TYPE_GRAPHICS;
+        queueDesc.mFlag = QUEUE_FLAG_INIT_MICROPROFILE;
+        addQueue(pRenderer, &queueDesc, &pGraphicsQueue);
 
-    addSemaphore(pRenderer, &pImageAcquiredSemaphore);
+        addSemaphore(pRenderer, &pImageAcquiredSemaphore);
 
-    initResourceLoaderInterface(pRenderer);
+        initResourceLoaderInterface(pRenderer);
+    }
 
-    // Loads Skybox Textures
-    for (int i = 0; i < 6; ++i)
+    // Before the worker pool starts, so its timings aren't shared with the rest of Init()
+    if (mLoadBenchmarkRuns > 0)
     {
-        TextureLoadDesc textureDesc = {};
-        textureDesc.pFileName = pSkyBoxImageFileNames[i];
-        textureDesc.ppTexture = &pSkyBoxTextures[i];
-        // Textures representing color should be stored in SRGB or HDR format
-        textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-        addResource(&textureDesc, NULL);
+        StartupTraceScope scope(&mStartupTrace, "Load benchmark");
+        runLoadBenchmark();
     }
 
+    // The castle materials and the texture loads both look their textures up in it
+    loadCookedTexturesMeta();
+
+    // The tasks wait on their own sync tokens, nothing below waits on all loads
+    ThreadSystemInitDesc threadDesc = {};
+    threadDesc.mThreadCount = INIT_TASK_COUNT;
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(threadDesc.mThreadAffinity); ++i)
+        threadDesc.mThreadAffinity[i] = -1;
+    threadDesc.pThreadName = "Init";
+    ThreadSystem* pInitThreads = NULL;
+    initThreadSystem(&threadDesc, &pInitThreads);
+    addThreadSystemRangeTask(pInitThreads, runInitTask, this, INIT_TASK_COUNT);
+
     // Dynamic sampler that is bound at runtime
     SamplerDesc samplerDesc = { FILTER_LINEAR,
                                 FILTER_LINEAR,
@@ -116,57 +171,46 @@ bool KokkuTestApp::Init()
                                 ADDRESS_MODE_CLAMP_TO_EDGE };
     addSampler(pRenderer, &samplerDesc, &pSamplerSkyBox);
 
-    //Skybox VB
-    uint64_t       skyBoxDataSize = 4 * 6 * 6 * sizeof(float);
-    BufferLoadDesc skyboxVbDesc = {};
-    skyboxVbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-    skyboxVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-    skyboxVbDesc.mDesc.mSize = skyBoxDataSize;
-    skyboxVbDesc.pData = gSkyBoxPoints;
-    skyboxVbDesc.ppBuffer = &pSkyBoxVertexBuffer;
-    addResource(&skyboxVbDesc, NULL);
+    if (mUploadRingBenchmarkDraws > 0)
+        pUploadRingBenchmarkBlocks = (FrameUploadBlock*)tf_calloc(mUploadRingBenchmarkDraws, sizeof(FrameUploadBlock));
+    // Before the frame resources, which only add the metrics queries when they are exported
+    mMetrics.Init(mMetricsFileName[0] ? mMetricsMaxFrames : 0);
+    addFrameResources();
 
-    BufferLoadDesc ubDesc = {};
-    ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
-    ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
-    ubDesc.pData = NULL;
-    for (uint32_t i = 0; i < gDataBufferCount; ++i)
-    {
-        ubDesc.mDesc.pName = "ProjViewUniformBuffer";
-        ubDesc.mDesc.mSize = sizeof(UniformBlock);
-        ubDesc.ppBuffer = &pProjViewUniformBuffer[i];
-        addResource(&ubDesc, NULL);
-        ubDesc.mDesc.pName = "SkyboxUniformBuffer";
-        ubDesc.mDesc.mSize = sizeof(UniformBlockSky);
-        ubDesc.ppBuffer = &pSkyboxUniformBuffer[i];
-        addResource(&ubDesc, NULL);
-    }
-
-    // Load fonts
-    FontDesc font = {};
-    font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
-    fntDefineFonts(&font, 1, &gFontID);
-
-    FontSystemDesc fontRenderDesc = {};
-    fontRenderDesc.pRenderer = pRenderer;
-    if (!initFontSystem(&fontRenderDesc))
-        return false; // report?
-
-    // Initialize Forge User Interface Rendering
-    UserInterfaceDesc uiRenderDesc = {};
-    uiRenderDesc.pRenderer = pRenderer;
-    initUserInterface(&uiRenderDesc);
-
-    // Initialize micro profiler and its UI.
-    ProfilerDesc profiler = {};
-    profiler.pRenderer = pRenderer;
-    profiler.mWidthUI = mSettings.mWidth;
-    profiler.mHeightUI = mSettings.mHeight;
-    initProfiler(&profiler);
-
-    // Gpu profiler can only be added after initProfile.
-    gGpuProfileToken = addGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
+    {
+        StartupTraceScope scope(&mStartupTrace, "Fonts");
+        // Load fonts
+        FontDesc font = {};
+        font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
+        fntDefineFonts(&font, 1, &gFontID);
+
+        FontSystemDesc fontRenderDesc = {};
+        fontRenderDesc.pRenderer = pRenderer;
+        if (!initFontSystem(&fontRenderDesc))
+        {
+            waitThreadSystemIdle(pInitThreads);
+            exitThreadSystem(pInitThreads);
+            return false; // report?
+        }
+    }
+
+    {
+        StartupTraceScope scope(&mStartupTrace, "UI and profiler");
+        // Initialize Forge User Interface Rendering
+        UserInterfaceDesc uiRenderDesc = {};
+        uiRenderDesc.pRenderer = pRenderer;
+        initUserInterface(&uiRenderDesc);
+
+        // Initialize micro profiler and its UI.
+        ProfilerDesc profiler = {};
+        profiler.pRenderer = pRenderer;
+        profiler.mWidthUI = mSettings.mWidth;
+        profiler.mHeightUI = mSettings.mHeight;
+        initProfiler(&profiler);
+
+        // Gpu profiler can only be added after initProfile.
+        gGpuProfileToken = addGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
+    }
 
     /************************************************************************/
     // GUI
@@ -176,13 +220,115 @@ bool KokkuTestApp::Init()
     uiCreateComponent(GetName(), &guiDesc, &pGuiWindow);
 
 
-    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    CheckboxWidget cullingCheckbox;
+    cullingCheckbox.pData = &mFrustumCulling;
+    uiCreateComponentWidget(pGuiWindow, "Frustum Culling", &cullingCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget meshletCheckbox;
+    meshletCheckbox.pData = &mGpuMeshletCulling;
+    uiCreateComponentWidget(pGuiWindow, "GPU Meshlet Culling", &meshletCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget coneCheckbox;
+    coneCheckbox.pData = &mMeshletConeCulling;
+    uiCreateComponentWidget(pGuiWindow, "Meshlet Cone Culling", &coneCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget visibilityBufferCheckbox;
+    visibilityBufferCheckbox.pData = &mVisibilityBuffer;
+    uiCreateComponentWidget(pGuiWindow, "Visibility Buffer", &visibilityBufferCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget depthPrepassCheckbox;
+    depthPrepassCheckbox.pData = &mDepthPrepass;
+    uiCreateComponentWidget(pGuiWindow, "Depth Prepass", &depthPrepassCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget occlusionCheckbox;
+    occlusionCheckbox.pData = &mOcclusionCulling;
+    uiCreateComponentWidget(pGuiWindow, "Occlusion Culling", &occlusionCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget gpuOcclusionCheckbox;
+    gpuOcclusionCheckbox.pData = &mGpuOcclusionCulling;
+    uiCreateComponentWidget(pGuiWindow, "GPU Occlusion Culling", &gpuOcclusionCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget lodCheckbox;
+    lodCheckbox.pData = &mLodSelection;
+    uiCreateComponentWidget(pGuiWindow, "LOD Selection", &lodCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    SliderFloatWidget lodThresholdSlider;
+    lodThresholdSlider.pData = &mLodThreshold;
+    lodThresholdSlider.mMin = 0.25f;
+    lodThresholdSlider.mMax = 8.0f;
+    lodThresholdSlider.mStep = 0.25f;
+    uiCreateComponentWidget(pGuiWindow, "LOD Threshold (px)", &lodThresholdSlider, WIDGET_TYPE_SLIDER_FLOAT);
+
+    SliderUintWidget lightCountSlider;
+    lightCountSlider.pData = &mLightCount;
+    lightCountSlider.mMin = 0;
+    lightCountSlider.mMax = CLUSTER_MAX_LIGHTS;
+    lightCountSlider.mStep = 16;
+    uiCreateComponentWidget(pGuiWindow, "Point Lights", &lightCountSlider, WIDGET_TYPE_SLIDER_UINT);
+
+    SliderUintWidget cityColumnsSlider;
+    cityColumnsSlider.pData = &mCityColumns;
+    cityColumnsSlider.mMin = 1;
+    cityColumnsSlider.mMax = CASTLE_CITY_MAX_SIDE;
+    cityColumnsSlider.mStep = 1;
+    uiCreateComponentWidget(pGuiWindow, "City Columns", &cityColumnsSlider, WIDGET_TYPE_SLIDER_UINT);
+
+    SliderUintWidget cityRowsSlider = cityColumnsSlider;
+    cityRowsSlider.pData = &mCityRows;
+    uiCreateComponentWidget(pGuiWindow, "City Rows", &cityRowsSlider, WIDGET_TYPE_SLIDER_UINT);
+
+    // Applied at the start of the next Draw()
+    SliderUintWidget framesInFlightSlider;
+    framesInFlightSlider.pData = &mRequestedFramesInFlight;
+    framesInFlightSlider.mMin = 1;
+    framesInFlightSlider.mMax = MAX_FRAMES_IN_FLIGHT;
+    framesInFlightSlider.mStep = 1;
+    uiCreateComponentWidget(pGuiWindow, "Frames In Flight", &framesInFlightSlider, WIDGET_TYPE_SLIDER_UINT);
+
+    CheckboxWidget dynamicResolutionCheckbox;
+    dynamicResolutionCheckbox.pData = &mDynamicResolution;
+    uiCreateComponentWidget(pGuiWindow, "Dynamic Resolution", &dynamicResolutionCheckbox, WIDGET_TYPE_CHECKBOX);
+
+    SliderFloatWidget gpuBudgetSlider;
+    gpuBudgetSlider.pData = &mDynamicResolutionBudgetMs;
+    gpuBudgetSlider.mMin = 2.0f;
+    gpuBudgetSlider.mMax = 50.0f;
+    gpuBudgetSlider.mStep = 0.5f;
+    uiCreateComponentWidget(pGuiWindow, "GPU Budget (ms)", &gpuBudgetSlider, WIDGET_TYPE_SLIDER_FLOAT);
+
+    if (mCameraRecordFileName[0])
+    {
+        SliderUintWidget segmentSlider;
+        segmentSlider.pData = &mCameraRecordSegment;
+        segmentSlider.mMin = 0;
+        segmentSlider.mMax = CameraPath::MAX_SEGMENTS - 1;
+        segmentSlider.mStep = 1;
+        uiCreateComponentWidget(pGuiWindow, "Camera Segment", &segmentSlider, WIDGET_TYPE_SLIDER_UINT);
+    }
+
+    // Also carries the castle culling counts, so it exists even without pipeline statistics queries
+    static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    DynamicTextWidget statsWidget;
+    statsWidget.pText = &gPipelineStats;
+    statsWidget.pColor = &color;
+    uiCreateComponentWidget(pGuiWindow, "Pipeline Stats", &statsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget framePacingWidget;
+    framePacingWidget.pText = &gFramePacing;
+    framePacingWidget.pColor = &color;
+    uiCreateComponentWidget(pGuiWindow, "Frame Pacing", &framePacingWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    // One histogram per telemetry metric, the titles carry the ms range and are refreshed with the stats
+    for (uint32_t m = 0; m < FRAME_TELEMETRY_METRIC_COUNT; ++m)
     {
-        static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
-        DynamicTextWidget statsWidget;
-        statsWidget.pText = &gPipelineStats;
-        statsWidget.pColor = &color;
-        uiCreateComponentWidget(pGuiWindow, "Pipeline Stats", &statsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        HistogramWidget histogram;
+        histogram.pValues = mFrameTelemetry.GetHistogram((FrameTelemetryMetric)m);
+        histogram.mCount = FrameTelemetry::HISTOGRAM_BIN_COUNT;
+        histogram.pMinScale = &mTelemetryHistogramMin;
+        histogram.pMaxScale = &mTelemetryHistogramMax[m];
+        histogram.mHistogramSize = float2(256.0f, 48.0f);
+        histogram.pHistogramTitle = mTelemetryTitles[m];
+        uiCreateComponentWidget(pGuiWindow, FrameTelemetry::GetMetricName((FrameTelemetryMetric)m), &histogram, WIDGET_TYPE_HISTOGRAM);
     }
 
     const uint32_t numScripts = TF_ARRAY_COUNT(gWindowTestScripts);
@@ -199,11 +345,30 @@ bool KokkuTestApp::Init()
                                 ADDRESS_MODE_CLAMP_TO_EDGE };
     addSampler(pRenderer, &samplerDesc, &pSmaplerCastle);
 
-    loadCastleTexs();
+    {
+        StartupTraceScope scope(&mStartupTrace, "Wait for init tasks");
+        waitThreadSystemIdle(pInitThreads);
+    }
+    exitThreadSystem(pInitThreads);
+
+    {
+        StartupTraceScope scope(&mStartupTrace, "Skybox bake");
+        bakeSkyBoxCube();
+    }
 
-    loadCastle();
+    {
+        StartupTraceScope scope(&mStartupTrace, "Castle GPU buffers");
+        pVisibleDraws = (uint32_t*)tf_calloc(mCastleScene.getGeometry()->mDrawArgCount, sizeof(uint32_t));
+        pInstanceLods = (uint8_t*)tf_calloc(CASTLE_CITY_MAX_SIDE * CASTLE_CITY_MAX_SIDE, sizeof(uint8_t));
+        addMeshletCullBuffers();
+        addCastleCityBuffer();
+        addOcclusionCullBuffers();
+        addLightBuffers();
+        placeLights();
+    }
 
-    waitForAllResourceLoads();
+    if (mHotReload)
+        initHotReload();
 
     //-----CAMERA-----//
     bool result = setupCamera();
@@ -213,11 +378,48 @@ bool KokkuTestApp::Init()
 
     gFrameIndex = 0;
 
+    mFrameBenchmark.Init(mBenchmarkFrameCount, mBenchmarkWarmupFrameCount);
+    initHiresTimer(&mFrameTimer);
+
+    // The replay warms up like the benchmark, holding the first pose
+    if (mCameraReplayFileName[0] &&
+        !mCameraReplay.Init(RD_OTHER_FILES, mCameraReplayFileName, mCameraReplayStepMs / 1000.0f, mBenchmarkWarmupFrameCount))
+        return false;
+    // The metrics leave out the same warmup frames as whichever benchmark drives the run
+    mMetricsSkipFrames = mFrameBenchmark.IsActive() || mCameraReplay.IsActive() ? mBenchmarkWarmupFrameCount : 0;
+
+    if (mLoadBenchmarkRuns > 0 && !mFrameBenchmark.IsActive() && !mCameraReplay.IsActive())
+        requestShutdown();
+
+    // Bound in prepareDescriptorSets()
+    {
+        StartupTraceScope scope(&mStartupTrace, "Wait for castle textures");
+        waitForToken(&mCastleTexturesToken);
+    }
+
+    const int64_t initEndUSec = getUSec(true);
+    mStartupTrace.Add("Init", mStartupUSec, initEndUSec);
+    LOGF(eINFO, "Init: %.2f ms", (initEndUSec - mStartupUSec) / 1000.0);
+
     return result;
 }
 
 void KokkuTestApp::Exit()
 {
+    if (mHotReload)
+        exitHotReload();
+
+    mFrameBenchmark.Exit();
+    mCameraReplay.Exit();
+
+    if (mCameraRecordFileName[0])
+        mCameraRecording.Save(RD_DEBUG, mCameraRecordFileName);
+    mCameraRecording.Exit();
+
+    reportUploadRingBenchmark();
+    tf_free(pUploadRingBenchmarkBlocks);
+    pUploadRingBenchmarkBlocks = NULL;
+
     exitInputSystem();
 
     exitCameraController(pCameraController);
@@ -229,78 +431,103 @@ void KokkuTestApp::Exit()
     // Exit profile
     exitProfiler();
 
-    for (uint32_t i = 0; i < gDataBufferCount; ++i)
-    {
-        removeResource(pProjViewUniformBuffer[i]);
-        removeResource(pSkyboxUniformBuffer[i]);
-        if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
-        {
-            removeQueryPool(pRenderer, pPipelineStatsQueryPool[i]);
-        }
-    }
+    // Reads back the frames still in flight, the queue is idle since Unload()
+    removeFrameResources();
 
-    removeResource(pSkyBoxVertexBuffer);
+    if (mMetrics.IsActive())
+        mMetrics.Write(RD_DEBUG, mMetricsFileName);
+    mMetrics.Exit();
 
-    for (uint i = 0; i < 6; ++i)
-        removeResource(pSkyBoxTextures[i]);
+    removeRenderTarget(pRenderer, pSkyBoxCube);
+
+    removeResource(pCastleAlbedo);
+    removeResource(pCastleBump);
+    removeResource(pCastleMaterialBuffer);
+
+    tf_free(pVisibleDraws);
+    pVisibleDraws = NULL;
+    tf_free(pInstanceLods);
+    pInstanceLods = NULL;
+    removeMeshletCullBuffers();
+    removeOcclusionCullBuffers();
+    removeLightBuffers();
+    tf_free(pLights);
+    tf_free(pLightPlacements);
+    tf_free(pClusterBinScratch);
+    removeResource(pCastleInstanceBuffer);
 
-    for (uint i = 0; i < 3; ++i)
-    {
-        removeResource(pCastleAlbedo[i]);
-        removeResource(pCastleBump[i]);
-    }
-    removeResource(pSubmeshSizes);
-    
     mCastleScene.Unload();
 
     removeSampler(pRenderer, pSamplerSkyBox);
     removeSampler(pRenderer, pSmaplerCastle);
 
-    removeGpuCmdRing(pRenderer, &gGraphicsCmdRing);
     removeSemaphore(pRenderer, pImageAcquiredSemaphore);
 
+    mPipelineCache.Exit(pRenderer);
+
     exitResourceLoaderInterface(pRenderer);
 
     removeQueue(pRenderer, pGraphicsQueue);
 
     exitRenderer(pRenderer);
     pRenderer = NULL;
+
+    mStartupTrace.Exit();
 }
 
 bool KokkuTestApp::Load(ReloadDesc* pReloadDesc)
 {
+    const int64_t loadStartUSec = getUSec(true);
+    int64_t shadersUSec = 0;
+    int64_t pipelinesUSec = 0;
+
     if (pReloadDesc->mType & RELOAD_TYPE_SHADER)
     {
+        StartupTraceScope scope(&mStartupTrace, "Shaders");
+        shadersUSec = getUSec(true);
         addShaders();
+        shadersUSec = getUSec(true) - shadersUSec;
         addRootSignatures();
         addDescriptorSets();
     }
 
     if (pReloadDesc->mType & (RELOAD_TYPE_RESIZE | RELOAD_TYPE_RENDERTARGET))
     {
-        if (!addSwapChain())
+        if (mHeadless ? !addOffscreenTarget() : !addSwapChain())
+            return false;
+
+        if (!addSceneColor())
             return false;
 
         if (!addDepthBuffer())
             return false;
+
+        if (!addVisibilityBuffer())
+            return false;
+
+        if (!addHiZ())
+            return false;
     }
 
     if (pReloadDesc->mType & (RELOAD_TYPE_SHADER | RELOAD_TYPE_RENDERTARGET))
     {
+        StartupTraceScope scope(&mStartupTrace, "Pipelines");
+        pipelinesUSec = getUSec(true);
         addPipelines();
+        pipelinesUSec = getUSec(true) - pipelinesUSec;
     }
 
     prepareDescriptorSets();
 
     UserInterfaceLoadDesc uiLoad = {};
-    uiLoad.mColorFormat = pSwapChain->ppRenderTargets[0]->mFormat;
+    uiLoad.mColorFormat = getBackBuffer(0)->mFormat;
     uiLoad.mHeight = mSettings.mHeight;
     uiLoad.mWidth = mSettings.mWidth;
     uiLoad.mLoadType = pReloadDesc->mType;
     loadUserInterface(&uiLoad);
 
     FontSystemLoadDesc fontLoad = {};
-    fontLoad.mColorFormat = pSwapChain->ppRenderTargets[0]->mFormat;
+    fontLoad.mColorFormat = getBackBuffer(0)->mFormat;
     fontLoad.mHeight = mSettings.mHeight;
     fontLoad.mWidth = mSettings.mWidth;
     fontLoad.mLoadType = pReloadDesc->mType;
@@ -308,6 +535,22 @@ bool KokkuTestApp::Load(ReloadDesc* pReloadDesc)
 
     initScreenshotInterface(pRenderer, pGraphicsQueue);
 
+    const int64_t loadEndUSec = getUSec(true);
+    LOGF(eINFO, "Load (reload type 0x%x): %.2f ms, shaders %.2f ms, pipelines %.2f ms, pipeline cache %s", (uint32_t)pReloadDesc->mType,
+         (loadEndUSec - loadStartUSec) / 1000.0, shadersUSec / 1000.0, pipelinesUSec / 1000.0,
+         mPipelineCache.GetCache() ? (mPipelineCache.IsWarm() ? "warm" : "cold") : "unsupported");
+    if (mStartupUSec != 0)
+    {
+        LOGF(eINFO, "Startup (Init + first Load): %.2f ms", (loadEndUSec - mStartupUSec) / 1000.0);
+        mStartupTrace.Add("Load", loadStartUSec, loadEndUSec);
+        mStartupTrace.Write(RD_DEBUG, "StartupTrace.json");
+        mStartupUSec = 0;
+    }
+
+    // Don't count the reload itself as frame time
+    getHiresTimerUSec(&mFrameTimer, true);
+    mLastPresentUSec = 0;
+
     return true;
 }
 
@@ -325,8 +568,14 @@ void KokkuTestApp::Unload(ReloadDesc* pReloadDesc)
 
     if (pReloadDesc->mType & (RELOAD_TYPE_RESIZE | RELOAD_TYPE_RENDERTARGET))
     {
-        removeSwapChain(pRenderer, pSwapChain);
+        if (mHeadless)
+            removeRenderTarget(pRenderer, pOffscreenTarget);
+        else
+            removeSwapChain(pRenderer, pSwapChain);
+        removeRenderTarget(pRenderer, pSceneColor);
         removeRenderTarget(pRenderer, pDepthBuffer);
+        removeRenderTarget(pRenderer, pVisibilityBuffer);
+        removeResource(pHiZ);
     }
 
     if (pReloadDesc->mType & RELOAD_TYPE_SHADER)
@@ -341,230 +590,1984 @@ void KokkuTestApp::Unload(ReloadDesc* pReloadDesc)
 
 void KokkuTestApp::Update(float deltaTime)
 {
+    const int64_t updateStartUSec = getUSec(true);
+
+    // Replays step a fixed time per frame, so the light animation repeats too
+    if (mCameraReplay.IsActive())
+        deltaTime = mCameraReplay.GetTimestep();
+
+    // Before anything reads the castle or its textures this frame
+    if (mHotReload)
+        updateHotReload(deltaTime);
+
     updateInputSystem(deltaTime, mSettings.mWidth, mSettings.mHeight);
 
-    pCameraController->update(deltaTime);
+    // Replays fly the camera along their path, benchmark runs keep it where setupCamera() put it, so every run sees
+    // the same frames
+    if (mCameraReplay.IsActive())
+    {
+        float position[3];
+        float rotation[2];
+        mCameraReplay.Step(position, rotation);
+        pCameraController->moveTo(vec3(position[0], position[1], position[2]));
+        pCameraController->setViewRotationXY(vec2(rotation[0], rotation[1]));
+    }
+    else if (!mFrameBenchmark.IsActive())
+    {
+        pCameraController->update(deltaTime);
+    }
+
+    if (mCameraRecordFileName[0])
+    {
+        if (mCameraRecording.GetKeyCount() == 0 || mCameraRecordSegment != mCameraRecordedSegment)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "Segment %u", mCameraRecordSegment);
+            mCameraRecording.AddSegment(name, mCameraRecordTime);
+            mCameraRecordedSegment = mCameraRecordSegment;
+        }
+        const vec3  viewPosition = pCameraController->getViewPosition();
+        const vec2  viewRotation = pCameraController->getRotationXY();
+        const float position[3] = { viewPosition.getX(), viewPosition.getY(), viewPosition.getZ() };
+        const float rotation[2] = { viewRotation.getX(), viewRotation.getY() };
+        mCameraRecording.AddKey(mCameraRecordTime, position, rotation);
+        mCameraRecordTime += deltaTime;
+    }
     /************************************************************************/
     // Scene Update
     /************************************************************************/
     static float currentTime = 0.0f;
     currentTime += deltaTime * 1000.0f;
 
+    // Picked before the camera below, the clusters and LOD thresholds are sized for the rendered pixels
+    if (mDynamicResolution != mDynamicResolutionApplied)
+    {
+        mResolutionController.Reset();
+        mDynamicResolutionApplied = mDynamicResolution;
+    }
+    float renderScale = 1.0f;
+    if (mDynamicResolution)
+        renderScale = mResolutionController.Update(getGpuProfileTime(gGpuProfileToken), mDynamicResolutionBudgetMs);
+    DynamicResolution::GetRenderSize(mSettings.mWidth, mSettings.mHeight, renderScale, &mRenderWidth, &mRenderHeight);
+
     // update camera with time
     mat4 viewMat = pCameraController->getViewMatrix();
 
     const float  aspectInverse = (float)mSettings.mHeight / (float)mSettings.mWidth;
     const float  horizontal_fov = PI / 2.0f;
-    CameraMatrix projMat = CameraMatrix::perspectiveReverseZ(horizontal_fov, aspectInverse, 0.1f, 1000.0f);
-    gUniformData.mSubmeshCount = mCastleScene.getGeometry()->mDrawArgCount;
+    // Push the far plane out with the city so the far corner of the grid is not clipped
+    const float  cityWidth = mCityColumns * mCastleCitySpacing[0] * gCastleScale;
+    const float  cityDepth = mCityRows * mCastleCitySpacing[1] * gCastleScale;
+    const float  farPlane = 1000.0f + sqrtf(cityWidth * cityWidth + cityDepth * cityDepth);
+    CameraMatrix projMat = CameraMatrix::perspectiveReverseZ(horizontal_fov, aspectInverse, 0.1f, farPlane);
     gUniformData.mProjectView = projMat * viewMat;
 
-    // point light parameters
-    gUniformData.mLightPosition = vec3(0.5f, 0.5f, 0.5f);
-    gUniformData.mLightColor = vec3(0.9f, 0.9f, 0.7f); // Pale Yellow
+    // Sun parameters
+    gUniformData.mSunDirection = vec4(0.5f, 0.5f, 0.5f, 0.0f);
+    gUniformData.mSunColor = vec4(0.9f, 0.9f, 0.7f, 0.0f); // Pale Yellow
 
     // update transformations
     mat4 trans, scale;
     trans = mat4::identity();
     scale = mat4::identity();
 
-    scale[0][0] *= 100;
-    scale[1][1] *= 100;
-    scale[2][2] *= 100;
-
-    gUniformData.mScaleMat = trans * scale;
+    scale[0][0] *= gCastleScale;
+    scale[1][1] *= gCastleScale;
+    scale[2][2] *= gCastleScale;
+
+    mCastleObjectToWorld = trans * scale;
+    // The quantized castle positions are 0..1 across the castle bounds, mScaleMat takes them to object space first
+    const float* positionScale = mCastleScene.getPositionScale();
+    const float* positionOffset = mCastleScene.getPositionOffset();
+    const mat4   dequantize = mat4::translation(vec3(positionOffset[0], positionOffset[1], positionOffset[2])) *
+                            mat4::scale(vec3(positionScale[0], positionScale[1], positionScale[2]));
+    gUniformData.mScaleMat = mCastleObjectToWorld * dequantize;
+
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            mClusterCamera.mView[c * 4 + r] = viewMat[c][r];
+    mClusterCamera.mProjScale[0] = projMat.mCamera[0][0];
+    mClusterCamera.mProjScale[1] = projMat.mCamera[1][1];
+    mClusterCamera.mNear = 0.1f;
+    mClusterCamera.mFar = farPlane;
+    mClusterCamera.mWidth = mRenderWidth;
+    mClusterCamera.mHeight = mRenderHeight;
+    mLodPixelsPerUnit = projMat.mCamera[1][1] * 0.5f * (float)mRenderHeight;
+
+    ClusterShaderParams clusterParams;
+    clusterShaderParams(&mClusterCamera, &clusterParams);
+    gUniformData.mClusterParams =
+        vec4(clusterParams.mInvTileSize[0], clusterParams.mInvTileSize[1], clusterParams.mSliceScale, clusterParams.mSliceBias);
+
+    updateLights(currentTime);
 
     viewMat.setTranslation(vec3(0));
     gUniformDataSky = {};
-    gUniformDataSky.mProjectView = projMat * viewMat;
+    gUniformDataSky.mInvProjectView = inverse((projMat * viewMat).mCamera);
+
+    mVisibilityBuffer = mVisibilityBuffer && mVisibilityBufferSupported;
+
+    cullCastle();
+
+    mLastUpdateMs = (getUSec(true) - updateStartUSec) / 1000.0f;
 }
 
-void KokkuTestApp::Draw()
+void KokkuTestApp::cullCastle()
 {
-    if (pSwapChain->mEnableVsync != mSettings.mVSyncEnabled)
+    const Geometry* pGeom = mCastleScene.getGeometry();
+    mVisibleDrawCount = 0;
+
+    // Submesh bounds are in object space, so cull against the full object to clip transform
+    const mat4 objectToClip = gUniformData.mProjectView.mCamera * mCastleObjectToWorld;
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            mCastleObjectToClip[c * 4 + r] = objectToClip[c][r];
+
+    frustumFromMatrix(mCastleObjectToClip, &mCastleFrustum);
+
+    const vec4 cameraPosition = inverse(mCastleObjectToWorld) * vec4(pCameraController->getViewPosition(), 1.0f);
+    mCastleCameraPosition[0] = cameraPosition.getX();
+    mCastleCameraPosition[1] = cameraPosition.getY();
+    mCastleCameraPosition[2] = cameraPosition.getZ();
+
+    // The culling only knows about the castle at the origin, the city baseline draws everything
+    const bool cityMode = getCityInstanceCount() > 1;
+    const BoundingBox* pBounds = mCastleScene.getSubmeshBounds();
+    for (uint32_t i = 0; i < pGeom->mDrawArgCount; ++i)
     {
-        waitQueueIdle(pGraphicsQueue);
-        ::toggleVSync(pRenderer, &pSwapChain);
+        if (!mFrustumCulling || cityMode || frustumIntersectsBox(&mCastleFrustum, &pBounds[i]))
+            pVisibleDraws[mVisibleDrawCount++] = i;
     }
 
-    uint32_t swapchainImageIndex;
-    acquireNextImage(pRenderer, pSwapChain, pImageAcquiredSemaphore, NULL, &swapchainImageIndex);
+    // The GPU does the actual meshlet culling, the CPU reference only feeds the stats.
+    // The occlusion culling and the LOD selection replace it, the former does its own frustum test.
+    const bool meshletCulling = mGpuMeshletCulling && !mOcclusionCulling && !mLodSelection && !cityMode;
+    const bool coneCulling = meshletCulling && mMeshletConeCulling;
+    memcpy(gMeshletCullUniformData.mFrustumPlanes, mCastleFrustum.mPlanes, sizeof(mCastleFrustum.mPlanes));
+    memcpy(gMeshletCullUniformData.mCameraPosition, mCastleCameraPosition, sizeof(mCastleCameraPosition));
+    gMeshletCullUniformData.mMeshletCount = mCastleScene.getMeshletCount();
+    gMeshletCullUniformData.mConeCulling = coneCulling ? 1 : 0;
 
-    RenderTarget* pRenderTarget = pSwapChain->ppRenderTargets[swapchainImageIndex];
-    GpuCmdRingElement elem = getNextGpuCmdRingElement(&gGraphicsCmdRing, true, 1);
+    if (meshletCulling)
+    {
+        mVisibleMeshletCount = meshletCull(mCastleScene.getMeshlets(), mCastleScene.getMeshletCount(), &mCastleFrustum,
+                                           mCastleCameraPosition, coneCulling, pVisibleMeshlets);
+    }
+    else
+    {
+        mVisibleMeshletCount = mCastleScene.getMeshletCount();
+    }
 
-    // Stall if CPU is running "gDataBufferCount" frames ahead of GPU
-    FenceStatus fenceStatus;
-    getFenceStatus(pRenderer, elem.pFence, &fenceStatus);
-    if (fenceStatus == FENCE_STATUS_INCOMPLETE)
-        waitForFences(pRenderer, 1, &elem.pFence);
+    memcpy(gOcclusionCullUniformData.mFrustumPlanes, mCastleFrustum.mPlanes, sizeof(mCastleFrustum.mPlanes));
+    memcpy(gOcclusionCullUniformData.mHiZObjectToClip, mHiZObjectToClip, sizeof(mHiZObjectToClip));
+    memcpy(gOcclusionCullUniformData.mInstanceScale, mCastleScene.getPositionScale(), sizeof(float) * 3);
+    gOcclusionCullUniformData.mDepthSize[0] = (float)pDepthBuffer->mWidth;
+    gOcclusionCullUniformData.mDepthSize[1] = (float)pDepthBuffer->mHeight;
+    gOcclusionCullUniformData.mViewportSize[0] = mHiZViewportSize[0];
+    gOcclusionCullUniformData.mViewportSize[1] = mHiZViewportSize[1];
+    gOcclusionCullUniformData.mInstanceCount = getCityInstanceCount();
+    gOcclusionCullUniformData.mDrawCount = pGeom->mDrawArgCount;
+    gOcclusionCullUniformData.mHiZLevelCount = mHiZLevelCount;
+    gOcclusionCullUniformData.mHiZValid = mHiZValid ? 1 : 0;
+    gOcclusionCullUniformData.mFrustumCulling = mFrustumCulling ? 1 : 0;
+}
 
-    // Update uniform buffers
-    BufferUpdateDesc viewProjCbv = { pProjViewUniformBuffer[gFrameIndex] };
-    beginUpdateResource(&viewProjCbv);
-    memcpy(viewProjCbv.pMappedData, &gUniformData, sizeof(gUniformData));
-    endUpdateResource(&viewProjCbv);
+void KokkuTestApp::addMeshletCullBuffers()
+{
+    const Geometry* pGeom = mCastleScene.getGeometry();
 
-    BufferUpdateDesc skyboxViewProjCbv = { pSkyboxUniformBuffer[gFrameIndex] };
-    beginUpdateResource(&skyboxViewProjCbv);
-    memcpy(skyboxViewProjCbv.pMappedData, &gUniformDataSky, sizeof(gUniformDataSky));
-    endUpdateResource(&skyboxViewProjCbv);
+    pVisibleMeshlets = (uint32_t*)tf_calloc(mCastleScene.getMeshletCount(), sizeof(uint32_t));
 
-    // Reset cmd pool for this frame
-    resetCmdPool(pRenderer, elem.pCmdPool);
+    // Each draw owns the same index range in the filtered buffer as in the castle index buffer.
+    // Meshlet indices are already rebased, so the vertex offset is 0.
+    IndirectDrawIndexArguments* clearedArgs = (IndirectDrawIndexArguments*)tf_calloc(pGeom->mDrawArgCount, sizeof(IndirectDrawIndexArguments));
+    for (uint32_t i = 0; i < pGeom->mDrawArgCount; ++i)
+    {
+        clearedArgs[i].mIndexCount = 0;
+        clearedArgs[i].mInstanceCount = 1;
+        clearedArgs[i].mStartIndex = pGeom->pDrawArgs[i].mStartIndex;
+        clearedArgs[i].mVertexOffset = 0;
+        clearedArgs[i].mStartInstance = 0;
+    }
 
-    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    const uint32_t argsUintCount = pGeom->mDrawArgCount * sizeof(IndirectDrawIndexArguments) / sizeof(uint32_t);
+
+    BufferLoadDesc clearedDesc = {};
+    clearedDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    clearedDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    clearedDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE | RESOURCE_STATE_COPY_SOURCE;
+    clearedDesc.mDesc.mElementCount = argsUintCount;
+    clearedDesc.mDesc.mStructStride = sizeof(uint32_t);
+    clearedDesc.mDesc.mSize = sizeof(IndirectDrawIndexArguments) * pGeom->mDrawArgCount;
+    clearedDesc.mDesc.pName = "Castle cleared draw args";
+    clearedDesc.pData = clearedArgs;
+    clearedDesc.ppBuffer = &pClearedDrawArgsBuffer;
+    SyncToken token = {};
+    addResource(&clearedDesc, &token);
+
+    BufferLoadDesc argsDesc = {};
+    argsDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_RW_BUFFER | DESCRIPTOR_TYPE_INDIRECT_BUFFER;
+    argsDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    argsDesc.mDesc.mStartState = RESOURCE_STATE_INDIRECT_ARGUMENT;
+    argsDesc.mDesc.mElementCount = argsUintCount;
+    argsDesc.mDesc.mStructStride = sizeof(uint32_t);
+    argsDesc.mDesc.mSize = sizeof(IndirectDrawIndexArguments) * pGeom->mDrawArgCount;
+    argsDesc.mDesc.pName = "Castle draw args";
+    argsDesc.pData = clearedArgs;
+
+    BufferLoadDesc indexDesc = {};
+    indexDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_RW_BUFFER | DESCRIPTOR_TYPE_INDEX_BUFFER;
+    indexDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    // Also read by visibilityResolve.frag
+    indexDesc.mDesc.mStartState = RESOURCE_STATE_INDEX_BUFFER | RESOURCE_STATE_SHADER_RESOURCE;
+    indexDesc.mDesc.mElementCount = pGeom->mIndexCount;
+    indexDesc.mDesc.mStructStride = sizeof(uint32_t);
+    indexDesc.mDesc.mSize = sizeof(uint32_t) * pGeom->mIndexCount;
+    indexDesc.mDesc.pName = "Castle filtered indices";
+
+    BufferLoadDesc ubDesc = {};
+    ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+    ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+    ubDesc.mDesc.mSize = sizeof(MeshletCullUniforms);
+    ubDesc.mDesc.pName = "MeshletCullUniformBuffer";
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
     {
-        QueryData data3D = {};
-        QueryData data2D = {};
-        getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 0, &data3D);
-        getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 1, &data2D);
-        bformat(&gPipelineStats,
-            "\n"
-            "Pipeline Stats 3D:\n"
-            "    VS invocations:      %u\n"
-            "    PS invocations:      %u\n"
-            "    Clipper invocations: %u\n"
-            "    IA primitives:       %u\n"
-            "    Clipper primitives:  %u\n"
-            "\n"
-            "Pipeline Stats 2D UI:\n"
-            "    VS invocations:      %u\n"
-            "    PS invocations:      %u\n"
-            "    Clipper invocations: %u\n"
-            "    IA primitives:       %u\n"
-            "    Clipper primitives:  %u\n",
-            data3D.mPipelineStats.mVSInvocations, data3D.mPipelineStats.mPSInvocations, data3D.mPipelineStats.mCInvocations,
-            data3D.mPipelineStats.mIAPrimitives, data3D.mPipelineStats.mCPrimitives, data2D.mPipelineStats.mVSInvocations,
-            data2D.mPipelineStats.mPSInvocations, data2D.mPipelineStats.mCInvocations, data2D.mPipelineStats.mIAPrimitives,
-            data2D.mPipelineStats.mCPrimitives);
+        argsDesc.ppBuffer = &pCastleDrawArgsBuffer[i];
+        addResource(&argsDesc, &token);
+        indexDesc.ppBuffer = &pFilteredIndexBuffer[i];
+        addResource(&indexDesc, &token);
+        ubDesc.ppBuffer = &pMeshletCullUniformBuffer[i];
+        addResource(&ubDesc, &token);
     }
 
-    Cmd* cmd = elem.pCmds[0];
-    beginCmd(cmd);
+    waitForToken(&token);
+    tf_free(clearedArgs);
+}
 
-    cmdBeginGpuFrameProfile(cmd, gGpuProfileToken);
-    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+void KokkuTestApp::removeMeshletCullBuffers()
+{
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
     {
-        cmdResetQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], 0, 2);
-        QueryDesc queryDesc = { 0 };
-        cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+        removeResource(pCastleDrawArgsBuffer[i]);
+        removeResource(pFilteredIndexBuffer[i]);
+        removeResource(pMeshletCullUniformBuffer[i]);
     }
+    removeResource(pClearedDrawArgsBuffer);
 
-    RenderTargetBarrier barriers[] = {
-        { pRenderTarget, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
-    };
-    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, barriers);
+    tf_free(pVisibleMeshlets);
+    pVisibleMeshlets = NULL;
+}
 
-    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
+void KokkuTestApp::cullMeshlets(Cmd* cmd)
+{
+    const uint32_t argsSize = mCastleScene.getGeometry()->mDrawArgCount * sizeof(IndirectDrawIndexArguments);
+    const uint32_t meshletCount = mCastleScene.getMeshletCount();
 
-    // simply record the screen cleaning command
-    BindRenderTargetsDesc bindRenderTargets = {};
-    bindRenderTargets.mRenderTargetCount = 1;
-    bindRenderTargets.mRenderTargets[0] = { pRenderTarget, LOAD_ACTION_CLEAR };
-    bindRenderTargets.mDepthStencil = { pDepthBuffer, LOAD_ACTION_CLEAR };
-    cmdBindRenderTargets(cmd, &bindRenderTargets);
-    cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 0.0f, 1.0f);
-    cmdSetScissor(cmd, 0, 0, pRenderTarget->mWidth, pRenderTarget->mHeight);
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Meshlet Cull");
 
-    const uint32_t skyboxVbStride = sizeof(float) * 4;
-    // draw skybox
-    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
-    cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 1.0f, 1.0f);
-    cmdBindPipeline(cmd, pSkyBoxDrawPipeline);
-    cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
-    cmdBindDescriptorSet(cmd, gFrameIndex * 2 + 0, pDescriptorSetUniforms);
-    cmdBindVertexBuffer(cmd, 1, &pSkyBoxVertexBuffer, &skyboxVbStride, NULL);
-    cmdDraw(cmd, 36, 0);
-    cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 0.0f, 1.0f);
-    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+    BufferBarrier bufferBarriers[2] = {};
+    bufferBarriers[0] = { pCastleDrawArgsBuffer[gFrameIndex], RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_COPY_DEST };
+    cmdResourceBarrier(cmd, 1, bufferBarriers, 0, NULL, 0, NULL);
 
-    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Castle");
+    cmdUpdateBuffer(cmd, pCastleDrawArgsBuffer[gFrameIndex], 0, pClearedDrawArgsBuffer, 0, argsSize);
 
-    cmdBindPipeline(cmd, pCastlePipeline);
-    cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
-    cmdBindDescriptorSet(cmd, gFrameIndex * 2 + 1, pDescriptorSetUniforms);
-    cmdBindVertexBuffer(cmd, 3, mCastleScene.getGeometry()->pVertexBuffers, mCastleScene.getGeometry()->mVertexStrides, nullptr);
-    cmdBindIndexBuffer(cmd, mCastleScene.getGeometry()->pIndexBuffer, INDEX_TYPE_UINT16, 0);
+    bufferBarriers[0] = { pCastleDrawArgsBuffer[gFrameIndex], RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_UNORDERED_ACCESS };
+    bufferBarriers[1] = { pFilteredIndexBuffer[gFrameIndex], RESOURCE_STATE_INDEX_BUFFER | RESOURCE_STATE_SHADER_RESOURCE,
+                          RESOURCE_STATE_UNORDERED_ACCESS };
+    cmdResourceBarrier(cmd, 2, bufferBarriers, 0, NULL, 0, NULL);
+
+    cmdBindPipeline(cmd, pMeshletCullPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetMeshletCull);
+    cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetMeshletCullPerFrame);
+    const uint32_t groupsX = meshletCount < gMeshletCullGroupsX ? meshletCount : gMeshletCullGroupsX;
+    const uint32_t groupsY = (meshletCount + gMeshletCullGroupsX - 1) / gMeshletCullGroupsX;
+    cmdDispatch(cmd, groupsX, groupsY, 1);
+
+    bufferBarriers[0] = { pCastleDrawArgsBuffer[gFrameIndex], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_INDIRECT_ARGUMENT };
+    bufferBarriers[1] = { pFilteredIndexBuffer[gFrameIndex], RESOURCE_STATE_UNORDERED_ACCESS,
+                          RESOURCE_STATE_INDEX_BUFFER | RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 2, bufferBarriers, 0, NULL, 0, NULL);
 
-    cmdDrawIndexedInstanced(cmd, mCastleScene.getGeometry()->mIndexCount, 0, 1, 0, 0);
-    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
     cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
-    cmdBindRenderTargets(cmd, NULL);
+}
 
-    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
-    {
-        QueryDesc queryDesc = { 0 };
-        cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+void KokkuTestApp::setCastleCitySpacing()
+{
+    // Neighbouring castles sit 10% of the castle footprint apart
+    const BoundingBox& bounds = mCastleScene.getBounds();
+    mCastleCitySpacing[0] = (bounds.mMax[0] - bounds.mMin[0]) * 1.1f;
+    mCastleCitySpacing[1] = (bounds.mMax[2] - bounds.mMin[2]) * 1.1f;
+}
 
-        queryDesc = { 1 };
-        cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
-    }
+void KokkuTestApp::addCastleCityBuffer()
+{
+    setCastleCitySpacing();
+
+    // Sized for the largest grid the UI allows, so changing the grid never reallocates
+    BufferLoadDesc instanceDesc = {};
+    instanceDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER;
+    instanceDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    instanceDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    instanceDesc.mDesc.mElementCount = CASTLE_CITY_MAX_SIDE * CASTLE_CITY_MAX_SIDE;
+    instanceDesc.mDesc.mStructStride = sizeof(mat4);
+    instanceDesc.mDesc.mSize = (uint64_t)instanceDesc.mDesc.mElementCount * sizeof(mat4);
+    instanceDesc.mDesc.pName = "Castle instances";
+    instanceDesc.ppBuffer = &pCastleInstanceBuffer;
+    SyncToken token = {};
+    addResource(&instanceDesc, &token);
+    waitForToken(&token);
+
+    mBuiltCityColumns = 0;
+    mBuiltCityRows = 0;
+}
 
-    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw UI");
+void KokkuTestApp::buildCastleCity(Cmd* cmd)
+{
+    CastleCityConstants constants = {};
+    constants.mInstanceCount = getCityInstanceCount();
+    constants.mColumns = mCityColumns;
+    // The instance transform applies before the dequantization in mScaleMat
+    constants.mSpacingX = mCastleCitySpacing[0] / mCastleScene.getPositionScale()[0];
+    constants.mSpacingZ = mCastleCitySpacing[1] / mCastleScene.getPositionScale()[2];
 
-    bindRenderTargets = {};
-    bindRenderTargets.mRenderTargetCount = 1;
-    bindRenderTargets.mRenderTargets[0] = { pRenderTarget, LOAD_ACTION_LOAD };
-    bindRenderTargets.mDepthStencil = { NULL, LOAD_ACTION_DONTCARE };
-    cmdBindRenderTargets(cmd, &bindRenderTargets);
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Castle City");
 
-    gFrameTimeDraw.mFontColor = 0xff00ffff;
-    gFrameTimeDraw.mFontSize = 18.0f;
-    gFrameTimeDraw.mFontID = gFontID;
-    float2 txtSizePx = cmdDrawCpuProfile(cmd, float2(8.f, 15.f), &gFrameTimeDraw);
-    cmdDrawGpuProfile(cmd, float2(8.f, txtSizePx.y + 75.f), gGpuProfileToken, &gFrameTimeDraw);
+    // Earlier frames on this queue may still be reading the transforms, the barrier orders the rewrite after them
+    BufferBarrier bufferBarrier = { pCastleInstanceBuffer, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS };
+    cmdResourceBarrier(cmd, 1, &bufferBarrier, 0, NULL, 0, NULL);
 
-    cmdDrawUserInterface(cmd);
+    cmdBindPipeline(cmd, pCastleCityPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetCastleCity);
+    cmdBindPushConstants(cmd, pCastleCityRootSignature, mCastleCityConstantsIndex, &constants);
+    cmdDispatch(cmd, (constants.mInstanceCount + gCastleCityThreads - 1) / gCastleCityThreads, 1, 1);
+
+    bufferBarrier = { pCastleInstanceBuffer, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 1, &bufferBarrier, 0, NULL, 0, NULL);
 
     cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
-    cmdBindRenderTargets(cmd, NULL);
 
-    barriers[0] = { pRenderTarget, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_PRESENT };
-    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, barriers);
+    mBuiltCityColumns = mCityColumns;
+    mBuiltCityRows = mCityRows;
+}
 
-    cmdEndGpuFrameProfile(cmd, gGpuProfileToken);
+void KokkuTestApp::packCastleVertices(Cmd* cmd)
+{
+    Geometry* pGeom = mCastleScene.getGeometry();
+    Buffer* pPackedVertexBuffer = mCastleScene.getPackedVertexBuffer();
+    const float* positionScale = mCastleScene.getPositionScale();
+    const float* positionOffset = mCastleScene.getPositionOffset();
 
-    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    CastleVertexPackConstants constants = {};
+    for (uint32_t i = 0; i < 3; ++i)
     {
-        QueryDesc queryDesc = { 1 };
-        cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
-        cmdResolveQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], 0, 2);
+        constants.mPositionOffset[i] = positionOffset[i];
+        constants.mPositionInvScale[i] = 1.0f / positionScale[i];
     }
+    constants.mVertexCount = pGeom->mVertexCount;
+    constants.mInterleaved = mCastleVertexFormat == CASTLE_VERTEX_FORMAT_INTERLEAVED ? 1 : 0;
+
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Castle Vertex Pack");
+
+    // geom's position, normal and uv stream and the tangents
+    Buffer* sourceBuffers[CastleScene::VERTEX_STREAM_COUNT] = { pGeom->pVertexBuffers[0], pGeom->pVertexBuffers[1], pGeom->pVertexBuffers[2],
+                                                                 mCastleScene.getTangentBuffer() };
+    BufferBarrier bufferBarriers[CastleScene::VERTEX_STREAM_COUNT] = {};
+    for (uint32_t i = 0; i < CastleScene::VERTEX_STREAM_COUNT; ++i)
+        bufferBarriers[i] = { sourceBuffers[i], RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, CastleScene::VERTEX_STREAM_COUNT, bufferBarriers, 0, NULL, 0, NULL);
+
+    cmdBindPipeline(cmd, pCastleVertexPackPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetCastleVertexPack);
+    cmdBindPushConstants(cmd, pCastleVertexPackRootSignature, mCastleVertexPackConstantsIndex, &constants);
+    cmdDispatch(cmd, (constants.mVertexCount + gCastleVertexPackThreads - 1) / gCastleVertexPackThreads, 1, 1);
+
+    for (uint32_t i = 0; i < CastleScene::VERTEX_STREAM_COUNT; ++i)
+        bufferBarriers[i] = { sourceBuffers[i], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER };
+    cmdResourceBarrier(cmd, CastleScene::VERTEX_STREAM_COUNT, bufferBarriers, 0, NULL, 0, NULL);
+    BufferBarrier packedBarrier = { pPackedVertexBuffer, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER };
+    cmdResourceBarrier(cmd, 1, &packedBarrier, 0, NULL, 0, NULL);
 
-    endCmd(cmd);
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 
-    FlushResourceUpdateDesc flushUpdateDesc = {};
-    flushUpdateDesc.mNodeIndex = 0;
-    flushResourceUpdates(&flushUpdateDesc);
-    Semaphore* waitSemaphores[2] = { flushUpdateDesc.pOutSubmittedSemaphore, pImageAcquiredSemaphore };
+    mCastleVerticesPacked = true;
+}
 
-    QueueSubmitDesc submitDesc = {};
-    submitDesc.mCmdCount = 1;
-    submitDesc.mSignalSemaphoreCount = 1;
-    submitDesc.mWaitSemaphoreCount = TF_ARRAY_COUNT(waitSemaphores);
-    submitDesc.ppCmds = &cmd;
-    submitDesc.ppSignalSemaphores = &elem.pSemaphore;
-    submitDesc.ppWaitSemaphores = waitSemaphores;
-    submitDesc.pSignalFence = elem.pFence;
-    queueSubmit(pGraphicsQueue, &submitDesc);
+void KokkuTestApp::drawVisibilityBuffer(Cmd* cmd, CastleDrawSource source)
+{
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Visibility Buffer");
 
-    QueuePresentDesc presentDesc = {};
-    presentDesc.mIndex = swapchainImageIndex;
-    presentDesc.mWaitSemaphoreCount = 1;
-    presentDesc.pSwapChain = pSwapChain;
-    presentDesc.ppWaitSemaphores = &elem.pSemaphore;
-    presentDesc.mSubmitDone = true;
+    RenderTargetBarrier barrier = { pVisibilityBuffer, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_RENDER_TARGET };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
 
-    queuePresent(pGraphicsQueue, &presentDesc);
-    flipProfiler();
+    BindRenderTargetsDesc bindRenderTargets = {};
+    bindRenderTargets.mRenderTargetCount = 1;
+    bindRenderTargets.mRenderTargets[0] = { pVisibilityBuffer, LOAD_ACTION_CLEAR };
+    bindRenderTargets.mDepthStencil = { pDepthBuffer, LOAD_ACTION_CLEAR };
+    cmdBindRenderTargets(cmd, &bindRenderTargets);
+    cmdSetViewport(cmd, 0.0f, 0.0f, (float)mRenderWidth, (float)mRenderHeight, 0.0f, 1.0f);
+    cmdSetScissor(cmd, 0, 0, mRenderWidth, mRenderHeight);
+
+    cmdBindPipeline(cmd, pVisibilityBufferPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
+    bindUniformSet(cmd, pDescriptorSetUniforms, gFrameIndex * 2 + 1, mCastleUniforms);
+    // Positions only, the resolve fetches the other attributes for the visible triangles.
+    // Primitive IDs restart at every draw, so the resolve only needs the draw's startIndex to find the triangle.
+    drawCastleGeometry(cmd, source, true);
+    cmdBindRenderTargets(cmd, NULL);
 
-    gFrameIndex = (gFrameIndex + 1) % gDataBufferCount;
+    barrier = { pVisibilityBuffer, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
+
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 }
 
-const char* KokkuTestApp::GetName()
+void KokkuTestApp::resolveVisibilityBuffer(Cmd* cmd, bool gpuMeshletCulling)
 {
-    return "KokkuRenderingEngineerTestApp";
+    Buffer** ppVertexBuffers = mCastleScene.getVertexBuffers();
+    const uint32_t* vertexStrides = mCastleScene.getVertexStrides();
+    const uint32_t* attributeOffsets = mCastleScene.getAttributeOffsets();
+    // The interleaved stream sits in every slot, it only needs one barrier
+    const uint32_t vertexBufferCount = mCastleScene.getVertexBufferCount(false);
+
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Visibility Resolve");
+
+    BufferBarrier vertexBarriers[CastleScene::VERTEX_STREAM_COUNT] = {};
+    for (uint32_t i = 0; i < vertexBufferCount; ++i)
+        vertexBarriers[i] = { ppVertexBuffers[i], RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, vertexBufferCount, vertexBarriers, 0, NULL, 0, NULL);
+
+    // The fullscreen triangle sits at depth 0, the LESS test keeps only the pixels the visibility pass covered
+    VisibilityResolveConstants constants = {};
+    constants.mScreenSize[0] = (float)mRenderWidth;
+    constants.mScreenSize[1] = (float)mRenderHeight;
+    constants.mPositionStride = vertexStrides[0];
+    constants.mQuantizedPositions = mCastleVertexFormat != CASTLE_VERTEX_FORMAT_FLOAT ? 1 : 0;
+    constants.mNormalStride = vertexStrides[1];
+    constants.mNormalOffset = attributeOffsets[1];
+    constants.mUVStride = vertexStrides[2];
+    constants.mUVOffset = attributeOffsets[2];
+    constants.mTangentStride = vertexStrides[3];
+    constants.mTangentOffset = attributeOffsets[3];
+    cmdBindPipeline(cmd, pVisibilityResolvePipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetVisibilityResolve);
+    // The meshlet index buffer matches the castle index buffer triangle for triangle, widened and rebased
+    bindUniformSet(cmd, pDescriptorSetVisibilityResolvePerFrame, gFrameIndex * 2 + (gpuMeshletCulling ? 0 : 1), mCastleUniforms);
+    cmdBindPushConstants(cmd, pVisibilityResolveRootSignature, mVisibilityResolveConstantsIndex, &constants);
+    cmdDraw(cmd, 3, 0);
+
+    for (uint32_t i = 0; i < vertexBufferCount; ++i)
+        vertexBarriers[i] = { ppVertexBuffers[i], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER };
+    cmdResourceBarrier(cmd, vertexBufferCount, vertexBarriers, 0, NULL, 0, NULL);
+
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+}
+
+void KokkuTestApp::upscaleSceneColor(Cmd* cmd, RenderTarget* pRenderTarget)
+{
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Upscale");
+
+    RenderTargetBarrier barrier = { pSceneColor, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
+
+    // Every back buffer pixel is written, nothing to load
+    BindRenderTargetsDesc bindRenderTargets = {};
+    bindRenderTargets.mRenderTargetCount = 1;
+    bindRenderTargets.mRenderTargets[0] = { pRenderTarget, LOAD_ACTION_DONTCARE };
+    cmdBindRenderTargets(cmd, &bindRenderTargets);
+    cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 0.0f, 1.0f);
+    cmdSetScissor(cmd, 0, 0, pRenderTarget->mWidth, pRenderTarget->mHeight);
+
+    UpscaleConstants constants = {};
+    constants.mUvScale[0] = (float)mRenderWidth / (float)pSceneColor->mWidth;
+    constants.mUvScale[1] = (float)mRenderHeight / (float)pSceneColor->mHeight;
+    constants.mUvMax[0] = ((float)mRenderWidth - 0.5f) / (float)pSceneColor->mWidth;
+    constants.mUvMax[1] = ((float)mRenderHeight - 0.5f) / (float)pSceneColor->mHeight;
+
+    cmdBindPipeline(cmd, pUpscalePipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetUpscale);
+    cmdBindPushConstants(cmd, pUpscaleRootSignature, mUpscaleConstantsIndex, &constants);
+    cmdDraw(cmd, 3, 0);
+    cmdBindRenderTargets(cmd, NULL);
+
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+}
+
+void KokkuTestApp::addOcclusionCullBuffers()
+{
+    const Geometry* pGeom = mCastleScene.getGeometry();
+    const uint32_t  drawCount = pGeom->mDrawArgCount;
+
+    float* bounds = (float*)tf_calloc(drawCount * 8, sizeof(float));
+    for (uint32_t i = 0; i < drawCount; ++i)
+    {
+        memcpy(bounds + i * 8 + 0, mCastleScene.getSubmeshBounds()[i].mMin, sizeof(float) * 3);
+        memcpy(bounds + i * 8 + 4, mCastleScene.getSubmeshBounds()[i].mMax, sizeof(float) * 3);
+    }
+
+    BufferLoadDesc boundsDesc = {};
+    boundsDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    boundsDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    boundsDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    boundsDesc.mDesc.mElementCount = drawCount * 2;
+    boundsDesc.mDesc.mStructStride = sizeof(float) * 4;
+    boundsDesc.mDesc.mSize = sizeof(float) * 8 * drawCount;
+    boundsDesc.mDesc.pName = "Castle submesh bounds";
+    boundsDesc.pData = bounds;
+    boundsDesc.ppBuffer = &pSubmeshBoundsBuffer;
+    SyncToken token = {};
+    addResource(&boundsDesc, &token);
+
+    // Each draw keeps its full index range, only the instance count changes
+    IndirectDrawIndexArguments* clearedArgs = (IndirectDrawIndexArguments*)tf_calloc(drawCount, sizeof(IndirectDrawIndexArguments));
+    for (uint32_t i = 0; i < drawCount; ++i)
+    {
+        clearedArgs[i] = pGeom->pDrawArgs[i];
+        clearedArgs[i].mInstanceCount = 0;
+        clearedArgs[i].mStartInstance = 0;
+    }
+
+    const uint32_t argsUintCount = drawCount * sizeof(IndirectDrawIndexArguments) / sizeof(uint32_t);
+
+    BufferLoadDesc clearedDesc = {};
+    clearedDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    clearedDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    clearedDesc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+    clearedDesc.mDesc.mElementCount = argsUintCount;
+    clearedDesc.mDesc.mStructStride = sizeof(uint32_t);
+    clearedDesc.mDesc.mSize = sizeof(IndirectDrawIndexArguments) * drawCount;
+    clearedDesc.mDesc.pName = "Castle occlusion cleared draw args";
+    clearedDesc.pData = clearedArgs;
+    clearedDesc.ppBuffer = &pOcclusionClearedArgsBuffer;
+    addResource(&clearedDesc, &token);
+
+    BufferLoadDesc argsDesc = {};
+    argsDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_RW_BUFFER | DESCRIPTOR_TYPE_INDIRECT_BUFFER;
+    argsDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    argsDesc.mDesc.mStartState = RESOURCE_STATE_INDIRECT_ARGUMENT;
+    argsDesc.mDesc.mElementCount = argsUintCount;
+    argsDesc.mDesc.mStructStride = sizeof(uint32_t);
+    argsDesc.mDesc.mSize = sizeof(IndirectDrawIndexArguments) * drawCount;
+    argsDesc.mDesc.pName = "Castle occlusion draw args";
+    argsDesc.pData = clearedArgs;
+
+    BufferLoadDesc ubDesc = {};
+    ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+    ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+    ubDesc.mDesc.mSize = sizeof(OcclusionCullUniforms);
+    ubDesc.mDesc.pName = "OcclusionCullUniformBuffer";
+
+    // Large enough for any pyramid level up to HIZ_READBACK_MAX_SIDE on both sides
+    const uint64_t readbackSize = sizeof(float) * HIZ_READBACK_MAX_SIDE * HIZ_READBACK_MAX_SIDE;
+    BufferLoadDesc readbackGpuDesc = {};
+    readbackGpuDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_RW_BUFFER;
+    readbackGpuDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    readbackGpuDesc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+    readbackGpuDesc.mDesc.mElementCount = HIZ_READBACK_MAX_SIDE * HIZ_READBACK_MAX_SIDE;
+    readbackGpuDesc.mDesc.mStructStride = sizeof(float);
+    readbackGpuDesc.mDesc.mSize = readbackSize;
+    readbackGpuDesc.mDesc.pName = "Hi-Z readback level";
+    readbackGpuDesc.ppBuffer = &pHiZReadbackGpuBuffer;
+    addResource(&readbackGpuDesc, &token);
+
+    BufferLoadDesc readbackDesc = {};
+    readbackDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_TO_CPU;
+    readbackDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+    readbackDesc.mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+    readbackDesc.mDesc.mSize = readbackSize;
+    readbackDesc.mDesc.pName = "Hi-Z readback";
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        argsDesc.ppBuffer = &pOcclusionDrawArgsBuffer[i];
+        addResource(&argsDesc, &token);
+        ubDesc.ppBuffer = &pOcclusionCullUniformBuffer[i];
+        addResource(&ubDesc, &token);
+        readbackDesc.ppBuffer = &pHiZReadbackBuffer[i];
+        addResource(&readbackDesc, &token);
+        mHiZReadbackValid[i] = false;
+    }
+
+    // The levels above the read back one are smaller than it all together
+    pHiZCpuLevels = (float*)tf_calloc(HIZ_READBACK_MAX_SIDE * HIZ_READBACK_MAX_SIDE, sizeof(float));
+    pOcclusionInstanceOffsets = (uint32_t*)tf_calloc(drawCount, sizeof(uint32_t));
+    pOcclusionInstanceCounts = (uint32_t*)tf_calloc(drawCount, sizeof(uint32_t));
+    addVisibleInstanceBuffers();
+
+    waitForToken(&token);
+    tf_free(clearedArgs);
+    tf_free(bounds);
+}
+
+void KokkuTestApp::addVisibleInstanceBuffers()
+{
+    // A region of the current city per draw, resizeVisibleInstanceBuffers() follows the city size
+    const uint32_t drawCount = mCastleScene.getGeometry()->mDrawArgCount;
+    mVisibleInstanceCapacity = getCityInstanceCount();
+
+    BufferLoadDesc visibleDesc = {};
+    visibleDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER;
+    visibleDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+    visibleDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    visibleDesc.mDesc.mElementCount = (uint64_t)drawCount * mVisibleInstanceCapacity;
+    visibleDesc.mDesc.mStructStride = sizeof(uint32_t);
+    visibleDesc.mDesc.mSize = sizeof(uint32_t) * (uint64_t)drawCount * mVisibleInstanceCapacity;
+    visibleDesc.mDesc.pName = "Castle visible instances";
+
+    BufferLoadDesc cpuVisibleDesc = {};
+    cpuVisibleDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    cpuVisibleDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+    cpuVisibleDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+    cpuVisibleDesc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+    cpuVisibleDesc.mDesc.mSize = visibleDesc.mDesc.mSize;
+    cpuVisibleDesc.mDesc.pName = "Castle CPU visible instances";
+
+    SyncToken token = {};
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        visibleDesc.ppBuffer = &pVisibleInstanceBuffer[i];
+        addResource(&visibleDesc, &token);
+        cpuVisibleDesc.ppBuffer = &pCpuVisibleInstanceBuffer[i];
+        addResource(&cpuVisibleDesc, &token);
+    }
+    waitForToken(&token);
+}
+
+void KokkuTestApp::removeVisibleInstanceBuffers()
+{
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        removeResource(pVisibleInstanceBuffer[i]);
+        removeResource(pCpuVisibleInstanceBuffer[i]);
+    }
+    mVisibleInstanceCapacity = 0;
+}
+
+void KokkuTestApp::resizeVisibleInstanceBuffers()
+{
+    // Every frame slot's buffers are replaced, so the GPU must be done with all of them
+    waitQueueIdle(pGraphicsQueue);
+    removeVisibleInstanceBuffers();
+    addVisibleInstanceBuffers();
+    updateVisibleInstanceDescriptors();
+    LOGF(eINFO, "Visible instance buffers: %u instances per draw", mVisibleInstanceCapacity);
+}
+
+void KokkuTestApp::removeOcclusionCullBuffers()
+{
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        removeResource(pOcclusionDrawArgsBuffer[i]);
+        removeResource(pOcclusionCullUniformBuffer[i]);
+        removeResource(pHiZReadbackBuffer[i]);
+    }
+    removeResource(pSubmeshBoundsBuffer);
+    removeResource(pOcclusionClearedArgsBuffer);
+    removeResource(pHiZReadbackGpuBuffer);
+
+    tf_free(pHiZCpuLevels);
+    tf_free(pOcclusionInstanceOffsets);
+    tf_free(pOcclusionInstanceCounts);
+    pHiZCpuLevels = NULL;
+    pOcclusionInstanceOffsets = NULL;
+    pOcclusionInstanceCounts = NULL;
+    removeVisibleInstanceBuffers();
+}
+
+void KokkuTestApp::cullOcclusion(Cmd* cmd)
+{
+    const uint32_t drawCount = mCastleScene.getGeometry()->mDrawArgCount;
+
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Occlusion Cull");
+
+    // The CPU fallback already has the lists, they only need to reach the GPU side buffer
+    if (!mGpuOcclusionCulling)
+    {
+        uploadCpuVisibleInstances(cmd, mOcclusionVisibleCount);
+        cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+        return;
+    }
+
+    BufferBarrier bufferBarriers[2] = {};
+    bufferBarriers[0] = { pOcclusionDrawArgsBuffer[gFrameIndex], RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_COPY_DEST };
+    cmdResourceBarrier(cmd, 1, bufferBarriers, 0, NULL, 0, NULL);
+
+    cmdUpdateBuffer(cmd, pOcclusionDrawArgsBuffer[gFrameIndex], 0, pOcclusionClearedArgsBuffer, 0,
+                    drawCount * sizeof(IndirectDrawIndexArguments));
+
+    bufferBarriers[0] = { pOcclusionDrawArgsBuffer[gFrameIndex], RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_UNORDERED_ACCESS };
+    bufferBarriers[1] = { pVisibleInstanceBuffer[gFrameIndex], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS };
+    cmdResourceBarrier(cmd, 2, bufferBarriers, 0, NULL, 0, NULL);
+
+    const uint32_t pairCount = getCityInstanceCount() * drawCount;
+    const uint32_t groupCount = (pairCount + gOcclusionCullThreads - 1) / gOcclusionCullThreads;
+    cmdBindPipeline(cmd, pOcclusionCullPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetOcclusionCull);
+    cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetOcclusionCullPerFrame);
+    cmdDispatch(cmd, groupCount < gOcclusionCullGroupsX ? groupCount : gOcclusionCullGroupsX,
+                (groupCount + gOcclusionCullGroupsX - 1) / gOcclusionCullGroupsX, 1);
+
+    bufferBarriers[0] = { pOcclusionDrawArgsBuffer[gFrameIndex], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_INDIRECT_ARGUMENT };
+    bufferBarriers[1] = { pVisibleInstanceBuffer[gFrameIndex], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 2, bufferBarriers, 0, NULL, 0, NULL);
+
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+}
+
+void KokkuTestApp::uploadCpuVisibleInstances(Cmd* cmd, uint32_t count)
+{
+    BufferBarrier bufferBarrier = { pVisibleInstanceBuffer[gFrameIndex], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_COPY_DEST };
+    cmdResourceBarrier(cmd, 1, &bufferBarrier, 0, NULL, 0, NULL);
+    if (count > 0)
+        cmdUpdateBuffer(cmd, pVisibleInstanceBuffer[gFrameIndex], 0, pCpuVisibleInstanceBuffer[gFrameIndex], 0, count * sizeof(uint32_t));
+    bufferBarrier = { pVisibleInstanceBuffer[gFrameIndex], RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 1, &bufferBarrier, 0, NULL, 0, NULL);
+}
+
+void KokkuTestApp::cullOcclusionCpu()
+{
+    const Geometry*    pGeom = mCastleScene.getGeometry();
+    const BoundingBox* pBounds = mCastleScene.getSubmeshBounds();
+    const uint32_t     instanceCount = getCityInstanceCount();
+
+    // This frame's readback slot was last written mFramesInFlight frames ago and its fence has passed.
+    // It holds level mHiZReadbackLevel, the coarser levels are rebuilt from it.
+    HiZPyramid pyramid = {};
+    const bool hiZValid = mHiZReadbackValid[gFrameIndex];
+    if (hiZValid)
+    {
+        pyramid.mDepthWidth = pDepthBuffer->mWidth;
+        pyramid.mDepthHeight = pDepthBuffer->mHeight;
+        pyramid.mViewportWidth = mHiZReadbackViewportSize[gFrameIndex][0];
+        pyramid.mViewportHeight = mHiZReadbackViewportSize[gFrameIndex][1];
+        pyramid.mFirstLevel = mHiZReadbackLevel;
+        pyramid.mLevelCount = mHiZLevelCount - mHiZReadbackLevel;
+
+        const float* src = (const float*)pHiZReadbackBuffer[gFrameIndex]->pCpuMappedAddress;
+        float*       dst = pHiZCpuLevels;
+        for (uint32_t i = 0; i < pyramid.mLevelCount; ++i)
+        {
+            hiZLevelSize(pyramid.mDepthWidth, pyramid.mDepthHeight, pyramid.mFirstLevel + i, &pyramid.mWidths[i], &pyramid.mHeights[i]);
+            if (i > 0)
+            {
+                hiZDownsample(src, pyramid.mWidths[i - 1], pyramid.mHeights[i - 1], dst);
+                src = dst;
+                dst += pyramid.mWidths[i] * pyramid.mHeights[i];
+            }
+            pyramid.pLevels[i] = src;
+        }
+    }
+
+    // Same packing the GPU uses, minus the gaps: the draws' regions follow each other
+    uint32_t* visibleInstances = (uint32_t*)pCpuVisibleInstanceBuffer[gFrameIndex]->pCpuMappedAddress;
+    mOcclusionVisibleCount = 0;
+    for (uint32_t d = 0; d < pGeom->mDrawArgCount; ++d)
+    {
+        pOcclusionInstanceOffsets[d] = mOcclusionVisibleCount;
+        for (uint32_t i = 0; i < instanceCount; ++i)
+        {
+            // Same grid as castleCity.comp
+            const float offset[3] = { (float)(i % mCityColumns) * mCastleCitySpacing[0], 0.0f,
+                                      (float)(i / mCityColumns) * mCastleCitySpacing[1] };
+            BoundingBox box = pBounds[d];
+            for (int a = 0; a < 3; ++a)
+            {
+                box.mMin[a] += offset[a];
+                box.mMax[a] += offset[a];
+            }
+
+            if (mFrustumCulling && !frustumIntersectsBox(&mCastleFrustum, &box))
+                continue;
+            if (hiZValid && !hiZIntersectsBox(&pyramid, mHiZReadbackObjectToClip[gFrameIndex], &box))
+                continue;
+
+            visibleInstances[mOcclusionVisibleCount++] = i;
+        }
+        pOcclusionInstanceCounts[d] = mOcclusionVisibleCount - pOcclusionInstanceOffsets[d];
+    }
+}
+
+void KokkuTestApp::selectCastleLods()
+{
+    const BoundingBox& bounds = mCastleScene.getBounds();
+    const uint32_t     instanceCount = getCityInstanceCount();
+    const uint32_t     lodCount = mCastleScene.getLodCount();
+
+    float center[3];
+    float radiusSq = 0.0f;
+    for (int a = 0; a < 3; ++a)
+    {
+        center[a] = (bounds.mMin[a] + bounds.mMax[a]) * 0.5f;
+        radiusSq += (bounds.mMax[a] - center[a]) * (bounds.mMax[a] - center[a]);
+    }
+    const float radius = sqrtf(radiusSq);
+
+    // Two passes over the instances: pick the levels, then write the instances grouped by level.
+    // Each level's group is shared by all draws, the lists only grow with the instance count.
+    memset(mLodInstanceCounts, 0, sizeof(mLodInstanceCounts));
+    for (uint32_t i = 0; i < instanceCount; ++i)
+    {
+        // Same grid as castleCity.comp
+        const float offset[3] = { (float)(i % mCityColumns) * mCastleCitySpacing[0], 0.0f, (float)(i / mCityColumns) * mCastleCitySpacing[1] };
+        pInstanceLods[i] = 0xFF;
+        if (mFrustumCulling)
+        {
+            BoundingBox box = bounds;
+            for (int a = 0; a < 3; ++a)
+            {
+                box.mMin[a] += offset[a];
+                box.mMax[a] += offset[a];
+            }
+            if (!frustumIntersectsBox(&mCastleFrustum, &box))
+                continue;
+        }
+
+        // Coarsest level whose error still projects under the threshold at the closest point of the bounding sphere
+        const float dx = center[0] + offset[0] - mCastleCameraPosition[0];
+        const float dy = center[1] + offset[1] - mCastleCameraPosition[1];
+        const float dz = center[2] + offset[2] - mCastleCameraPosition[2];
+        const float distance = sqrtf(dx * dx + dy * dy + dz * dz) - radius;
+        uint32_t    lod = 0;
+        if (distance > 0.0f)
+        {
+            const float maxError = mLodThreshold * distance / mLodPixelsPerUnit;
+            while (lod + 1 < lodCount && mCastleScene.getLodError(lod + 1) <= maxError)
+                ++lod;
+        }
+        pInstanceLods[i] = (uint8_t)lod;
+        ++mLodInstanceCounts[lod];
+    }
+
+    mLodVisibleCount = 0;
+    for (uint32_t lod = 0; lod < lodCount; ++lod)
+    {
+        mLodInstanceOffsets[lod] = mLodVisibleCount;
+        mLodVisibleCount += mLodInstanceCounts[lod];
+    }
+
+    // Only written, never read back: the buffer is write-combined
+    uint32_t* visibleInstances = (uint32_t*)pCpuVisibleInstanceBuffer[gFrameIndex]->pCpuMappedAddress;
+    uint32_t  written[CastleScene::MAX_LODS] = {};
+    for (uint32_t i = 0; i < instanceCount; ++i)
+    {
+        const uint8_t lod = pInstanceLods[i];
+        if (lod != 0xFF)
+            visibleInstances[mLodInstanceOffsets[lod] + written[lod]++] = i;
+    }
+}
+
+uint64_t KokkuTestApp::countCastleTriangles(CastleDrawSource source)
+{
+    const Geometry* pGeom = mCastleScene.getGeometry();
+    uint64_t        triangles = 0;
+    switch (source)
+    {
+    case CASTLE_DRAW_OCCLUSION_CPU:
+        for (uint32_t i = 0; i < pGeom->mDrawArgCount; ++i)
+            triangles += (uint64_t)pOcclusionInstanceCounts[i] * (pGeom->pDrawArgs[i].mIndexCount / 3);
+        break;
+    case CASTLE_DRAW_LOD:
+        for (uint32_t lod = 0; lod < mCastleScene.getLodCount(); ++lod)
+            for (uint32_t i = 0; i < mVisibleDrawCount; ++i)
+                triangles += (uint64_t)mLodInstanceCounts[lod] * (mCastleScene.getLodDrawArgs(pVisibleDraws[i], lod).mIndexCount / 3);
+        break;
+    default:
+        for (uint32_t i = 0; i < mVisibleDrawCount; ++i)
+            triangles += (uint64_t)getCityInstanceCount() * (pGeom->pDrawArgs[pVisibleDraws[i]].mIndexCount / 3);
+        break;
+    }
+    return triangles;
+}
+
+void KokkuTestApp::buildHiZ(Cmd* cmd)
+{
+    const bool readback = !mGpuOcclusionCulling;
+
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Hi-Z Build");
+
+    BufferBarrier       bufferBarrier = { pHiZReadbackGpuBuffer, RESOURCE_STATE_COPY_SOURCE, RESOURCE_STATE_UNORDERED_ACCESS };
+    TextureBarrier      textureBarrier = { pHiZ, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS };
+    RenderTargetBarrier depthBarrier = { pDepthBuffer, RESOURCE_STATE_DEPTH_WRITE, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 1, &bufferBarrier, 1, &textureBarrier, 1, &depthBarrier);
+
+    cmdBindPipeline(cmd, pHiZBuildPipeline);
+    for (uint32_t level = 0; level < mHiZLevelCount; ++level)
+    {
+        HiZBuildConstants constants = {};
+        if (level == 0)
+        {
+            constants.mSrcSize[0] = pDepthBuffer->mWidth;
+            constants.mSrcSize[1] = pDepthBuffer->mHeight;
+        }
+        else
+        {
+            hiZLevelSize(pDepthBuffer->mWidth, pDepthBuffer->mHeight, level - 1, &constants.mSrcSize[0], &constants.mSrcSize[1]);
+        }
+        hiZLevelSize(pDepthBuffer->mWidth, pDepthBuffer->mHeight, level, &constants.mDstSize[0], &constants.mDstSize[1]);
+        constants.mSrcLevel = level == 0 ? 0 : level - 1;
+        constants.mReadback = readback && level == mHiZReadbackLevel ? 1 : 0;
+
+        cmdBindDescriptorSet(cmd, level, pDescriptorSetHiZBuild);
+        cmdBindPushConstants(cmd, pHiZBuildRootSignature, mHiZBuildConstantsIndex, &constants);
+        cmdDispatch(cmd, (constants.mDstSize[0] + gHiZBuildThreads - 1) / gHiZBuildThreads,
+                    (constants.mDstSize[1] + gHiZBuildThreads - 1) / gHiZBuildThreads, 1);
+
+        // The next level reads this one, so every level ends up back in SHADER_RESOURCE
+        textureBarrier = { pHiZ, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE };
+        textureBarrier.mSubresourceBarrier = 1;
+        textureBarrier.mMipLevel = (uint8_t)level;
+        cmdResourceBarrier(cmd, 0, NULL, 1, &textureBarrier, 0, NULL);
+    }
+
+    bufferBarrier = { pHiZReadbackGpuBuffer, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_COPY_SOURCE };
+    depthBarrier = { pDepthBuffer, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_DEPTH_WRITE };
+    cmdResourceBarrier(cmd, 1, &bufferBarrier, 0, NULL, 1, &depthBarrier);
+
+    if (readback)
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        hiZLevelSize(pDepthBuffer->mWidth, pDepthBuffer->mHeight, mHiZReadbackLevel, &width, &height);
+        cmdUpdateBuffer(cmd, pHiZReadbackBuffer[gFrameIndex], 0, pHiZReadbackGpuBuffer, 0, width * height * sizeof(float));
+        memcpy(mHiZReadbackObjectToClip[gFrameIndex], mCastleObjectToClip, sizeof(mCastleObjectToClip));
+        mHiZReadbackViewportSize[gFrameIndex][0] = mRenderWidth;
+        mHiZReadbackViewportSize[gFrameIndex][1] = mRenderHeight;
+    }
+    mHiZReadbackValid[gFrameIndex] = readback;
+
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+
+    // Culled against by the next frame
+    memcpy(mHiZObjectToClip, mCastleObjectToClip, sizeof(mCastleObjectToClip));
+    mHiZViewportSize[0] = (float)mRenderWidth;
+    mHiZViewportSize[1] = (float)mRenderHeight;
+    mHiZValid = true;
+}
+
+void KokkuTestApp::addLightBuffers()
+{
+    BufferLoadDesc lightDesc = {};
+    lightDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+    lightDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+    lightDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+    lightDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    lightDesc.mDesc.mElementCount = CLUSTER_MAX_LIGHTS * 2;
+    lightDesc.mDesc.mStructStride = sizeof(float) * 4;
+    lightDesc.mDesc.mSize = sizeof(PointLight) * CLUSTER_MAX_LIGHTS;
+    lightDesc.mDesc.pName = "Point lights";
+
+    BufferLoadDesc clusterDesc = lightDesc;
+    clusterDesc.mDesc.mElementCount = CLUSTER_COUNT;
+    clusterDesc.mDesc.mStructStride = sizeof(uint32_t) * 2;
+    clusterDesc.mDesc.mSize = sizeof(uint32_t) * 2 * CLUSTER_COUNT;
+    clusterDesc.mDesc.pName = "Light clusters";
+
+    BufferLoadDesc indexDesc = lightDesc;
+    indexDesc.mDesc.mElementCount = CLUSTER_MAX_LIGHT_INDICES;
+    indexDesc.mDesc.mStructStride = sizeof(uint32_t);
+    indexDesc.mDesc.mSize = sizeof(uint32_t) * CLUSTER_MAX_LIGHT_INDICES;
+    indexDesc.mDesc.pName = "Light indices";
+
+    SyncToken token = {};
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        lightDesc.ppBuffer = &pLightBuffer[i];
+        addResource(&lightDesc, &token);
+        clusterDesc.ppBuffer = &pLightClusterBuffer[i];
+        addResource(&clusterDesc, &token);
+        indexDesc.ppBuffer = &pLightIndexBuffer[i];
+        addResource(&indexDesc, &token);
+    }
+    waitForToken(&token);
+
+    // Empty clusters until the first binning
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+        memset(pLightClusterBuffer[i]->pCpuMappedAddress, 0, sizeof(uint32_t) * 2 * CLUSTER_COUNT);
+}
+
+void KokkuTestApp::removeLightBuffers()
+{
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        removeResource(pLightBuffer[i]);
+        removeResource(pLightClusterBuffer[i]);
+        removeResource(pLightIndexBuffer[i]);
+    }
+}
+
+void KokkuTestApp::placeLights()
+{
+    pLights = (PointLight*)tf_calloc(CLUSTER_MAX_LIGHTS, sizeof(PointLight));
+    pLightPlacements = (LightPlacement*)tf_calloc(CLUSTER_MAX_LIGHTS, sizeof(LightPlacement));
+    pClusterBinScratch = (ClusterBinScratch*)tf_calloc(1, sizeof(ClusterBinScratch));
+
+    // Fixed seed, so benchmark runs see the same lights
+    uint32_t seed = 0x4B4F4B4Bu;
+    auto random01 = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (float)(seed >> 8) / (float)(1u << 24);
+    };
+
+    for (uint32_t i = 0; i < CLUSTER_MAX_LIGHTS; ++i)
+    {
+        pLightPlacements[i] = { random01(), random01(), random01(), random01() * 2.0f * PI };
+
+        // Saturated colors: one channel full, the others random
+        float color[3] = { random01(), random01(), random01() };
+        color[i % 3] = 1.0f;
+        memcpy(pLights[i].mColor, color, sizeof(color));
+        pLights[i].mIntensity = 1.0f;
+    }
+}
+
+void KokkuTestApp::updateLights(float time)
+{
+    // Spread over the whole city, a light reaches about a tenth of a castle
+    const BoundingBox& bounds = mCastleScene.getBounds();
+    const float        castleSize[3] = { bounds.mMax[0] - bounds.mMin[0], bounds.mMax[1] - bounds.mMin[1], bounds.mMax[2] - bounds.mMin[2] };
+    const float        citySize[2] = { castleSize[0] + (mCityColumns - 1) * mCastleCitySpacing[0],
+                                       castleSize[2] + (mCityRows - 1) * mCastleCitySpacing[1] };
+    const float        radius = 0.1f * fmaxf(castleSize[0], castleSize[2]) * gCastleScale;
+
+    for (uint32_t i = 0; i < mLightCount; ++i)
+    {
+        const LightPlacement& placement = pLightPlacements[i];
+        const float           bob = 0.1f * castleSize[1] * sinf(time * 0.001f + placement.mPhase);
+        pLights[i].mPosition[0] = (bounds.mMin[0] + placement.mU * citySize[0]) * gCastleScale;
+        pLights[i].mPosition[1] = (bounds.mMin[1] + placement.mHeight * castleSize[1] + bob) * gCastleScale;
+        pLights[i].mPosition[2] = (bounds.mMin[2] + placement.mV * citySize[1]) * gCastleScale;
+        pLights[i].mRadius = radius;
+    }
+}
+
+void KokkuTestApp::binLights()
+{
+    memcpy(pLightBuffer[gFrameIndex]->pCpuMappedAddress, pLights, mLightCount * sizeof(PointLight));
+
+    int64_t startUSec = getUSec(true);
+    clusterLightRanges(&mClusterCamera, pLights, mLightCount, pClusterBinScratch);
+    int64_t endUSec = getUSec(true);
+    mLightRangesMs = (endUSec - startUSec) / 1000.0f;
+
+    startUSec = endUSec;
+    clusterScatterLights(mLightCount, pClusterBinScratch, (uint32_t*)pLightClusterBuffer[gFrameIndex]->pCpuMappedAddress,
+                         (uint32_t*)pLightIndexBuffer[gFrameIndex]->pCpuMappedAddress, &mClusterBinStats);
+    endUSec = getUSec(true);
+    mLightScatterMs = (endUSec - startUSec) / 1000.0f;
+}
+
+void KokkuTestApp::drawCastleGeometry(Cmd* cmd, CastleDrawSource source, bool positionsOnly)
+{
+    Geometry* pGeom = mCastleScene.getGeometry();
+    cmdBindVertexBuffer(cmd, mCastleScene.getVertexBufferCount(positionsOnly), mCastleScene.getVertexBuffers(),
+                        mCastleScene.getVertexStrides(), nullptr);
+
+    DrawConstants constants = {};
+    constants.mVisibleInstanceOffset = NO_INSTANCE_CULLING;
+    switch (source)
+    {
+    case CASTLE_DRAW_MESHLET_CULLED:
+        // Index counts come from meshletCull.comp, draws culled on the CPU are skipped altogether
+        cmdBindIndexBuffer(cmd, pFilteredIndexBuffer[gFrameIndex], INDEX_TYPE_UINT32, 0);
+        for (uint32_t i = 0; i < mVisibleDrawCount; ++i)
+        {
+            constants.mMaterialIndex = pVisibleDraws[i];
+            cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &constants);
+            cmdExecuteIndirect(cmd, pCastleCommandSignature, 1, pCastleDrawArgsBuffer[gFrameIndex],
+                               pVisibleDraws[i] * sizeof(IndirectDrawIndexArguments), NULL, 0);
+        }
+        break;
+    case CASTLE_DRAW_OCCLUSION_GPU:
+        // Instance counts come from occlusionCull.comp, which also did the frustum culling. The castle index buffer is
+        // 16 or 32-bit depending on the file, the draw args are the same either way
+        cmdBindIndexBuffer(cmd, pGeom->pIndexBuffer, (IndexType)pGeom->mIndexType, 0);
+        for (uint32_t i = 0; i < pGeom->mDrawArgCount; ++i)
+        {
+            constants.mMaterialIndex = i;
+            constants.mVisibleInstanceOffset = i * getCityInstanceCount();
+            cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &constants);
+            cmdExecuteIndirect(cmd, pCastleCommandSignature, 1, pOcclusionDrawArgsBuffer[gFrameIndex],
+                               i * sizeof(IndirectDrawIndexArguments), NULL, 0);
+        }
+        break;
+    case CASTLE_DRAW_OCCLUSION_CPU:
+        cmdBindIndexBuffer(cmd, pGeom->pIndexBuffer, (IndexType)pGeom->mIndexType, 0);
+        for (uint32_t i = 0; i < pGeom->mDrawArgCount; ++i)
+        {
+            if (pOcclusionInstanceCounts[i] == 0)
+                continue;
+
+            const IndirectDrawIndexArguments& args = pGeom->pDrawArgs[i];
+            constants.mMaterialIndex = i;
+            constants.mVisibleInstanceOffset = pOcclusionInstanceOffsets[i];
+            cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &constants);
+            cmdDrawIndexedInstanced(cmd, args.mIndexCount, args.mStartIndex, pOcclusionInstanceCounts[i], args.mVertexOffset, 0);
+        }
+        break;
+    case CASTLE_DRAW_LOD:
+        // The LOD index ranges are already rebased, like the meshlet culled indices
+        cmdBindIndexBuffer(cmd, mCastleScene.getMeshletIndexBuffer(), INDEX_TYPE_UINT32, 0);
+        for (uint32_t lod = 0; lod < mCastleScene.getLodCount(); ++lod)
+        {
+            if (mLodInstanceCounts[lod] == 0)
+                continue;
+
+            constants.mVisibleInstanceOffset = mLodInstanceOffsets[lod];
+            constants.mLodLevel = lod;
+            for (uint32_t i = 0; i < mVisibleDrawCount; ++i)
+            {
+                const IndirectDrawIndexArguments& args = mCastleScene.getLodDrawArgs(pVisibleDraws[i], lod);
+                constants.mMaterialIndex = pVisibleDraws[i];
+                cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &constants);
+                cmdDrawIndexedInstanced(cmd, args.mIndexCount, args.mStartIndex, mLodInstanceCounts[lod], 0, 0);
+            }
+        }
+        break;
+    default:
+        cmdBindIndexBuffer(cmd, pGeom->pIndexBuffer, (IndexType)pGeom->mIndexType, 0);
+        for (uint32_t i = 0; i < mVisibleDrawCount; ++i)
+        {
+            const IndirectDrawIndexArguments& args = pGeom->pDrawArgs[pVisibleDraws[i]];
+            constants.mMaterialIndex = pVisibleDraws[i];
+            cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &constants);
+            cmdDrawIndexedInstanced(cmd, args.mIndexCount, args.mStartIndex, getCityInstanceCount(), args.mVertexOffset, 0);
+        }
+        break;
+    }
+}
+
+void KokkuTestApp::bindUniformSet(Cmd* cmd, DescriptorSet* pSet, uint32_t index, const FrameUploadBlock& block)
+{
+    DescriptorDataRange range = { block.mOffset, block.mSize };
+    Buffer* pBuffer = block.pBuffer;
+    DescriptorData param = {};
+    param.pName = "uniformBlock_rootcbv";
+    param.pRanges = &range;
+    param.ppBuffers = &pBuffer;
+    cmdBindDescriptorSetWithRootCbvs(cmd, index, pSet, 1, &param);
+}
+
+void KokkuTestApp::runUploadRingBenchmark(Cmd* cmd)
+{
+    // What a draw loop with a constant block per draw costs on the CPU: the allocation and copy, then the bind
+    DrawConstants constants = {};
+    constants.mVisibleInstanceOffset = NO_INSTANCE_CULLING;
+    const int64_t startUSec = getUSec(true);
+    uint32_t allocated = 0;
+    for (; allocated < mUploadRingBenchmarkDraws; ++allocated)
+    {
+        constants.mMaterialIndex = allocated;
+        if (!mUploadRing.Upload(&constants, sizeof(constants), &pUploadRingBenchmarkBlocks[allocated]))
+            break;
+    }
+    const int64_t allocEndUSec = getUSec(true);
+    for (uint32_t i = 0; i < allocated; ++i)
+        bindUniformSet(cmd, pDescriptorSetUniforms, gFrameIndex * 2 + 1, pUploadRingBenchmarkBlocks[i]);
+    const int64_t bindEndUSec = getUSec(true);
+
+    const uint32_t sample = mUploadRingBenchmarkFrames++ % UPLOAD_RING_BENCHMARK_SAMPLES;
+    mUploadRingAllocMs[sample] = (allocEndUSec - startUSec) / 1000.0f;
+    mUploadRingBindMs[sample] = (bindEndUSec - allocEndUSec) / 1000.0f;
+}
+
+void KokkuTestApp::reportUploadRingBenchmark()
+{
+    if (mUploadRingBenchmarkFrames == 0)
+        return;
+
+    const uint32_t count =
+        mUploadRingBenchmarkFrames < UPLOAD_RING_BENCHMARK_SAMPLES ? mUploadRingBenchmarkFrames : UPLOAD_RING_BENCHMARK_SAMPLES;
+    const FrameTimeStats alloc = FrameBenchmark::ComputeStats(mUploadRingAllocMs, count);
+    const FrameTimeStats bind = FrameBenchmark::ComputeStats(mUploadRingBindMs, count);
+    LOGF(eINFO, "[UploadRing] %u draws/frame over the last %u frames, %u B blocks", mUploadRingBenchmarkDraws, count,
+         mUploadRing.GetAlignment());
+    LOGF(eINFO, "[UploadRing] allocate + copy ms: avg %.3f p99 %.3f max %.3f (%.1f ns per draw)", alloc.mAvg, alloc.mP99, alloc.mMax,
+         alloc.mAvg * 1.0e6f / mUploadRingBenchmarkDraws);
+    LOGF(eINFO, "[UploadRing] bind ms: avg %.3f p99 %.3f max %.3f (%.1f ns per draw)", bind.mAvg, bind.mP99, bind.mMax,
+         bind.mAvg * 1.0e6f / mUploadRingBenchmarkDraws);
+    LOGF(eINFO, "[UploadRing] high-water mark %u of %u KB per frame, %llu allocations overflowed", mUploadRing.GetHighWater() / 1024,
+         mUploadRing.GetFrameCapacity() / 1024, (unsigned long long)mUploadRing.GetTotalOverflows());
+}
+
+void KokkuTestApp::drawDepthPrepass(Cmd* cmd, CastleDrawSource source)
+{
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Depth Prepass");
+
+    BindRenderTargetsDesc bindRenderTargets = {};
+    bindRenderTargets.mDepthStencil = { pDepthBuffer, LOAD_ACTION_CLEAR };
+    cmdBindRenderTargets(cmd, &bindRenderTargets);
+    cmdSetViewport(cmd, 0.0f, 0.0f, (float)mRenderWidth, (float)mRenderHeight, 0.0f, 1.0f);
+    cmdSetScissor(cmd, 0, 0, mRenderWidth, mRenderHeight);
+
+    cmdBindPipeline(cmd, pDepthPrepassPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
+    bindUniformSet(cmd, pDescriptorSetUniforms, gFrameIndex * 2 + 1, mCastleUniforms);
+    // Positions only
+    drawCastleGeometry(cmd, source, true);
+    cmdBindRenderTargets(cmd, NULL);
+
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+}
+
+void KokkuTestApp::loadSkyBoxFaces()
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        TextureLoadDesc textureDesc = {};
+        textureDesc.pFileName = pSkyBoxImageFileNames[i];
+        textureDesc.ppTexture = &pSkyBoxFaces[i];
+        // Textures representing color should be stored in SRGB or HDR format
+        textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
+        addResource(&textureDesc, &mSkyBoxFacesToken);
+    }
+}
+
+void KokkuTestApp::bakeSkyBoxCube()
+{
+    waitForToken(&mSkyBoxFacesToken);
+    Texture** faces = pSkyBoxFaces;
+
+    // Same resolution as the faces, so each cubemap texel maps to about one face texel
+    RenderTargetDesc cubeDesc = {};
+    cubeDesc.mArraySize = 6;
+    cubeDesc.mDepth = 1;
+    cubeDesc.mWidth = faces[0]->mWidth;
+    cubeDesc.mHeight = faces[0]->mHeight;
+    cubeDesc.mFormat = TinyImageFormat_R8G8B8A8_SRGB;
+    cubeDesc.mSampleCount = SAMPLE_COUNT_1;
+    cubeDesc.mSampleQuality = 0;
+    cubeDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    cubeDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE_CUBE | DESCRIPTOR_TYPE_RENDER_TARGET_ARRAY_SLICES;
+    cubeDesc.pName = "Skybox cubemap";
+    addRenderTarget(pRenderer, &cubeDesc, &pSkyBoxCube);
+
+    // One-off bake pipeline, released again below
+    ShaderLoadDesc bakeShaderDesc = {};
+    bakeShaderDesc.mStages[0].pFileName = "skybox.vert";
+    bakeShaderDesc.mStages[1].pFileName = "skyboxCube.frag";
+    Shader* pBakeShader = NULL;
+    addShader(pRenderer, &bakeShaderDesc, &pBakeShader);
+
+    RootSignatureDesc bakeRootDesc = {};
+    bakeRootDesc.mShaderCount = 1;
+    bakeRootDesc.ppShaders = &pBakeShader;
+    RootSignature* pBakeRootSignature = NULL;
+    addRootSignature(pRenderer, &bakeRootDesc, &pBakeRootSignature);
+    const uint32_t bakeConstantsIndex = getDescriptorIndexFromName(pBakeRootSignature, "skyboxCubeConstants");
+
+    DescriptorSetDesc setDesc = { pBakeRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    DescriptorSet* pBakeDescriptorSet = NULL;
+    addDescriptorSet(pRenderer, &setDesc, &pBakeDescriptorSet);
+
+    static const char* faceNames[6] = { "RightText", "LeftText", "TopText", "BotText", "FrontText", "BackText" };
+    DescriptorData params[7] = {};
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        params[i].pName = faceNames[i];
+        params[i].ppTextures = &faces[i];
+    }
+    params[6].pName = "faceSampler";
+    params[6].ppSamplers = &pSamplerSkyBox;
+    updateDescriptorSet(pRenderer, 0, pBakeDescriptorSet, 7, params);
+
+    RasterizerStateDesc rasterizerStateDesc = {};
+    rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+    PipelineDesc desc = {};
+    desc.pCache = mPipelineCache.GetCache();
+    desc.mType = PIPELINE_TYPE_GRAPHICS;
+    GraphicsPipelineDesc& pipelineSettings = desc.mGraphicsDesc;
+    pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+    pipelineSettings.mRenderTargetCount = 1;
+    pipelineSettings.pColorFormats = &pSkyBoxCube->mFormat;
+    pipelineSettings.mSampleCount = SAMPLE_COUNT_1;
+    pipelineSettings.mSampleQuality = 0;
+    pipelineSettings.mDepthStencilFormat = TinyImageFormat_UNDEFINED;
+    pipelineSettings.pRootSignature = pBakeRootSignature;
+    pipelineSettings.pShaderProgram = pBakeShader;
+    pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+    Pipeline* pBakePipeline = NULL;
+    addPipeline(pRenderer, &desc, &pBakePipeline);
+
+    GpuCmdRingElement elem = getNextGpuCmdRingElement(&gGraphicsCmdRing, true, 1);
+    resetCmdPool(pRenderer, elem.pCmdPool);
+    Cmd* cmd = elem.pCmds[0];
+    beginCmd(cmd);
+
+    RenderTargetBarrier barrier = { pSkyBoxCube, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_RENDER_TARGET };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
+
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        BindRenderTargetsDesc bindRenderTargets = {};
+        bindRenderTargets.mRenderTargetCount = 1;
+        bindRenderTargets.mRenderTargets[0] = { pSkyBoxCube, LOAD_ACTION_DONTCARE };
+        bindRenderTargets.mRenderTargets[0].mArraySlice = face;
+        bindRenderTargets.mRenderTargets[0].mUseArraySlice = true;
+        cmdBindRenderTargets(cmd, &bindRenderTargets);
+        cmdSetViewport(cmd, 0.0f, 0.0f, (float)pSkyBoxCube->mWidth, (float)pSkyBoxCube->mHeight, 0.0f, 1.0f);
+        cmdSetScissor(cmd, 0, 0, pSkyBoxCube->mWidth, pSkyBoxCube->mHeight);
+
+        cmdBindPipeline(cmd, pBakePipeline);
+        cmdBindDescriptorSet(cmd, 0, pBakeDescriptorSet);
+        cmdBindPushConstants(cmd, pBakeRootSignature, bakeConstantsIndex, &face);
+        cmdDraw(cmd, 3, 0);
+    }
+    cmdBindRenderTargets(cmd, NULL);
+
+    barrier = { pSkyBoxCube, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_SHADER_RESOURCE };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
+    endCmd(cmd);
+
+    QueueSubmitDesc submitDesc = {};
+    submitDesc.mCmdCount = 1;
+    submitDesc.ppCmds = &cmd;
+    submitDesc.pSignalFence = elem.pFence;
+    queueSubmit(pGraphicsQueue, &submitDesc);
+    waitQueueIdle(pGraphicsQueue);
+
+    removePipeline(pRenderer, pBakePipeline);
+    removeDescriptorSet(pRenderer, pBakeDescriptorSet);
+    removeRootSignature(pRenderer, pBakeRootSignature);
+    removeShader(pRenderer, pBakeShader);
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        removeResource(faces[i]);
+        faces[i] = NULL;
+    }
+
+    LOGF(eINFO, "Baked the skybox faces into a %ux%u cubemap", pSkyBoxCube->mWidth, pSkyBoxCube->mHeight);
+}
+
+void KokkuTestApp::addFrameResources()
+{
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        QueryPoolDesc poolDesc = {};
+        poolDesc.mQueryCount = 4; // The count is 4 due to quest & multi-view use otherwise 3 is enough as we use 3 queries.
+        poolDesc.mType = QUERY_TYPE_PIPELINE_STATISTICS;
+        for (uint32_t i = 0; i < mFramesInFlight; ++i)
+        {
+            addQueryPool(pRenderer, &poolDesc, &pPipelineStatsQueryPool[i]);
+        }
+    }
+
+    if (mMetrics.IsActive())
+    {
+        QueryPoolDesc poolDesc = {};
+        poolDesc.mQueryCount = METRICS_QUERY_COUNT;
+        poolDesc.mType = QUERY_TYPE_TIMESTAMP;
+        for (uint32_t i = 0; i < mFramesInFlight; ++i)
+            addQueryPool(pRenderer, &poolDesc, &pMetricsQueryPool[i]);
+        getTimestampFrequency(pGraphicsQueue, &mTimestampFrequency);
+    }
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        mMetricsSlotFrames[i] = MetricsExport::INVALID_FRAME;
+
+    GpuCmdRingDesc cmdRingDesc = {};
+    cmdRingDesc.pQueue = pGraphicsQueue;
+    cmdRingDesc.mPoolCount = mFramesInFlight;
+    cmdRingDesc.mCmdPerPoolCount = 1;
+    cmdRingDesc.mAddSyncPrimitives = true;
+    addGpuCmdRing(pRenderer, &cmdRingDesc, &gGraphicsCmdRing);
+
+    // The frame's constants, then --upload-ring-kb for the rest and one aligned block per benchmark draw
+    const uint32_t frameConstantsSize = FrameUploadRing::GetAlignedSize(pRenderer, sizeof(gUniformData)) +
+                                        FrameUploadRing::GetAlignedSize(pRenderer, sizeof(gUniformDataSky));
+    const uint32_t benchmarkSize = mUploadRingBenchmarkDraws * FrameUploadRing::GetAlignedSize(pRenderer, sizeof(DrawConstants));
+    mUploadRing.Init(pRenderer, mFramesInFlight, frameConstantsSize + mUploadRingKb * 1024 + benchmarkSize, "Frame upload ring");
+}
+
+void KokkuTestApp::removeFrameResources()
+{
+    mUploadRing.Exit();
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        // Every caller waited for the queue, so the frames still in flight have their results
+        readFrameMetrics(i);
+        if (pMetricsQueryPool[i])
+        {
+            removeQueryPool(pRenderer, pMetricsQueryPool[i]);
+            pMetricsQueryPool[i] = NULL;
+        }
+
+        if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+        {
+            removeQueryPool(pRenderer, pPipelineStatsQueryPool[i]);
+            pPipelineStatsQueryPool[i] = NULL;
+        }
+    }
+
+    removeGpuCmdRing(pRenderer, &gGraphicsCmdRing);
+}
+
+void KokkuTestApp::setFramesInFlight(uint32_t count)
+{
+    // Everything sized by the frame count is rebuilt, so the GPU must be done with all of it
+    waitQueueIdle(pGraphicsQueue);
+
+    removeDescriptorSets();
+    removeMeshletCullBuffers();
+    removeOcclusionCullBuffers();
+    removeLightBuffers();
+    removeFrameResources();
+
+    mFramesInFlight = count;
+
+    addFrameResources();
+    addMeshletCullBuffers();
+    addOcclusionCullBuffers();
+    addLightBuffers();
+    addDescriptorSets();
+    prepareDescriptorSets();
+
+    gFrameIndex = 0;
+    mFrameTelemetry.Reset();
+    mLastPresentUSec = 0;
+    mTelemetryUIRefreshUSec = 0;
+    LOGF(eINFO, "Frames in flight: %u", mFramesInFlight);
+}
+
+void KokkuTestApp::updateFrameTelemetry(const FrameTelemetrySample& sample, int64_t nowUSec)
+{
+    mFrameTelemetry.AddFrame(sample);
+
+    // Headless runs have no UI, Report computes their stats once at the end
+    if (mHeadless || nowUSec - mTelemetryUIRefreshUSec < TELEMETRY_UI_REFRESH_USEC)
+        return;
+    mTelemetryUIRefreshUSec = nowUSec;
+
+    mFrameTelemetry.UpdateHistograms();
+
+    bformat(&gFramePacing, "\nFrames in flight: %u (last %u frames)\n", mFramesInFlight, mFrameTelemetry.GetSampleCount());
+    for (uint32_t m = 0; m < FRAME_TELEMETRY_METRIC_COUNT; ++m)
+    {
+        const FrameTelemetryMetric metric = (FrameTelemetryMetric)m;
+        const FrameTimeStats       stats = mFrameTelemetry.ComputeStats(metric);
+        bformata(&gFramePacing, "%s ms: avg %.3f p99 %.3f max %.3f\n", FrameTelemetry::GetMetricName(metric), stats.mAvg, stats.mP99,
+                 stats.mMax);
+
+        snprintf(mTelemetryTitles[m], sizeof(mTelemetryTitles[m]), "%s, 0 - %.1f ms", FrameTelemetry::GetMetricName(metric),
+                 mFrameTelemetry.GetHistogramRangeMs(metric));
+        mTelemetryHistogramMax[m] = mFrameTelemetry.GetHistogramPeak(metric);
+    }
+}
+
+void KokkuTestApp::beginMetricsQuery(Cmd* cmd, uint32_t query)
+{
+    if (pMetricsQueryPool[gFrameIndex])
+    {
+        QueryDesc queryDesc = { query };
+        cmdBeginQuery(cmd, pMetricsQueryPool[gFrameIndex], &queryDesc);
+    }
+}
+
+void KokkuTestApp::endMetricsQuery(Cmd* cmd, uint32_t query)
+{
+    if (pMetricsQueryPool[gFrameIndex])
+    {
+        QueryDesc queryDesc = { query };
+        cmdEndQuery(cmd, pMetricsQueryPool[gFrameIndex], &queryDesc);
+    }
+}
+
+void KokkuTestApp::readFrameMetrics(uint32_t frameIndex)
+{
+    const uint32_t frame = mMetricsSlotFrames[frameIndex];
+    if (frame == MetricsExport::INVALID_FRAME)
+        return;
+    mMetricsSlotFrames[frameIndex] = MetricsExport::INVALID_FRAME;
+
+    static const MetricsColumn timestampColumns[METRICS_QUERY_COUNT] = { METRICS_GPU_FRAME_MS, METRICS_GPU_CASTLE_MS,
+                                                                         METRICS_GPU_SKYBOX_MS, METRICS_GPU_UI_MS };
+    for (uint32_t q = 0; q < METRICS_QUERY_COUNT; ++q)
+    {
+        QueryData data = {};
+        getQueryData(pRenderer, pMetricsQueryPool[frameIndex], q, &data);
+        if (data.mEndTimestamp >= data.mBeginTimestamp)
+            mMetrics.Set(frame, timestampColumns[q], (data.mEndTimestamp - data.mBeginTimestamp) * 1000.0 / mTimestampFrequency);
+    }
+
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        QueryData data3D = {};
+        QueryData data2D = {};
+        QueryData dataSky = {};
+        getQueryData(pRenderer, pPipelineStatsQueryPool[frameIndex], 0, &data3D);
+        getQueryData(pRenderer, pPipelineStatsQueryPool[frameIndex], 1, &data2D);
+        getQueryData(pRenderer, pPipelineStatsQueryPool[frameIndex], 2, &dataSky);
+        mMetrics.Set(frame, METRICS_CASTLE_VS_INVOCATIONS, (double)data3D.mPipelineStats.mVSInvocations);
+        mMetrics.Set(frame, METRICS_CASTLE_PS_INVOCATIONS, (double)data3D.mPipelineStats.mPSInvocations);
+        mMetrics.Set(frame, METRICS_CASTLE_IA_PRIMITIVES, (double)data3D.mPipelineStats.mIAPrimitives);
+        mMetrics.Set(frame, METRICS_CASTLE_CLIPPER_PRIMITIVES, (double)data3D.mPipelineStats.mCPrimitives);
+        mMetrics.Set(frame, METRICS_SKYBOX_PS_INVOCATIONS, (double)dataSky.mPipelineStats.mPSInvocations);
+        mMetrics.Set(frame, METRICS_UI_VS_INVOCATIONS, (double)data2D.mPipelineStats.mVSInvocations);
+        mMetrics.Set(frame, METRICS_UI_PS_INVOCATIONS, (double)data2D.mPipelineStats.mPSInvocations);
+    }
+
+    mMetrics.Complete(frame);
+}
+
+void KokkuTestApp::Draw()
+{
+    const int64_t drawStartUSec = getUSec(true);
+
+    if (mRequestedFramesInFlight != mFramesInFlight)
+        setFramesInFlight(mRequestedFramesInFlight);
+    if (getCityInstanceCount() != mVisibleInstanceCapacity)
+        resizeVisibleInstanceBuffers();
+
+    uint32_t metricsFrame = MetricsExport::INVALID_FRAME;
+    if (mMetricsSkipFrames > 0)
+        --mMetricsSkipFrames;
+    else
+        metricsFrame = mMetrics.BeginFrame();
+
+    if (!mHeadless && pSwapChain->mEnableVsync != mSettings.mVSyncEnabled)
+    {
+        waitQueueIdle(pGraphicsQueue);
+        ::toggleVSync(pRenderer, &pSwapChain);
+    }
+
+    FrameTelemetrySample telemetry = {};
+    int64_t              telemetryStartUSec = getUSec(true);
+
+    uint32_t swapchainImageIndex = 0;
+    if (!mHeadless)
+        acquireNextImage(pRenderer, pSwapChain, pImageAcquiredSemaphore, NULL, &swapchainImageIndex);
+
+    int64_t telemetryEndUSec = getUSec(true);
+    telemetry.mMs[FRAME_TELEMETRY_ACQUIRE] = (telemetryEndUSec - telemetryStartUSec) / 1000.0f;
+
+    // The offscreen target sits in SHADER_RESOURCE between frames, the swapchain images in PRESENT
+    const ResourceState backBufferState = mHeadless ? RESOURCE_STATE_SHADER_RESOURCE : RESOURCE_STATE_PRESENT;
+    RenderTarget* pRenderTarget = getBackBuffer(swapchainImageIndex);
+    GpuCmdRingElement elem = getNextGpuCmdRingElement(&gGraphicsCmdRing, true, 1);
+
+    // Stall if CPU is running "mFramesInFlight" frames ahead of GPU
+    telemetryStartUSec = getUSec(true);
+    FenceStatus fenceStatus;
+    getFenceStatus(pRenderer, elem.pFence, &fenceStatus);
+    if (fenceStatus == FENCE_STATUS_INCOMPLETE)
+        waitForFences(pRenderer, 1, &elem.pFence);
+    telemetryEndUSec = getUSec(true);
+    telemetry.mMs[FRAME_TELEMETRY_FENCE_WAIT] = (telemetryEndUSec - telemetryStartUSec) / 1000.0f;
+
+    // The slot's previous frame is done on the GPU, its queries are reused below
+    readFrameMetrics(gFrameIndex);
+    mMetricsSlotFrames[gFrameIndex] = metricsFrame;
+
+    // Update uniform buffers. The frame's constants go first into the room addFrameResources reserved for them.
+    mUploadRing.BeginFrame(gFrameIndex);
+    if (!mUploadRing.Upload(&gUniformData, sizeof(gUniformData), &mCastleUniforms) ||
+        !mUploadRing.Upload(&gUniformDataSky, sizeof(gUniformDataSky), &mSkyUniforms))
+    {
+        // The blocks that failed still point at the constants of the frame before
+        LOGF(eERROR, "Upload ring: the frame constants don't fit in %u KB per frame, drawing with the previous ones",
+             mUploadRing.GetFrameCapacity() / 1024);
+    }
+
+    BufferUpdateDesc meshletCullCbv = { pMeshletCullUniformBuffer[gFrameIndex] };
+    beginUpdateResource(&meshletCullCbv);
+    memcpy(meshletCullCbv.pMappedData, &gMeshletCullUniformData, sizeof(gMeshletCullUniformData));
+    endUpdateResource(&meshletCullCbv);
+
+    BufferUpdateDesc occlusionCullCbv = { pOcclusionCullUniformBuffer[gFrameIndex] };
+    beginUpdateResource(&occlusionCullCbv);
+    memcpy(occlusionCullCbv.pMappedData, &gOcclusionCullUniformData, sizeof(gOcclusionCullUniformData));
+    endUpdateResource(&occlusionCullCbv);
+
+    // The readback this frame slot issued last time is complete now that its fence passed
+    if (mOcclusionCulling && !mGpuOcclusionCulling)
+        cullOcclusionCpu();
+
+    // Shares the CPU visible instance buffer with the occlusion culling, which turns it off
+    const bool lodSelection = mLodSelection && !mOcclusionCulling;
+    if (lodSelection)
+        selectCastleLods();
+
+    // The light buffers of this frame slot are free again too
+    binLights();
+
+    // Reset cmd pool for this frame
+    resetCmdPool(pRenderer, elem.pCmdPool);
+
+    const uint32_t castleDrawCount = mCastleScene.getGeometry()->mDrawArgCount;
+    const uint32_t cityInstanceCount = getCityInstanceCount();
+    // Meshlet culling rewrites the index buffer for the castle at the origin only, occlusion culling and the
+    // LOD selection replace it
+    const bool gpuMeshletCulling = mGpuMeshletCulling && cityInstanceCount == 1 && !mOcclusionCulling && !lodSelection;
+    CastleDrawSource drawSource = CASTLE_DRAW_DIRECT;
+    if (mOcclusionCulling)
+        drawSource = mGpuOcclusionCulling ? CASTLE_DRAW_OCCLUSION_GPU : CASTLE_DRAW_OCCLUSION_CPU;
+    else if (lodSelection)
+        drawSource = CASTLE_DRAW_LOD;
+    else if (gpuMeshletCulling)
+        drawSource = CASTLE_DRAW_MESHLET_CULLED;
+    const uint32_t pairCount = castleDrawCount * cityInstanceCount;
+
+    // The GPU driven paths decide on the GPU, their count is the IA primitives below
+    char triangleStats[64];
+    if (drawSource == CASTLE_DRAW_MESHLET_CULLED || drawSource == CASTLE_DRAW_OCCLUSION_GPU)
+        snprintf(triangleStats, sizeof(triangleStats), "GPU driven");
+    else
+        snprintf(triangleStats, sizeof(triangleStats), "%llu", (unsigned long long)countCastleTriangles(drawSource));
+
+    char lodStats[96];
+    if (!lodSelection)
+        snprintf(lodStats, sizeof(lodStats), "off");
+    else
+    {
+        int length = snprintf(lodStats, sizeof(lodStats), "%u levels, instances per level:", mCastleScene.getLodCount());
+        for (uint32_t lod = 0; lod < mCastleScene.getLodCount() && length < (int)sizeof(lodStats); ++lod)
+            length += snprintf(lodStats + length, sizeof(lodStats) - length, " %u", mLodInstanceCounts[lod]);
+    }
+
+    // Vertex fetch estimate from the VS invocations: the visibility pass only fetches positions. It leaves out the
+    // resolve's raw loads and counts a depth prepass at the full vertex size.
+    const uint32_t vertexSize = CastleScene::getVertexSize(mCastleVertexFormat, false);
+    const uint32_t positionVertexSize = CastleScene::getVertexSize(mCastleVertexFormat, true);
+    const uint32_t fetchedVertexSize = mVisibilityBuffer ? positionVertexSize : vertexSize;
+    char vertexStats[96];
+    snprintf(vertexStats, sizeof(vertexStats), "%s, %u B per vertex, %u B position only",
+             CastleScene::getVertexFormatName(mCastleVertexFormat), vertexSize, positionVertexSize);
+
+    // The GPU path's visible count never comes back to the CPU, its effect shows in the 3D stats below
+    char occlusionStats[96];
+    if (!mOcclusionCulling)
+        snprintf(occlusionStats, sizeof(occlusionStats), "off");
+    else if (mGpuOcclusionCulling)
+        snprintf(occlusionStats, sizeof(occlusionStats), "GPU, %u instance draws tested", pairCount);
+    else
+        snprintf(occlusionStats, sizeof(occlusionStats), "CPU, %u instance draws visible, %u culled", mOcclusionVisibleCount,
+                 pairCount - mOcclusionVisibleCount);
+
+    char resolutionStats[128];
+    if (!mDynamicResolutionApplied)
+        snprintf(resolutionStats, sizeof(resolutionStats), "%ux%u", mRenderWidth, mRenderHeight);
+    else
+        snprintf(resolutionStats, sizeof(resolutionStats), "%ux%u (%.0f%%), GPU %.2f ms of a %.1f ms budget", mRenderWidth, mRenderHeight,
+                 mResolutionController.GetScale() * 100.0f, mResolutionController.GetSmoothedMs(), mDynamicResolutionBudgetMs);
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        QueryData data3D = {};
+        QueryData data2D = {};
+        QueryData dataSky = {};
+        getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 0, &data3D);
+        getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 1, &data2D);
+        getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 2, &dataSky);
+        bformat(&gPipelineStats,
+            "\n"
+            "Castle instances: %u (%ux%u)\n"
+            "Castle submeshes: %u drawn, %u culled\n"
+            "Castle meshlets: %u visible, %u culled (CPU reference)\n"
+            "Castle occlusion: %s\n"
+            "Castle LOD: %s\n"
+            "Castle triangles submitted: %s\n"
+            "Castle vertices: %s\n"
+            "Render resolution: %s\n"
+            "Point lights: %u, %u visible, %u cluster entries (%u dropped)\n"
+            "Light binning (CPU): %.3f ms ranges + %.3f ms scatter\n"
+            "Upload ring: %.1f KB last frame, %.1f KB high-water, %u KB per frame, %u overflowed\n"
+            "\n"
+            "Pipeline Stats 3D:\n"
+            "    VS invocations:      %u\n"
+            "    Vertex fetch (est.): %.2f MB\n"
+            "    PS invocations:      %u\n"
+            "    Clipper invocations: %u\n"
+            "    IA primitives:       %u\n"
+            "    Clipper primitives:  %u\n"
+            "\n"
+            "Pipeline Stats Skybox:\n"
+            "    PS invocations:      %u\n"
+            "\n"
+            "Pipeline Stats 2D UI:\n"
+            "    VS invocations:      %u\n"
+            "    PS invocations:      %u\n"
+            "    Clipper invocations: %u\n"
+            "    IA primitives:       %u\n"
+            "    Clipper primitives:  %u\n",
+            cityInstanceCount, mCityColumns, mCityRows,
+            mVisibleDrawCount, castleDrawCount - mVisibleDrawCount,
+            mVisibleMeshletCount, mCastleScene.getMeshletCount() - mVisibleMeshletCount, occlusionStats,
+            lodStats, triangleStats, vertexStats, resolutionStats,
+            mLightCount, mClusterBinStats.mVisibleLights, mClusterBinStats.mIndexCount, mClusterBinStats.mDroppedIndices,
+            mLightRangesMs, mLightScatterMs, mUploadRing.GetLastFrameUsed() / 1024.0f, mUploadRing.GetHighWater() / 1024.0f,
+            mUploadRing.GetFrameCapacity() / 1024, mUploadRing.GetLastFrameOverflows(),
+            data3D.mPipelineStats.mVSInvocations, (double)data3D.mPipelineStats.mVSInvocations * fetchedVertexSize / (1024.0 * 1024.0),
+            data3D.mPipelineStats.mPSInvocations, data3D.mPipelineStats.mCInvocations,
+            data3D.mPipelineStats.mIAPrimitives, data3D.mPipelineStats.mCPrimitives, dataSky.mPipelineStats.mPSInvocations,
+            data2D.mPipelineStats.mVSInvocations,
+            data2D.mPipelineStats.mPSInvocations, data2D.mPipelineStats.mCInvocations, data2D.mPipelineStats.mIAPrimitives,
+            data2D.mPipelineStats.mCPrimitives);
+    }
+    else
+    {
+        bformat(&gPipelineStats,
+            "\n"
+            "Castle instances: %u (%ux%u)\n"
+            "Castle submeshes: %u drawn, %u culled\n"
+            "Castle meshlets: %u visible, %u culled (CPU reference)\n"
+            "Castle occlusion: %s\n"
+            "Castle LOD: %s\n"
+            "Castle triangles submitted: %s\n"
+            "Castle vertices: %s\n"
+            "Render resolution: %s\n"
+            "Point lights: %u, %u visible, %u cluster entries (%u dropped)\n"
+            "Light binning (CPU): %.3f ms ranges + %.3f ms scatter\n"
+            "Upload ring: %.1f KB last frame, %.1f KB high-water, %u KB per frame, %u overflowed\n",
+            cityInstanceCount, mCityColumns, mCityRows,
+            mVisibleDrawCount, castleDrawCount - mVisibleDrawCount,
+            mVisibleMeshletCount, mCastleScene.getMeshletCount() - mVisibleMeshletCount, occlusionStats,
+            lodStats, triangleStats, vertexStats, resolutionStats,
+            mLightCount, mClusterBinStats.mVisibleLights, mClusterBinStats.mIndexCount, mClusterBinStats.mDroppedIndices,
+            mLightRangesMs, mLightScatterMs, mUploadRing.GetLastFrameUsed() / 1024.0f, mUploadRing.GetHighWater() / 1024.0f,
+            mUploadRing.GetFrameCapacity() / 1024, mUploadRing.GetLastFrameOverflows());
+    }
+
+    Cmd* cmd = elem.pCmds[0];
+    beginCmd(cmd);
+
+    if (mUploadRingBenchmarkDraws > 0)
+        runUploadRingBenchmark(cmd);
+
+    cmdBeginGpuFrameProfile(cmd, gGpuProfileToken);
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        cmdResetQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], 0, 3);
+        QueryDesc queryDesc = { 0 };
+        cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+    }
+    if (pMetricsQueryPool[gFrameIndex])
+        cmdResetQuery(cmd, pMetricsQueryPool[gFrameIndex], 0, METRICS_QUERY_COUNT);
+    beginMetricsQuery(cmd, METRICS_QUERY_FRAME);
+
+    if (mCastleScene.getPackedVertexBuffer() && !mCastleVerticesPacked)
+        packCastleVertices(cmd);
+
+    if (mCityColumns != mBuiltCityColumns || mCityRows != mBuiltCityRows)
+        buildCastleCity(cmd);
+
+    if (gpuMeshletCulling)
+        cullMeshlets(cmd);
+
+    if (mOcclusionCulling)
+        cullOcclusion(cmd);
+    else if (lodSelection)
+        uploadCpuVisibleInstances(cmd, mLodVisibleCount);
+
+    // Both fill the depth buffer, so the castle and sky passes below load it instead of clearing
+    const bool depthPrepass = mDepthPrepass && !mVisibilityBuffer;
+    beginMetricsQuery(cmd, METRICS_QUERY_CASTLE);
+    if (mVisibilityBuffer)
+        drawVisibilityBuffer(cmd, drawSource);
+    else if (depthPrepass)
+        drawDepthPrepass(cmd, drawSource);
+
+    // With dynamic resolution the castle and sky go to the scene color region, upscaled into the back buffer below
+    const bool dynamicResolution = mDynamicResolutionApplied;
+    RenderTarget* pSceneTarget = dynamicResolution ? pSceneColor : pRenderTarget;
+    RenderTargetBarrier barriers[] = {
+        { pRenderTarget, backBufferState, RESOURCE_STATE_RENDER_TARGET },
+        { pSceneColor, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_RENDER_TARGET },
+    };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, dynamicResolution ? 2 : 1, barriers);
+
+    // simply record the screen cleaning command
+    BindRenderTargetsDesc bindRenderTargets = {};
+    bindRenderTargets.mRenderTargetCount = 1;
+    bindRenderTargets.mRenderTargets[0] = { pSceneTarget, LOAD_ACTION_CLEAR };
+    bindRenderTargets.mDepthStencil = { pDepthBuffer, mVisibilityBuffer || depthPrepass ? LOAD_ACTION_LOAD : LOAD_ACTION_CLEAR };
+    cmdBindRenderTargets(cmd, &bindRenderTargets);
+    cmdSetViewport(cmd, 0.0f, 0.0f, (float)mRenderWidth, (float)mRenderHeight, 0.0f, 1.0f);
+    cmdSetScissor(cmd, 0, 0, mRenderWidth, mRenderHeight);
+
+    if (mVisibilityBuffer)
+    {
+        resolveVisibilityBuffer(cmd, gpuMeshletCulling);
+    }
+    else
+    {
+        cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Castle");
+
+        // After the prepass only the front-most surface passes the depth test, each pixel is shaded once
+        cmdBindPipeline(cmd, depthPrepass ? pCastleDepthEqualPipeline : pCastlePipeline);
+        cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
+        bindUniformSet(cmd, pDescriptorSetUniforms, gFrameIndex * 2 + 1, mCastleUniforms);
+        drawCastleGeometry(cmd, drawSource, false);
+        cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+    }
+    endMetricsQuery(cmd, METRICS_QUERY_CASTLE);
+
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        QueryDesc queryDesc = { 0 };
+        cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+
+        queryDesc = { 2 };
+        cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+    }
+
+    // Sky last, at the far plane: the GEQUAL depth test rejects every pixel the castle already covered
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
+    beginMetricsQuery(cmd, METRICS_QUERY_SKYBOX);
+    cmdBindPipeline(cmd, pSkyBoxDrawPipeline);
+    cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
+    bindUniformSet(cmd, pDescriptorSetUniforms, gFrameIndex * 2 + 0, mSkyUniforms);
+    cmdDraw(cmd, 3, 0);
+    endMetricsQuery(cmd, METRICS_QUERY_SKYBOX);
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+    cmdBindRenderTargets(cmd, NULL);
+
+    // Next frame's occlusion test runs against this frame's depth
+    if (mOcclusionCulling)
+    {
+        buildHiZ(cmd);
+    }
+    else
+    {
+        // Stale once the camera moved, turning the culling back on starts without a pyramid
+        mHiZValid = false;
+        mHiZReadbackValid[gFrameIndex] = false;
+    }
+
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        QueryDesc queryDesc = { 2 };
+        cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+
+        queryDesc = { 1 };
+        cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+    }
+
+    if (dynamicResolution)
+        upscaleSceneColor(cmd, pRenderTarget);
+
+    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw UI");
+    beginMetricsQuery(cmd, METRICS_QUERY_UI);
+
+    bindRenderTargets = {};
+    bindRenderTargets.mRenderTargetCount = 1;
+    bindRenderTargets.mRenderTargets[0] = { pRenderTarget, LOAD_ACTION_LOAD };
+    bindRenderTargets.mDepthStencil = { NULL, LOAD_ACTION_DONTCARE };
+    cmdBindRenderTargets(cmd, &bindRenderTargets);
+
+    gFrameTimeDraw.mFontColor = 0xff00ffff;
+    gFrameTimeDraw.mFontSize = 18.0f;
+    gFrameTimeDraw.mFontID = gFontID;
+    float2 txtSizePx = cmdDrawCpuProfile(cmd, float2(8.f, 15.f), &gFrameTimeDraw);
+    cmdDrawGpuProfile(cmd, float2(8.f, txtSizePx.y + 75.f), gGpuProfileToken, &gFrameTimeDraw);
+
+    cmdDrawUserInterface(cmd);
+
+    endMetricsQuery(cmd, METRICS_QUERY_UI);
+    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+    cmdBindRenderTargets(cmd, NULL);
+
+    barriers[0] = { pRenderTarget, RESOURCE_STATE_RENDER_TARGET, backBufferState };
+    cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, barriers);
+
+    endMetricsQuery(cmd, METRICS_QUERY_FRAME);
+    if (pMetricsQueryPool[gFrameIndex])
+        cmdResolveQuery(cmd, pMetricsQueryPool[gFrameIndex], 0, METRICS_QUERY_COUNT);
+    cmdEndGpuFrameProfile(cmd, gGpuProfileToken);
+
+    if (pRenderer->pGpu->mSettings.mPipelineStatsQueries)
+    {
+        QueryDesc queryDesc = { 1 };
+        cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+        cmdResolveQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], 0, 3);
+    }
+
+    endCmd(cmd);
+
+    FlushResourceUpdateDesc flushUpdateDesc = {};
+    flushUpdateDesc.mNodeIndex = 0;
+    flushResourceUpdates(&flushUpdateDesc);
+    Semaphore* waitSemaphores[2] = { flushUpdateDesc.pOutSubmittedSemaphore, pImageAcquiredSemaphore };
+
+    // Nothing waits on the frame semaphore without a present, so headless frames only signal the fence
+    QueueSubmitDesc submitDesc = {};
+    submitDesc.mCmdCount = 1;
+    submitDesc.mSignalSemaphoreCount = mHeadless ? 0 : 1;
+    submitDesc.mWaitSemaphoreCount = mHeadless ? 1 : TF_ARRAY_COUNT(waitSemaphores);
+    submitDesc.ppCmds = &cmd;
+    submitDesc.ppSignalSemaphores = &elem.pSemaphore;
+    submitDesc.ppWaitSemaphores = waitSemaphores;
+    submitDesc.pSignalFence = elem.pFence;
+    telemetryStartUSec = getUSec(true);
+    queueSubmit(pGraphicsQueue, &submitDesc);
+    telemetryEndUSec = getUSec(true);
+    telemetry.mMs[FRAME_TELEMETRY_SUBMIT] = (telemetryEndUSec - telemetryStartUSec) / 1000.0f;
+
+    if (!mHeadless)
+    {
+        QueuePresentDesc presentDesc = {};
+        presentDesc.mIndex = swapchainImageIndex;
+        presentDesc.mWaitSemaphoreCount = 1;
+        presentDesc.pSwapChain = pSwapChain;
+        presentDesc.ppWaitSemaphores = &elem.pSemaphore;
+        presentDesc.mSubmitDone = true;
+
+        queuePresent(pGraphicsQueue, &presentDesc);
+        telemetryEndUSec = getUSec(true);
+    }
+    flipProfiler();
+
+    // The first frame after a reset has no previous present to measure against
+    if (mLastPresentUSec != 0)
+    {
+        telemetry.mMs[FRAME_TELEMETRY_PRESENT_INTERVAL] = (telemetryEndUSec - mLastPresentUSec) / 1000.0f;
+        updateFrameTelemetry(telemetry, telemetryEndUSec);
+    }
+    mLastPresentUSec = telemetryEndUSec;
+
+    if (metricsFrame != MetricsExport::INVALID_FRAME)
+    {
+        mMetrics.Set(metricsFrame, METRICS_CPU_UPDATE_MS, mLastUpdateMs);
+        mMetrics.Set(metricsFrame, METRICS_CPU_DRAW_MS, (getUSec(true) - drawStartUSec) / 1000.0);
+        mMetrics.Set(metricsFrame, METRICS_FENCE_WAIT_MS, telemetry.mMs[FRAME_TELEMETRY_FENCE_WAIT]);
+        mMetrics.Set(metricsFrame, METRICS_ACQUIRE_MS, telemetry.mMs[FRAME_TELEMETRY_ACQUIRE]);
+        mMetrics.Set(metricsFrame, METRICS_SUBMIT_MS, telemetry.mMs[FRAME_TELEMETRY_SUBMIT]);
+    }
+
+    const float cpuFrameMs = getHiresTimerUSec(&mFrameTimer, true) / 1000.0f;
+    if (mCameraReplay.IsActive())
+    {
+        mCameraReplay.AddFrame(cpuFrameMs, getGpuProfileTime(gGpuProfileToken));
+        if (mCameraReplay.IsFinished())
+        {
+            mCameraReplay.Report();
+            mCameraReplay.Exit();
+            requestShutdown();
+        }
+    }
+
+    if (mFrameBenchmark.IsActive())
+    {
+        mFrameBenchmark.AddFrame(cpuFrameMs, getGpuProfileTime(gGpuProfileToken));
+        if (mFrameBenchmark.IsFinished())
+        {
+            mFrameBenchmark.Report(mHeadless ? "headless" : "windowed");
+            LOGF(eINFO, "Castle vertex format: %s, %u bytes per vertex, %u per position only vertex",
+                 CastleScene::getVertexFormatName(mCastleVertexFormat), CastleScene::getVertexSize(mCastleVertexFormat, false),
+                 CastleScene::getVertexSize(mCastleVertexFormat, true));
+            mFrameTelemetry.Report(mHeadless ? "headless" : "windowed");
+            mFrameBenchmark.Exit();
+            requestShutdown();
+        }
+    }
+
+    gFrameIndex = (gFrameIndex + 1) % mFramesInFlight;
+}
+
+const char* KokkuTestApp::GetName()
+{
+    return "KokkuRenderingEngineerTestApp";
 }
 
 bool KokkuTestApp::addSwapChain()
@@ -585,6 +2588,51 @@ bool KokkuTestApp::addSwapChain()
     return pSwapChain != NULL;
 }
 
+bool KokkuTestApp::addOffscreenTarget()
+{
+    RenderTargetDesc colorRT = {};
+    colorRT.mArraySize = 1;
+    colorRT.mClearValue = {};
+    colorRT.mDepth = 1;
+    colorRT.mFormat = TinyImageFormat_R8G8B8A8_SRGB;
+    colorRT.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    colorRT.mHeight = mSettings.mHeight;
+    colorRT.mSampleCount = SAMPLE_COUNT_1;
+    colorRT.mSampleQuality = 0;
+    colorRT.mWidth = mSettings.mWidth;
+    colorRT.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    colorRT.pName = "OffscreenTarget";
+    addRenderTarget(pRenderer, &colorRT, &pOffscreenTarget);
+
+    return pOffscreenTarget != NULL;
+}
+
+bool KokkuTestApp::addSceneColor()
+{
+    // Back buffer format, so the castle and sky pipelines draw into either
+    RenderTarget* pBackBuffer = getBackBuffer(0);
+    RenderTargetDesc colorRT = {};
+    colorRT.mArraySize = 1;
+    colorRT.mClearValue = pBackBuffer->mClearValue;
+    colorRT.mDepth = 1;
+    colorRT.mFormat = pBackBuffer->mFormat;
+    colorRT.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    colorRT.mHeight = mSettings.mHeight;
+    colorRT.mSampleCount = SAMPLE_COUNT_1;
+    colorRT.mSampleQuality = 0;
+    colorRT.mWidth = mSettings.mWidth;
+    colorRT.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    colorRT.pName = "SceneColor";
+    addRenderTarget(pRenderer, &colorRT, &pSceneColor);
+
+    return pSceneColor != NULL;
+}
+
+RenderTarget* KokkuTestApp::getBackBuffer(uint32_t index)
+{
+    return mHeadless ? pOffscreenTarget : pSwapChain->ppRenderTargets[index];
+}
+
 bool KokkuTestApp::addDepthBuffer()
 {
     // Add depth buffer
@@ -599,59 +2647,249 @@ bool KokkuTestApp::addDepthBuffer()
     depthRT.mSampleCount = SAMPLE_COUNT_1;
     depthRT.mSampleQuality = 0;
     depthRT.mWidth = mSettings.mWidth;
-    depthRT.mFlags = TEXTURE_CREATION_FLAG_ON_TILE | TEXTURE_CREATION_FLAG_VR_MULTIVIEW;
+    // Not on-tile: the Hi-Z build samples it after the frame
+    depthRT.mFlags = TEXTURE_CREATION_FLAG_VR_MULTIVIEW;
+    depthRT.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
     addRenderTarget(pRenderer, &depthRT, &pDepthBuffer);
 
     return pDepthBuffer != NULL;
 }
 
+bool KokkuTestApp::addVisibilityBuffer()
+{
+    // x = primitive ID, y = (instance + 1) << 11 | LOD level << 8 | draw index, 0 where nothing was drawn.
+    // 21 bits of instance, 3 of LOD level and 8 of draw index: must match VISIBILITY_BUFFER_MAX_DRAWS,
+    // CastleScene::MAX_LODS and visibilityBuffer.frag
+    RenderTargetDesc visibilityRT = {};
+    visibilityRT.mArraySize = 1;
+    visibilityRT.mClearValue = {};
+    visibilityRT.mDepth = 1;
+    visibilityRT.mFormat = TinyImageFormat_R32G32_UINT;
+    visibilityRT.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    visibilityRT.mHeight = mSettings.mHeight;
+    visibilityRT.mSampleCount = SAMPLE_COUNT_1;
+    visibilityRT.mSampleQuality = 0;
+    visibilityRT.mWidth = mSettings.mWidth;
+    visibilityRT.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    visibilityRT.pName = "VisibilityBuffer";
+    addRenderTarget(pRenderer, &visibilityRT, &pVisibilityBuffer);
+
+    return pVisibilityBuffer != NULL;
+}
+
+bool KokkuTestApp::addHiZ()
+{
+    // Level 0 is half the depth buffer, the depth buffer itself stays the finest level
+    mHiZLevelCount = hiZLevelCount(mSettings.mWidth, mSettings.mHeight);
+
+    TextureDesc hiZDesc = {};
+    hiZDesc.mArraySize = 1;
+    hiZDesc.mDepth = 1;
+    hiZDesc.mFormat = TinyImageFormat_R32_SFLOAT;
+    hiZDesc.mSampleCount = SAMPLE_COUNT_1;
+    hiZDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+    hiZDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE | DESCRIPTOR_TYPE_RW_TEXTURE;
+    hiZLevelSize(mSettings.mWidth, mSettings.mHeight, 0, &hiZDesc.mWidth, &hiZDesc.mHeight);
+    hiZDesc.mMipLevels = mHiZLevelCount;
+    hiZDesc.pName = "Hi-Z";
+
+    TextureLoadDesc hiZLoadDesc = {};
+    hiZLoadDesc.pDesc = &hiZDesc;
+    hiZLoadDesc.ppTexture = &pHiZ;
+    SyncToken token = {};
+    addResource(&hiZLoadDesc, &token);
+    waitForToken(&token);
+
+    // The CPU fallback reads back the first level small enough for the readback buffer
+    mHiZReadbackLevel = mHiZLevelCount - 1;
+    for (uint32_t level = 0; level < mHiZLevelCount; ++level)
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        hiZLevelSize(mSettings.mWidth, mSettings.mHeight, level, &width, &height);
+        if (width <= HIZ_READBACK_MAX_SIDE && height <= HIZ_READBACK_MAX_SIDE)
+        {
+            mHiZReadbackLevel = level;
+            break;
+        }
+    }
+
+    // A resize invalidates the old pyramids
+    mHiZValid = false;
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        mHiZReadbackValid[i] = false;
+
+    return pHiZ != NULL;
+}
+
 void KokkuTestApp::addDescriptorSets()
 {
     DescriptorSetDesc desc = { pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
     addDescriptorSet(pRenderer, &desc, &pDescriptorSetTexture);
-    desc = { pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, gDataBufferCount * 2 };
+    desc = { pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, mFramesInFlight * 2 };
     addDescriptorSet(pRenderer, &desc, &pDescriptorSetUniforms);
+
+    desc = { pMeshletCullRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetMeshletCull);
+    desc = { pMeshletCullRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, mFramesInFlight };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetMeshletCullPerFrame);
+
+    desc = { pCastleCityRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetCastleCity);
+
+    desc = { pCastleVertexPackRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetCastleVertexPack);
+
+    desc = { pVisibilityResolveRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetVisibilityResolve);
+    desc = { pVisibilityResolveRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, mFramesInFlight * 2 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetVisibilityResolvePerFrame);
+
+    desc = { pUpscaleRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetUpscale);
+
+    // One set per pyramid level, each reads the level below and writes its own mip
+    desc = { pHiZBuildRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, HIZ_MAX_LEVELS };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetHiZBuild);
+
+    desc = { pOcclusionCullRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetOcclusionCull);
+    desc = { pOcclusionCullRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, mFramesInFlight };
+    addDescriptorSet(pRenderer, &desc, &pDescriptorSetOcclusionCullPerFrame);
 }
 
 void KokkuTestApp::removeDescriptorSets()
 {
     removeDescriptorSet(pRenderer, pDescriptorSetTexture);
     removeDescriptorSet(pRenderer, pDescriptorSetUniforms);
+    removeDescriptorSet(pRenderer, pDescriptorSetMeshletCull);
+    removeDescriptorSet(pRenderer, pDescriptorSetMeshletCullPerFrame);
+    removeDescriptorSet(pRenderer, pDescriptorSetCastleCity);
+    removeDescriptorSet(pRenderer, pDescriptorSetCastleVertexPack);
+    removeDescriptorSet(pRenderer, pDescriptorSetVisibilityResolve);
+    removeDescriptorSet(pRenderer, pDescriptorSetVisibilityResolvePerFrame);
+    removeDescriptorSet(pRenderer, pDescriptorSetUpscale);
+    removeDescriptorSet(pRenderer, pDescriptorSetHiZBuild);
+    removeDescriptorSet(pRenderer, pDescriptorSetOcclusionCull);
+    removeDescriptorSet(pRenderer, pDescriptorSetOcclusionCullPerFrame);
 }
 
 void KokkuTestApp::addRootSignatures()
 {
-    Shader* shaders[2];
+    Shader* shaders[4];
     uint32_t shadersCount = 0;
     shaders[shadersCount++] = pCastleShader;
     shaders[shadersCount++] = pSkyBoxDrawShader;
+    shaders[shadersCount++] = pVisibilityBufferShader;
+    shaders[shadersCount++] = pDepthPrepassShader;
 
     RootSignatureDesc rootDesc = {};
     rootDesc.mShaderCount = shadersCount;
     rootDesc.ppShaders = shaders;
     addRootSignature(pRenderer, &rootDesc, &pRootSignature);
+    mDrawConstantsIndex = getDescriptorIndexFromName(pRootSignature, "drawConstants");
+
+    RootSignatureDesc cullRootDesc = {};
+    cullRootDesc.mShaderCount = 1;
+    cullRootDesc.ppShaders = &pMeshletCullShader;
+    addRootSignature(pRenderer, &cullRootDesc, &pMeshletCullRootSignature);
+
+    RootSignatureDesc cityRootDesc = {};
+    cityRootDesc.mShaderCount = 1;
+    cityRootDesc.ppShaders = &pCastleCityShader;
+    addRootSignature(pRenderer, &cityRootDesc, &pCastleCityRootSignature);
+    mCastleCityConstantsIndex = getDescriptorIndexFromName(pCastleCityRootSignature, "castleCityConstants");
+
+    RootSignatureDesc packRootDesc = {};
+    packRootDesc.mShaderCount = 1;
+    packRootDesc.ppShaders = &pCastleVertexPackShader;
+    addRootSignature(pRenderer, &packRootDesc, &pCastleVertexPackRootSignature);
+    mCastleVertexPackConstantsIndex = getDescriptorIndexFromName(pCastleVertexPackRootSignature, "castleVertexPackConstants");
+
+    RootSignatureDesc resolveRootDesc = {};
+    resolveRootDesc.mShaderCount = 1;
+    resolveRootDesc.ppShaders = &pVisibilityResolveShader;
+    addRootSignature(pRenderer, &resolveRootDesc, &pVisibilityResolveRootSignature);
+    mVisibilityResolveConstantsIndex = getDescriptorIndexFromName(pVisibilityResolveRootSignature, "visibilityResolveConstants");
+
+    RootSignatureDesc upscaleRootDesc = {};
+    upscaleRootDesc.mShaderCount = 1;
+    upscaleRootDesc.ppShaders = &pUpscaleShader;
+    addRootSignature(pRenderer, &upscaleRootDesc, &pUpscaleRootSignature);
+    mUpscaleConstantsIndex = getDescriptorIndexFromName(pUpscaleRootSignature, "upscaleConstants");
+
+    RootSignatureDesc hiZRootDesc = {};
+    hiZRootDesc.mShaderCount = 1;
+    hiZRootDesc.ppShaders = &pHiZBuildShader;
+    addRootSignature(pRenderer, &hiZRootDesc, &pHiZBuildRootSignature);
+    mHiZBuildConstantsIndex = getDescriptorIndexFromName(pHiZBuildRootSignature, "hiZBuildConstants");
+
+    RootSignatureDesc occlusionRootDesc = {};
+    occlusionRootDesc.mShaderCount = 1;
+    occlusionRootDesc.ppShaders = &pOcclusionCullShader;
+    addRootSignature(pRenderer, &occlusionRootDesc, &pOcclusionCullRootSignature);
+
+    // Plain indexed draws, the material root constant is set before each cmdExecuteIndirect
+    IndirectArgumentDescriptor indirectArgs[1] = {};
+    indirectArgs[0].mType = INDIRECT_DRAW_INDEX;
+    CommandSignatureDesc cmdSignatureDesc = { pRootSignature, indirectArgs, 1, true };
+    addIndirectCommandSignature(pRenderer, &cmdSignatureDesc, &pCastleCommandSignature);
 }
 
-void KokkuTestApp::removeRootSignatures() { removeRootSignature(pRenderer, pRootSignature); }
-
-void KokkuTestApp::addShaders()
+void KokkuTestApp::removeRootSignatures()
 {
-    ShaderLoadDesc skyShader = {};
-    skyShader.mStages[0].pFileName = "skybox.vert";
-    skyShader.mStages[1].pFileName = "skybox.frag";
+    removeIndirectCommandSignature(pRenderer, pCastleCommandSignature);
+    removeRootSignature(pRenderer, pMeshletCullRootSignature);
+    removeRootSignature(pRenderer, pCastleCityRootSignature);
+    removeRootSignature(pRenderer, pCastleVertexPackRootSignature);
+    removeRootSignature(pRenderer, pVisibilityResolveRootSignature);
+    removeRootSignature(pRenderer, pUpscaleRootSignature);
+    removeRootSignature(pRenderer, pHiZBuildRootSignature);
+    removeRootSignature(pRenderer, pOcclusionCullRootSignature);
+    removeRootSignature(pRenderer, pRootSignature);
+}
 
-    ShaderLoadDesc basicShader = {};
-    basicShader.mStages[0].pFileName = "basic.vert";
-    basicShader.mStages[1].pFileName = "basic.frag";
+uint32_t KokkuTestApp::getShaderPrograms(ShaderProgram* pPrograms)
+{
+    uint32_t count = 0;
+    pPrograms[count++] = { &pSkyBoxDrawShader, { "skybox.vert", "skybox.frag" } };
+    pPrograms[count++] = { &pCastleShader, { "basic.vert", "basic.frag" } };
+    pPrograms[count++] = { &pMeshletCullShader, { "meshletCull.comp", NULL } };
+    pPrograms[count++] = { &pCastleCityShader, { "castleCity.comp", NULL } };
+    pPrograms[count++] = { &pCastleVertexPackShader, { "castleVertexPack.comp", NULL } };
+    pPrograms[count++] = { &pVisibilityBufferShader, { "visibilityBuffer.vert", "visibilityBuffer.frag" } };
+    // The visibility pass vertex shader without a pixel shader, depth only
+    pPrograms[count++] = { &pDepthPrepassShader, { "visibilityBuffer.vert", NULL } };
+    pPrograms[count++] = { &pHiZBuildShader, { "hiZBuild.comp", NULL } };
+    pPrograms[count++] = { &pOcclusionCullShader, { "occlusionCull.comp", NULL } };
+    // Same fullscreen triangle as the sky
+    pPrograms[count++] = { &pVisibilityResolveShader, { "skybox.vert", "visibilityResolve.frag" } };
+    pPrograms[count++] = { &pUpscaleShader, { "skybox.vert", "upscale.frag" } };
+    return count;
+}
 
-    addShader(pRenderer, &skyShader, &pSkyBoxDrawShader);
-    addShader(pRenderer, &basicShader, &pCastleShader);
+void KokkuTestApp::addShaders()
+{
+    ShaderProgram  programs[MAX_SHADER_PROGRAMS];
+    const uint32_t programCount = getShaderPrograms(programs);
+    for (uint32_t i = 0; i < programCount; ++i)
+    {
+        ShaderLoadDesc shaderDesc = {};
+        shaderDesc.mStages[0].pFileName = programs[i].pStages[0];
+        shaderDesc.mStages[1].pFileName = programs[i].pStages[1];
+        addShader(pRenderer, &shaderDesc, programs[i].ppShader);
+    }
 }
 
 void KokkuTestApp::removeShaders()
 {
-    removeShader(pRenderer, pCastleShader);
-    removeShader(pRenderer, pSkyBoxDrawShader);
+    ShaderProgram  programs[MAX_SHADER_PROGRAMS];
+    const uint32_t programCount = getShaderPrograms(programs);
+    for (uint32_t i = 0; i < programCount; ++i)
+    {
+        removeShader(pRenderer, *programs[i].ppShader);
+        *programs[i].ppShader = NULL;
+    }
 }
 
 void KokkuTestApp::addPipelines()
@@ -668,14 +2906,15 @@ void KokkuTestApp::addPipelines()
     depthStateDesc.mDepthFunc = CMP_GEQUAL;
 
     PipelineDesc desc = {};
+    desc.pCache = mPipelineCache.GetCache();
     desc.mType = PIPELINE_TYPE_GRAPHICS;
     GraphicsPipelineDesc& pipelineSettings = desc.mGraphicsDesc;
     pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
     pipelineSettings.mRenderTargetCount = 1;
     pipelineSettings.pDepthState = &depthStateDesc;
-    pipelineSettings.pColorFormats = &pSwapChain->ppRenderTargets[0]->mFormat;
-    pipelineSettings.mSampleCount = pSwapChain->ppRenderTargets[0]->mSampleCount;
-    pipelineSettings.mSampleQuality = pSwapChain->ppRenderTargets[0]->mSampleQuality;
+    pipelineSettings.pColorFormats = &getBackBuffer(0)->mFormat;
+    pipelineSettings.mSampleCount = getBackBuffer(0)->mSampleCount;
+    pipelineSettings.mSampleQuality = getBackBuffer(0)->mSampleQuality;
     pipelineSettings.mDepthStencilFormat = pDepthBuffer->mFormat;
     pipelineSettings.pRootSignature = pRootSignature;
     pipelineSettings.pShaderProgram = pCastleShader;
@@ -684,169 +2923,720 @@ void KokkuTestApp::addPipelines()
     pipelineSettings.mVRFoveatedRendering = true;
     addPipeline(pRenderer, &desc, &pCastlePipeline);
 
-    // layout and pipeline for skybox draw
-    VertexLayout vertexLayout = {};
-    vertexLayout.mBindingCount = 1;
-    vertexLayout.mBindings[0].mStride = sizeof(float4);
-    vertexLayout.mAttribCount = 1;
-    vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
-    vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32A32_SFLOAT;
-    vertexLayout.mAttribs[0].mBinding = 0;
-    vertexLayout.mAttribs[0].mLocation = 0;
-    vertexLayout.mAttribs[0].mOffset = 0;
-    pipelineSettings.pVertexLayout = &vertexLayout;
-
-    pipelineSettings.pDepthState = NULL;
+    // Castle after the depth prepass: the depth is final, only the matching surface gets shaded
+    DepthStateDesc depthEqualStateDesc = {};
+    depthEqualStateDesc.mDepthTest = true;
+    depthEqualStateDesc.mDepthWrite = false;
+    depthEqualStateDesc.mDepthFunc = CMP_GEQUAL;
+
+    pipelineSettings.pDepthState = &depthEqualStateDesc;
+    addPipeline(pRenderer, &desc, &pCastleDepthEqualPipeline);
+
+    // Skybox: fullscreen triangle without vertex buffers, depth tested against the castle but never written
+    DepthStateDesc skyDepthStateDesc = {};
+    skyDepthStateDesc.mDepthTest = true;
+    skyDepthStateDesc.mDepthWrite = false;
+    skyDepthStateDesc.mDepthFunc = CMP_GEQUAL;
+
+    pipelineSettings.pVertexLayout = NULL;
+    pipelineSettings.pDepthState = &skyDepthStateDesc;
     pipelineSettings.pRasterizerState = &rasterizerStateDesc;
     pipelineSettings.pShaderProgram = pSkyBoxDrawShader; //-V519
     addPipeline(pRenderer, &desc, &pSkyBoxDrawPipeline);
+
+    // Upscale: the same fullscreen triangle into the back buffer, without depth
+    PipelineDesc upscaleDesc = desc;
+    upscaleDesc.mGraphicsDesc.pDepthState = NULL;
+    upscaleDesc.mGraphicsDesc.mDepthStencilFormat = TinyImageFormat_UNDEFINED;
+    upscaleDesc.mGraphicsDesc.pRootSignature = pUpscaleRootSignature;
+    upscaleDesc.mGraphicsDesc.pShaderProgram = pUpscaleShader;
+    upscaleDesc.mGraphicsDesc.mVRFoveatedRendering = false;
+    addPipeline(pRenderer, &upscaleDesc, &pUpscalePipeline);
+
+    // Visibility buffer resolve: shades the pixels the visibility pass covered, the sky then fills the rest
+    DepthStateDesc resolveDepthStateDesc = {};
+    resolveDepthStateDesc.mDepthTest = true;
+    resolveDepthStateDesc.mDepthWrite = false;
+    resolveDepthStateDesc.mDepthFunc = CMP_LESS;
+
+    pipelineSettings.pDepthState = &resolveDepthStateDesc;
+    pipelineSettings.pRootSignature = pVisibilityResolveRootSignature;
+    pipelineSettings.pShaderProgram = pVisibilityResolveShader;
+    addPipeline(pRenderer, &desc, &pVisibilityResolvePipeline);
+
+    // Visibility buffer pass: same depth state and rasterization as the castle pass, IDs instead of colors
+    pipelineSettings.pDepthState = &depthStateDesc;
+    pipelineSettings.pColorFormats = &pVisibilityBuffer->mFormat;
+    pipelineSettings.mSampleCount = pVisibilityBuffer->mSampleCount;
+    pipelineSettings.mSampleQuality = pVisibilityBuffer->mSampleQuality;
+    pipelineSettings.pRootSignature = pRootSignature;
+    pipelineSettings.pShaderProgram = pVisibilityBufferShader;
+    pipelineSettings.pVertexLayout = &gVisibilityBufferVertexLayout;
+    pipelineSettings.pRasterizerState = &castleRasterizerStateDesc;
+    pipelineSettings.mVRFoveatedRendering = false;
+    addPipeline(pRenderer, &desc, &pVisibilityBufferPipeline);
+
+    // Depth prepass: the visibility pass without color targets
+    pipelineSettings.mRenderTargetCount = 0;
+    pipelineSettings.pColorFormats = NULL;
+    pipelineSettings.mSampleCount = pDepthBuffer->mSampleCount;
+    pipelineSettings.mSampleQuality = pDepthBuffer->mSampleQuality;
+    pipelineSettings.pShaderProgram = pDepthPrepassShader;
+    addPipeline(pRenderer, &desc, &pDepthPrepassPipeline);
+
+    PipelineDesc computeDesc = {};
+    computeDesc.pCache = mPipelineCache.GetCache();
+    computeDesc.mType = PIPELINE_TYPE_COMPUTE;
+    computeDesc.mComputeDesc.pShaderProgram = pMeshletCullShader;
+    computeDesc.mComputeDesc.pRootSignature = pMeshletCullRootSignature;
+    addPipeline(pRenderer, &computeDesc, &pMeshletCullPipeline);
+
+    computeDesc.mComputeDesc.pShaderProgram = pCastleCityShader;
+    computeDesc.mComputeDesc.pRootSignature = pCastleCityRootSignature;
+    addPipeline(pRenderer, &computeDesc, &pCastleCityPipeline);
+
+    computeDesc.mComputeDesc.pShaderProgram = pCastleVertexPackShader;
+    computeDesc.mComputeDesc.pRootSignature = pCastleVertexPackRootSignature;
+    addPipeline(pRenderer, &computeDesc, &pCastleVertexPackPipeline);
+
+    computeDesc.mComputeDesc.pShaderProgram = pHiZBuildShader;
+    computeDesc.mComputeDesc.pRootSignature = pHiZBuildRootSignature;
+    addPipeline(pRenderer, &computeDesc, &pHiZBuildPipeline);
+
+    computeDesc.mComputeDesc.pShaderProgram = pOcclusionCullShader;
+    computeDesc.mComputeDesc.pRootSignature = pOcclusionCullRootSignature;
+    addPipeline(pRenderer, &computeDesc, &pOcclusionCullPipeline);
 }
 
 void KokkuTestApp::removePipelines()
 {
     removePipeline(pRenderer, pSkyBoxDrawPipeline);
     removePipeline(pRenderer, pCastlePipeline);
+    removePipeline(pRenderer, pMeshletCullPipeline);
+    removePipeline(pRenderer, pCastleCityPipeline);
+    removePipeline(pRenderer, pCastleVertexPackPipeline);
+    removePipeline(pRenderer, pVisibilityBufferPipeline);
+    removePipeline(pRenderer, pVisibilityResolvePipeline);
+    removePipeline(pRenderer, pUpscalePipeline);
+    removePipeline(pRenderer, pCastleDepthEqualPipeline);
+    removePipeline(pRenderer, pDepthPrepassPipeline);
+    removePipeline(pRenderer, pHiZBuildPipeline);
+    removePipeline(pRenderer, pOcclusionCullPipeline);
 }
 
 void KokkuTestApp::prepareDescriptorSets()
 {
     // Prepare descriptor sets
-    DescriptorData params[15] = {};
-    params[0].pName = "RightText";
-    params[0].ppTextures = &pSkyBoxTextures[0];
-    params[1].pName = "LeftText";
-    params[1].ppTextures = &pSkyBoxTextures[1];
-    params[2].pName = "TopText";
-    params[2].ppTextures = &pSkyBoxTextures[2];
-    params[3].pName = "BotText";
-    params[3].ppTextures = &pSkyBoxTextures[3];
-    params[4].pName = "FrontText";
-    params[4].ppTextures = &pSkyBoxTextures[4];
-    params[5].pName = "BackText";
-    params[5].ppTextures = &pSkyBoxTextures[5];
-    params[6].pName = "uSampler0";
-    params[6].ppSamplers = &pSamplerSkyBox;
-    params[7].pName = "Albedo1";
-    params[7].ppTextures = &pCastleAlbedo[0];
-    params[8].pName = "Albedo2";
-    params[8].ppTextures = &pCastleAlbedo[1];
-    params[9].pName = "Albedo3";
-    params[9].ppTextures = &pCastleAlbedo[2];
-    params[10].pName = "Bump1";
-    params[10].ppTextures = &pCastleBump[0];
-    params[11].pName = "Bump2";
-    params[11].ppTextures = &pCastleBump[1];
-    params[12].pName = "Bump3";
-    params[12].ppTextures = &pCastleBump[2];
-    params[13].pName = "uSampler1";
-    params[13].ppSamplers = &pSmaplerCastle;
-    params[14].pName = "submeshSizes";
-    params[14].ppBuffers = &pSubmeshSizes;
-
-    updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, 15, params);
-
-    for (uint32_t i = 0; i < gDataBufferCount; ++i)
+    Texture* pSkyBoxCubeTexture = pSkyBoxCube->pTexture;
+    DescriptorData params[6] = {};
+    params[0].pName = "skyboxCube";
+    params[0].ppTextures = &pSkyBoxCubeTexture;
+    params[1].pName = "uSampler0";
+    params[1].ppSamplers = &pSamplerSkyBox;
+    params[2].pName = "castleAlbedo";
+    params[2].ppTextures = &pCastleAlbedo;
+    params[3].pName = "castleBump";
+    params[3].ppTextures = &pCastleBump;
+    params[4].pName = "uSampler1";
+    params[4].ppSamplers = &pSmaplerCastle;
+    params[5].pName = "castleInstances";
+    params[5].ppBuffers = &pCastleInstanceBuffer;
+
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, 6, params);
+
+    // uniformBlock_rootcbv is bound with the frame's upload ring block, the sky sets have nothing else per frame
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        DescriptorData params[3] = {};
+        params[0].pName = "lights";
+        params[0].ppBuffers = &pLightBuffer[i];
+        params[1].pName = "lightClusters";
+        params[1].ppBuffers = &pLightClusterBuffer[i];
+        params[2].pName = "lightIndices";
+        params[2].ppBuffers = &pLightIndexBuffer[i];
+        updateDescriptorSet(pRenderer, i * 2 + 1, pDescriptorSetUniforms, 3, params);
+    }
+
+    DescriptorData cityParams[1] = {};
+    cityParams[0].pName = "castleInstances";
+    cityParams[0].ppBuffers = &pCastleInstanceBuffer;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetCastleCity, 1, cityParams);
+
+    DescriptorData resolveParams[5] = {};
+    resolveParams[0].pName = "castleAlbedo";
+    resolveParams[0].ppTextures = &pCastleAlbedo;
+    resolveParams[1].pName = "castleBump";
+    resolveParams[1].ppTextures = &pCastleBump;
+    resolveParams[2].pName = "uSampler1";
+    resolveParams[2].ppSamplers = &pSmaplerCastle;
+    resolveParams[3].pName = "castleInstances";
+    resolveParams[3].ppBuffers = &pCastleInstanceBuffer;
+    resolveParams[4].pName = "visibilityBuffer";
+    resolveParams[4].ppTextures = &pVisibilityBuffer->pTexture;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetVisibilityResolve, 5, resolveParams);
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        // uniformBlock_rootcbv comes from the upload ring when the set is bound
+        DescriptorData params[3] = {};
+        params[0].pName = "lights";
+        params[0].ppBuffers = &pLightBuffer[i];
+        params[1].pName = "lightClusters";
+        params[1].ppBuffers = &pLightClusterBuffer[i];
+        params[2].pName = "lightIndices";
+        params[2].ppBuffers = &pLightIndexBuffer[i];
+        updateDescriptorSet(pRenderer, i * 2 + 0, pDescriptorSetVisibilityResolvePerFrame, 3, params);
+        updateDescriptorSet(pRenderer, i * 2 + 1, pDescriptorSetVisibilityResolvePerFrame, 3, params);
+    }
+
+    DescriptorData upscaleParams[2] = {};
+    upscaleParams[0].pName = "sceneColor";
+    upscaleParams[0].ppTextures = &pSceneColor->pTexture;
+    upscaleParams[1].pName = "upscaleSampler";
+    upscaleParams[1].ppSamplers = &pSamplerSkyBox;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetUpscale, 2, upscaleParams);
+
+    for (uint32_t level = 0; level < mHiZLevelCount; ++level)
+    {
+        DescriptorData hiZParams[2] = {};
+        hiZParams[0].pName = "hiZSource";
+        hiZParams[0].ppTextures = level == 0 ? &pDepthBuffer->pTexture : &pHiZ;
+        hiZParams[1].pName = "hiZDestination";
+        hiZParams[1].ppTextures = &pHiZ;
+        hiZParams[1].mUAVMipSlice = (uint16_t)level;
+        updateDescriptorSet(pRenderer, level, pDescriptorSetHiZBuild, 2, hiZParams);
+    }
+
+    DescriptorData occlusionParams[2] = {};
+    occlusionParams[0].pName = "castleInstances";
+    occlusionParams[0].ppBuffers = &pCastleInstanceBuffer;
+    occlusionParams[1].pName = "hiZ";
+    occlusionParams[1].ppTextures = &pHiZ;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetOcclusionCull, 2, occlusionParams);
+
+    updateCastleSceneDescriptors();
+}
+
+void KokkuTestApp::updateCastleSceneDescriptors()
+{
+    // Only the descriptors of the castle vertex, index and material buffers and of the culling buffers sized by
+    // its draw count, what swapCastleScene() rebuilds
+    DescriptorData materialParams[1] = {};
+    materialParams[0].pName = "castleMaterials";
+    materialParams[0].ppBuffers = &pCastleMaterialBuffer;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, 1, materialParams);
+
+    Buffer* pMeshletBuffer = mCastleScene.getMeshletBuffer();
+    Buffer* pMeshletIndexBuffer = mCastleScene.getMeshletIndexBuffer();
+    DescriptorData cullParams[3] = {};
+    cullParams[0].pName = "meshlets";
+    cullParams[0].ppBuffers = &pMeshletBuffer;
+    cullParams[1].pName = "meshletIndices";
+    cullParams[1].ppBuffers = &pMeshletIndexBuffer;
+    cullParams[2].pName = "clearedDrawArgs";
+    cullParams[2].ppBuffers = &pClearedDrawArgsBuffer;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetMeshletCull, 3, cullParams);
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        cullParams[0].pName = "meshletCullUniforms";
+        cullParams[0].ppBuffers = &pMeshletCullUniformBuffer[i];
+        cullParams[1].pName = "filteredIndices";
+        cullParams[1].ppBuffers = &pFilteredIndexBuffer[i];
+        cullParams[2].pName = "castleDrawArgs";
+        cullParams[2].ppBuffers = &pCastleDrawArgsBuffer[i];
+        updateDescriptorSet(pRenderer, i, pDescriptorSetMeshletCullPerFrame, 3, cullParams);
+    }
+
+    // The float streams are the source of the quantized ones, the float layout never binds this set
+    Geometry* pGeom = mCastleScene.getGeometry();
+    Buffer* pPackedVertexBuffer = mCastleScene.getPackedVertexBuffer();
+    if (pPackedVertexBuffer)
+    {
+        Buffer* pTangentBuffer = mCastleScene.getTangentBuffer();
+        DescriptorData packParams[5] = {};
+        packParams[0].pName = "sourcePositions";
+        packParams[0].ppBuffers = &pGeom->pVertexBuffers[0];
+        packParams[1].pName = "sourceNormals";
+        packParams[1].ppBuffers = &pGeom->pVertexBuffers[1];
+        packParams[2].pName = "sourceUVs";
+        packParams[2].ppBuffers = &pGeom->pVertexBuffers[2];
+        packParams[3].pName = "sourceTangents";
+        packParams[3].ppBuffers = &pTangentBuffer;
+        packParams[4].pName = "packedVertices";
+        packParams[4].ppBuffers = &pPackedVertexBuffer;
+        updateDescriptorSet(pRenderer, 0, pDescriptorSetCastleVertexPack, 5, packParams);
+    }
+
+    Buffer** ppCastleVertexBuffers = mCastleScene.getVertexBuffers();
+    Buffer*  pLodStartBuffer = mCastleScene.getLodStartBuffer();
+    DescriptorData resolveParams[6] = {};
+    resolveParams[0].pName = "castleMaterials";
+    resolveParams[0].ppBuffers = &pCastleMaterialBuffer;
+    resolveParams[1].pName = "castlePositions";
+    resolveParams[1].ppBuffers = &ppCastleVertexBuffers[0];
+    resolveParams[2].pName = "castleNormals";
+    resolveParams[2].ppBuffers = &ppCastleVertexBuffers[1];
+    resolveParams[3].pName = "castleUVs";
+    resolveParams[3].ppBuffers = &ppCastleVertexBuffers[2];
+    resolveParams[4].pName = "castleLodStarts";
+    resolveParams[4].ppBuffers = &pLodStartBuffer;
+    resolveParams[5].pName = "castleTangents";
+    resolveParams[5].ppBuffers = &ppCastleVertexBuffers[3];
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetVisibilityResolve, 6, resolveParams);
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
     {
         DescriptorData params[1] = {};
-        params[0].pName = "uniformBlock";
-        params[0].ppBuffers = &pSkyboxUniformBuffer[i];
-        updateDescriptorSet(pRenderer, i * 2 + 0, pDescriptorSetUniforms, 1, params);
+        params[0].pName = "visibilityIndices";
+        params[0].ppBuffers = &pFilteredIndexBuffer[i];
+        updateDescriptorSet(pRenderer, i * 2 + 0, pDescriptorSetVisibilityResolvePerFrame, 1, params);
+        params[0].ppBuffers = &pMeshletIndexBuffer;
+        updateDescriptorSet(pRenderer, i * 2 + 1, pDescriptorSetVisibilityResolvePerFrame, 1, params);
+    }
+
+    for (uint32_t level = 0; level < mHiZLevelCount; ++level)
+    {
+        DescriptorData hiZParams[1] = {};
+        hiZParams[0].pName = "hiZReadback";
+        hiZParams[0].ppBuffers = &pHiZReadbackGpuBuffer;
+        updateDescriptorSet(pRenderer, level, pDescriptorSetHiZBuild, 1, hiZParams);
+    }
+
+    DescriptorData occlusionParams[2] = {};
+    occlusionParams[0].pName = "submeshBounds";
+    occlusionParams[0].ppBuffers = &pSubmeshBoundsBuffer;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetOcclusionCull, 1, occlusionParams);
+
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        occlusionParams[0].pName = "occlusionCullUniforms";
+        occlusionParams[0].ppBuffers = &pOcclusionCullUniformBuffer[i];
+        occlusionParams[1].pName = "occlusionDrawArgs";
+        occlusionParams[1].ppBuffers = &pOcclusionDrawArgsBuffer[i];
+        updateDescriptorSet(pRenderer, i, pDescriptorSetOcclusionCullPerFrame, 2, occlusionParams);
+    }
+
+    updateVisibleInstanceDescriptors();
+}
 
-        params[0].pName = "uniformBlock";
-        params[0].ppBuffers = &pProjViewUniformBuffer[i];
+void KokkuTestApp::updateVisibleInstanceDescriptors()
+{
+    for (uint32_t i = 0; i < mFramesInFlight; ++i)
+    {
+        DescriptorData params[1] = {};
+        params[0].pName = "castleVisibleInstances";
+        params[0].ppBuffers = &pVisibleInstanceBuffer[i];
         updateDescriptorSet(pRenderer, i * 2 + 1, pDescriptorSetUniforms, 1, params);
+
+        params[0].pName = "visibleInstances";
+        updateDescriptorSet(pRenderer, i, pDescriptorSetOcclusionCullPerFrame, 1, params);
     }
 }
 
-void KokkuTestApp::loadCastleTexs()
+static void loadCookedTexture(const char* pFileName, const CookedTextureInfo* pCooked, uint32_t cookedCount, bool srgbFallback,
+                              Texture** ppTexture, SyncToken* pToken)
 {
-    //Albedo:
+    // The cooker records whether the data is color (sRGB) or not, files missing from the
+    // manifest fall back to what their usage implies
+    const CookedTextureInfo* info = cookedTexturesFind(pCooked, cookedCount, pFileName);
+    const bool               srgb = info ? info->mSrgb : srgbFallback;
+    if (info)
+        LOGF(eINFO, "%s: %s %s, %ux%u, %u mips", pFileName, info->mFormat, srgb ? "sRGB" : "linear", info->mWidth, info->mHeight,
+             info->mMipCount);
+    else
+        LOGF(eWARNING, "%s is not in CookedTextures.meta, loading it as %s", pFileName, srgb ? "sRGB" : "linear");
+
     TextureLoadDesc textureDesc = {};
-    textureDesc.pFileName = "Castle Exterior Texture.dds";
-    textureDesc.ppTexture = &pCastleAlbedo[0];
-    // Textures representing color should be stored in SRGB or HDR format
-    textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-    addResource(&textureDesc, NULL);
-    textureDesc = {};
-    textureDesc.pFileName = "Castle Interior Texture.dds";
-    textureDesc.ppTexture = &pCastleAlbedo[1];
-    // Textures representing color should be stored in SRGB or HDR format
-    textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-    addResource(&textureDesc, NULL);
-    textureDesc = {};
-    textureDesc.pFileName = "Ground and Fountain Texture.dds";
-    textureDesc.ppTexture = &pCastleAlbedo[2];
-    // Textures representing color should be stored in SRGB or HDR format
-    textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-    addResource(&textureDesc, NULL);
-
-    //Bumps
-
-    textureDesc.pFileName = "Castle Exterior Texture Bump.dds";
-    textureDesc.ppTexture = &pCastleBump[0];
-    // Textures representing color should be stored in SRGB or HDR format
-    textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-    addResource(&textureDesc, NULL);
-    textureDesc = {};
-    textureDesc.pFileName = "Castle Interior Texture Bump.dds";
-    textureDesc.ppTexture = &pCastleBump[1];
-    // Textures representing color should be stored in SRGB or HDR format
-    textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-    addResource(&textureDesc, NULL);
-    textureDesc = {};
-    textureDesc.pFileName = "Ground and Fountain Texture Bump.dds";
-    textureDesc.ppTexture = &pCastleBump[2];
-    // Textures representing color should be stored in SRGB or HDR format
-    textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-    addResource(&textureDesc, NULL);
+    textureDesc.pFileName = pFileName;
+    textureDesc.ppTexture = ppTexture;
+    textureDesc.mCreationFlag = srgb ? TEXTURE_CREATION_FLAG_SRGB : TEXTURE_CREATION_FLAG_NONE;
+    addResource(&textureDesc, pToken);
+}
+
+void KokkuTestApp::loadCookedTexturesMeta()
+{
+    // Written by KokkuTextureCooker (Art/TexCooked)
+    mCookedTextureCount = 0;
+    FileStream stream = {};
+    if (fsOpenStreamFromPath(RD_TEXTURES, "CookedTextures.meta", FM_READ, &stream))
+    {
+        const ssize_t size = fsGetStreamFileSize(&stream);
+        if (size > 0)
+        {
+            char* text = (char*)tf_malloc((size_t)size);
+            const size_t read = fsReadFromStream(&stream, text, (size_t)size);
+            mCookedTextureCount = cookedTexturesParse(text, read, mCookedTextures, MAX_COOKED_TEXTURES);
+            tf_free(text);
+        }
+        fsCloseStream(&stream);
+    }
+    else
+    {
+        LOGF(eWARNING, "CookedTextures.meta not found, castle textures weren't cooked");
+    }
+}
+
+void KokkuTestApp::loadCastleTexs()
+{
+    loadCookedTexture(gCastleAlbedoArrayFileName, mCookedTextures, mCookedTextureCount, true, &pCastleAlbedo, &mCastleTexturesToken);
+    // Tangent space normals baked from the bump heights, sampling them as sRGB would bend every normal
+    loadCookedTexture(gCastleBumpArrayFileName, mCookedTextures, mCookedTextureCount, false, &pCastleBump, &mCastleTexturesToken);
+}
+
+// Layer of pFileName in a castle texture array, the first one when the texture wasn't packed into it
+static uint32_t findCastleLayer(const CookedTextureInfo* pCooked, uint32_t cookedCount, const char* pArrayFileName,
+                                const char* pFileName)
+{
+    const CookedTextureInfo* info = cookedTexturesFind(pCooked, cookedCount, pFileName);
+    if (info && strcmp(info->mArrayFileName, pArrayFileName) == 0)
+        return info->mLayer;
+    LOGF(eWARNING, "Castle texture %s is not a layer of %s", pFileName, pArrayFileName);
+    return 0;
 }
 
 void KokkuTestApp::loadCastle()
 {
     GeometryLoadDesc sceneLoadDesc = {};
-    mCastleScene.Load(&sceneLoadDesc, false);
+    mCastleScene.setCookedFileName(getCastleSceneFileName());
+    mCastleScene.Load(&sceneLoadDesc, false, mCastleVertexFormat, mCastleSceneFormat);
+    addCastleSceneResources();
+}
 
-    uint32_t numSubmeshes = mCastleScene.getGeometry()->mDrawArgCount;
-    const uint32_t maxSubmeshes = 256;
-    uint32_t subMeshSizes[maxSubmeshes];
-    uint32_t temp = 0;
-    for (uint32_t i = 0; i < numSubmeshes && i < maxSubmeshes; i++)
+void KokkuTestApp::addCastleSceneResources()
+{
+    // Textures used by each castle.gltf primitive, in draw arg order, as gCastleAlbedoFileNames and
+    // gCastleBumpFileNames indices: Castle_Exterior, Towers_Doors_and_Windows, Ground_and_Fountain, Castle_Interior.
+    // castle.bin has no material names, castle.kscene brings its own table, one entry per draw. That includes the
+    // chunks KokkuMeshCooker --split-16bit adds, which keep the material of the primitive they were split from.
+    static const CastleMaterial gCastleMaterials[] = { { 0, 0 }, { 1, 1 }, { 2, 2 }, { 1, 1 } };
+
+    // Material table, uploaded once. Draw i uses entry i, so the shader does a single
+    // indexed fetch no matter how many submeshes the castle has.
+    const uint32_t numSubmeshes = mCastleScene.getGeometry()->mDrawArgCount;
+    const uint32_t numMaterials = sizeof(gCastleMaterials) / sizeof(gCastleMaterials[0]);
+    const CookedSceneMaterial* cookedMaterials = mCastleScene.getMaterials();
+    // A castle.bin with other draws (split, or another mesh) doesn't say which primitive each came from, so no entry
+    // of the table is known to be right for it
+    const bool binMaterialsMatch = cookedMaterials || numSubmeshes == numMaterials;
+    if (!binMaterialsMatch)
+        LOGF(eWARNING, "%s has %u draws, its material table is for the %u castle.gltf primitives. Drawing all with the first material, "
+             "cook it with KokkuSceneCooker for per draw materials", mCastleScene.getFileName(), numSubmeshes, numMaterials);
+    CastleMaterial* materials = (CastleMaterial*)tf_calloc(numSubmeshes, sizeof(CastleMaterial));
+    for (uint32_t i = 0; i < numSubmeshes; i++)
     {
-        temp += mCastleScene.getGeometry()->pDrawArgs[i].mIndexCount / 3;
-        subMeshSizes[i] = temp;
+        const char* albedo;
+        const char* bump;
+        if (cookedMaterials)
+        {
+            albedo = cookedMaterials[i].mAlbedo;
+            bump = cookedMaterials[i].mBump;
+        }
+        else
+        {
+            const CastleMaterial& material = gCastleMaterials[binMaterialsMatch ? i : 0];
+            albedo = gCastleAlbedoFileNames[material.mAlbedoLayer];
+            bump = gCastleBumpFileNames[material.mBumpLayer];
+        }
+        materials[i].mAlbedoLayer = findCastleLayer(mCookedTextures, mCookedTextureCount, gCastleAlbedoArrayFileName, albedo);
+        materials[i].mBumpLayer = findCastleLayer(mCookedTextures, mCookedTextureCount, gCastleBumpArrayFileName, bump);
     }
 
     BufferLoadDesc bDesc = {};
     bDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
     bDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-    bDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
-    bDesc.pData = subMeshSizes;
-    bDesc.mDesc.mSize = sizeof(uint32_t) * numSubmeshes;
-    bDesc.mDesc.pName = "submeshSizes";
-    bDesc.ppBuffer = &pSubmeshSizes;
+    bDesc.pData = materials;
+    bDesc.mDesc.mSize = sizeof(CastleMaterial) * numSubmeshes;
+    bDesc.mDesc.pName = "castleMaterials";
+    bDesc.ppBuffer = &pCastleMaterialBuffer;
     bDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
     bDesc.mDesc.mElementCount = numSubmeshes;
-    bDesc.mDesc.mStructStride = sizeof(uint32_t);
+    bDesc.mDesc.mStructStride = sizeof(CastleMaterial);
+
+    SyncToken token = {};
+    addResource(&bDesc, &token);
+    waitForToken(&token);
+    tf_free(materials);
+
+    CastleScene::getVertexLayout(mCastleVertexFormat, false, &gCastleVertexLayout);
+    CastleScene::getVertexLayout(mCastleVertexFormat, true, &gVisibilityBufferVertexLayout);
+
+    // The visibility buffer keeps the draw index in 8 bits, meshes with more parts only draw forward
+    mVisibilityBufferSupported = numSubmeshes <= VISIBILITY_BUFFER_MAX_DRAWS;
+    if (!mVisibilityBufferSupported)
+        LOGF(eWARNING, "Castle has %u draws, the visibility buffer supports %u and stays off", numSubmeshes, VISIBILITY_BUFFER_MAX_DRAWS);
+    LOGF(eINFO, "Castle geometry: %u draws, %u vertices, %u-bit indices", numSubmeshes, mCastleScene.getGeometry()->mVertexCount,
+         mCastleScene.getGeometry()->mIndexType == INDEX_TYPE_UINT16 ? 16 : 32);
+}
+
+void KokkuTestApp::runLoadBenchmark()
+{
+    char path[FS_MAX_PATH] = {};
+    const char* fileName = mCastleSceneFormat == CASTLE_SCENE_FORMAT_COOKED && getCastleSceneFileName()
+                               ? getCastleSceneFileName()
+                               : CastleScene::getSceneFileName(mCastleSceneFormat);
+    fsAppendPathComponent(fsGetResourceDirectory(RD_MESHES), fileName, path);
+    if (!loadBenchmarkEvictFile(path))
+        LOGF(eWARNING, "Could not evict %s from the page cache, the cold load may be warm", path);
+
+    // A scratch scene, so mCastleScene and everything bound to its buffers is created once as usual
+    LoadSample* samples = (LoadSample*)tf_calloc(mLoadBenchmarkRuns, sizeof(LoadSample));
+    const char* loadedFileName = fileName;
+    for (uint32_t i = 0; i < mLoadBenchmarkRuns; ++i)
+    {
+        const uint64_t startRss = loadBenchmarkBeginRun();
+        CastleScene scene = {};
+        GeometryLoadDesc loadDesc = {};
+        scene.setCookedFileName(getCastleSceneFileName());
+        scene.Load(&loadDesc, false, mCastleVertexFormat, mCastleSceneFormat);
+        const uint64_t peakRss = loadBenchmarkGetPeakRss();
+
+        samples[i].mGeometryMs = scene.getGeometryLoadMs();
+        samples[i].mBuildMs = scene.getBuildMs();
+        samples[i].mPeakRssGrowth = peakRss > startRss ? peakRss - startRss : 0;
+        loadedFileName = scene.getFileName();
+        scene.Unload();
+    }
+
+    loadBenchmarkReport(loadedFileName, samples, mLoadBenchmarkRuns);
+    tf_free(samples);
+}
+
+void KokkuTestApp::initHotReload()
+{
+    mAssetWatcher.Init(0.25f);
+    mAssetWatcher.Add(RD_TEXTURES, gCastleAlbedoArrayFileName, HOT_RELOAD_CASTLE_ALBEDO << 16);
+    mAssetWatcher.Add(RD_TEXTURES, gCastleBumpArrayFileName, HOT_RELOAD_CASTLE_BUMP << 16);
+    // The file the castle actually came from, after a fallback from castle.kscene that's castle.bin
+    mAssetWatcher.Add(RD_MESHES, mCastleScene.getFileName(), HOT_RELOAD_CASTLE_SCENE << 16);
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(gPipelineShaderFileNames); ++i)
+        mAssetWatcher.Add(RD_SHADER_BINARIES, gPipelineShaderFileNames[i], HOT_RELOAD_SHADER << 16 | i);
+
+    ThreadSystemInitDesc threadDesc = {};
+    threadDesc.mThreadCount = 1;
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(threadDesc.mThreadAffinity); ++i)
+        threadDesc.mThreadAffinity[i] = -1;
+    threadDesc.pThreadName = "HotReload";
+    initThreadSystem(&threadDesc, &pHotReloadThreads);
+
+    LOGF(eINFO, "Hot reload: watching %u files", mAssetWatcher.GetFileCount());
+}
 
-    addResource(&bDesc, NULL);
+void KokkuTestApp::exitHotReload()
+{
+    waitThreadSystemIdle(pHotReloadThreads);
+    exitThreadSystem(pHotReloadThreads);
+    pHotReloadThreads = NULL;
+    if (mCastleSceneReloading)
+        mReloadedCastleScene.Unload();
+    mCastleSceneReloading = false;
+
+    for (uint32_t asset = HOT_RELOAD_CASTLE_ALBEDO; asset <= HOT_RELOAD_CASTLE_BUMP; ++asset)
+    {
+        if (!pReloadedCastleTextures[asset])
+            continue;
+        waitForToken(&mReloadedCastleTextureTokens[asset]);
+        removeResource(pReloadedCastleTextures[asset]);
+        pReloadedCastleTextures[asset] = NULL;
+    }
+}
+
+void KokkuTestApp::loadReloadedCastleScene(void* pUser, uint64_t)
+{
+    KokkuTestApp* app = (KokkuTestApp*)pUser;
+    // The main thread leaves mCastleScene alone until this load is done
+    GeometryLoadDesc loadDesc = {};
+    app->mReloadedCastleScene.setCookedFileName(app->getCastleSceneFileName());
+    app->mReloadedCastleScene.Load(&loadDesc, false, app->mCastleVertexFormat, app->mCastleScene.getSceneFormat());
+}
+
+void KokkuTestApp::updateHotReload(float deltaTime)
+{
+    uint32_t       changed[AssetWatcher::MAX_FILES];
+    const uint32_t changedCount = mAssetWatcher.Update(deltaTime, changed, AssetWatcher::MAX_FILES);
+
+    const char* shaderFileNames[TF_ARRAY_COUNT(gPipelineShaderFileNames)];
+    uint32_t    shaderCount = 0;
+    for (uint32_t i = 0; i < changedCount; ++i)
+    {
+        const uint32_t asset = changed[i] >> 16;
+        const uint32_t index = changed[i] & 0xFFFF;
+        switch (asset)
+        {
+        case HOT_RELOAD_CASTLE_ALBEDO:
+        case HOT_RELOAD_CASTLE_BUMP:
+            reloadCastleTexture(asset);
+            break;
+        case HOT_RELOAD_CASTLE_SCENE:
+            mCastleSceneReloadQueued = true;
+            break;
+        case HOT_RELOAD_SHADER:
+            shaderFileNames[shaderCount++] = gPipelineShaderFileNames[index];
+            break;
+        }
+    }
+
+    // A shader change rewrites several binaries at once, they share one pipeline rebuild
+    if (shaderCount > 0)
+        reloadShaders(shaderFileNames, shaderCount);
+
+    // Loaded texture arrays replace the running ones once the GPU is idle, waited for once for all of them, so no
+    // frame still samples an array when it is released
+    bool texturesSwapped = false;
+    for (uint32_t asset = HOT_RELOAD_CASTLE_ALBEDO; asset <= HOT_RELOAD_CASTLE_BUMP; ++asset)
+    {
+        if (!pReloadedCastleTextures[asset] || !isTokenCompleted(&mReloadedCastleTextureTokens[asset]))
+            continue;
+
+        if (!texturesSwapped)
+            waitQueueIdle(pGraphicsQueue);
+        Texture** ppTexture = asset == HOT_RELOAD_CASTLE_ALBEDO ? &pCastleAlbedo : &pCastleBump;
+        removeResource(*ppTexture);
+        *ppTexture = pReloadedCastleTextures[asset];
+        pReloadedCastleTextures[asset] = NULL;
+        texturesSwapped = true;
+    }
+    if (texturesSwapped)
+        updateCastleTextureDescriptors();
+
+    if (mCastleSceneReloading && isThreadSystemIdle(pHotReloadThreads))
+    {
+        mCastleSceneReloading = false;
+        swapCastleScene();
+    }
+    // A change during the load is loaded again after the swap
+    if (mCastleSceneReloadQueued && !mCastleSceneReloading)
+    {
+        mCastleSceneReloadQueued = false;
+        mCastleSceneReloading = true;
+        addThreadSystemTask(pHotReloadThreads, loadReloadedCastleScene, this, 0);
+    }
+}
+
+void KokkuTestApp::reloadCastleTexture(uint32_t asset)
+{
+    Texture**  ppReloaded = &pReloadedCastleTextures[asset];
+    SyncToken* pToken = &mReloadedCastleTextureTokens[asset];
+
+    // Changed again before the last version was swapped in
+    if (*ppReloaded)
+    {
+        waitForToken(pToken);
+        removeResource(*ppReloaded);
+        *ppReloaded = NULL;
+    }
+
+    // The cooker rewrites the manifest with the arrays. The material layers are only looked up again when the
+    // castle scene reloads, the job file keeps them in order.
+    loadCookedTexturesMeta();
+
+    *pToken = {};
+    if (asset == HOT_RELOAD_CASTLE_ALBEDO)
+        loadCookedTexture(gCastleAlbedoArrayFileName, mCookedTextures, mCookedTextureCount, true, ppReloaded, pToken);
+    else
+        loadCookedTexture(gCastleBumpArrayFileName, mCookedTextures, mCookedTextureCount, false, ppReloaded, pToken);
+}
+
+void KokkuTestApp::updateCastleTextureDescriptors()
+{
+    // Two descriptors in each set sampling the castle materials, whatever the material count
+    DescriptorData params[2] = {};
+    params[0].pName = "castleAlbedo";
+    params[0].ppTextures = &pCastleAlbedo;
+    params[1].pName = "castleBump";
+    params[1].ppTextures = &pCastleBump;
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, 2, params);
+    updateDescriptorSet(pRenderer, 0, pDescriptorSetVisibilityResolve, 2, params);
+}
+
+void KokkuTestApp::swapCastleScene()
+{
+    const int64_t startUSec = getUSec(true);
+
+    // Everything sized by the draw count is rebuilt and only the descriptors of those buffers rewritten
+    waitQueueIdle(pGraphicsQueue);
+
+    removeResource(pCastleMaterialBuffer);
+    removeMeshletCullBuffers();
+    removeOcclusionCullBuffers();
+    tf_free(pVisibleDraws);
+    mCastleScene.Unload();
+
+    mCastleScene = mReloadedCastleScene;
+    mReloadedCastleScene = {};
+
+    addCastleSceneResources();
+    pVisibleDraws = (uint32_t*)tf_calloc(mCastleScene.getGeometry()->mDrawArgCount, sizeof(uint32_t));
+    addMeshletCullBuffers();
+    addOcclusionCullBuffers();
+    setCastleCitySpacing();
+    mBuiltCityColumns = 0;
+    mBuiltCityRows = 0;
+    mCastleVerticesPacked = false;
+    updateCastleSceneDescriptors();
+
+    LOGF(eINFO, "Hot reload: castle scene swapped in %.2f ms", (getUSec(true) - startUSec) / 1000.0);
+}
+
+void KokkuTestApp::reloadShaders(const char* const* ppFileNames, uint32_t count)
+{
+    const int64_t startUSec = getUSec(true);
 
-    gCastleVertexLayout = {};
-    gCastleVertexLayout.mAttribCount = 3;
-    gCastleVertexLayout.mBindingCount = 3;
-    gCastleVertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
-    gCastleVertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
-    gCastleVertexLayout.mAttribs[0].mBinding = 0;
-    gCastleVertexLayout.mAttribs[0].mLocation = 0;
-    gCastleVertexLayout.mAttribs[1].mSemantic = SEMANTIC_NORMAL;
-    gCastleVertexLayout.mAttribs[1].mFormat = TinyImageFormat_R16G16_UNORM;
-    gCastleVertexLayout.mAttribs[1].mBinding = 1;
-    gCastleVertexLayout.mAttribs[1].mLocation = 1;
-    gCastleVertexLayout.mAttribs[2].mSemantic = SEMANTIC_TEXCOORD0;
-    gCastleVertexLayout.mAttribs[2].mFormat = TinyImageFormat_R16G16_SFLOAT;
-    gCastleVertexLayout.mAttribs[2].mBinding = 2;
-    gCastleVertexLayout.mAttribs[2].mLocation = 2;
+    ShaderProgram  programs[MAX_SHADER_PROGRAMS];
+    const uint32_t programCount = getShaderPrograms(programs);
 
-    waitForAllResourceLoads();
+    // The new programs are all loaded before anything is released, a binary that fails keeps the old ones
+    Shader*  reloaded[MAX_SHADER_PROGRAMS] = {};
+    uint32_t reloadedCount = 0;
+    bool     failed = false;
+    for (uint32_t i = 0; i < programCount; ++i)
+    {
+        bool uses = false;
+        for (uint32_t f = 0; f < count && !uses; ++f)
+        {
+            for (uint32_t stage = 0; stage < 2 && !uses; ++stage)
+                uses = programs[i].pStages[stage] && strcmp(programs[i].pStages[stage], ppFileNames[f]) == 0;
+        }
+        if (!uses)
+            continue;
+
+        ShaderLoadDesc shaderDesc = {};
+        shaderDesc.mStages[0].pFileName = programs[i].pStages[0];
+        shaderDesc.mStages[1].pFileName = programs[i].pStages[1];
+        addShader(pRenderer, &shaderDesc, &reloaded[i]);
+        if (reloaded[i])
+            ++reloadedCount;
+        else
+            failed = true;
+    }
+
+    if (failed || reloadedCount == 0)
+    {
+        for (uint32_t i = 0; i < programCount; ++i)
+        {
+            if (reloaded[i])
+                removeShader(pRenderer, reloaded[i]);
+        }
+        if (failed)
+            LOGF(eERROR, "Hot reload: a changed shader failed to load, keeping the running ones");
+        return;
+    }
+
+    // Root signatures and descriptor sets stay, so a reloaded shader must keep its resources. The pipelines of the
+    // unchanged shaders come back from the pipeline cache.
+    waitQueueIdle(pGraphicsQueue);
+    removePipelines();
+    for (uint32_t i = 0; i < programCount; ++i)
+    {
+        if (!reloaded[i])
+            continue;
+        removeShader(pRenderer, *programs[i].ppShader);
+        *programs[i].ppShader = reloaded[i];
+    }
+    addPipelines();
+
+    LOGF(eINFO, "Hot reload: %u shader programs and the pipelines swapped in %.2f ms", reloadedCount,
+         (getUSec(true) - startUSec) / 1000.0);
 }
 
 void KokkuTestApp::add_attribute(VertexLayout* layout, ShaderSemantic semantic, TinyImageFormat format, uint32_t offset)
@@ -892,6 +3682,187 @@ void KokkuTestApp::compute_normal(const float* src, float* dst)
     }
 }
 
+// Count from the command line, kept inside the [1, maxCount] range of the matching UI slider
+static uint32_t clampCountArg(const char* pValue, uint32_t maxCount)
+{
+    const int count = atoi(pValue);
+    if (count < 1)
+        return 1;
+    return (uint32_t)count < maxCount ? (uint32_t)count : maxCount;
+}
+
+void KokkuTestApp::parseCommandLine()
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--headless") == 0)
+        {
+            mHeadless = true;
+        }
+        else if (strcmp(arg, "--benchmark-frames") == 0 && value)
+        {
+            mBenchmarkFrameCount = (uint32_t)atoi(value);
+            ++i;
+        }
+        else if (strcmp(arg, "--warmup-frames") == 0 && value)
+        {
+            mBenchmarkWarmupFrameCount = (uint32_t)atoi(value);
+            ++i;
+        }
+        else if (strcmp(arg, "--frames-in-flight") == 0 && value)
+        {
+            mFramesInFlight = clampCountArg(value, MAX_FRAMES_IN_FLIGHT);
+            mRequestedFramesInFlight = mFramesInFlight;
+            ++i;
+        }
+        else if (strcmp(arg, "--dynamic-resolution") == 0 && value)
+        {
+            mDynamicResolution = true;
+            mDynamicResolutionBudgetMs = fmaxf((float)atof(value), 1.0f);
+            ++i;
+        }
+        else if (strcmp(arg, "--hot-reload") == 0)
+        {
+            mHotReload = true;
+        }
+        else if (strcmp(arg, "--visibility-buffer") == 0)
+        {
+            mVisibilityBuffer = true;
+        }
+        else if (strcmp(arg, "--lights") == 0 && value)
+        {
+            const int count = atoi(value);
+            mLightCount = count < 0 ? 0 : ((uint32_t)count < CLUSTER_MAX_LIGHTS ? (uint32_t)count : CLUSTER_MAX_LIGHTS);
+            ++i;
+        }
+        else if (strcmp(arg, "--depth-prepass") == 0)
+        {
+            mDepthPrepass = true;
+        }
+        else if (strcmp(arg, "--occlusion-culling") == 0)
+        {
+            mOcclusionCulling = true;
+        }
+        else if (strcmp(arg, "--cpu-occlusion-culling") == 0)
+        {
+            mOcclusionCulling = true;
+            mGpuOcclusionCulling = false;
+        }
+        else if (strcmp(arg, "--lod") == 0)
+        {
+            mLodSelection = true;
+        }
+        else if (strcmp(arg, "--lod-threshold") == 0 && value)
+        {
+            mLodSelection = true;
+            mLodThreshold = fmaxf((float)atof(value), 0.01f);
+            ++i;
+        }
+        else if (strcmp(arg, "--city") == 0 && value && i + 2 < argc)
+        {
+            mCityColumns = clampCountArg(value, CASTLE_CITY_MAX_SIDE);
+            mCityRows = clampCountArg(argv[i + 2], CASTLE_CITY_MAX_SIDE);
+            i += 2;
+        }
+        else if (strcmp(arg, "--vertex-format") == 0 && value)
+        {
+            uint32_t format = 0;
+            while (format < CASTLE_VERTEX_FORMAT_COUNT && strcmp(value, CastleScene::getVertexFormatName((CastleVertexFormat)format)) != 0)
+                ++format;
+
+            if (format < CASTLE_VERTEX_FORMAT_COUNT)
+                mCastleVertexFormat = (CastleVertexFormat)format;
+            else
+            {
+                char names[64] = {};
+                for (format = 0; format < CASTLE_VERTEX_FORMAT_COUNT; ++format)
+                    snprintf(names + strlen(names), sizeof(names) - strlen(names), "%s%s", format ? ", " : "",
+                             CastleScene::getVertexFormatName((CastleVertexFormat)format));
+                LOGF(eERROR, "Unknown --vertex-format '%s', expected one of: %s. Keeping %s", value, names,
+                     CastleScene::getVertexFormatName(mCastleVertexFormat));
+            }
+            ++i;
+        }
+        else if (strcmp(arg, "--scene-format") == 0 && value)
+        {
+            uint32_t format = 0;
+            while (format < CASTLE_SCENE_FORMAT_COUNT && strcmp(value, CastleScene::getSceneFormatName((CastleSceneFormat)format)) != 0)
+                ++format;
+
+            if (format < CASTLE_SCENE_FORMAT_COUNT)
+                mCastleSceneFormat = (CastleSceneFormat)format;
+            else
+            {
+                char names[64] = {};
+                for (format = 0; format < CASTLE_SCENE_FORMAT_COUNT; ++format)
+                    snprintf(names + strlen(names), sizeof(names) - strlen(names), "%s%s", format ? ", " : "",
+                             CastleScene::getSceneFormatName((CastleSceneFormat)format));
+                LOGF(eERROR, "Unknown --scene-format '%s', expected one of: %s. Keeping %s", value, names,
+                     CastleScene::getSceneFormatName(mCastleSceneFormat));
+            }
+            ++i;
+        }
+        else if (strcmp(arg, "--scene-file") == 0 && value)
+        {
+            snprintf(mCastleSceneFileName, sizeof(mCastleSceneFileName), "%s", value);
+            mCastleSceneFormat = CASTLE_SCENE_FORMAT_COOKED;
+            ++i;
+        }
+        else if (strcmp(arg, "--upload-ring-kb") == 0 && value)
+        {
+            // On top of the room the frame's own constants get anyway
+            const int kb = atoi(value);
+            mUploadRingKb = kb > 4 ? (uint32_t)kb : 4;
+            ++i;
+        }
+        else if (strcmp(arg, "--upload-ring-benchmark") == 0)
+        {
+            mUploadRingBenchmarkDraws = value && atoi(value) > 0 ? (uint32_t)atoi(value) : 10000;
+            if (value && atoi(value) > 0)
+                ++i;
+        }
+        else if (strcmp(arg, "--metrics") == 0 && value)
+        {
+            snprintf(mMetricsFileName, sizeof(mMetricsFileName), "%s", value);
+            ++i;
+        }
+        else if (strcmp(arg, "--metrics-frames") == 0 && value)
+        {
+            const int frames = atoi(value);
+            mMetricsMaxFrames = frames > 0 ? (uint32_t)frames : mMetricsMaxFrames;
+            ++i;
+        }
+        else if (strcmp(arg, "--camera-record") == 0 && value)
+        {
+            snprintf(mCameraRecordFileName, sizeof(mCameraRecordFileName), "%s", value);
+            ++i;
+        }
+        else if (strcmp(arg, "--camera-replay") == 0 && value)
+        {
+            snprintf(mCameraReplayFileName, sizeof(mCameraReplayFileName), "%s", value);
+            ++i;
+        }
+        else if (strcmp(arg, "--camera-replay-step") == 0 && value)
+        {
+            const float stepMs = (float)atof(value);
+            mCameraReplayStepMs = stepMs > 0.0f ? stepMs : mCameraReplayStepMs;
+            ++i;
+        }
+        else if (strcmp(arg, "--load-benchmark") == 0 && value)
+        {
+            const int runs = atoi(value);
+            mLoadBenchmarkRuns = runs > 0 ? (uint32_t)runs : 0;
+            ++i;
+        }
+    }
+
+    if (mHeadless)
+        LOGF(eINFO, "Running headless at %dx%d", mSettings.mWidth, mSettings.mHeight);
+}
+
 void KokkuTestApp::setupActions()
 {
 
@@ -1,6 +1,17 @@
 #pragma once
 
+#include "AssetWatcher.h"
+#include "CameraPath.h"
 #include "CastleScene.h"
+#include "ClusteredLights.h"
+#include "CookedTextures.h"
+#include "DynamicResolution.h"
+#include "FrameBenchmark.h"
+#include "FrameTelemetry.h"
+#include "FrameUploadRing.h"
+#include "MetricsExport.h"
+#include "PipelineCacheStore.h"
+#include "StartupTrace.h"
 
 #include <Application/Interfaces/IApp.h>
 #include <Application/Interfaces/IFont.h>
@@ -11,6 +22,8 @@
 #include <Game/Interfaces/IScripting.h>
 
 #include <Utilities/RingBuffer.h>
+#include <Utilities/Threading/ThreadSystem.h>
+#include <Utilities/Interfaces/ITime.h>
 
 // Math
 #include <Utilities/Interfaces/IMemory.h>
@@ -24,20 +37,131 @@ private:
         CameraMatrix mProjectView;
         mat4         mScaleMat;
 
-        // Point Light Information
-        vec3 mLightPosition;
-        vec3 mLightColor;
+        // Directional light, the point lights are in the light cluster buffers
+        vec4 mSunDirection;
+        vec4 mSunColor;
+        // ClusterShaderParams of this frame's camera
+        vec4 mClusterParams;
+    };
 
-        uint32_t mSubmeshCount;
+    // Entry of the castle material table, layers of pCastleAlbedo/pCastleBump.
+    // Matches the uint2 layout of castleMaterials in castleShading.h.
+    struct CastleMaterial
+    {
+        uint32_t mAlbedoLayer;
+        uint32_t mBumpLayer;
     };
 
     struct UniformBlockSky
     {
-        CameraMatrix mProjectView;
+        // Inverse of the translation free view projection, turns screen positions into sky directions
+        mat4 mInvProjectView;
+    };
+
+    // Same layout as meshletCullUniforms in meshletCull.comp
+    struct MeshletCullUniforms
+    {
+        float    mFrustumPlanes[6][4];
+        float    mCameraPosition[4];
+        uint32_t mMeshletCount;
+        uint32_t mConeCulling;
+    };
+
+    // Same layout as castleCityConstants in castleCity.comp
+    struct CastleCityConstants
+    {
+        uint32_t mInstanceCount;
+        uint32_t mColumns;
+        float    mSpacingX;
+        float    mSpacingZ;
+    };
+
+    // Same layout as castleVertexPackConstants in castleVertexPack.comp
+    struct CastleVertexPackConstants
+    {
+        float    mPositionOffset[4];
+        float    mPositionInvScale[4];
+        uint32_t mVertexCount;
+        uint32_t mInterleaved;
+    };
+
+    // Same layout as visibilityResolveConstants in visibilityResolve.frag
+    struct VisibilityResolveConstants
+    {
+        float    mScreenSize[2];
+        uint32_t mPositionStride;
+        uint32_t mQuantizedPositions;
+        uint32_t mNormalStride;
+        uint32_t mNormalOffset;
+        uint32_t mUVStride;
+        uint32_t mUVOffset;
+        uint32_t mTangentStride;
+        uint32_t mTangentOffset;
+    };
+
+    // Same layout as occlusionCullUniforms in occlusionCull.comp
+    struct OcclusionCullUniforms
+    {
+        float    mFrustumPlanes[6][4];
+        float    mHiZObjectToClip[16];
+        float    mInstanceScale[4];
+        float    mDepthSize[2];
+        float    mViewportSize[2];
+        uint32_t mInstanceCount;
+        uint32_t mDrawCount;
+        uint32_t mHiZLevelCount;
+        uint32_t mHiZValid;
+        uint32_t mFrustumCulling;
+        uint32_t mPad[3];
+    };
+
+    // Same layout as hiZBuildConstants in hiZBuild.comp
+    struct HiZBuildConstants
+    {
+        uint32_t mSrcSize[2];
+        uint32_t mDstSize[2];
+        uint32_t mSrcLevel;
+        uint32_t mReadback;
     };
 
-    // But we only need Two sets of resources (one in flight and one being used on CPU)
-    static const uint32_t gDataBufferCount = 2;
+    // Same layout as upscaleConstants in upscale.frag
+    struct UpscaleConstants
+    {
+        float mUvScale[2];
+        float mUvMax[2];
+    };
+
+    // Same layout as drawConstants in basic.vert
+    struct DrawConstants
+    {
+        uint32_t mMaterialIndex;
+        uint32_t mVisibleInstanceOffset;
+        // Only read by the visibility buffer, which stores it next to the draw index
+        uint32_t mLodLevel;
+    };
+    // Must match NO_INSTANCE_CULLING in resources.h
+    static const uint32_t NO_INSTANCE_CULLING = 0xFFFFFFFF;
+
+    // Where the castle draws of a frame come from, see drawCastleGeometry()
+    enum CastleDrawSource
+    {
+        // pVisibleDraws, each drawn for the whole city
+        CASTLE_DRAW_DIRECT,
+        // pFilteredIndexBuffer and the draw args written by meshletCull.comp
+        CASTLE_DRAW_MESHLET_CULLED,
+        // Draw args and visible instances written by occlusionCull.comp
+        CASTLE_DRAW_OCCLUSION_GPU,
+        // Visible instances of cullOcclusionCpu()
+        CASTLE_DRAW_OCCLUSION_CPU,
+        // pVisibleDraws from the LOD index ranges, instances grouped by level in selectCastleLods()
+        CASTLE_DRAW_LOD,
+    };
+
+    // Per-frame resources are declared for the maximum, mFramesInFlight of them exist at a time
+    static const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+    // Frames the CPU may record ahead of the GPU, changed at runtime through mRequestedFramesInFlight
+    uint32_t mFramesInFlight = 2;
+    uint32_t mRequestedFramesInFlight = 2;
 
     Renderer* pRenderer = NULL;
 
@@ -45,28 +169,69 @@ private:
     GpuCmdRing gGraphicsCmdRing = {};
 
     SwapChain* pSwapChain = NULL;
+    // Used instead of pSwapChain when running headless
+    RenderTarget* pOffscreenTarget = NULL;
     RenderTarget* pDepthBuffer = NULL;
     Semaphore* pImageAcquiredSemaphore = NULL;
 
     Shader* pCastleShader = NULL;
     Pipeline* pCastlePipeline = NULL;
+    // Depth-only castle pass (visibilityBuffer.vert without a pixel shader), then the castle pass tests against it without writing
+    bool mDepthPrepass = false;
+    Shader* pDepthPrepassShader = NULL;
+    Pipeline* pDepthPrepassPipeline = NULL;
+    Pipeline* pCastleDepthEqualPipeline = NULL;
     VertexLayout gCastleVertexLayout = {};
 
+    // Castle vertex layout, see CastleVertexFormat. Picked with --vertex-format before the castle loads; the
+    // quantized ones are packed by castleVertexPack.comp in the first frame.
+    CastleVertexFormat mCastleVertexFormat = CASTLE_VERTEX_FORMAT_FLOAT;
+    bool mCastleVerticesPacked = false;
+    Shader* pCastleVertexPackShader = NULL;
+    RootSignature* pCastleVertexPackRootSignature = NULL;
+    uint32_t mCastleVertexPackConstantsIndex = 0;
+    Pipeline* pCastleVertexPackPipeline = NULL;
+    DescriptorSet* pDescriptorSetCastleVertexPack = NULL;
+    // Object to world of the castle for the CPU side. gUniformData.mScaleMat also carries the position
+    // dequantization, so the shaders see the stored vertex positions as their object space.
+    mat4 mCastleObjectToWorld = mat4::identity();
+
     Shader* pSkyBoxDrawShader = NULL;
-    Buffer* pSkyBoxVertexBuffer = NULL;
     Pipeline* pSkyBoxDrawPipeline = NULL;
     RootSignature* pRootSignature = NULL;
+    uint32_t mDrawConstantsIndex = 0;
     Sampler* pSamplerSkyBox = NULL;
     Sampler* pSmaplerCastle = NULL;
-    Texture* pCastleAlbedo[3];
-    Texture* pCastleBump[3];
-    Texture* pSkyBoxTextures[6];
+    // Castle material textures, one texture array per kind, see CastleMaterial
+    Texture* pCastleAlbedo = NULL;
+    Texture* pCastleBump = NULL;
+    SyncToken mCastleTexturesToken = {};
+    // CookedTextures.meta, read before the castle and its textures load
+    static const uint32_t MAX_COOKED_TEXTURES = 32;
+    CookedTextureInfo mCookedTextures[MAX_COOKED_TEXTURES] = {};
+    uint32_t mCookedTextureCount = 0;
+    // The six skybox faces baked into one cubemap at startup, see bakeSkyBoxCube()
+    Texture* pSkyBoxFaces[6] = {};
+    SyncToken mSkyBoxFacesToken = {};
+    RenderTarget* pSkyBoxCube = NULL;
     DescriptorSet* pDescriptorSetTexture = { NULL };
     DescriptorSet* pDescriptorConstCastle = { NULL };
     DescriptorSet* pDescriptorSetUniforms = { NULL };
 
-    Buffer* pProjViewUniformBuffer[gDataBufferCount] = { NULL };
-    Buffer* pSkyboxUniformBuffer[gDataBufferCount] = { NULL };
+    // Per-frame constants, uniformBlock_rootcbv of the castle and sky passes is bound at its block's offset
+    FrameUploadRing mUploadRing;
+    FrameUploadBlock mCastleUniforms = {};
+    FrameUploadBlock mSkyUniforms = {};
+    // --upload-ring-kb, on top of what the benchmark below needs
+    uint32_t mUploadRingKb = 64;
+
+    // --upload-ring-benchmark N: N extra DrawConstants blocks allocated and bound per frame, timed and reported on exit
+    static const uint32_t UPLOAD_RING_BENCHMARK_SAMPLES = 1024;
+    uint32_t mUploadRingBenchmarkDraws = 0;
+    FrameUploadBlock* pUploadRingBenchmarkBlocks = NULL;
+    float mUploadRingAllocMs[UPLOAD_RING_BENCHMARK_SAMPLES] = {};
+    float mUploadRingBindMs[UPLOAD_RING_BENCHMARK_SAMPLES] = {};
+    uint32_t mUploadRingBenchmarkFrames = 0;
 
     uint32_t     gFrameIndex = 0;
     ProfileToken gGpuProfileToken;
@@ -80,23 +245,286 @@ private:
 
     uint32_t gFontID = 0;
 
-    QueryPool* pPipelineStatsQueryPool[gDataBufferCount] = {};
+    QueryPool* pPipelineStatsQueryPool[MAX_FRAMES_IN_FLIGHT] = {};
 
     unsigned char gPipelineStatsCharArray[2048] = {};
     bstring       gPipelineStats = bfromarr(gPipelineStatsCharArray);
 
     FontDrawDesc gFrameTimeDraw;
 
+    // Frame pacing telemetry shown in the UI, reset whenever the frame count changes
+    FrameTelemetry mFrameTelemetry;
+    int64_t mLastPresentUSec = 0;
+    // The stats and histograms are rebuilt at this rate rather than every frame, readable and off the frame cost
+    static const int64_t TELEMETRY_UI_REFRESH_USEC = 250000;
+    int64_t mTelemetryUIRefreshUSec = 0;
+    char mTelemetryTitles[FRAME_TELEMETRY_METRIC_COUNT][64] = {};
+    float mTelemetryHistogramMin = 0.0f;
+    float mTelemetryHistogramMax[FRAME_TELEMETRY_METRIC_COUNT] = {};
+    unsigned char gFramePacingCharArray[512] = {};
+    bstring       gFramePacing = bfromarr(gFramePacingCharArray);
+
+    // Headless benchmark mode (--headless, --benchmark-frames N, --warmup-frames N)
+    bool mHeadless = false;
+    uint32_t mBenchmarkFrameCount = 0;
+    uint32_t mBenchmarkWarmupFrameCount = 16;
+    FrameBenchmark mFrameBenchmark;
+    HiresTimer mFrameTimer;
+
+    // --metrics <file> [--metrics-frames N]: per-frame CPU, GPU and pipeline stats written to Debug/<file> on exit,
+    // without the benchmark warmup frames
+    MetricsExport mMetrics;
+    char mMetricsFileName[256] = {};
+    uint32_t mMetricsMaxFrames = 100000;
+    uint32_t mMetricsSkipFrames = 0;
+    float mLastUpdateMs = 0.0f;
+    // Timestamps of the frame and its main passes, read back with the pipeline stats once the slot's fence passed
+    QueryPool* pMetricsQueryPool[MAX_FRAMES_IN_FLIGHT] = {};
+    uint32_t mMetricsSlotFrames[MAX_FRAMES_IN_FLIGHT] = {};
+    double mTimestampFrequency = 0.0;
+
+    // --camera-record <file>: the camera pose of every Update() is saved to Debug/<file> on exit, moving the
+    // Camera Segment slider starts a new segment
+    CameraPath mCameraRecording;
+    char mCameraRecordFileName[256] = {};
+    float mCameraRecordTime = 0.0f;
+    uint32_t mCameraRecordSegment = 0;
+    uint32_t mCameraRecordedSegment = 0;
+    // --camera-replay <file> [--camera-replay-step <ms>]: flies the camera along CameraPaths/<file> at a fixed
+    // timestep and quits with the frame time percentiles of every segment
+    CameraPathReplay mCameraReplay;
+    char mCameraReplayFileName[256] = {};
+    float mCameraReplayStepMs = 1000.0f / 60.0f;
+
+    // --scene-format picks the castle file, --load-benchmark N loads it N times into a scratch CastleScene before
+    // the real load and quits after the report unless --benchmark-frames runs too
+    CastleSceneFormat mCastleSceneFormat = CASTLE_SCENE_FORMAT_COOKED;
+    // --scene-file: a cooked scene loaded in place of castle.kscene, empty for the castle
+    char mCastleSceneFileName[256] = {};
+    const char* getCastleSceneFileName() const { return mCastleSceneFileName[0] ? mCastleSceneFileName : NULL; }
+    uint32_t mLoadBenchmarkRuns = 0;
+
+    // Every addPipeline goes through this cache, saved in Exit() and reloaded by the next run
+    PipelineCacheStore mPipelineCache;
+    // Start of Init(), cleared once the first Load() logged the startup time
+    int64_t mStartupUSec = 0;
+    // Init() and the first Load(), written to Debug/StartupTrace.json
+    StartupTrace mStartupTrace;
+
     CastleScene mCastleScene = {};
-    Buffer* pSubmeshSizes = NULL;
+    // One CastleMaterial per castle draw, the draw index is passed as a root constant
+    Buffer* pCastleMaterialBuffer = NULL;
+
+    // --hot-reload: the castle textures, the castle scene and the shader binaries are polled and swapped one by one
+    // while frames keep rendering, see updateHotReload()
+    bool mHotReload = false;
+    AssetWatcher mAssetWatcher;
+    // Replacement castle texture arrays being loaded, by HotReloadAsset, the albedo and bump kinds
+    Texture* pReloadedCastleTextures[2] = {};
+    SyncToken mReloadedCastleTextureTokens[2] = {};
+    // The castle scene is loaded on its own thread into a scratch scene, swapped in once the load is done
+    ThreadSystem* pHotReloadThreads = NULL;
+    CastleScene mReloadedCastleScene = {};
+    bool mCastleSceneReloading = false;
+    bool mCastleSceneReloadQueued = false;
+
+    // CPU frustum culling of castle submeshes, filled in Update() and consumed in Draw()
+    bool mFrustumCulling = true;
+    uint32_t* pVisibleDraws = NULL;
+    uint32_t mVisibleDrawCount = 0;
+    // Object space frustum and camera position, shared by the CPU and GPU culling
+    Frustum mCastleFrustum = {};
+    float mCastleCameraPosition[3] = {};
+
+    // GPU-driven castle pass: meshletCull.comp writes the visible triangles of each castle draw into a
+    // per-frame index buffer and bumps that draw's indirect args, which the castle pass executes
+    bool mGpuMeshletCulling = true;
+    // Off by default: the castle material is double-sided (CULL_MODE_NONE, back faces shaded with the flipped normal),
+    // so the back-facing meshlets the cone test drops are visible
+    bool mMeshletConeCulling = false;
+    Shader* pMeshletCullShader = NULL;
+    RootSignature* pMeshletCullRootSignature = NULL;
+    Pipeline* pMeshletCullPipeline = NULL;
+    DescriptorSet* pDescriptorSetMeshletCull = NULL;
+    DescriptorSet* pDescriptorSetMeshletCullPerFrame = NULL;
+    CommandSignature* pCastleCommandSignature = NULL;
+    MeshletCullUniforms gMeshletCullUniformData = {};
+    Buffer* pMeshletCullUniformBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    // Castle draw args with zero index counts, copied over pCastleDrawArgsBuffer before every cull
+    Buffer* pClearedDrawArgsBuffer = NULL;
+    Buffer* pCastleDrawArgsBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    Buffer* pFilteredIndexBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    // Results of the CPU reference culling, only used for the stats text
+    uint32_t* pVisibleMeshlets = NULL;
+    uint32_t mVisibleMeshletCount = 0;
+
+    // Castle city: the castle drawn as a mCityColumns x mCityRows grid of instances. castleCity.comp writes
+    // the per-instance transforms whenever the grid changes, so the CPU cost does not grow with the count.
+    // A 1x1 city is the single castle, which keeps the culling paths above.
+    static const uint32_t CASTLE_CITY_MAX_SIDE = 512;
+    uint32_t mCityColumns = 1;
+    uint32_t mCityRows = 1;
+    // Grid currently stored in pCastleInstanceBuffer, 0 forces a rebuild
+    uint32_t mBuiltCityColumns = 0;
+    uint32_t mBuiltCityRows = 0;
+    // Object space distance between neighbouring castles along X and Z
+    float mCastleCitySpacing[2] = {};
+    Buffer* pCastleInstanceBuffer = NULL;
+    Shader* pCastleCityShader = NULL;
+    RootSignature* pCastleCityRootSignature = NULL;
+    uint32_t mCastleCityConstantsIndex = 0;
+    Pipeline* pCastleCityPipeline = NULL;
+    DescriptorSet* pDescriptorSetCastleCity = NULL;
+
+    // Visibility buffer path: the castle pass only writes triangle and draw IDs to pVisibilityBuffer, then
+    // visibilityResolve.frag fetches the triangle again and shades every covered pixel in one fullscreen pass.
+    // Shares the geometry, culling results and textures with the forward path.
+    // Must match the 8 draw index bits in visibilityBuffer.frag, the 3 LOD bits next to them fit CastleScene::MAX_LODS
+    static const uint32_t VISIBILITY_BUFFER_MAX_DRAWS = 256;
+    bool mVisibilityBuffer = false;
+    // False when the castle has more draws than the visibility buffer can tell apart
+    bool mVisibilityBufferSupported = true;
+    RenderTarget* pVisibilityBuffer = NULL;
+    Shader* pVisibilityBufferShader = NULL;
+    Pipeline* pVisibilityBufferPipeline = NULL;
+    VertexLayout gVisibilityBufferVertexLayout = {};
+    Shader* pVisibilityResolveShader = NULL;
+    RootSignature* pVisibilityResolveRootSignature = NULL;
+    uint32_t mVisibilityResolveConstantsIndex = 0;
+    Pipeline* pVisibilityResolvePipeline = NULL;
+    DescriptorSet* pDescriptorSetVisibilityResolve = NULL;
+    // Two per frame: the GPU culled index buffer and the full meshlet index buffer
+    DescriptorSet* pDescriptorSetVisibilityResolvePerFrame = NULL;
+
+    // Dynamic resolution (--dynamic-resolution <ms>): the 3D passes render into the top-left mRenderWidth x mRenderHeight
+    // of pSceneColor and of the depth, visibility and Hi-Z targets. Those keep the full size, so a new scale costs no
+    // reallocation. upscale.frag then stretches the region over the back buffer before the UI. Turned off, the
+    // passes draw straight into the back buffer at the full size.
+    bool mDynamicResolution = false;
+    // Setting of the last Update(), turning it on starts again from the full resolution
+    bool mDynamicResolutionApplied = false;
+    float mDynamicResolutionBudgetMs = 1000.0f / 60.0f;
+    DynamicResolution mResolutionController;
+    uint32_t mRenderWidth = 0;
+    uint32_t mRenderHeight = 0;
+    RenderTarget* pSceneColor = NULL;
+    Shader* pUpscaleShader = NULL;
+    RootSignature* pUpscaleRootSignature = NULL;
+    uint32_t mUpscaleConstantsIndex = 0;
+    Pipeline* pUpscalePipeline = NULL;
+    DescriptorSet* pDescriptorSetUpscale = NULL;
+
+    // Occlusion culling: every castle draw of every instance is tested against the Hi-Z pyramid of the previous
+    // frame's depth. occlusionCull.comp does it on the GPU, cullOcclusionCpu() is the fallback that reads the
+    // coarse end of the pyramid back and uploads the visible instance lists itself.
+    bool mOcclusionCulling = false;
+    bool mGpuOcclusionCulling = true;
+    Texture* pHiZ = NULL;
+    uint32_t mHiZLevelCount = 0;
+    // Camera the current pyramid was built with, mHiZValid is false until one exists for this depth buffer size
+    float mHiZObjectToClip[16] = {};
+    // Region of the depth buffer the pyramid's frame rendered to
+    float mHiZViewportSize[2] = {};
+    bool mHiZValid = false;
+    Shader* pHiZBuildShader = NULL;
+    RootSignature* pHiZBuildRootSignature = NULL;
+    uint32_t mHiZBuildConstantsIndex = 0;
+    Pipeline* pHiZBuildPipeline = NULL;
+    // One set per pyramid level
+    DescriptorSet* pDescriptorSetHiZBuild = NULL;
+    Shader* pOcclusionCullShader = NULL;
+    RootSignature* pOcclusionCullRootSignature = NULL;
+    Pipeline* pOcclusionCullPipeline = NULL;
+    DescriptorSet* pDescriptorSetOcclusionCull = NULL;
+    DescriptorSet* pDescriptorSetOcclusionCullPerFrame = NULL;
+    OcclusionCullUniforms gOcclusionCullUniformData = {};
+    Buffer* pOcclusionCullUniformBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    // Min and max of each castle draw's bounds as float4s
+    Buffer* pSubmeshBoundsBuffer = NULL;
+    // Castle draw args with zero instance counts, copied over pOcclusionDrawArgsBuffer before every cull
+    Buffer* pOcclusionClearedArgsBuffer = NULL;
+    Buffer* pOcclusionDrawArgsBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    // Read by the castle vertex shaders through castleVisibleInstances. It and pCpuVisibleInstanceBuffer hold
+    // mVisibleInstanceCapacity instances per draw, the city size they were built for.
+    Buffer* pVisibleInstanceBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    uint32_t mVisibleInstanceCapacity = 0;
+    // CPU fallback: one level of the pyramid is copied to pHiZReadbackBuffer[frame], the coarser ones are rebuilt
+    // from it on the CPU once that frame's fence has passed
+    static const uint32_t HIZ_READBACK_MAX_SIDE = 128;
+    uint32_t mHiZReadbackLevel = 0;
+    Buffer* pHiZReadbackGpuBuffer = NULL;
+    Buffer* pHiZReadbackBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    float mHiZReadbackObjectToClip[MAX_FRAMES_IN_FLIGHT][16] = {};
+    uint32_t mHiZReadbackViewportSize[MAX_FRAMES_IN_FLIGHT][2] = {};
+    bool mHiZReadbackValid[MAX_FRAMES_IN_FLIGHT] = {};
+    float* pHiZCpuLevels = NULL;
+    Buffer* pCpuVisibleInstanceBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    uint32_t* pOcclusionInstanceOffsets = NULL;
+    uint32_t* pOcclusionInstanceCounts = NULL;
+    uint32_t mOcclusionVisibleCount = 0;
+    // Object to clip of this frame, the camera of the pyramid built at its end
+    float mCastleObjectToClip[16] = {};
+
+    // LOD selection: every castle instance picks the coarsest level of the CastleScene LOD chain whose error
+    // projects to at most mLodThreshold pixels. The instances of each level are uploaded through
+    // pCpuVisibleInstanceBuffer like the CPU occlusion culling, which replaces the selection while it is on.
+    bool mLodSelection = false;
+    float mLodThreshold = 1.0f;
+    // Object space error to pixels at a distance of one object space unit
+    float mLodPixelsPerUnit = 0.0f;
+    // Level picked for each instance, 0xFF when frustum culled
+    uint8_t* pInstanceLods = NULL;
+    uint32_t mLodInstanceOffsets[CastleScene::MAX_LODS] = {};
+    uint32_t mLodInstanceCounts[CastleScene::MAX_LODS] = {};
+    uint32_t mLodVisibleCount = 0;
+
+    // Clustered point lights: Update() moves the lights and Draw() bins them into CLUSTER_COUNT clusters on the
+    // CPU (ClusteredLights.cpp), so the castle shaders only loop over the lights of their pixel's cluster.
+    struct LightPlacement
+    {
+        // Position inside the city bounds in 0..1, then the bobbing phase
+        float mU;
+        float mV;
+        float mHeight;
+        float mPhase;
+    };
+    uint32_t mLightCount = 256;
+    PointLight* pLights = NULL;
+    LightPlacement* pLightPlacements = NULL;
+    ClusterBinScratch* pClusterBinScratch = NULL;
+    ClusterCamera mClusterCamera = {};
+    ClusterBinStats mClusterBinStats = {};
+    float mLightRangesMs = 0.0f;
+    float mLightScatterMs = 0.0f;
+    Buffer* pLightBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    Buffer* pLightClusterBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
+    Buffer* pLightIndexBuffer[MAX_FRAMES_IN_FLIGHT] = { NULL };
     Texture** ppDiffuseTexs;
 
     void setupActions();
+
+    void parseCommandLine();
+
+    void addFrameResources();
+    void removeFrameResources();
+    void setFramesInFlight(uint32_t count);
+    void updateFrameTelemetry(const FrameTelemetrySample& sample, int64_t nowUSec);
+    void beginMetricsQuery(Cmd* cmd, uint32_t query);
+    void endMetricsQuery(Cmd* cmd, uint32_t query);
+    void readFrameMetrics(uint32_t frameIndex);
     
     bool addSwapChain();
 
+    bool addOffscreenTarget();
+
+    RenderTarget* getBackBuffer(uint32_t index);
+
     bool addDepthBuffer();
 
+    bool addSceneColor();
+    bool addVisibilityBuffer();
+    bool addHiZ();
+
     void addDescriptorSets();
 
     void removeDescriptorSets();
@@ -105,6 +533,14 @@ private:
 
     void removeRootSignatures();
 
+    // Stages of one addShaders() program, pStages[1] is NULL for compute and depth only programs
+    struct ShaderProgram
+    {
+        Shader** ppShader;
+        const char* pStages[2];
+    };
+    static const uint32_t MAX_SHADER_PROGRAMS = 16;
+    uint32_t getShaderPrograms(ShaderProgram* pPrograms);
     void addShaders();
     void removeShaders();
 
@@ -113,12 +549,76 @@ private:
     void removePipelines();
 
     void prepareDescriptorSets();
+    // The part of prepareDescriptorSets() that reads the castle scene and the buffers sized by its draw count
+    void updateCastleSceneDescriptors();
 
     void loadCastle();
+    // Material table and the settings that follow from the loaded castle
+    void addCastleSceneResources();
+    void runLoadBenchmark();
+    void loadCookedTexturesMeta();
     void loadCastleTexs();
+    void loadSkyBoxFaces();
+    void bakeSkyBoxCube();
+
+    // Init() work that only needs the renderer and the resource loader, run on a worker pool while the main
+    // thread sets up the fonts, UI and profiler. index is an InitTask.
+    static void runInitTask(void* pUser, uint64_t index);
+
+    void initHotReload();
+    void exitHotReload();
+    void updateHotReload(float deltaTime);
+    void reloadCastleTexture(uint32_t asset);
+    void updateCastleTextureDescriptors();
+    void swapCastleScene();
+    void reloadShaders(const char* const* ppFileNames, uint32_t count);
+    static void loadReloadedCastleScene(void* pUser, uint64_t index);
 
     bool setupCamera();
 
+    void cullCastle();
+
+    void addMeshletCullBuffers();
+    void removeMeshletCullBuffers();
+    void cullMeshlets(Cmd* cmd);
+
+    void addCastleCityBuffer();
+    void setCastleCitySpacing();
+    void buildCastleCity(Cmd* cmd);
+    void packCastleVertices(Cmd* cmd);
+    uint32_t getCityInstanceCount() const { return mCityColumns * mCityRows; }
+
+    void addOcclusionCullBuffers();
+    void removeOcclusionCullBuffers();
+    void addVisibleInstanceBuffers();
+    void removeVisibleInstanceBuffers();
+    // Rebuilds the visible instance buffers for a new city size, once the GPU is idle
+    void resizeVisibleInstanceBuffers();
+    void updateVisibleInstanceDescriptors();
+    void cullOcclusion(Cmd* cmd);
+    void cullOcclusionCpu();
+    void uploadCpuVisibleInstances(Cmd* cmd, uint32_t count);
+    void buildHiZ(Cmd* cmd);
+
+    void selectCastleLods();
+    uint64_t countCastleTriangles(CastleDrawSource source);
+
+    void addLightBuffers();
+    void removeLightBuffers();
+    void placeLights();
+    void updateLights(float time);
+    void binLights();
+
+    void drawCastleGeometry(Cmd* cmd, CastleDrawSource source, bool positionsOnly);
+    // Binds a set of a root signature with uniformBlock_rootcbv, pointing it at block
+    void bindUniformSet(Cmd* cmd, DescriptorSet* pSet, uint32_t index, const FrameUploadBlock& block);
+    void runUploadRingBenchmark(Cmd* cmd);
+    void reportUploadRingBenchmark();
+    void drawDepthPrepass(Cmd* cmd, CastleDrawSource source);
+    void drawVisibilityBuffer(Cmd* cmd, CastleDrawSource source);
+    void resolveVisibilityBuffer(Cmd* cmd, bool gpuMeshletCulling);
+    void upscaleSceneColor(Cmd* cmd, RenderTarget* pRenderTarget);
+
     void add_attribute(VertexLayout* layout, ShaderSemantic semantic, TinyImageFormat format, uint32_t offset);
     void copy_attribute(VertexLayout* layout, void* buffer_data, uint32_t offset, uint32_t size, uint32_t vcount, void* data);
     void compute_normal(const float* src, float* dst);
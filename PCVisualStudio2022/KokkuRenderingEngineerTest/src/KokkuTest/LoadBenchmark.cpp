@@ -0,0 +1,128 @@
+#include "LoadBenchmark.h"
+#include "FrameBenchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+#if defined(__linux__)
+// A "VmRSS:"/"VmHWM:" line of /proc/self/status in bytes
+static uint64_t readStatusKb(const char* pKey)
+{
+    FILE* file = fopen("/proc/self/status", "r");
+    if (!file)
+        return 0;
+
+    uint64_t value = 0;
+    char line[256];
+    const size_t keyLength = strlen(pKey);
+    while (fgets(line, sizeof(line), file))
+    {
+        if (strncmp(line, pKey, keyLength) == 0)
+        {
+            value = strtoull(line + keyLength, NULL, 10) * 1024;
+            break;
+        }
+    }
+    fclose(file);
+    return value;
+}
+#endif
+
+bool loadBenchmarkEvictFile(const char* pPath)
+{
+#if defined(__linux__)
+    const int fd = open(pPath, O_RDONLY);
+    if (fd < 0)
+        return false;
+    // Clean pages only, the scene files are never written by the app
+    const bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return evicted;
+#else
+    (void)pPath;
+    return false;
+#endif
+}
+
+uint64_t loadBenchmarkBeginRun()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.WorkingSetSize;
+#elif defined(__linux__)
+    // "5" resets VmHWM to the current resident set
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file)
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+    return readStatusKb("VmRSS:");
+#else
+    return 0;
+#endif
+}
+
+uint64_t loadBenchmarkGetPeakRss()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+    return readStatusKb("VmHWM:");
+#else
+    return 0;
+#endif
+}
+
+void loadBenchmarkReport(const char* pName, const LoadSample* pSamples, uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    const LoadSample& cold = pSamples[0];
+    LOGF(eINFO, "[LoadBenchmark] %s: %u runs", pName, count);
+    LOGF(eINFO, "[LoadBenchmark] cold geometry ms %.3f, build ms %.3f, peak RSS +%.2f MB", cold.mGeometryMs, cold.mBuildMs,
+         cold.mPeakRssGrowth / (1024.0 * 1024.0));
+
+    const uint32_t warmCount = count - 1;
+    if (warmCount == 0)
+        return;
+
+    float* geometryMs = (float*)tf_malloc(sizeof(float) * warmCount);
+    float* buildMs = (float*)tf_malloc(sizeof(float) * warmCount);
+    float* rssMb = (float*)tf_malloc(sizeof(float) * warmCount);
+    for (uint32_t i = 0; i < warmCount; ++i)
+    {
+        geometryMs[i] = pSamples[i + 1].mGeometryMs;
+        buildMs[i] = pSamples[i + 1].mBuildMs;
+        rssMb[i] = (float)(pSamples[i + 1].mPeakRssGrowth / (1024.0 * 1024.0));
+    }
+
+    const FrameTimeStats geometry = FrameBenchmark::ComputeStats(geometryMs, warmCount);
+    const FrameTimeStats build = FrameBenchmark::ComputeStats(buildMs, warmCount);
+    const FrameTimeStats rss = FrameBenchmark::ComputeStats(rssMb, warmCount);
+    LOGF(eINFO, "[LoadBenchmark] warm geometry ms: min %.3f avg %.3f max %.3f", geometry.mMin, geometry.mAvg, geometry.mMax);
+    LOGF(eINFO, "[LoadBenchmark] warm build ms: min %.3f avg %.3f max %.3f", build.mMin, build.mAvg, build.mMax);
+    LOGF(eINFO, "[LoadBenchmark] warm peak RSS MB: min +%.2f avg +%.2f max +%.2f", rss.mMin, rss.mAvg, rss.mMax);
+
+    tf_free(rssMb);
+    tf_free(buildMs);
+    tf_free(geometryMs);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+
+// Castle load time and memory for --load-benchmark. The first run is cold, its file evicted from the OS page cache
+// where the platform allows it, the others are warm. Memory is the growth of the resident set over a run, pages of
+// mapped files included, so the formats compare on what they really touch.
+
+struct LoadSample
+{
+    // File to GPU buffers, then the bounds, meshlets and LODs CastleScene builds on top
+    float mGeometryMs;
+    float mBuildMs;
+    // Peak resident set during the run over the one it started with, in bytes
+    uint64_t mPeakRssGrowth;
+};
+
+// Drops the cached pages of pPath so the next read goes to the disk. Only Linux can, false elsewhere.
+bool loadBenchmarkEvictFile(const char* pPath);
+
+// Returns the current resident set and restarts the peak from it. On Windows the peak can't be restarted, only
+// the first run of a process measures its own peak there.
+uint64_t loadBenchmarkBeginRun();
+
+// Peak resident set since loadBenchmarkBeginRun, 0 where unknown
+uint64_t loadBenchmarkGetPeakRss();
+
+// Logs the cold run and min/avg/max of the warm ones
+void loadBenchmarkReport(const char* pName, const LoadSample* pSamples, uint32_t count);
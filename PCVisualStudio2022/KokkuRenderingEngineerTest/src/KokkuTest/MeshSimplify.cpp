@@ -0,0 +1,486 @@
+#include "MeshSimplify.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+// Seam vertices with more copies than this at one position are kept in place
+static const uint32_t SIMPLIFY_MAX_SEAM_COPIES = 16;
+
+enum VertexKind
+{
+    VERTEX_INTERIOR,
+    // On exactly two open edges, may only slide along them
+    VERTEX_BORDER,
+    // Non-manifold or a corner where borders meet
+    VERTEX_LOCKED,
+};
+
+// Weighted sum of squared distances to a set of planes. Divided by the weight sum mWeight it is the mean squared
+// distance, which keeps the error in object space units.
+struct Quadric
+{
+    double mA00, mA01, mA02, mA11, mA12, mA22;
+    double mB0, mB1, mB2;
+    double mC;
+    double mWeight;
+};
+
+struct Collapse
+{
+    float    mCost;
+    uint32_t mFrom;
+    uint32_t mTo;
+};
+
+static const float* getPosition(const float* pPositions, uint32_t positionStride, uint32_t index)
+{
+    return (const float*)((const uint8_t*)pPositions + (size_t)index * positionStride);
+}
+
+static void triangleNormal(const float* a, const float* b, const float* c, double* pOutNormal)
+{
+    const double e0[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+    const double e1[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+    pOutNormal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    pOutNormal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    pOutNormal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+static void quadricAddPlane(Quadric* pQuadric, const double* pNormal, double d, double weight)
+{
+    const double* n = pNormal;
+    pQuadric->mA00 += weight * n[0] * n[0];
+    pQuadric->mA01 += weight * n[0] * n[1];
+    pQuadric->mA02 += weight * n[0] * n[2];
+    pQuadric->mA11 += weight * n[1] * n[1];
+    pQuadric->mA12 += weight * n[1] * n[2];
+    pQuadric->mA22 += weight * n[2] * n[2];
+    pQuadric->mB0 += weight * d * n[0];
+    pQuadric->mB1 += weight * d * n[1];
+    pQuadric->mB2 += weight * d * n[2];
+    pQuadric->mC += weight * d * d;
+}
+
+static void quadricAdd(Quadric* pQuadric, const Quadric* pOther)
+{
+    pQuadric->mA00 += pOther->mA00;
+    pQuadric->mA01 += pOther->mA01;
+    pQuadric->mA02 += pOther->mA02;
+    pQuadric->mA11 += pOther->mA11;
+    pQuadric->mA12 += pOther->mA12;
+    pQuadric->mA22 += pOther->mA22;
+    pQuadric->mB0 += pOther->mB0;
+    pQuadric->mB1 += pOther->mB1;
+    pQuadric->mB2 += pOther->mB2;
+    pQuadric->mC += pOther->mC;
+    pQuadric->mWeight += pOther->mWeight;
+}
+
+static double quadricError(const Quadric* pQuadric, const float* p)
+{
+    const Quadric& q = *pQuadric;
+    const double   x = p[0], y = p[1], z = p[2];
+    const double   error = q.mA00 * x * x + q.mA11 * y * y + q.mA22 * z * z + 2.0 * (q.mA01 * x * y + q.mA02 * x * z + q.mA12 * y * z) +
+                         2.0 * (q.mB0 * x + q.mB1 * y + q.mB2 * z) + q.mC;
+    return q.mWeight > 0.0 ? fabs(error) / q.mWeight : 0.0;
+}
+
+// Squared distance error of moving from onto to, over the surfaces and borders of both
+static float collapseCost(const Quadric* pQuadrics, const Quadric* pBorderQuadrics, uint32_t from, uint32_t to, const float* pTarget)
+{
+    Quadric q = pQuadrics[from];
+    quadricAdd(&q, &pQuadrics[to]);
+    Quadric border = pBorderQuadrics[from];
+    quadricAdd(&border, &pBorderQuadrics[to]);
+    return (float)fmax(quadricError(&q, pTarget), quadricError(&border, pTarget));
+}
+
+static int compareCollapse(const void* a, const void* b)
+{
+    const float ca = ((const Collapse*)a)->mCost;
+    const float cb = ((const Collapse*)b)->mCost;
+    return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+static int compareEdge(const void* a, const void* b)
+{
+    const uint64_t ea = *(const uint64_t*)a;
+    const uint64_t eb = *(const uint64_t*)b;
+    return ea < eb ? -1 : (ea > eb ? 1 : 0);
+}
+
+static void addOpenEdges(uint8_t* pCount, uint32_t increment)
+{
+    *pCount = (uint8_t)(*pCount + increment < 3 ? *pCount + increment : 3);
+}
+
+static uint32_t hashPosition(const float* p)
+{
+    uint32_t bits[3];
+    memcpy(bits, p, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+// pOutWeld[v] is the first vertex with v's position
+static void weldPositions(const float* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t* pOutWeld)
+{
+    uint32_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize *= 2;
+
+    uint32_t* table = (uint32_t*)tf_malloc(tableSize * sizeof(uint32_t));
+    memset(table, 0xFF, tableSize * sizeof(uint32_t));
+
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        const float* p = getPosition(pPositions, positionStride, v);
+        uint32_t     slot = hashPosition(p) & (tableSize - 1);
+        while (table[slot] != UINT32_MAX && memcmp(getPosition(pPositions, positionStride, table[slot]), p, sizeof(float) * 3) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == UINT32_MAX)
+            table[slot] = v;
+        pOutWeld[v] = table[slot];
+    }
+
+    tf_free(table);
+}
+
+uint32_t meshSimplify(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, uint32_t positionStride,
+                      uint32_t vertexCount, uint32_t targetIndexCount, float maxError, uint32_t* pOutIndices, float* pOutError)
+{
+    *pOutError = 0.0f;
+    memcpy(pOutIndices, pIndices, indexCount * sizeof(uint32_t));
+    if (indexCount <= targetIndexCount)
+        return indexCount;
+
+    uint32_t* weld = (uint32_t*)tf_malloc(vertexCount * sizeof(uint32_t));
+    weldPositions(pPositions, positionStride, vertexCount, weld);
+
+    // Quadrics live on the welded vertices and carry the planes of the original surface through every collapse,
+    // each triangle weighted by its area
+    Quadric* quadrics = (Quadric*)tf_calloc(vertexCount, sizeof(Quadric));
+    for (uint32_t t = 0; t < indexCount / 3; ++t)
+    {
+        const float* a = getPosition(pPositions, positionStride, pIndices[t * 3 + 0]);
+        const float* b = getPosition(pPositions, positionStride, pIndices[t * 3 + 1]);
+        const float* c = getPosition(pPositions, positionStride, pIndices[t * 3 + 2]);
+        double       n[3];
+        triangleNormal(a, b, c, n);
+        const double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len == 0.0)
+            continue;
+
+        n[0] /= len;
+        n[1] /= len;
+        n[2] /= len;
+        const double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+        for (int k = 0; k < 3; ++k)
+        {
+            Quadric* q = &quadrics[weld[pIndices[t * 3 + k]]];
+            quadricAddPlane(q, n, d, len * 0.5);
+            q->mWeight += len * 0.5;
+        }
+    }
+
+    uint32_t* adjacencyOffsets = (uint32_t*)tf_malloc((vertexCount + 1) * sizeof(uint32_t));
+    uint32_t* adjacency = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+    uint64_t* edges = (uint64_t*)tf_malloc(indexCount * sizeof(uint64_t));
+    Collapse* collapses = (Collapse*)tf_malloc(indexCount * 2 * sizeof(Collapse));
+    uint8_t*  kinds = (uint8_t*)tf_malloc(vertexCount);
+    uint8_t*  openEdges = (uint8_t*)tf_malloc(vertexCount);
+    uint8_t*  touched = (uint8_t*)tf_malloc(vertexCount);
+    uint32_t* remap = (uint32_t*)tf_malloc(vertexCount * sizeof(uint32_t));
+
+    // Open edges get a plane through them, perpendicular to their triangle, so borders keep their shape.
+    // Kept apart from the surface quadrics, both errors are distances and the larger one counts.
+    Quadric* borderQuadrics = (Quadric*)tf_calloc(vertexCount, sizeof(Quadric));
+    for (uint32_t t = 0; t < indexCount / 3; ++t)
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint64_t a = weld[pIndices[t * 3 + k]];
+            const uint64_t b = weld[pIndices[t * 3 + (k + 1) % 3]];
+            edges[t * 3 + k] = a < b ? (a << 32) | b : (b << 32) | a;
+        }
+    qsort(edges, indexCount, sizeof(uint64_t), compareEdge);
+    for (uint32_t t = 0; t < indexCount / 3; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t a = weld[pIndices[t * 3 + k]];
+            const uint32_t b = weld[pIndices[t * 3 + (k + 1) % 3]];
+            const uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+            const uint64_t* found = (const uint64_t*)bsearch(&key, edges, indexCount, sizeof(uint64_t), compareEdge);
+            if ((found > edges && found[-1] == key) || (found + 1 < edges + indexCount && found[1] == key))
+                continue;
+
+            const float* pa = getPosition(pPositions, positionStride, a);
+            const float* pb = getPosition(pPositions, positionStride, b);
+            double       n[3];
+            triangleNormal(getPosition(pPositions, positionStride, pIndices[t * 3 + 0]),
+                           getPosition(pPositions, positionStride, pIndices[t * 3 + 1]),
+                           getPosition(pPositions, positionStride, pIndices[t * 3 + 2]), n);
+            const double e[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+            double       m[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+            const double len = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+            if (len == 0.0)
+                continue;
+
+            m[0] /= len;
+            m[1] /= len;
+            m[2] /= len;
+            const double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+            const double weight = sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+            const uint32_t ends[2] = { a, b };
+            for (uint32_t v = 0; v < 2; ++v)
+            {
+                quadricAddPlane(&borderQuadrics[ends[v]], m, d, weight);
+                borderQuadrics[ends[v]].mWeight += weight;
+            }
+        }
+    }
+
+    double   maxCost = 0.0;
+    bool     crossSeams = false;
+    uint32_t passWidening = 0;
+    uint32_t currentCount = indexCount;
+    // Passes of non-overlapping collapses, the topology is rebuilt between them
+    while (currentCount > targetIndexCount)
+    {
+        const uint32_t triangleCount = currentCount / 3;
+        uint32_t*      indices = pOutIndices;
+
+        // Triangles around every welded vertex
+        memset(adjacencyOffsets, 0, (vertexCount + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < currentCount; ++i)
+            ++adjacencyOffsets[weld[indices[i]] + 1];
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        for (uint32_t i = 0; i < currentCount; ++i)
+            adjacency[adjacencyOffsets[weld[indices[i]]]++] = i / 3;
+        for (uint32_t v = vertexCount; v > 0; --v)
+            adjacencyOffsets[v] = adjacencyOffsets[v - 1];
+        adjacencyOffsets[0] = 0;
+
+        // Vertices on open edges become borders, non-manifold edges and border corners lock them
+        for (uint32_t t = 0; t < triangleCount; ++t)
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint64_t a = weld[indices[t * 3 + k]];
+                const uint64_t b = weld[indices[t * 3 + (k + 1) % 3]];
+                edges[t * 3 + k] = a < b ? (a << 32) | b : (b << 32) | a;
+            }
+        qsort(edges, currentCount, sizeof(uint64_t), compareEdge);
+        // Open edge count of each vertex, saturated at 3
+        memset(openEdges, 0, vertexCount);
+        for (uint32_t i = 0; i < currentCount;)
+        {
+            uint32_t run = 1;
+            while (i + run < currentCount && edges[i + run] == edges[i])
+                ++run;
+            if (run != 2)
+            {
+                // A non-manifold edge counts as enough open edges to lock its vertices
+                addOpenEdges(&openEdges[edges[i] >> 32], run == 1 ? 1 : 3);
+                addOpenEdges(&openEdges[edges[i] & 0xFFFFFFFF], run == 1 ? 1 : 3);
+            }
+            i += run;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            kinds[v] = openEdges[v] == 0 ? VERTEX_INTERIOR : (openEdges[v] == 2 ? VERTEX_BORDER : VERTEX_LOCKED);
+
+        // Interior vertices collapse along any edge, border vertices only along their open edges
+        uint32_t collapseCount = 0;
+        for (uint32_t i = 0; i < currentCount;)
+        {
+            uint32_t run = 1;
+            while (i + run < currentCount && edges[i + run] == edges[i])
+                ++run;
+
+            const uint32_t a = (uint32_t)(edges[i] >> 32);
+            const uint32_t b = (uint32_t)(edges[i] & 0xFFFFFFFF);
+            const uint32_t pair[2][2] = { { a, b }, { b, a } };
+            for (int d = 0; d < 2; ++d)
+            {
+                const uint32_t from = pair[d][0];
+                const uint32_t to = pair[d][1];
+                if (kinds[from] != (run == 1 ? VERTEX_BORDER : VERTEX_INTERIOR) || run > 2)
+                    continue;
+
+                const float cost = collapseCost(quadrics, borderQuadrics, from, to, getPosition(pPositions, positionStride, to));
+                collapses[collapseCount++] = { cost, from, to };
+            }
+            i += run;
+        }
+        qsort(collapses, collapseCount, sizeof(Collapse), compareCollapse);
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            remap[v] = v;
+        memset(touched, 0, vertexCount);
+
+        // A pass only goes as far as the cheapest collapses that would reach the target on their own (about two
+        // triangles each), later ones wait for the next pass instead of filling in for blocked cheap ones.
+        // Widened when all of those were blocked.
+        const uint64_t goal = ((uint64_t)(currentCount - targetIndexCount) / 6 + 1) << passWidening;
+        const bool     lastCandidates = goal >= collapseCount;
+        const float    passLimit = collapseCount > 0 ? collapses[lastCandidates ? collapseCount - 1 : goal].mCost : 0.0f;
+
+        uint32_t removedIndices = 0;
+        uint32_t applied = 0;
+        for (uint32_t c = 0; c < collapseCount && currentCount - removedIndices > targetIndexCount; ++c)
+        {
+            const Collapse& collapse = collapses[c];
+            if (collapse.mCost > passLimit || sqrtf(collapse.mCost) > maxError)
+                break;
+            if (touched[collapse.mFrom] || touched[collapse.mTo])
+                continue;
+
+            // Each copy of the moving vertex goes to the copy of the target it shares a triangle with,
+            // a copy without one would pull its seam across the surface until crossSeams allows it
+            uint32_t seamFrom[SIMPLIFY_MAX_SEAM_COPIES];
+            uint32_t seamTo[SIMPLIFY_MAX_SEAM_COPIES];
+            uint32_t seamCount = 0;
+            uint32_t removedTriangles = 0;
+            bool     valid = true;
+            for (uint32_t j = adjacencyOffsets[collapse.mFrom]; j < adjacencyOffsets[collapse.mFrom + 1] && valid; ++j)
+            {
+                const uint32_t* tri = indices + adjacency[j] * 3;
+                uint32_t        fromCorner = 3;
+                uint32_t        toCorner = 3;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    if (weld[tri[k]] == collapse.mFrom)
+                        fromCorner = k;
+                    else if (weld[tri[k]] == collapse.mTo)
+                        toCorner = k;
+                }
+                if (toCorner == 3)
+                    continue;
+
+                ++removedTriangles;
+                uint32_t s = 0;
+                while (s < seamCount && seamFrom[s] != tri[fromCorner])
+                    ++s;
+                if (s == seamCount)
+                {
+                    if (seamCount == SIMPLIFY_MAX_SEAM_COPIES)
+                        valid = false;
+                    else
+                    {
+                        seamFrom[seamCount] = tri[fromCorner];
+                        seamTo[seamCount++] = tri[toCorner];
+                    }
+                }
+            }
+
+            // The triangles that stay must keep their facing
+            const float* target = getPosition(pPositions, positionStride, collapse.mTo);
+            for (uint32_t j = adjacencyOffsets[collapse.mFrom]; j < adjacencyOffsets[collapse.mFrom + 1] && valid; ++j)
+            {
+                const uint32_t* tri = indices + adjacency[j] * 3;
+                uint32_t        fromCorner = 3;
+                bool            hasTo = false;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    if (weld[tri[k]] == collapse.mFrom)
+                        fromCorner = k;
+                    else if (weld[tri[k]] == collapse.mTo)
+                        hasTo = true;
+                }
+                if (hasTo)
+                    continue;
+
+                uint32_t s = 0;
+                while (s < seamCount && seamFrom[s] != tri[fromCorner])
+                    ++s;
+                if (s == seamCount)
+                {
+                    // Stretches the attributes on this side of the seam, the surface stays closed
+                    if (!crossSeams || seamCount == 0 || seamCount == SIMPLIFY_MAX_SEAM_COPIES)
+                    {
+                        valid = false;
+                        break;
+                    }
+                    seamFrom[seamCount] = tri[fromCorner];
+                    seamTo[seamCount++] = seamTo[0];
+                }
+
+                const float* corners[3] = { getPosition(pPositions, positionStride, tri[0]), getPosition(pPositions, positionStride, tri[1]),
+                                            getPosition(pPositions, positionStride, tri[2]) };
+                double       before[3];
+                triangleNormal(corners[0], corners[1], corners[2], before);
+                corners[fromCorner] = target;
+                double after[3];
+                triangleNormal(corners[0], corners[1], corners[2], after);
+                valid = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] > 0.0;
+            }
+
+            if (!valid || removedTriangles == 0)
+                continue;
+
+            for (uint32_t s = 0; s < seamCount; ++s)
+                remap[seamFrom[s]] = seamTo[s];
+            quadricAdd(&quadrics[collapse.mTo], &quadrics[collapse.mFrom]);
+            quadricAdd(&borderQuadrics[collapse.mTo], &borderQuadrics[collapse.mFrom]);
+
+            // The one-ring of the moved vertex changes shape, leave it to the next pass
+            for (uint32_t j = adjacencyOffsets[collapse.mFrom]; j < adjacencyOffsets[collapse.mFrom + 1]; ++j)
+                for (uint32_t k = 0; k < 3; ++k)
+                    touched[weld[indices[adjacency[j] * 3 + k]]] = 1;
+
+            maxCost = fmax(maxCost, (double)collapse.mCost);
+            removedIndices += removedTriangles * 3;
+            ++applied;
+        }
+
+        // Seams hold most of a heavily split mesh in place, they may be crossed before costlier collapses are taken
+        if (applied == 0 && !crossSeams)
+        {
+            crossSeams = true;
+            continue;
+        }
+        if (applied == 0 && !lastCandidates)
+        {
+            ++passWidening;
+            continue;
+        }
+        if (applied == 0)
+            break;
+        passWidening = 0;
+
+        // Apply the pass, dropping the triangles that lost an edge
+        uint32_t writeCount = 0;
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t a = remap[indices[t * 3 + 0]];
+            const uint32_t b = remap[indices[t * 3 + 1]];
+            const uint32_t c = remap[indices[t * 3 + 2]];
+            if (weld[a] == weld[b] || weld[b] == weld[c] || weld[a] == weld[c])
+                continue;
+
+            indices[writeCount++] = a;
+            indices[writeCount++] = b;
+            indices[writeCount++] = c;
+        }
+        currentCount = writeCount;
+    }
+
+    tf_free(remap);
+    tf_free(touched);
+    tf_free(openEdges);
+    tf_free(kinds);
+    tf_free(collapses);
+    tf_free(edges);
+    tf_free(adjacency);
+    tf_free(adjacencyOffsets);
+    tf_free(borderQuadrics);
+    tf_free(quadrics);
+    tf_free(weld);
+
+    *pOutError = (float)sqrt(maxCost);
+    return currentCount;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// Quadric error edge collapse simplification for the castle LOD chain. Vertices are only moved onto existing
+// vertices, so every LOD indexes the same vertex buffer. Vertices at the same position (UV and normal seams)
+// collapse together, along the seam while that still makes progress. Open borders only slide along themselves
+// and the corners where they meet stay in place.
+
+// pIndices are triangle list indices into pPositions (float3, positionStride bytes apart, vertexCount vertices).
+// Collapses the cheapest edges until at most targetIndexCount indices are left or no collapse stays under
+// maxError. Writes the result to pOutIndices (indexCount entries are enough) and returns its index count.
+// pOutError receives the largest error of the applied collapses, an object space distance.
+uint32_t meshSimplify(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, uint32_t positionStride,
+                      uint32_t vertexCount, uint32_t targetIndexCount, float maxError, uint32_t* pOutIndices, float* pOutError);
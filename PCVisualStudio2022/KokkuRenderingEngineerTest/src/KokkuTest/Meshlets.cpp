@@ -0,0 +1,177 @@
+#include "Meshlets.h"
+
+#include <float.h>
+#include <math.h>
+
+static const float* getPosition(const float* pPositions, uint32_t positionStride, uint32_t index)
+{
+    return (const float*)((const uint8_t*)pPositions + (size_t)index * positionStride);
+}
+
+static float dot3(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static void computeMeshletBounds(const uint32_t* pIndices, const float* pPositions, uint32_t positionStride, Meshlet* pMeshlet)
+{
+    const uint32_t* indices = pIndices + pMeshlet->mFirstIndex;
+    const uint32_t  indexCount = pMeshlet->mTriangleCount * 3;
+
+    // Sphere around the AABB center, good enough for meshlet sized clusters
+    BoundingBox box;
+    boundingBoxReset(&box);
+    for (uint32_t i = 0; i < indexCount; ++i)
+        boundingBoxExpand(&box, getPosition(pPositions, positionStride, indices[i]));
+
+    float radiusSq = 0.0f;
+    for (int c = 0; c < 3; ++c)
+        pMeshlet->mCenter[c] = (box.mMin[c] + box.mMax[c]) * 0.5f;
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        const float* p = getPosition(pPositions, positionStride, indices[i]);
+        const float  d[3] = { p[0] - pMeshlet->mCenter[0], p[1] - pMeshlet->mCenter[1], p[2] - pMeshlet->mCenter[2] };
+        radiusSq = fmaxf(radiusSq, dot3(d, d));
+    }
+    pMeshlet->mRadius = sqrtf(radiusSq);
+
+    // Normal cone from the face normals (counter-clockwise winding)
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t t = 0; t < pMeshlet->mTriangleCount; ++t)
+    {
+        const float* a = getPosition(pPositions, positionStride, indices[t * 3 + 0]);
+        const float* b = getPosition(pPositions, positionStride, indices[t * 3 + 1]);
+        const float* c = getPosition(pPositions, positionStride, indices[t * 3 + 2]);
+        const float  e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float  e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        const float  n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+        const float  len = sqrtf(dot3(n, n));
+        if (len > 0.0f)
+        {
+            for (int k = 0; k < 3; ++k)
+                axis[k] += n[k] / len;
+        }
+    }
+
+    const float axisLen = sqrtf(dot3(axis, axis));
+    float       minDot = 1.0f;
+    if (axisLen > 0.0f)
+    {
+        for (int k = 0; k < 3; ++k)
+            axis[k] /= axisLen;
+
+        for (uint32_t t = 0; t < pMeshlet->mTriangleCount; ++t)
+        {
+            const float* a = getPosition(pPositions, positionStride, indices[t * 3 + 0]);
+            const float* b = getPosition(pPositions, positionStride, indices[t * 3 + 1]);
+            const float* c = getPosition(pPositions, positionStride, indices[t * 3 + 2]);
+            const float  e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float  e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            const float  n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            const float  len = sqrtf(dot3(n, n));
+            if (len > 0.0f)
+                minDot = fminf(minDot, dot3(axis, n) / len);
+        }
+    }
+
+    // Cones wider than ~84 degrees can't be culled from anywhere useful
+    if (axisLen <= 0.0f || minDot <= 0.1f)
+    {
+        pMeshlet->mConeAxis[0] = pMeshlet->mConeAxis[1] = pMeshlet->mConeAxis[2] = 0.0f;
+        pMeshlet->mConeCutoff = 1.0f;
+        return;
+    }
+
+    // The backface region is the normal cone widened by 90 degrees and flipped: sin(angle) = sqrt(1 - cos^2)
+    for (int k = 0; k < 3; ++k)
+        pMeshlet->mConeAxis[k] = axis[k];
+    pMeshlet->mConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+uint32_t meshletBuildBound(uint32_t triangleCount)
+{
+    const uint32_t minTriangles = MESHLET_MAX_VERTICES / 3;
+    return (triangleCount + minTriangles - 1) / minTriangles + 1;
+}
+
+uint32_t meshletBuild(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, uint32_t positionStride,
+                      uint32_t drawIndex, uint32_t firstIndex, Meshlet* pOutMeshlets)
+{
+    uint32_t meshletCount = 0;
+    uint32_t vertices[MESHLET_MAX_VERTICES];
+    Meshlet* current = NULL;
+
+    for (uint32_t t = 0; t < indexCount / 3; ++t)
+    {
+        const uint32_t* tri = pIndices + t * 3;
+
+        uint32_t newVertices = 0;
+        if (current)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                bool found = false;
+                for (uint32_t v = 0; v < current->mVertexCount && !found; ++v)
+                    found = vertices[v] == tri[k];
+                // Repeated vertices inside a degenerate triangle are counted twice, which is only conservative
+                newVertices += found ? 0 : 1;
+            }
+        }
+
+        if (!current || current->mVertexCount + newVertices > MESHLET_MAX_VERTICES || current->mTriangleCount == MESHLET_MAX_TRIANGLES)
+        {
+            current = &pOutMeshlets[meshletCount++];
+            *current = {};
+            current->mFirstIndex = firstIndex + t * 3;
+            current->mDrawIndex = drawIndex;
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            bool found = false;
+            for (uint32_t v = 0; v < current->mVertexCount && !found; ++v)
+                found = vertices[v] == tri[k];
+            if (!found)
+                vertices[current->mVertexCount++] = tri[k];
+        }
+        ++current->mTriangleCount;
+    }
+
+    // Bounds read the indices relative to pIndices
+    for (uint32_t m = 0; m < meshletCount; ++m)
+    {
+        Meshlet& meshlet = pOutMeshlets[m];
+        meshlet.mFirstIndex -= firstIndex;
+        computeMeshletBounds(pIndices, pPositions, positionStride, &meshlet);
+        meshlet.mFirstIndex += firstIndex;
+    }
+
+    return meshletCount;
+}
+
+bool meshletIsVisible(const Meshlet* pMeshlet, const Frustum* pFrustum, const float* pCameraPosition, bool coneCulling)
+{
+    if (!frustumIntersectsSphere(pFrustum, pMeshlet->mCenter, pMeshlet->mRadius))
+        return false;
+
+    if (coneCulling)
+    {
+        // Every triangle faces away from any point of the bounding sphere as seen from the camera
+        const float toCenter[3] = { pMeshlet->mCenter[0] - pCameraPosition[0], pMeshlet->mCenter[1] - pCameraPosition[1],
+                                    pMeshlet->mCenter[2] - pCameraPosition[2] };
+        const float distance = sqrtf(dot3(toCenter, toCenter));
+        if (dot3(toCenter, pMeshlet->mConeAxis) >= pMeshlet->mConeCutoff * distance + pMeshlet->mRadius)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t meshletCull(const Meshlet* pMeshlets, uint32_t meshletCount, const Frustum* pFrustum, const float* pCameraPosition,
+                     bool coneCulling, uint32_t* pOutVisible)
+{
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < meshletCount; ++i)
+    {
+        if (meshletIsVisible(&pMeshlets[i], pFrustum, pCameraPosition, coneCulling))
+            pOutVisible[visibleCount++] = i;
+    }
+    return visibleCount;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+#include "Culling.h"
+
+// Meshlet build and the CPU reference of the meshlet cull pass (meshletCull.comp).
+// Like Culling.h this has no renderer types, so the results can be checked without a GPU.
+
+static const uint32_t MESHLET_MAX_VERTICES = 64;
+static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Same layout as the Meshlet struct in meshletCull.comp.fsl (48 bytes)
+struct Meshlet
+{
+    // Triangles of a meshlet are contiguous in the meshlet index buffer
+    uint32_t mFirstIndex;
+    uint32_t mTriangleCount;
+    // Castle draw (and material) the meshlet belongs to
+    uint32_t mDrawIndex;
+    uint32_t mVertexCount;
+
+    float mCenter[3];
+    float mRadius;
+
+    // Normal cone, see meshletIsVisible() for how the cutoff is used.
+    // Meshlets with a too wide cone get a zero axis and a cutoff of 1 so they are never cone culled.
+    float mConeAxis[3];
+    float mConeCutoff;
+};
+
+// Upper bound of the meshlets meshletBuild() can produce for a triangle count.
+// A triangle adds at most 3 vertices, so every meshlet but the last one holds at least MESHLET_MAX_VERTICES / 3 triangles.
+uint32_t meshletBuildBound(uint32_t triangleCount);
+
+// Greedily splits one draw into meshlets, keeping the triangle order.
+// pIndices are the draw's triangle list indices, already rebased to pPositions (float3, positionStride bytes apart).
+// firstIndex is where pIndices start in the meshlet index buffer. Returns the number of meshlets written.
+uint32_t meshletBuild(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, uint32_t positionStride,
+                      uint32_t drawIndex, uint32_t firstIndex, Meshlet* pOutMeshlets);
+
+// Frustum test of the bounding sphere plus, when coneCulling is set, the backface cone test.
+// pCameraPosition is in the same (object) space as the meshlets and the frustum.
+bool meshletIsVisible(const Meshlet* pMeshlet, const Frustum* pFrustum, const float* pCameraPosition, bool coneCulling);
+
+// Writes the indices of the visible meshlets to pOutVisible and returns how many there are
+uint32_t meshletCull(const Meshlet* pMeshlets, uint32_t meshletCount, const Frustum* pFrustum, const float* pCameraPosition,
+                     bool coneCulling, uint32_t* pOutVisible);
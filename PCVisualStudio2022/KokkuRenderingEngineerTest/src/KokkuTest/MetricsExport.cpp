@@ -0,0 +1,126 @@
+#include "MetricsExport.h"
+
+#include <string.h>
+
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+void MetricsExport::Init(uint32_t maxFrames)
+{
+    mMaxFrames = maxFrames;
+    mFrameCount = 0;
+    mCompleteCount = 0;
+    pValues = maxFrames > 0 ? (double*)tf_calloc((size_t)maxFrames * METRICS_COLUMN_COUNT, sizeof(double)) : NULL;
+    pComplete = maxFrames > 0 ? (uint8_t*)tf_calloc(maxFrames, sizeof(uint8_t)) : NULL;
+}
+
+void MetricsExport::Exit()
+{
+    tf_free(pValues);
+    tf_free(pComplete);
+    pValues = NULL;
+    pComplete = NULL;
+    mMaxFrames = 0;
+}
+
+uint32_t MetricsExport::BeginFrame()
+{
+    if (!pValues || mFrameCount == mMaxFrames)
+        return INVALID_FRAME;
+    return mFrameCount++;
+}
+
+void MetricsExport::Set(uint32_t frame, MetricsColumn column, double value)
+{
+    if (frame < mFrameCount)
+        pValues[(size_t)frame * METRICS_COLUMN_COUNT + column] = value;
+}
+
+void MetricsExport::Complete(uint32_t frame)
+{
+    if (frame < mFrameCount && !pComplete[frame])
+    {
+        pComplete[frame] = 1;
+        ++mCompleteCount;
+    }
+}
+
+bool MetricsExport::Write(ResourceDirectory dir, const char* pFileName) const
+{
+    FileStream stream = {};
+    if (!fsOpenStreamFromPath(dir, pFileName, FM_WRITE, &stream))
+    {
+        LOGF(eWARNING, "Can't write the metrics %s", pFileName);
+        return false;
+    }
+
+    const size_t nameLength = strlen(pFileName);
+    const bool json = nameLength >= 5 && strcmp(pFileName + nameLength - 5, ".json") == 0;
+
+    fsPrintToStream(&stream, json ? "{\"columns\":[\"frame\"" : "frame");
+    for (uint32_t c = 0; c < METRICS_COLUMN_COUNT; ++c)
+        fsPrintToStream(&stream, json ? ",\"%s\"" : ",%s", GetColumnName((MetricsColumn)c));
+    fsPrintToStream(&stream, json ? "],\n\"frames\":[" : "\n");
+
+    // The frame column keeps the numbers of the rows written, so the gaps of dropped frames show
+    uint32_t written = 0;
+    for (uint32_t f = 0; f < mFrameCount; ++f)
+    {
+        if (!pComplete[f])
+            continue;
+        const double* row = pValues + (size_t)f * METRICS_COLUMN_COUNT;
+        fsPrintToStream(&stream, json ? "%s\n[%u" : "%s%u", json && written++ > 0 ? "," : "", f);
+        // %.9g keeps the counters exact and the times to well below a nanosecond
+        for (uint32_t c = 0; c < METRICS_COLUMN_COUNT; ++c)
+            fsPrintToStream(&stream, ",%.9g", row[c]);
+        fsPrintToStream(&stream, json ? "]" : "\n");
+    }
+    if (json)
+        fsPrintToStream(&stream, "\n]}\n");
+    fsCloseStream(&stream);
+
+    LOGF(eINFO, "Metrics: %u frames written to %s, %u incomplete left out", mCompleteCount, pFileName, mFrameCount - mCompleteCount);
+    return true;
+}
+
+const char* MetricsExport::GetColumnName(MetricsColumn column)
+{
+    switch (column)
+    {
+    case METRICS_CPU_UPDATE_MS:
+        return "cpu_update_ms";
+    case METRICS_CPU_DRAW_MS:
+        return "cpu_draw_ms";
+    case METRICS_FENCE_WAIT_MS:
+        return "fence_wait_ms";
+    case METRICS_ACQUIRE_MS:
+        return "acquire_ms";
+    case METRICS_SUBMIT_MS:
+        return "submit_ms";
+    case METRICS_GPU_FRAME_MS:
+        return "gpu_frame_ms";
+    case METRICS_GPU_CASTLE_MS:
+        return "gpu_castle_ms";
+    case METRICS_GPU_SKYBOX_MS:
+        return "gpu_skybox_ms";
+    case METRICS_GPU_UI_MS:
+        return "gpu_ui_ms";
+    case METRICS_CASTLE_VS_INVOCATIONS:
+        return "castle_vs_invocations";
+    case METRICS_CASTLE_PS_INVOCATIONS:
+        return "castle_ps_invocations";
+    case METRICS_CASTLE_IA_PRIMITIVES:
+        return "castle_ia_primitives";
+    case METRICS_CASTLE_CLIPPER_PRIMITIVES:
+        return "castle_clipper_primitives";
+    case METRICS_SKYBOX_PS_INVOCATIONS:
+        return "skybox_ps_invocations";
+    case METRICS_UI_VS_INVOCATIONS:
+        return "ui_vs_invocations";
+    case METRICS_UI_PS_INVOCATIONS:
+        return "ui_ps_invocations";
+    default:
+        return "unknown";
+    }
+}
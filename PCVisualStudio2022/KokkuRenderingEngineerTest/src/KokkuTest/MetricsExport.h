@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Utilities/Interfaces/IFileSystem.h>
+
+// Per-frame metrics kept in memory and written as CSV or JSON (by the file extension) for KokkuMetricsCompare.
+// The GPU columns of a frame arrive mFramesInFlight frames later, once its fence passed, so a frame only counts
+// as complete after Complete(). Write() leaves out every other one: those still in flight and those whose queries
+// were dropped when the frame resources were rebuilt under them.
+
+enum MetricsColumn
+{
+    // CPU time of Update()
+    METRICS_CPU_UPDATE_MS,
+    // CPU time of Draw(), fence wait, acquire and submit included
+    METRICS_CPU_DRAW_MS,
+    METRICS_FENCE_WAIT_MS,
+    METRICS_ACQUIRE_MS,
+    METRICS_SUBMIT_MS,
+    // GPU timestamps around the whole command buffer and the three main passes. The castle one also covers the
+    // depth prepass or the visibility buffer pass and its resolve.
+    METRICS_GPU_FRAME_MS,
+    METRICS_GPU_CASTLE_MS,
+    METRICS_GPU_SKYBOX_MS,
+    METRICS_GPU_UI_MS,
+    // Pipeline statistics, zero when the GPU has no pipeline statistics queries
+    METRICS_CASTLE_VS_INVOCATIONS,
+    METRICS_CASTLE_PS_INVOCATIONS,
+    METRICS_CASTLE_IA_PRIMITIVES,
+    METRICS_CASTLE_CLIPPER_PRIMITIVES,
+    METRICS_SKYBOX_PS_INVOCATIONS,
+    METRICS_UI_VS_INVOCATIONS,
+    METRICS_UI_PS_INVOCATIONS,
+    METRICS_COLUMN_COUNT
+};
+
+class MetricsExport
+{
+public:
+    static const uint32_t INVALID_FRAME = ~0u;
+
+private:
+    // mMaxFrames rows of METRICS_COLUMN_COUNT values
+    double* pValues = NULL;
+    // Non-zero for the rows Complete() was called on
+    uint8_t* pComplete = NULL;
+    uint32_t mMaxFrames = 0;
+    uint32_t mFrameCount = 0;
+    uint32_t mCompleteCount = 0;
+
+public:
+    void Init(uint32_t maxFrames);
+    void Exit();
+
+    bool IsActive() const { return pValues != NULL; }
+
+    // Starts a zeroed row, INVALID_FRAME once maxFrames rows were recorded
+    uint32_t BeginFrame();
+    // Both ignore INVALID_FRAME
+    void Set(uint32_t frame, MetricsColumn column, double value);
+    void Complete(uint32_t frame);
+
+    uint32_t GetCompleteCount() const { return mCompleteCount; }
+
+    // ".json" writes { "columns": [...], "frames": [[...], ...] }, anything else a CSV with a header row
+    bool Write(ResourceDirectory dir, const char* pFileName) const;
+
+    // snake_case, the header of the CSV
+    static const char* GetColumnName(MetricsColumn column);
+};
@@ -0,0 +1,152 @@
+#include "PipelineCacheStore.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x4350504B; // "KPPC"
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
+static const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+
+struct PipelineCacheFileHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mGpuKey;
+    uint64_t mShaderKey;
+    uint64_t mDataSize;
+    uint64_t mDataHash;
+};
+
+uint64_t PipelineCacheStore::Hash(const void* pData, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = (const uint8_t*)pData;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Reads the whole file into a tf_malloc'd block, NULL when it is missing or empty
+static void* readFile(ResourceDirectory dir, const char* pFileName, size_t* pSize)
+{
+    FileStream stream = {};
+    if (!fsOpenStreamFromPath(dir, pFileName, FM_READ, &stream))
+        return NULL;
+
+    const ssize_t size = fsGetStreamFileSize(&stream);
+    void* data = size > 0 ? tf_malloc((size_t)size) : NULL;
+    *pSize = data ? fsReadFromStream(&stream, data, (size_t)size) : 0;
+    fsCloseStream(&stream);
+    return data;
+}
+
+void PipelineCacheStore::Init(Renderer* pRenderer, const char* const* pShaderFileNames, uint32_t shaderCount)
+{
+    // Same device, driver and API, or the blob is worthless
+    const GPUVendorPreset& gpu = pRenderer->pGpu->mSettings.mGpuVendorPreset;
+    mGpuKey = Hash(&gpu.mVendorId, sizeof(gpu.mVendorId), FNV_OFFSET_BASIS);
+    mGpuKey = Hash(&gpu.mModelId, sizeof(gpu.mModelId), mGpuKey);
+    mGpuKey = Hash(&gpu.mRevisionId, sizeof(gpu.mRevisionId), mGpuKey);
+    mGpuKey = Hash(gpu.mGpuName, strlen(gpu.mGpuName), mGpuKey);
+    mGpuKey = Hash(gpu.mGpuDriverVersion, strlen(gpu.mGpuDriverVersion), mGpuKey);
+    mGpuKey = Hash(pRenderer->pName, strlen(pRenderer->pName), mGpuKey);
+
+    // A binary that can't be read (packed or compiled at runtime) still counts with its name
+    mShaderKey = FNV_OFFSET_BASIS;
+    uint32_t missingShaders = 0;
+    for (uint32_t i = 0; i < shaderCount; ++i)
+    {
+        mShaderKey = Hash(pShaderFileNames[i], strlen(pShaderFileNames[i]), mShaderKey);
+        size_t size = 0;
+        void* binary = readFile(RD_SHADER_BINARIES, pShaderFileNames[i], &size);
+        if (binary)
+            mShaderKey = Hash(binary, size, mShaderKey);
+        else
+            ++missingShaders;
+        tf_free(binary);
+    }
+    if (missingShaders > 0)
+        LOGF(eWARNING, "Pipeline cache: %u of %u shader binaries unreadable, rebuilt shaders won't reset the cache", missingShaders,
+             shaderCount);
+
+    snprintf(mFileName, sizeof(mFileName), "KokkuTest_%016llx.cache", (unsigned long long)mGpuKey);
+
+    size_t fileSize = 0;
+    void* file = readFile(RD_PIPELINE_CACHE, mFileName, &fileSize);
+    const PipelineCacheFileHeader* header = (const PipelineCacheFileHeader*)file;
+    const uint8_t* blob = (const uint8_t*)file + sizeof(PipelineCacheFileHeader);
+
+    const char* miss = NULL;
+    if (!file)
+        miss = "no file";
+    else if (fileSize < sizeof(PipelineCacheFileHeader) || header->mMagic != PIPELINE_CACHE_MAGIC || header->mVersion != PIPELINE_CACHE_VERSION)
+        miss = "unknown file version";
+    else if (header->mGpuKey != mGpuKey)
+        miss = "different GPU or driver";
+    else if (header->mShaderKey != mShaderKey)
+        miss = "shaders changed";
+    else if (header->mDataSize != fileSize - sizeof(PipelineCacheFileHeader) || header->mDataHash != Hash(blob, header->mDataSize, FNV_OFFSET_BASIS))
+        miss = "corrupt data";
+
+    mWarm = miss == NULL;
+    PipelineCacheDesc cacheDesc = {};
+    cacheDesc.pData = mWarm ? (void*)blob : NULL;
+    cacheDesc.mSize = mWarm ? (size_t)header->mDataSize : 0;
+#if defined(VULKAN) || defined(DIRECT3D12)
+    addPipelineCache(pRenderer, &cacheDesc, &pCache);
+#endif
+    tf_free(file);
+
+    if (mWarm)
+        LOGF(eINFO, "Pipeline cache %s: warm, %llu bytes", mFileName, (unsigned long long)cacheDesc.mSize);
+    else
+        LOGF(eINFO, "Pipeline cache %s: cold (%s)", mFileName, miss);
+}
+
+void PipelineCacheStore::Exit(Renderer* pRenderer)
+{
+    if (!pCache)
+        return;
+
+    size_t dataSize = 0;
+    getPipelineCacheData(pRenderer, pCache, &dataSize, NULL);
+    uint8_t* file = (uint8_t*)tf_malloc(sizeof(PipelineCacheFileHeader) + dataSize);
+    if (dataSize > 0)
+        getPipelineCacheData(pRenderer, pCache, &dataSize, file + sizeof(PipelineCacheFileHeader));
+
+    PipelineCacheFileHeader header = {};
+    header.mMagic = PIPELINE_CACHE_MAGIC;
+    header.mVersion = PIPELINE_CACHE_VERSION;
+    header.mGpuKey = mGpuKey;
+    header.mShaderKey = mShaderKey;
+    header.mDataSize = dataSize;
+    header.mDataHash = Hash(file + sizeof(PipelineCacheFileHeader), dataSize, FNV_OFFSET_BASIS);
+    memcpy(file, &header, sizeof(header));
+
+    FileStream stream = {};
+    const size_t size = sizeof(PipelineCacheFileHeader) + dataSize;
+    if (fsOpenStreamFromPath(RD_PIPELINE_CACHE, mFileName, FM_WRITE, &stream))
+    {
+        if (fsWriteToStream(&stream, file, size) == size)
+            LOGF(eINFO, "Pipeline cache %s: saved %llu bytes", mFileName, (unsigned long long)dataSize);
+        else
+            LOGF(eWARNING, "Pipeline cache %s: write failed", mFileName);
+        fsCloseStream(&stream);
+    }
+    else
+    {
+        LOGF(eWARNING, "Pipeline cache %s: can't open for writing", mFileName);
+    }
+    tf_free(file);
+
+    removePipelineCache(pRenderer, pCache);
+    pCache = NULL;
+}
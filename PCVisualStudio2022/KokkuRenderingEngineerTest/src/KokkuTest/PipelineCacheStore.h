@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Graphics/Interfaces/IGraphics.h>
+
+// Driver pipeline cache kept on disk between runs (RD_PIPELINE_CACHE). One file per GPU and driver, named after
+// their hash, with a small header in front of the driver blob:
+// - the GPU/driver key, in case a file is copied between machines
+// - a hash of every shader binary the app loads, a rebuilt shader drops the whole cache instead of letting
+//   stale pipelines pile up in it
+// - the size and hash of the blob, so a torn write reads as a miss
+// The driver validates the blob itself as well, a rejected one just behaves like an empty cache.
+
+class PipelineCacheStore
+{
+private:
+    PipelineCache* pCache = NULL;
+    uint64_t mGpuKey = 0;
+    uint64_t mShaderKey = 0;
+    char mFileName[64] = {};
+    // The cache started from a valid file
+    bool mWarm = false;
+
+public:
+    // FNV-1a, also used for the file names
+    static uint64_t Hash(const void* pData, size_t size, uint64_t seed);
+
+    // Creates the cache, from the file when it matches this GPU and these shader binaries (RD_SHADER_BINARIES names)
+    void Init(Renderer* pRenderer, const char* const* pShaderFileNames, uint32_t shaderCount);
+    // Writes the driver's cache data back and destroys the cache
+    void Exit(Renderer* pRenderer);
+
+    // NULL where the API has no pipeline caches, addPipeline takes that too
+    PipelineCache* GetCache() { return pCache; }
+    bool IsWarm() const { return mWarm; }
+};
@@ -0,0 +1,62 @@
+#include "StartupTrace.h"
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/ITime.h>
+
+#include <Utilities/Interfaces/IMemory.h>
+
+void StartupTrace::Init(int64_t originUSec)
+{
+    initMutex(&mMutex);
+    mMainThreadId = getCurrentThreadID();
+    mOriginUSec = originUSec;
+    mEventCount = 0;
+    mActive = true;
+}
+
+void StartupTrace::Exit()
+{
+    exitMutex(&mMutex);
+    mActive = false;
+}
+
+void StartupTrace::Add(const char* pName, int64_t startUSec, int64_t endUSec)
+{
+    acquireMutex(&mMutex);
+    if (mActive && mEventCount < MAX_EVENTS)
+        mEvents[mEventCount++] = { pName, getCurrentThreadID(), startUSec - mOriginUSec, endUSec - startUSec };
+    releaseMutex(&mMutex);
+}
+
+bool StartupTrace::Write(ResourceDirectory dir, const char* pFileName)
+{
+    acquireMutex(&mMutex);
+    mActive = false;
+    releaseMutex(&mMutex);
+
+    FileStream stream = {};
+    if (!fsOpenStreamFromPath(dir, pFileName, FM_WRITE, &stream))
+    {
+        LOGF(eWARNING, "Can't write the startup trace %s", pFileName);
+        return false;
+    }
+
+    fsPrintToStream(&stream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fsPrintToStream(&stream, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,\"args\":{\"name\":\"Main\"}}",
+                    (unsigned long long)mMainThreadId);
+    for (uint32_t i = 0; i < mEventCount; ++i)
+    {
+        const StartupTraceEvent& event = mEvents[i];
+        fsPrintToStream(&stream, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%lld,\"dur\":%lld}", event.pName,
+                        (unsigned long long)event.mThreadId, (long long)event.mStartUSec, (long long)event.mDurationUSec);
+    }
+    fsPrintToStream(&stream, "\n]}\n");
+    fsCloseStream(&stream);
+
+    LOGF(eINFO, "Startup trace: %u events written to %s", mEventCount, pFileName);
+    return true;
+}
+
+StartupTraceScope::StartupTraceScope(StartupTrace* pTrace, const char* pName) : pTrace(pTrace), pName(pName), mStartUSec(getUSec(true)) {}
+
+StartupTraceScope::~StartupTraceScope() { pTrace->Add(pName, mStartUSec, getUSec(true)); }
@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/IThread.h>
+
+// Startup phases written as Chrome trace events (chrome://tracing, ui.perfetto.dev), one row per thread.
+// Add() can be called from any thread until Write(), later events are dropped.
+
+struct StartupTraceEvent
+{
+    const char* pName;
+    ThreadID mThreadId;
+    int64_t mStartUSec;
+    int64_t mDurationUSec;
+};
+
+class StartupTrace
+{
+public:
+    static const uint32_t MAX_EVENTS = 128;
+
+private:
+    StartupTraceEvent mEvents[MAX_EVENTS] = {};
+    uint32_t mEventCount = 0;
+    Mutex mMutex = {};
+    ThreadID mMainThreadId = 0;
+    int64_t mOriginUSec = 0;
+    bool mActive = false;
+
+public:
+    // Timestamps in the file are relative to originUSec, the thread calling Init is named "Main"
+    void Init(int64_t originUSec);
+    void Exit();
+
+    // pName must outlive the trace, usually a string literal
+    void Add(const char* pName, int64_t startUSec, int64_t endUSec);
+
+    // Stops recording, returns false when the file could not be written
+    bool Write(ResourceDirectory dir, const char* pFileName);
+};
+
+// Adds the lifetime of the scope as an event
+struct StartupTraceScope
+{
+    StartupTrace* pTrace;
+    const char* pName;
+    int64_t mStartUSec;
+
+    StartupTraceScope(StartupTrace* pTrace, const char* pName);
+    ~StartupTraceScope();
+};
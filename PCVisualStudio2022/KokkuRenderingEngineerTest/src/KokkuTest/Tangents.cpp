@@ -0,0 +1,104 @@
+#include "Tangents.h"
+
+#include <math.h>
+#include <string.h>
+
+static float dot3(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static void cross3(const float* a, const float* b, float* pOut)
+{
+    pOut[0] = a[1] * b[2] - a[2] * b[1];
+    pOut[1] = a[2] * b[0] - a[0] * b[2];
+    pOut[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// a without its part along the unit vector n, normalized. False when nothing is left. pOut may be a.
+static bool projectOnPlane(const float* a, const float* n, float* pOut)
+{
+    const float along = dot3(a, n);
+    for (int c = 0; c < 3; ++c)
+        pOut[c] = a[c] - n[c] * along;
+    const float lengthSq = dot3(pOut, pOut);
+    if (lengthSq < 1e-24f)
+        return false;
+    const float scale = 1.0f / sqrtf(lengthSq);
+    for (int c = 0; c < 3; ++c)
+        pOut[c] *= scale;
+    return true;
+}
+
+static uint32_t toSnorm8(float value) { return (uint32_t)(uint8_t)(int8_t)lrintf(fminf(fmaxf(value, -1.0f), 1.0f) * 127.0f); }
+
+void tangentsGenerate(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, const float* pNormals, const float* pUVs,
+                      uint32_t vertexCount, float* pOutTangents)
+{
+    // xyz sums the weighted tangents, w the weights signed by the handedness of each triangle's frame
+    memset(pOutTangents, 0, sizeof(float) * 4 * vertexCount);
+
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const uint32_t* triangle = pIndices + i;
+        const float* p[3] = { pPositions + (size_t)triangle[0] * 3, pPositions + (size_t)triangle[1] * 3, pPositions + (size_t)triangle[2] * 3 };
+        const float* uv[3] = { pUVs + (size_t)triangle[0] * 2, pUVs + (size_t)triangle[1] * 2, pUVs + (size_t)triangle[2] * 2 };
+
+        const float edge1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+        const float edge2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+        const float du1 = uv[1][0] - uv[0][0], dv1 = uv[1][1] - uv[0][1];
+        const float du2 = uv[2][0] - uv[0][0], dv2 = uv[2][1] - uv[0][1];
+        const float det = du1 * dv2 - du2 * dv1;
+        // Collapsed in uv, there is no direction to follow
+        if (fabsf(det) < 1e-20f)
+            continue;
+
+        float tangent[3];
+        float bitangent[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            tangent[c] = (edge1[c] * dv2 - edge2[c] * dv1) / det;
+            bitangent[c] = (edge2[c] * du1 - edge1[c] * du2) / det;
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t vertex = triangle[k];
+            const float* n = pNormals + (size_t)vertex * 3;
+            const float* next = p[(k + 1) % 3];
+            const float* prev = p[(k + 2) % 3];
+            const float toNext[3] = { next[0] - p[k][0], next[1] - p[k][1], next[2] - p[k][2] };
+            const float toPrev[3] = { prev[0] - p[k][0], prev[1] - p[k][1], prev[2] - p[k][2] };
+
+            // The corner angle as seen in the plane of the vertex normal
+            float nextDir[3];
+            float prevDir[3];
+            float projected[3];
+            if (!projectOnPlane(toNext, n, nextDir) || !projectOnPlane(toPrev, n, prevDir) || !projectOnPlane(tangent, n, projected))
+                continue;
+            const float angle = acosf(fminf(fmaxf(dot3(nextDir, prevDir), -1.0f), 1.0f));
+
+            float side[3];
+            cross3(n, projected, side);
+            float* out = pOutTangents + (size_t)vertex * 4;
+            for (int c = 0; c < 3; ++c)
+                out[c] += projected[c] * angle;
+            out[3] += dot3(side, bitangent) < 0.0f ? -angle : angle;
+        }
+    }
+
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        const float* n = pNormals + (size_t)v * 3;
+        float* out = pOutTangents + (size_t)v * 4;
+        if (!projectOnPlane(out, n, out))
+        {
+            // Any direction orthogonal to the normal, starting from an axis far from it
+            const float axis[3] = { fabsf(n[0]) < 0.9f ? 1.0f : 0.0f, fabsf(n[0]) < 0.9f ? 0.0f : 1.0f, 0.0f };
+            projectOnPlane(axis, n, out);
+        }
+        out[3] = out[3] < 0.0f ? -1.0f : 1.0f;
+    }
+}
+
+uint32_t tangentEncode(const float* pTangent)
+{
+    return toSnorm8(pTangent[0]) | (toSnorm8(pTangent[1]) << 8) | (toSnorm8(pTangent[2]) << 16) | (toSnorm8(pTangent[3]) << 24);
+}
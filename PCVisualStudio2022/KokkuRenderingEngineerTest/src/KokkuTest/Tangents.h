@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+// Per-vertex tangent frames for the baked castle normal maps, shared by KokkuSceneCooker and the castle.bin path
+// of CastleScene. No renderer types here, the cooker builds this file too.
+//
+// Follows the MikkTSpace conventions, so the normal maps agree with what other tools bake: each triangle's uv
+// derivatives are projected onto the plane of the vertex normal and weighted by the corner angle, the tangent points
+// along +u and w holds the sign of the bitangent, which the shaders rebuild per pixel as w * cross(normal, tangent)
+// from the interpolated, unnormalized vectors. Unlike mikktspace.c no vertex is split where the frames of its
+// triangles disagree (mirrored uvs), such a vertex gets their average and the sign of the larger part.
+
+// pIndices are triangle list indices into the float3 pPositions and pNormals and the float2 pUVs. Writes a float4
+// per vertex to pOutTangents, a unit tangent orthogonal to the normal. Vertices of no triangle with a usable uv
+// mapping get any tangent orthogonal to their normal.
+void tangentsGenerate(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, const float* pNormals, const float* pUVs,
+                      uint32_t vertexCount, float* pOutTangents);
+
+// R8G8B8A8_SNORM, the layout of the castle tangent stream
+uint32_t tangentEncode(const float* pTangent);
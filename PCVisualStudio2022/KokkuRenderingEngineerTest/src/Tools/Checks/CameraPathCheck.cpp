@@ -0,0 +1,205 @@
+// Checks a camera path against the castle triangles: no move between two keys passes through one and every key
+// keeps minDistance from all of them, well clear of the 0.1 near plane. ctest runs it on the shipped paths, so an
+// edited or newly recorded path can't fly the benchmarks through walls unnoticed.
+//
+//   KokkuCameraPathCheck <castle.gltf> <path.kpath> [minDistance]
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../Common/Gltf.h"
+
+// gCastleScale of the app, the object to world scale the paths are recorded in
+static const float CASTLE_SCALE = 100.0f;
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+static Vec3  sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+static Vec3  add(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+static Vec3  mul(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+static float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static Vec3  cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+struct Key
+{
+    float mTime;
+    Vec3  mPosition;
+    int   mLine;
+};
+
+// Moller-Trumbore, true when the segment from p to q crosses the triangle
+static bool segmentHitsTriangle(const Vec3& p, const Vec3& q, const Vec3* pTriangle)
+{
+    const Vec3  dir = sub(q, p);
+    const Vec3  e1 = sub(pTriangle[1], pTriangle[0]);
+    const Vec3  e2 = sub(pTriangle[2], pTriangle[0]);
+    const Vec3  h = cross(dir, e2);
+    const float det = dot(e1, h);
+    if (fabsf(det) < 1e-12f)
+        return false;
+    const float invDet = 1.0f / det;
+    const Vec3  s = sub(p, pTriangle[0]);
+    const float u = dot(s, h) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    const Vec3  c = cross(s, e1);
+    const float v = dot(dir, c) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    const float t = dot(e2, c) * invDet;
+    return t >= 0.0f && t <= 1.0f;
+}
+
+// Closest point on a triangle by its Voronoi regions (Ericson, Real-Time Collision Detection 5.1.5)
+static float pointTriangleDistance(const Vec3& p, const Vec3* pTriangle)
+{
+    const Vec3& a = pTriangle[0];
+    const Vec3& b = pTriangle[1];
+    const Vec3& c = pTriangle[2];
+    const Vec3  ab = sub(b, a);
+    const Vec3  ac = sub(c, a);
+    const Vec3  ap = sub(p, a);
+    Vec3        closest;
+    const float d1 = dot(ab, ap);
+    const float d2 = dot(ac, ap);
+    const Vec3  bp = sub(p, b);
+    const float d3 = dot(ab, bp);
+    const float d4 = dot(ac, bp);
+    const Vec3  cp = sub(p, c);
+    const float d5 = dot(ab, cp);
+    const float d6 = dot(ac, cp);
+    const float va = d3 * d6 - d5 * d4;
+    const float vb = d5 * d2 - d1 * d6;
+    const float vc = d1 * d4 - d3 * d2;
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        closest = a;
+    else if (d3 >= 0.0f && d4 <= d3)
+        closest = b;
+    else if (d6 >= 0.0f && d5 <= d6)
+        closest = c;
+    else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        closest = add(a, mul(ab, d1 / (d1 - d3)));
+    else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        closest = add(a, mul(ac, d2 / (d2 - d6)));
+    else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        closest = add(b, mul(sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    else
+    {
+        const float denom = 1.0f / (va + vb + vc);
+        closest = add(a, add(mul(ab, vb * denom), mul(ac, vc * denom)));
+    }
+    const Vec3 d = sub(p, closest);
+    return sqrtf(dot(d, d));
+}
+
+// The key lines of a .kpath, the format CameraPath::Load reads
+static bool loadKeys(const char* pPath, std::vector<Key>* pOut)
+{
+    FILE* file = fopen(pPath, "r");
+    if (!file)
+    {
+        printf("can't open %s\n", pPath);
+        return false;
+    }
+    char line[256];
+    int  lineNumber = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        ++lineNumber;
+        Key   key;
+        float pitch, yaw;
+        if (sscanf(line, "key %f %f %f %f %f %f", &key.mTime, &key.mPosition.x, &key.mPosition.y, &key.mPosition.z, &pitch,
+                   &yaw) == 6)
+        {
+            key.mLine = lineNumber;
+            pOut->push_back(key);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || argc > 4)
+    {
+        printf("Usage: KokkuCameraPathCheck <castle.gltf> <path.kpath> [minDistance]\n");
+        return 2;
+    }
+    const float minDistance = argc > 3 ? (float)atof(argv[3]) : 1.0f;
+
+    GltfDocument document;
+    std::string  error;
+    if (!gltfLoad(argv[1], &document, &error))
+    {
+        printf("%s: %s\n", argv[1], error.c_str());
+        return 2;
+    }
+    std::vector<Vec3> triangles;
+    for (const GltfPrimitive& primitive : gltfGetPrimitives(document))
+    {
+        GltfAccessor positionAccessor;
+        GltfAccessor indexAccessor;
+        if (primitive.mPositionAccessor < 0 || primitive.mIndicesAccessor < 0 ||
+            !gltfGetAccessor(&document, (uint32_t)primitive.mPositionAccessor, &positionAccessor) ||
+            !gltfGetAccessor(&document, (uint32_t)primitive.mIndicesAccessor, &indexAccessor))
+            continue;
+        std::vector<float>    positions;
+        std::vector<uint32_t> indices;
+        gltfReadPositions(positionAccessor, &positions);
+        gltfReadIndices(indexAccessor, &indices);
+        for (uint32_t index : indices)
+            triangles.push_back(mul({ positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2] }, CASTLE_SCALE));
+    }
+    const size_t triangleCount = triangles.size() / 3;
+
+    std::vector<Key> keys;
+    if (!loadKeys(argv[2], &keys))
+        return 2;
+    if (keys.empty())
+    {
+        printf("%s: no keys\n", argv[2]);
+        return 1;
+    }
+
+    uint32_t failures = 0;
+    float    closestDistance = FLT_MAX;
+    for (size_t k = 0; k < keys.size(); ++k)
+    {
+        const Key& key = keys[k];
+        float      distance = FLT_MAX;
+        bool       crossed = false;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const Vec3* pTriangle = &triangles[t * 3];
+            distance = fminf(distance, pointTriangleDistance(key.mPosition, pTriangle));
+            if (k > 0 && segmentHitsTriangle(keys[k - 1].mPosition, key.mPosition, pTriangle))
+                crossed = true;
+        }
+        closestDistance = fminf(closestDistance, distance);
+        if (crossed)
+        {
+            printf("%s:%d: the move from line %d to %.2fs passes through the castle\n", argv[2], key.mLine,
+                   keys[k - 1].mLine, key.mTime);
+            ++failures;
+        }
+        if (distance < minDistance)
+        {
+            printf("%s:%d: %.2fs is %.3f from the castle, under %.3f\n", argv[2], key.mLine, key.mTime, distance, minDistance);
+            ++failures;
+        }
+    }
+
+    printf("%s: %zu keys over %.2fs against %zu triangles, closest %.3f, %u failures\n", argv[2], keys.size(),
+           keys.back().mTime - keys.front().mTime, triangleCount, closestDistance, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// Runs the SSE2 light range loop of ClusteredLights.cpp and its scalar reference on the same lights and fails on
+// any difference in the cluster ranges or the visibility flags. Registered with ctest.
+//
+//   KokkuClusteredLightsCheck
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ClusteredLights.h"
+
+// Deterministic across platforms, unlike rand()
+static uint32_t gRandomState = 0x12345678u;
+
+static float randomFloat(float minValue, float maxValue)
+{
+    gRandomState = gRandomState * 1664525u + 1013904223u;
+    return minValue + (maxValue - minValue) * (float)(gRandomState >> 8) / (float)(1u << 24);
+}
+
+// Camera at pEye turned by yaw around y, column-major world to view like the app's
+static void makeCamera(const float* pEye, float yaw, uint32_t width, uint32_t height, ClusterCamera* pOutCamera)
+{
+    const float c = cosf(yaw);
+    const float s = sinf(yaw);
+    float* v = pOutCamera->mView;
+    memset(v, 0, sizeof(pOutCamera->mView));
+    v[0] = c;
+    v[2] = s;
+    v[5] = 1.0f;
+    v[8] = -s;
+    v[10] = c;
+    v[12] = -(c * pEye[0] - s * pEye[2]);
+    v[13] = -pEye[1];
+    v[14] = -(s * pEye[0] + c * pEye[2]);
+    v[15] = 1.0f;
+
+    const float aspect = (float)width / (float)height;
+    pOutCamera->mProjScale[1] = 1.0f / tanf(0.5f * 1.0471976f);
+    pOutCamera->mProjScale[0] = pOutCamera->mProjScale[1] / aspect;
+    pOutCamera->mNear = 0.1f;
+    pOutCamera->mFar = 4000.0f;
+    pOutCamera->mWidth = width;
+    pOutCamera->mHeight = height;
+}
+
+int main()
+{
+    static PointLight        lights[CLUSTER_MAX_LIGHTS];
+    static ClusterBinScratch simd;
+    static ClusterBinScratch scalar;
+
+    const float    eyes[][3] = { { 0.0f, 3.0f, 0.0f }, { 120.0f, 40.0f, -250.0f }, { -35.5f, 0.25f, 17.0f } };
+    const float    yaws[] = { 0.0f, 0.7853982f, 3.0f };
+    const uint32_t sizes[][2] = { { 1920, 1080 }, { 1280, 720 }, { 1000, 999 } };
+    // Tails of 0 to 3 lights go through the scalar loop in both cases
+    const uint32_t lightCounts[] = { 4, 7, 1022, CLUSTER_MAX_LIGHTS };
+
+    uint32_t failures = 0;
+    uint32_t checked = 0;
+    for (uint32_t c = 0; c < sizeof(eyes) / sizeof(eyes[0]); ++c)
+    {
+        ClusterCamera camera;
+        makeCamera(eyes[c], yaws[c], sizes[c][0], sizes[c][1], &camera);
+
+        for (uint32_t n = 0; n < sizeof(lightCounts) / sizeof(lightCounts[0]); ++n)
+        {
+            const uint32_t lightCount = lightCounts[n];
+            for (uint32_t i = 0; i < lightCount; ++i)
+            {
+                // Around the camera, including lights behind it and ones that cut the near plane
+                PointLight& light = lights[i];
+                light.mPosition[0] = eyes[c][0] + randomFloat(-300.0f, 300.0f);
+                light.mPosition[1] = eyes[c][1] + randomFloat(-50.0f, 50.0f);
+                light.mPosition[2] = eyes[c][2] + randomFloat(-300.0f, 300.0f);
+                light.mRadius = (i % 8) == 0 ? randomFloat(0.0f, 0.2f) : randomFloat(0.5f, 40.0f);
+                light.mColor[0] = light.mColor[1] = light.mColor[2] = 1.0f;
+                light.mIntensity = 1.0f;
+            }
+
+            memset(&simd, 0xcd, sizeof(simd.mRanges) + sizeof(simd.mVisible));
+            memset(&scalar, 0xcd, sizeof(scalar.mRanges) + sizeof(scalar.mVisible));
+            clusterLightRanges(&camera, lights, lightCount, &simd);
+            clusterLightRangesScalar(&camera, lights, 0, lightCount, &scalar);
+
+            for (uint32_t i = 0; i < lightCount; ++i)
+            {
+                ++checked;
+                if (memcmp(simd.mRanges[i], scalar.mRanges[i], 6) == 0 && simd.mVisible[i] == scalar.mVisible[i])
+                    continue;
+
+                if (++failures <= 10)
+                {
+                    const uint8_t* a = simd.mRanges[i];
+                    const uint8_t* b = scalar.mRanges[i];
+                    printf("camera %u, light %u of %u: x %u-%u y %u-%u z %u-%u visible %u, scalar x %u-%u y %u-%u z %u-%u visible %u\n", c,
+                           i, lightCount, a[0], a[1], a[2], a[3], a[4], a[5], simd.mVisible[i], b[0], b[1], b[2], b[3], b[4], b[5],
+                           scalar.mVisible[i]);
+                }
+            }
+        }
+    }
+
+    printf("%u light ranges checked, %u differ\n", checked, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// Reads a cooked scene back the way CastleScene does (cookedSceneParse) and checks what the app relies on past
+// the parse: the index width, every index inside its draw's vertices, and the material of every draw. ctest runs
+// it on the synthetic grids, split and unsplit, so both index widths and split draws are covered.
+//
+//   KokkuCookedSceneCheck <scene.kscene> <16|32> <material>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "CookedScene.h"
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        printf("Usage: KokkuCookedSceneCheck <scene.kscene> <16|32> <material>\n");
+        return 2;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (!file)
+    {
+        printf("can't open %s\n", argv[1]);
+        return 2;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::vector<uint8_t> data(size > 0 ? (size_t)size : 0);
+    const size_t read = fread(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    CookedScene scene;
+    if (const char* error = cookedSceneParse(data.data(), read, &scene))
+    {
+        printf("%s: %s\n", argv[1], error);
+        return 1;
+    }
+    const CookedSceneHeader& header = *scene.pHeader;
+
+    uint32_t failures = 0;
+    const uint32_t indexBits = (uint32_t)atoi(argv[2]);
+    if (header.mIndexSize * 8 != indexBits)
+    {
+        printf("%u-bit indices, expected %u-bit\n", header.mIndexSize * 8, indexBits);
+        ++failures;
+    }
+
+    uint32_t maxIndex = 0;
+    for (uint32_t d = 0; d < header.mDrawCount; ++d)
+    {
+        const CookedSceneDraw& draw = scene.pDraws[d];
+        // The cooker concatenates the draws' vertices in order, each draw owns the ones up to the next
+        const uint32_t vertexEnd = d + 1 < header.mDrawCount ? scene.pDraws[d + 1].mVertexOffset : header.mVertexCount;
+        const uint32_t vertexCount = vertexEnd - draw.mVertexOffset;
+
+        uint32_t outOfRange = 0;
+        for (uint32_t i = draw.mStartIndex; i < draw.mStartIndex + draw.mIndexCount; ++i)
+        {
+            const uint32_t index = header.mIndexSize == 2 ? ((const uint16_t*)scene.pIndices)[i] : ((const uint32_t*)scene.pIndices)[i];
+            outOfRange += index >= vertexCount;
+            maxIndex = index > maxIndex ? index : maxIndex;
+        }
+        if (outOfRange)
+        {
+            printf("draw %u: %u indices past its %u vertices\n", d, outOfRange, vertexCount);
+            ++failures;
+        }
+        if (strcmp(scene.pMaterials[d].mName, argv[3]) != 0)
+        {
+            printf("draw %u: material \"%s\", expected \"%s\"\n", d, scene.pMaterials[d].mName, argv[3]);
+            ++failures;
+        }
+    }
+
+    // A 32-bit file that never needs the upper half doesn't test that path
+    if (header.mIndexSize == 4 && maxIndex <= 0xFFFF)
+    {
+        printf("32-bit indices, but none past 0xFFFF\n");
+        ++failures;
+    }
+
+    printf("%s: %u draws, %u vertices, %u %u-bit indices, largest %u, %u failures\n", argv[1], header.mDrawCount, header.mVertexCount,
+           header.mIndexCount, header.mIndexSize * 8, maxIndex, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdlib.h>
+
+// Stand-in for The-Forge's allocator, so the checks build the app's renderer free sources without The-Forge.
+// Only what those sources call.
+#define tf_malloc(size) malloc(size)
+#define tf_calloc(count, size) calloc(count, size)
+#define tf_realloc(ptr, size) realloc(ptr, size)
+#define tf_free(ptr) free(ptr)
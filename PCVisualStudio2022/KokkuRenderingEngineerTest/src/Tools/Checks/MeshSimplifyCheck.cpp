@@ -0,0 +1,117 @@
+// Simplifies generated grids with meshSimplify, the castle LOD builder, and checks its output: the triangle count
+// reaches the target, the error grows with each coarser target and stays under maxError, and every index is a
+// valid vertex of a non-degenerate triangle. Registered with ctest.
+//
+//   KokkuMeshSimplifyCheck
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "MeshSimplify.h"
+
+static uint32_t gFailures = 0;
+
+static void check(bool condition, const char* pName, const char* pWhat)
+{
+    if (condition)
+        return;
+    printf("%s: %s\n", pName, pWhat);
+    ++gFailures;
+}
+
+// size x size quads over [0, 1]^2 in x and z, y from the height function
+static void makeGrid(uint32_t size, float (*height)(float, float), std::vector<float>& positions, std::vector<uint32_t>& indices)
+{
+    const uint32_t row = size + 1;
+    positions.resize(row * row * 3);
+    for (uint32_t z = 0; z < row; ++z)
+    {
+        for (uint32_t x = 0; x < row; ++x)
+        {
+            float* p = &positions[(z * row + x) * 3];
+            p[0] = (float)x / size;
+            p[2] = (float)z / size;
+            p[1] = height(p[0], p[2]);
+        }
+    }
+
+    indices.clear();
+    for (uint32_t z = 0; z < size; ++z)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            const uint32_t v = z * row + x;
+            const uint32_t quad[6] = { v, v + row, v + 1, v + 1, v + row, v + row + 1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+static float flatHeight(float, float) { return 0.0f; }
+
+static float wavyHeight(float x, float z) { return 0.05f * sinf(x * 12.0f) * cosf(z * 9.0f); }
+
+static bool validIndices(const std::vector<uint32_t>& indices, uint32_t count, uint32_t vertexCount)
+{
+    if (count % 3 != 0)
+        return false;
+    for (uint32_t i = 0; i < count; i += 3)
+    {
+        const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c)
+            return false;
+    }
+    return true;
+}
+
+static void checkGrid(const char* pName, float (*height)(float, float), bool expectZeroError)
+{
+    std::vector<float>    positions;
+    std::vector<uint32_t> indices;
+    makeGrid(64, height, positions, indices);
+    const uint32_t vertexCount = (uint32_t)positions.size() / 3;
+    const uint32_t indexCount = (uint32_t)indices.size();
+
+    std::vector<uint32_t> simplified(indexCount);
+    float previousError = 0.0f;
+    // Each target from the full grid, so the errors of coarser targets can be compared
+    const float ratios[] = { 0.5f, 0.25f, 0.1f, 0.05f };
+    for (float ratio : ratios)
+    {
+        const uint32_t target = (uint32_t)(indexCount / 3 * ratio) * 3;
+        float error = -1.0f;
+        const uint32_t count =
+            meshSimplify(indices.data(), indexCount, positions.data(), 3 * sizeof(float), vertexCount, target, FLT_MAX, simplified.data(), &error);
+
+        printf("%s %.0f%%: %u of %u triangles (target %u), error %g\n", pName, ratio * 100.0f, count / 3, indexCount / 3, target / 3, error);
+        check(count > 0 && count <= target, pName, "triangle count misses the target");
+        // A collapse removes the two triangles around its edge, so stopping at the target lands just below it
+        check(count + 3 * 16 >= target, pName, "stopped well short of the target");
+        check(validIndices(simplified, count, vertexCount), pName, "invalid or degenerate triangle");
+        check(error >= previousError, pName, "error dropped for a coarser target");
+        check(!expectZeroError || error == 0.0f, pName, "error on a flat grid");
+        previousError = error;
+    }
+
+    // Collapses past maxError are not taken, the rest still is
+    const float maxError = previousError * 0.25f;
+    float error = -1.0f;
+    const uint32_t count =
+        meshSimplify(indices.data(), indexCount, positions.data(), 3 * sizeof(float), vertexCount, 0, maxError, simplified.data(), &error);
+    printf("%s maxError %g: %u triangles, error %g\n", pName, maxError, count / 3, error);
+    check(error <= maxError, pName, "error past maxError");
+    check(count > 0 && count < indexCount, pName, "nothing simplified under maxError");
+    check(validIndices(simplified, count, vertexCount), pName, "invalid or degenerate triangle under maxError");
+}
+
+int main()
+{
+    checkGrid("flat", flatHeight, true);
+    checkGrid("wavy", wavyHeight, false);
+
+    printf("%u failures\n", gFailures);
+    return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,678 @@
+#include "BlockCompression.h"
+
+#include <math.h>
+#include <string.h>
+
+static inline int clampInt(int value, int low, int high) { return value < low ? low : (value > high ? high : value); }
+
+// Principal axis of the block (in numChannels dimensions) by power iteration on the covariance matrix.
+// Fills pMin/pMax with the block colors at both ends of the axis.
+static void fitPrincipalAxis(const uint8_t* pTexels, uint32_t numChannels, float* pMin, float* pMax)
+{
+    float mean[4] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        for (uint32_t c = 0; c < numChannels; ++c)
+            mean[c] += pTexels[i * 4 + c];
+    }
+    for (uint32_t c = 0; c < numChannels; ++c)
+        mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        float d[4];
+        for (uint32_t c = 0; c < numChannels; ++c)
+            d[c] = pTexels[i * 4 + c] - mean[c];
+        for (uint32_t r = 0; r < numChannels; ++r)
+        {
+            for (uint32_t c = 0; c < numChannels; ++c)
+                covariance[r][c] += d[r] * d[c];
+        }
+    }
+
+    // Start from the bounding box diagonal, it is close to the answer for most blocks
+    float axis[4] = {};
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        uint8_t low = 255;
+        uint8_t high = 0;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            low = pTexels[i * 4 + c] < low ? pTexels[i * 4 + c] : low;
+            high = pTexels[i * 4 + c] > high ? pTexels[i * 4 + c] : high;
+        }
+        axis[c] = (float)(high - low);
+    }
+
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        float maxComponent = 0.0f;
+        for (uint32_t r = 0; r < numChannels; ++r)
+        {
+            for (uint32_t c = 0; c < numChannels; ++c)
+                next[r] += covariance[r][c] * axis[c];
+            maxComponent = fmaxf(maxComponent, fabsf(next[r]));
+        }
+        if (maxComponent == 0.0f)
+            break;
+        for (uint32_t c = 0; c < numChannels; ++c)
+            axis[c] = next[c] / maxComponent;
+    }
+
+    float minDot = INFINITY;
+    float maxDot = -INFINITY;
+    uint32_t minTexel = 0;
+    uint32_t maxTexel = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        float d = 0.0f;
+        for (uint32_t c = 0; c < numChannels; ++c)
+            d += pTexels[i * 4 + c] * axis[c];
+        if (d < minDot)
+        {
+            minDot = d;
+            minTexel = i;
+        }
+        if (d > maxDot)
+        {
+            maxDot = d;
+            maxTexel = i;
+        }
+    }
+
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        pMin[c] = pTexels[minTexel * 4 + c];
+        pMax[c] = pTexels[maxTexel * 4 + c];
+    }
+}
+
+// Least squares endpoints for the given per texel weights (weight of endpoint 1, in [0, 1])
+static bool solveEndpoints(const uint8_t* pTexels, uint32_t numChannels, const float* pWeights, float* pEnd0, float* pEnd1)
+{
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const float b = pWeights[i];
+        const float a = 1.0f - b;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (uint32_t c = 0; c < numChannels; ++c)
+        {
+            ax[c] += a * pTexels[i * 4 + c];
+            bx[c] += b * pTexels[i * 4 + c];
+        }
+    }
+
+    const float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return false;
+
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        pEnd0[c] = fminf(fmaxf((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+        pEnd1[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+//
+// BC1
+//
+
+static uint16_t pack565(const float* pColor)
+{
+    const int r = clampInt((int)(pColor[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    const int g = clampInt((int)(pColor[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    const int b = clampInt((int)(pColor[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(uint16_t color, int* pRgb)
+{
+    const int r = (color >> 11) & 31;
+    const int g = (color >> 5) & 63;
+    const int b = color & 31;
+    pRgb[0] = (r << 3) | (r >> 2);
+    pRgb[1] = (g << 2) | (g >> 4);
+    pRgb[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1Palette(uint16_t color0, uint16_t color1, int pPalette[4][4])
+{
+    unpack565(color0, pPalette[0]);
+    unpack565(color1, pPalette[1]);
+    pPalette[0][3] = pPalette[1][3] = 255;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (color0 > color1)
+        {
+            pPalette[2][c] = (2 * pPalette[0][c] + pPalette[1][c]) / 3;
+            pPalette[3][c] = (pPalette[0][c] + 2 * pPalette[1][c]) / 3;
+        }
+        else
+        {
+            pPalette[2][c] = (pPalette[0][c] + pPalette[1][c]) / 2;
+            pPalette[3][c] = 0;
+        }
+    }
+    pPalette[2][3] = 255;
+    pPalette[3][3] = color0 > color1 ? 255 : 0;
+}
+
+// Builds an opaque 4 color block from two endpoint colors and returns its squared error
+static uint32_t bc1BuildBlock(const uint8_t* pTexels, uint16_t color0, uint16_t color1, uint8_t* pDst, uint8_t* pIndices)
+{
+    if (color0 < color1)
+    {
+        const uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    int palette[4][4];
+    bc1Palette(color0, color1, palette);
+    // Equal endpoints select 3 color mode, only its first entry is used then
+    const uint32_t paletteSize = color0 == color1 ? 1 : 4;
+
+    uint32_t totalError = 0;
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        uint32_t bestError = UINT32_MAX;
+        uint32_t bestIndex = 0;
+        for (uint32_t p = 0; p < paletteSize; ++p)
+        {
+            uint32_t error = 0;
+            for (int c = 0; c < 3; ++c)
+            {
+                const int d = (int)pTexels[i * 4 + c] - palette[p][c];
+                error += (uint32_t)(d * d);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                bestIndex = p;
+            }
+        }
+        totalError += bestError;
+        bits |= bestIndex << (i * 2);
+        pIndices[i] = (uint8_t)bestIndex;
+    }
+
+    memcpy(pDst, &color0, 2);
+    memcpy(pDst + 2, &color1, 2);
+    memcpy(pDst + 4, &bits, 4);
+    return totalError;
+}
+
+void bc1EncodeBlock(uint8_t* pDst, const uint8_t* pTexels)
+{
+    float end0[4], end1[4];
+    fitPrincipalAxis(pTexels, 3, end1, end0);
+
+    uint8_t  indices[16];
+    uint32_t bestError = bc1BuildBlock(pTexels, pack565(end0), pack565(end1), pDst, indices);
+
+    // Refit the endpoints to the chosen indices, keeping whichever block ends up closer
+    static const float gIndexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    for (int iteration = 0; iteration < 2 && bestError > 0; ++iteration)
+    {
+        float weights[16];
+        for (uint32_t i = 0; i < 16; ++i)
+            weights[i] = gIndexWeights[indices[i]];
+        if (!solveEndpoints(pTexels, 3, weights, end0, end1))
+            break;
+
+        uint8_t  candidate[8];
+        uint8_t  candidateIndices[16];
+        const uint32_t error = bc1BuildBlock(pTexels, pack565(end0), pack565(end1), candidate, candidateIndices);
+        if (error >= bestError)
+            break;
+
+        bestError = error;
+        memcpy(pDst, candidate, sizeof(candidate));
+        memcpy(indices, candidateIndices, sizeof(indices));
+    }
+}
+
+void bc1DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc)
+{
+    uint16_t color0, color1;
+    uint32_t bits;
+    memcpy(&color0, pSrc, 2);
+    memcpy(&color1, pSrc + 2, 2);
+    memcpy(&bits, pSrc + 4, 4);
+
+    int palette[4][4];
+    bc1Palette(color0, color1, palette);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const uint32_t index = (bits >> (i * 2)) & 3;
+        for (int c = 0; c < 4; ++c)
+            pTexels[i * 4 + c] = (uint8_t)palette[index][c];
+    }
+}
+
+//
+// BC4 / BC5
+//
+
+static void bc4Palette(uint8_t value0, uint8_t value1, int* pPalette)
+{
+    pPalette[0] = value0;
+    pPalette[1] = value1;
+    if (value0 > value1)
+    {
+        for (int i = 1; i < 7; ++i)
+            pPalette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+    }
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            pPalette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+        pPalette[6] = 0;
+        pPalette[7] = 255;
+    }
+}
+
+// Indices for an 8 value mode block, returns the squared error
+static uint32_t bc4PickIndices(const uint8_t* pTexels, uint32_t channel, uint8_t value0, uint8_t value1, uint8_t* pIndices)
+{
+    int palette[8];
+    bc4Palette(value0, value1, palette);
+
+    uint32_t totalError = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const int value = pTexels[i * 4 + channel];
+        int       bestError = 256;
+        for (uint8_t p = 0; p < 8; ++p)
+        {
+            const int error = value > palette[p] ? value - palette[p] : palette[p] - value;
+            if (error < bestError)
+            {
+                bestError = error;
+                pIndices[i] = p;
+            }
+        }
+        totalError += (uint32_t)(bestError * bestError);
+    }
+    return totalError;
+}
+
+void bc4EncodeBlock(uint8_t* pDst, const uint8_t* pTexels, uint32_t channel)
+{
+    uint8_t low = 255;
+    uint8_t high = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const uint8_t value = pTexels[i * 4 + channel];
+        low = value < low ? value : low;
+        high = value > high ? value : high;
+    }
+
+    // value0 > value1 selects the 8 value mode, a flat block decodes exactly with any index
+    uint8_t  indices[16];
+    uint32_t bestError = bc4PickIndices(pTexels, channel, high, low, indices);
+
+    // Min/max leaves the interior values up to a 14th of the range off, refitting the endpoints to the
+    // chosen indices pulls them onto the values that actually occur (BC1 sourced data only has 4 per block)
+    static const float gIndexWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+    for (int iteration = 0; iteration < 2 && bestError > 0; ++iteration)
+    {
+        // Only the selected channel is solved, the others are left alone
+        uint8_t texels[64];
+        float   weights[16];
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            texels[i * 4] = pTexels[i * 4 + channel];
+            weights[i] = gIndexWeights[indices[i]];
+        }
+
+        float end0, end1;
+        if (!solveEndpoints(texels, 1, weights, &end0, &end1))
+            break;
+
+        const uint8_t value0 = (uint8_t)(end0 + 0.5f);
+        const uint8_t value1 = (uint8_t)(end1 + 0.5f);
+        if (value0 <= value1)
+            break;
+
+        uint8_t        candidateIndices[16];
+        const uint32_t error = bc4PickIndices(pTexels, channel, value0, value1, candidateIndices);
+        if (error >= bestError)
+            break;
+
+        bestError = error;
+        high = value0;
+        low = value1;
+        memcpy(indices, candidateIndices, sizeof(indices));
+    }
+
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+        bits |= (uint64_t)indices[i] << (i * 3);
+
+    pDst[0] = high;
+    pDst[1] = low;
+    for (int b = 0; b < 6; ++b)
+        pDst[2 + b] = (uint8_t)(bits >> (b * 8));
+}
+
+void bc4DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc, uint32_t channel)
+{
+    int palette[8];
+    bc4Palette(pSrc[0], pSrc[1], palette);
+
+    uint64_t bits = 0;
+    for (int b = 0; b < 6; ++b)
+        bits |= (uint64_t)pSrc[2 + b] << (b * 8);
+
+    for (uint32_t i = 0; i < 16; ++i)
+        pTexels[i * 4 + channel] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+}
+
+void bc5EncodeBlock(uint8_t* pDst, const uint8_t* pTexels)
+{
+    bc4EncodeBlock(pDst, pTexels, 0);
+    bc4EncodeBlock(pDst + 8, pTexels, 1);
+}
+
+void bc5DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc)
+{
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        pTexels[i * 4 + 2] = 0;
+        pTexels[i * 4 + 3] = 255;
+    }
+    bc4DecodeBlock(pTexels, pSrc, 0);
+    bc4DecodeBlock(pTexels, pSrc + 8, 1);
+}
+
+//
+// BC7 mode 6
+//
+
+static const int gBc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitWriter
+{
+    uint8_t* pData;
+    uint32_t mPosition;
+
+    void write(uint32_t value, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; ++i, ++mPosition)
+        {
+            if (value & (1u << i))
+                pData[mPosition >> 3] |= (uint8_t)(1u << (mPosition & 7));
+        }
+    }
+};
+
+struct BitReader
+{
+    const uint8_t* pData;
+    uint32_t       mPosition;
+
+    uint32_t read(uint32_t count)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i, ++mPosition)
+            value |= (uint32_t)((pData[mPosition >> 3] >> (mPosition & 7)) & 1) << i;
+        return value;
+    }
+};
+
+struct Bc7Mode6Block
+{
+    uint8_t  mEndpoints[2][4]; // 7 bit values
+    uint8_t  mPBits[2];
+    uint8_t  mIndices[16];
+    uint32_t mError;
+};
+
+// Quantizes the endpoints trying all four p-bit combinations and picks indices for the best one
+static void bc7FitMode6(const uint8_t* pTexels, const float* pEnd0, const float* pEnd1, Bc7Mode6Block* pBest)
+{
+    pBest->mError = UINT32_MAX;
+    for (uint32_t pbits = 0; pbits < 4; ++pbits)
+    {
+        Bc7Mode6Block block;
+        block.mPBits[0] = (uint8_t)(pbits & 1);
+        block.mPBits[1] = (uint8_t)(pbits >> 1);
+
+        int endpoints[2][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            block.mEndpoints[0][c] = (uint8_t)clampInt((int)((pEnd0[c] - block.mPBits[0]) / 2.0f + 0.5f), 0, 127);
+            block.mEndpoints[1][c] = (uint8_t)clampInt((int)((pEnd1[c] - block.mPBits[1]) / 2.0f + 0.5f), 0, 127);
+            endpoints[0][c] = (block.mEndpoints[0][c] << 1) | block.mPBits[0];
+            endpoints[1][c] = (block.mEndpoints[1][c] << 1) | block.mPBits[1];
+        }
+
+        int palette[16][4];
+        for (int p = 0; p < 16; ++p)
+        {
+            for (int c = 0; c < 4; ++c)
+                palette[p][c] = ((64 - gBc7Weights4[p]) * endpoints[0][c] + gBc7Weights4[p] * endpoints[1][c] + 32) >> 6;
+        }
+
+        block.mError = 0;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t bestError = UINT32_MAX;
+            for (uint32_t p = 0; p < 16; ++p)
+            {
+                uint32_t error = 0;
+                for (int c = 0; c < 4; ++c)
+                {
+                    const int d = (int)pTexels[i * 4 + c] - palette[p][c];
+                    error += (uint32_t)(d * d);
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    block.mIndices[i] = (uint8_t)p;
+                }
+            }
+            block.mError += bestError;
+        }
+
+        if (block.mError < pBest->mError)
+            *pBest = block;
+    }
+}
+
+void bc7EncodeBlock(uint8_t* pDst, const uint8_t* pTexels)
+{
+    float end0[4], end1[4];
+    fitPrincipalAxis(pTexels, 4, end0, end1);
+
+    Bc7Mode6Block best;
+    bc7FitMode6(pTexels, end0, end1, &best);
+
+    for (int iteration = 0; iteration < 2 && best.mError > 0; ++iteration)
+    {
+        float weights[16];
+        for (uint32_t i = 0; i < 16; ++i)
+            weights[i] = gBc7Weights4[best.mIndices[i]] / 64.0f;
+        if (!solveEndpoints(pTexels, 4, weights, end0, end1))
+            break;
+
+        Bc7Mode6Block candidate;
+        bc7FitMode6(pTexels, end0, end1, &candidate);
+        if (candidate.mError >= best.mError)
+            break;
+        best = candidate;
+    }
+
+    // The anchor (first) index is stored without its top bit, so it has to be below 8
+    if (best.mIndices[0] >= 8)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            const uint8_t swap = best.mEndpoints[0][c];
+            best.mEndpoints[0][c] = best.mEndpoints[1][c];
+            best.mEndpoints[1][c] = swap;
+        }
+        const uint8_t swap = best.mPBits[0];
+        best.mPBits[0] = best.mPBits[1];
+        best.mPBits[1] = swap;
+        for (uint32_t i = 0; i < 16; ++i)
+            best.mIndices[i] = (uint8_t)(15 - best.mIndices[i]);
+    }
+
+    memset(pDst, 0, 16);
+    BitWriter writer = { pDst, 0 };
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.write(best.mEndpoints[0][c], 7);
+        writer.write(best.mEndpoints[1][c], 7);
+    }
+    writer.write(best.mPBits[0], 1);
+    writer.write(best.mPBits[1], 1);
+    for (uint32_t i = 0; i < 16; ++i)
+        writer.write(best.mIndices[i], i == 0 ? 3 : 4);
+}
+
+bool bc7DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc)
+{
+    BitReader reader = { pSrc, 0 };
+    if (reader.read(7) != (1u << 6))
+        return false;
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = (int)reader.read(7) << 1;
+        endpoints[1][c] = (int)reader.read(7) << 1;
+    }
+    const uint32_t pbit0 = reader.read(1);
+    const uint32_t pbit1 = reader.read(1);
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] |= pbit0;
+        endpoints[1][c] |= pbit1;
+    }
+
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const int weight = gBc7Weights4[reader.read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c)
+            pTexels[i * 4 + c] = (uint8_t)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+    }
+    return true;
+}
+
+//
+// Images
+//
+
+bool imageCompress(DxgiFormat format, const uint8_t* pRgba, uint32_t width, uint32_t height, std::vector<uint8_t>* pOut)
+{
+    const uint32_t blockSize = ddsBlockSize(format);
+    if (blockSize == 0)
+        return false;
+
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    pOut->assign((size_t)blocksX * blocksY * blockSize, 0);
+
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            // Edge blocks of small mips repeat the last row/column
+            uint8_t texels[64];
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                for (uint32_t x = 0; x < 4; ++x)
+                {
+                    const uint32_t sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                    const uint32_t sy = by * 4 + y < height ? by * 4 + y : height - 1;
+                    memcpy(&texels[(y * 4 + x) * 4], &pRgba[((size_t)sy * width + sx) * 4], 4);
+                }
+            }
+
+            uint8_t* block = pOut->data() + ((size_t)by * blocksX + bx) * blockSize;
+            switch (format)
+            {
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB: bc1EncodeBlock(block, texels); break;
+            case DXGI_FORMAT_BC4_UNORM: bc4EncodeBlock(block, texels, 0); break;
+            case DXGI_FORMAT_BC5_UNORM: bc5EncodeBlock(block, texels); break;
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB: bc7EncodeBlock(block, texels); break;
+            default: return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool imageDecompress(DxgiFormat format, const uint8_t* pData, uint32_t width, uint32_t height, std::vector<uint8_t>* pRgba)
+{
+    pRgba->assign((size_t)width * height * 4, 0);
+
+    const uint32_t blockSize = ddsBlockSize(format);
+    if (blockSize == 0)
+    {
+        const bool bgra = format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+        memcpy(pRgba->data(), pData, pRgba->size());
+        if (bgra)
+        {
+            for (size_t i = 0; i < pRgba->size(); i += 4)
+            {
+                const uint8_t swap = (*pRgba)[i];
+                (*pRgba)[i] = (*pRgba)[i + 2];
+                (*pRgba)[i + 2] = swap;
+            }
+        }
+        return true;
+    }
+
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            const uint8_t* block = pData + ((size_t)by * blocksX + bx) * blockSize;
+            uint8_t        texels[64];
+            switch (format)
+            {
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB: bc1DecodeBlock(texels, block); break;
+            case DXGI_FORMAT_BC4_UNORM:
+                for (uint32_t i = 0; i < 16; ++i)
+                {
+                    texels[i * 4 + 1] = texels[i * 4 + 2] = 0;
+                    texels[i * 4 + 3] = 255;
+                }
+                bc4DecodeBlock(texels, block, 0);
+                break;
+            case DXGI_FORMAT_BC5_UNORM: bc5DecodeBlock(texels, block); break;
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                if (!bc7DecodeBlock(texels, block))
+                    return false;
+                break;
+            default: return false;
+            }
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+            {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+                    memcpy(&(*pRgba)[(((size_t)by * 4 + y) * width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Dds.h"
+
+// CPU block compression for the texture cooker. Blocks are 4x4 RGBA8 texels in row order.
+// The encoders aim for predictable offline quality, not speed:
+// - BC1: principal axis fit plus least squares refinement, always in opaque 4 color mode
+// - BC4/BC5: min/max endpoints in 8 value mode, one or two channels
+// - BC7: mode 6 only (single subset RGBA, 4 bit indices), which covers opaque albedo well
+
+void bc1EncodeBlock(uint8_t* pDst, const uint8_t* pTexels);
+void bc4EncodeBlock(uint8_t* pDst, const uint8_t* pTexels, uint32_t channel);
+void bc5EncodeBlock(uint8_t* pDst, const uint8_t* pTexels);
+void bc7EncodeBlock(uint8_t* pDst, const uint8_t* pTexels);
+
+// Decoders return texels the way the hardware samples them (BC4 = r001, BC5 = rg01).
+void bc1DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc);
+void bc4DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc, uint32_t channel);
+void bc5DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc);
+// Only mode 6 blocks, returns false for anything else
+bool bc7DecodeBlock(uint8_t* pTexels, const uint8_t* pSrc);
+
+// Whole level helpers, working on tightly packed RGBA8 images of any size
+bool imageCompress(DxgiFormat format, const uint8_t* pRgba, uint32_t width, uint32_t height, std::vector<uint8_t>* pOut);
+bool imageDecompress(DxgiFormat format, const uint8_t* pData, uint32_t width, uint32_t height, std::vector<uint8_t>* pRgba);
@@ -0,0 +1,285 @@
+#include "Dds.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+static const uint32_t DDSD_CAPS = 0x1;
+static const uint32_t DDSD_HEIGHT = 0x2;
+static const uint32_t DDSD_WIDTH = 0x4;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE = 0x80000;
+
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDPF_RGB = 0x40;
+
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+#define DDS_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+struct DdsPixelFormat
+{
+    uint32_t mSize;
+    uint32_t mFlags;
+    uint32_t mFourCC;
+    uint32_t mRGBBitCount;
+    uint32_t mRBitMask;
+    uint32_t mGBitMask;
+    uint32_t mBBitMask;
+    uint32_t mABitMask;
+};
+
+struct DdsHeader
+{
+    uint32_t       mSize;
+    uint32_t       mFlags;
+    uint32_t       mHeight;
+    uint32_t       mWidth;
+    uint32_t       mPitchOrLinearSize;
+    uint32_t       mDepth;
+    uint32_t       mMipMapCount;
+    uint32_t       mReserved1[11];
+    DdsPixelFormat mPixelFormat;
+    uint32_t       mCaps;
+    uint32_t       mCaps2;
+    uint32_t       mCaps3;
+    uint32_t       mCaps4;
+    uint32_t       mReserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t mDxgiFormat;
+    uint32_t mResourceDimension;
+    uint32_t mMiscFlag;
+    uint32_t mArraySize;
+    uint32_t mMiscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DDS DX10 header layout");
+
+uint32_t ddsBlockSize(DxgiFormat format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM: return 8;
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB: return 16;
+    default: return 0;
+    }
+}
+
+bool ddsIsSrgb(DxgiFormat format)
+{
+    return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+           format == DXGI_FORMAT_BC1_UNORM_SRGB || format == DXGI_FORMAT_BC7_UNORM_SRGB;
+}
+
+const char* ddsFormatName(DxgiFormat format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM: return "RGBA8";
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: return "RGBA8_SRGB";
+    case DXGI_FORMAT_B8G8R8A8_UNORM: return "BGRA8";
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: return "BGRA8_SRGB";
+    case DXGI_FORMAT_BC1_UNORM: return "BC1";
+    case DXGI_FORMAT_BC1_UNORM_SRGB: return "BC1_SRGB";
+    case DXGI_FORMAT_BC4_UNORM: return "BC4";
+    case DXGI_FORMAT_BC5_UNORM: return "BC5";
+    case DXGI_FORMAT_BC7_UNORM: return "BC7";
+    case DXGI_FORMAT_BC7_UNORM_SRGB: return "BC7_SRGB";
+    default: return "UNKNOWN";
+    }
+}
+
+size_t ddsLevelSize(DxgiFormat format, uint32_t width, uint32_t height)
+{
+    const uint32_t blockSize = ddsBlockSize(format);
+    if (blockSize == 0)
+        return (size_t)width * height * 4;
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+uint32_t ddsMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        ++count;
+    }
+    return count;
+}
+
+static DxgiFormat formatFromLegacy(const DdsPixelFormat& pixelFormat)
+{
+    if (pixelFormat.mFlags & DDPF_FOURCC)
+    {
+        switch (pixelFormat.mFourCC)
+        {
+        case DDS_FOURCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+        case DDS_FOURCC('A', 'T', 'I', '1'):
+        case DDS_FOURCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+        case DDS_FOURCC('A', 'T', 'I', '2'):
+        case DDS_FOURCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+        default: return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    if ((pixelFormat.mFlags & DDPF_RGB) && pixelFormat.mRGBBitCount == 32)
+    {
+        if (pixelFormat.mRBitMask == 0x000000FF && pixelFormat.mGBitMask == 0x0000FF00 && pixelFormat.mBBitMask == 0x00FF0000)
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+        if (pixelFormat.mRBitMask == 0x00FF0000 && pixelFormat.mGBitMask == 0x0000FF00 && pixelFormat.mBBitMask == 0x000000FF)
+            return DXGI_FORMAT_B8G8R8A8_UNORM;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+bool ddsLoad(const char* pPath, DdsImage* pOut, std::string* pError)
+{
+    FILE* file = fopen(pPath, "rb");
+    if (!file)
+    {
+        *pError = std::string("Can't open ") + pPath;
+        return false;
+    }
+
+    std::vector<uint8_t> bytes;
+    uint8_t              buffer[65536];
+    size_t               read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    fclose(file);
+
+    uint32_t  magic = 0;
+    DdsHeader header;
+    if (bytes.size() < sizeof(magic) + sizeof(header))
+    {
+        *pError = std::string(pPath) + " is too small to be a DDS file";
+        return false;
+    }
+    memcpy(&magic, bytes.data(), sizeof(magic));
+    memcpy(&header, bytes.data() + sizeof(magic), sizeof(header));
+    if (magic != DDS_MAGIC || header.mSize != sizeof(DdsHeader))
+    {
+        *pError = std::string(pPath) + " is not a DDS file";
+        return false;
+    }
+
+    size_t offset = sizeof(magic) + sizeof(header);
+    if ((header.mPixelFormat.mFlags & DDPF_FOURCC) && header.mPixelFormat.mFourCC == DDS_FOURCC('D', 'X', '1', '0'))
+    {
+        DdsHeaderDx10 dx10;
+        if (bytes.size() < offset + sizeof(dx10))
+        {
+            *pError = std::string(pPath) + " has a truncated DX10 header";
+            return false;
+        }
+        memcpy(&dx10, bytes.data() + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+
+        if (dx10.mResourceDimension != DDS_DIMENSION_TEXTURE2D || dx10.mArraySize > 1)
+        {
+            *pError = std::string(pPath) + ": only single 2D textures are supported";
+            return false;
+        }
+        pOut->mFormat = (DxgiFormat)dx10.mDxgiFormat;
+        if (strcmp(ddsFormatName(pOut->mFormat), "UNKNOWN") == 0)
+            pOut->mFormat = DXGI_FORMAT_UNKNOWN;
+    }
+    else
+    {
+        pOut->mFormat = formatFromLegacy(header.mPixelFormat);
+    }
+
+    if (pOut->mFormat == DXGI_FORMAT_UNKNOWN)
+    {
+        *pError = std::string(pPath) + " uses an unsupported pixel format";
+        return false;
+    }
+    if (header.mCaps2 != 0 || header.mDepth > 1)
+    {
+        *pError = std::string(pPath) + ": cubemaps and volume textures are not supported";
+        return false;
+    }
+
+    pOut->mWidth = header.mWidth;
+    pOut->mHeight = header.mHeight;
+    const uint32_t mipCount = (header.mFlags & DDSD_MIPMAPCOUNT) && header.mMipMapCount > 0 ? header.mMipMapCount : 1;
+
+    pOut->mLevels.clear();
+    uint32_t width = header.mWidth;
+    uint32_t height = header.mHeight;
+    for (uint32_t level = 0; level < mipCount; ++level)
+    {
+        const size_t size = ddsLevelSize(pOut->mFormat, width, height);
+        if (bytes.size() < offset + size)
+        {
+            *pError = std::string(pPath) + " is truncated";
+            return false;
+        }
+        pOut->mLevels.emplace_back(bytes.begin() + offset, bytes.begin() + offset + size);
+        offset += size;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return true;
+}
+
+bool ddsSave(const char* pPath, const DdsImage& image, std::string* pError) { return ddsSaveArray(pPath, &image, 1, pError); }
+
+bool ddsSaveArray(const char* pPath, const DdsImage* pLayers, uint32_t layerCount, std::string* pError)
+{
+    const DdsImage& image = pLayers[0];
+    DdsHeader       header = {};
+    header.mSize = sizeof(DdsHeader);
+    header.mFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.mHeight = image.mHeight;
+    header.mWidth = image.mWidth;
+    header.mPitchOrLinearSize = (uint32_t)ddsLevelSize(image.mFormat, image.mWidth, image.mHeight);
+    header.mMipMapCount = (uint32_t)image.mLevels.size();
+    header.mPixelFormat.mSize = sizeof(DdsPixelFormat);
+    header.mPixelFormat.mFlags = DDPF_FOURCC;
+    header.mPixelFormat.mFourCC = DDS_FOURCC('D', 'X', '1', '0');
+    header.mCaps = DDSCAPS_TEXTURE | (image.mLevels.size() > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+
+    DdsHeaderDx10 dx10 = {};
+    dx10.mDxgiFormat = image.mFormat;
+    dx10.mResourceDimension = DDS_DIMENSION_TEXTURE2D;
+    dx10.mArraySize = layerCount;
+
+    FILE* file = fopen(pPath, "wb");
+    if (!file)
+    {
+        *pError = std::string("Can't write ") + pPath;
+        return false;
+    }
+
+    bool ok = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file) == 1;
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(&dx10, sizeof(dx10), 1, file) == 1;
+    // Layer after layer, each with its whole mip chain
+    for (uint32_t layer = 0; layer < layerCount; ++layer)
+    {
+        for (const std::vector<uint8_t>& level : pLayers[layer].mLevels)
+            ok = ok && fwrite(level.data(), 1, level.size(), file) == level.size();
+    }
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok)
+        *pError = std::string("Failed writing ") + pPath;
+    return ok;
+}
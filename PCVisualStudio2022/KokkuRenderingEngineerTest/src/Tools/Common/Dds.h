@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// DDS reading/writing for the texture tools. Reads the legacy DXT1/ATI1/ATI2 and 32 bit RGBA headers plus
+// DX10 headers, always writes a DX10 header so the color space travels with the file.
+
+// The DXGI_FORMAT values the tools know about
+enum DxgiFormat
+{
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+    DXGI_FORMAT_BC1_UNORM = 71,
+    DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+    DXGI_FORMAT_BC4_UNORM = 80,
+    DXGI_FORMAT_BC5_UNORM = 83,
+    DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+    DXGI_FORMAT_BC7_UNORM = 98,
+    DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+struct DdsImage
+{
+    DxgiFormat mFormat = DXGI_FORMAT_UNKNOWN;
+    uint32_t   mWidth = 0;
+    uint32_t   mHeight = 0;
+    // One entry per mip level, largest first
+    std::vector<std::vector<uint8_t>> mLevels;
+};
+
+bool ddsLoad(const char* pPath, DdsImage* pOut, std::string* pError);
+bool ddsSave(const char* pPath, const DdsImage& image, std::string* pError);
+// A 2D texture array, every layer with the format, size and mip count of the first
+bool ddsSaveArray(const char* pPath, const DdsImage* pLayers, uint32_t layerCount, std::string* pError);
+
+// 0 for uncompressed formats
+uint32_t ddsBlockSize(DxgiFormat format);
+bool     ddsIsSrgb(DxgiFormat format);
+const char* ddsFormatName(DxgiFormat format);
+
+// Bytes taken by a width x height level of the format
+size_t   ddsLevelSize(DxgiFormat format, uint32_t width, uint32_t height);
+uint32_t ddsMipCount(uint32_t width, uint32_t height);
@@ -0,0 +1,459 @@
+#include "Gltf.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static std::string getDirectory(const char* pPath)
+{
+    const char* slash = strrchr(pPath, '/');
+    const char* backslash = strrchr(pPath, '\\');
+    if (backslash > slash)
+        slash = backslash;
+    return slash ? std::string(pPath, slash + 1) : std::string();
+}
+
+static std::string getFileName(const char* pPath) { return std::string(pPath + getDirectory(pPath).size()); }
+
+static uint32_t getComponentSize(uint32_t componentType)
+{
+    switch (componentType)
+    {
+    case 5120: // BYTE
+    case 5121: // UNSIGNED_BYTE
+        return 1;
+    case 5122: // SHORT
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+static uint32_t getComponentCount(const char* pType)
+{
+    if (strcmp(pType, "VEC2") == 0)
+        return 2;
+    if (strcmp(pType, "VEC3") == 0)
+        return 3;
+    if (strcmp(pType, "VEC4") == 0 || strcmp(pType, "MAT2") == 0)
+        return 4;
+    if (strcmp(pType, "MAT3") == 0)
+        return 9;
+    if (strcmp(pType, "MAT4") == 0)
+        return 16;
+    return 1;
+}
+
+bool gltfLoad(const char* pPath, GltfDocument* pOut, std::string* pError)
+{
+    if (!jsonReadFile(pPath, &pOut->mJson, pError))
+        return false;
+
+    const JsonValue* buffers = pOut->mJson.find("buffers");
+    if (!buffers || buffers->size() != 1)
+    {
+        *pError = "Only glTF files with exactly one buffer are supported";
+        return false;
+    }
+
+    const JsonValue* uri = (*buffers)[0].find("uri");
+    if (!uri || strncmp(uri->asString(), "data:", 5) == 0)
+    {
+        *pError = "The buffer must be an external file";
+        return false;
+    }
+
+    const std::string bufferPath = getDirectory(pPath) + uri->asString();
+    FILE* file = fopen(bufferPath.c_str(), "rb");
+    if (!file)
+    {
+        *pError = "Can't open " + bufferPath;
+        return false;
+    }
+
+    pOut->mBuffer.resize((*buffers)[0].find("byteLength")->asUint());
+    const size_t read = fread(pOut->mBuffer.data(), 1, pOut->mBuffer.size(), file);
+    fclose(file);
+
+    if (read != pOut->mBuffer.size())
+    {
+        *pError = bufferPath + " is shorter than its byteLength";
+        return false;
+    }
+
+    return true;
+}
+
+bool gltfSave(GltfDocument* pDocument, const char* pPath, std::string* pError)
+{
+    std::string bufferName = getFileName(pPath);
+    const size_t dot = bufferName.rfind('.');
+    bufferName = (dot == std::string::npos ? bufferName : bufferName.substr(0, dot)) + ".bin";
+
+    JsonValue& buffer = (*pDocument->mJson.find("buffers"))[0];
+    buffer["uri"] = JsonValue(bufferName);
+    buffer["byteLength"] = JsonValue((uint64_t)pDocument->mBuffer.size());
+
+    const std::string bufferPath = getDirectory(pPath) + bufferName;
+    FILE* file = fopen(bufferPath.c_str(), "wb");
+    if (!file)
+    {
+        *pError = "Can't write " + bufferPath;
+        return false;
+    }
+    const bool written = fwrite(pDocument->mBuffer.data(), 1, pDocument->mBuffer.size(), file) == pDocument->mBuffer.size();
+    if (fclose(file) != 0 || !written)
+    {
+        *pError = "Can't write " + bufferPath;
+        return false;
+    }
+
+    if (!jsonWriteFile(pPath, pDocument->mJson))
+    {
+        *pError = std::string("Can't write ") + pPath;
+        return false;
+    }
+    return true;
+}
+
+bool gltfGetAccessor(GltfDocument* pDocument, uint32_t accessorIndex, GltfAccessor* pOut)
+{
+    const JsonValue* accessors = pDocument->mJson.find("accessors");
+    const JsonValue* bufferViews = pDocument->mJson.find("bufferViews");
+    if (!accessors || !bufferViews || accessorIndex >= accessors->size())
+        return false;
+
+    const JsonValue& accessor = (*accessors)[accessorIndex];
+    const JsonValue* viewIndex = accessor.find("bufferView");
+    // Sparse or zero-filled accessors have no data to edit
+    if (!viewIndex || viewIndex->asUint() >= bufferViews->size())
+        return false;
+
+    const JsonValue& view = (*bufferViews)[viewIndex->asUint()];
+    const JsonValue* viewOffset = view.find("byteOffset");
+    const JsonValue* accessorOffset = accessor.find("byteOffset");
+    const JsonValue* stride = view.find("byteStride");
+    const JsonValue* type = accessor.find("type");
+
+    pOut->mComponentType = accessor.find("componentType")->asUint();
+    pOut->mComponentCount = getComponentCount(type ? type->asString() : "SCALAR");
+    pOut->mElementSize = getComponentSize(pOut->mComponentType) * pOut->mComponentCount;
+    pOut->mStride = stride ? stride->asUint() : pOut->mElementSize;
+    pOut->mCount = accessor.find("count")->asUint();
+
+    const uint64_t offset = (viewOffset ? viewOffset->asUint() : 0) + (accessorOffset ? accessorOffset->asUint() : 0);
+    if (pOut->mCount > 0 && offset + (uint64_t)(pOut->mCount - 1) * pOut->mStride + pOut->mElementSize > pDocument->mBuffer.size())
+        return false;
+
+    pOut->pData = pDocument->mBuffer.data() + offset;
+    return true;
+}
+
+uint32_t gltfAddAccessor(GltfDocument* pDocument, const JsonValue& templateAccessor, const void* pData, uint32_t count,
+                         uint32_t target)
+{
+    const JsonValue* type = templateAccessor.find("type");
+    const uint32_t componentType = templateAccessor.find("componentType")->asUint();
+    const uint32_t componentCount = getComponentCount(type ? type->asString() : "SCALAR");
+    const size_t size = (size_t)count * getComponentSize(componentType) * componentCount;
+
+    // Accessor data has to be aligned to its component size, 4 covers all of them
+    const size_t offset = (pDocument->mBuffer.size() + 3) & ~(size_t)3;
+    pDocument->mBuffer.resize(offset + size);
+    memcpy(pDocument->mBuffer.data() + offset, pData, size);
+
+    JsonValue& bufferViews = pDocument->mJson["bufferViews"];
+    JsonValue view = JsonValue::object();
+    view["buffer"] = JsonValue(0);
+    view["byteOffset"] = JsonValue((uint64_t)offset);
+    view["byteLength"] = JsonValue((uint64_t)size);
+    view["target"] = JsonValue(target);
+    bufferViews.push(view);
+
+    JsonValue accessor = JsonValue::object();
+    accessor["bufferView"] = JsonValue((uint32_t)bufferViews.size() - 1);
+    accessor["componentType"] = JsonValue(componentType);
+    if (const JsonValue* normalized = templateAccessor.find("normalized"))
+        accessor["normalized"] = *normalized;
+    accessor["count"] = JsonValue(count);
+    accessor["type"] = JsonValue(type ? type->asString() : "SCALAR");
+
+    // Required for POSITION, harmless for the other float attributes
+    if (componentType == GLTF_FLOAT && count > 0)
+    {
+        const float* values = (const float*)pData;
+        JsonValue minValues = JsonValue::array();
+        JsonValue maxValues = JsonValue::array();
+        for (uint32_t c = 0; c < componentCount; ++c)
+        {
+            float minValue = values[c];
+            float maxValue = values[c];
+            for (uint32_t i = 1; i < count; ++i)
+            {
+                const float value = values[(size_t)i * componentCount + c];
+                minValue = value < minValue ? value : minValue;
+                maxValue = value > maxValue ? value : maxValue;
+            }
+            minValues.push(JsonValue((double)minValue));
+            maxValues.push(JsonValue((double)maxValue));
+        }
+        accessor["min"] = minValues;
+        accessor["max"] = maxValues;
+    }
+
+    JsonValue& accessors = pDocument->mJson["accessors"];
+    accessors.push(accessor);
+    return (uint32_t)accessors.size() - 1;
+}
+
+// Calls visit on every accessor reference outside the accessors array
+template <typename Visit> static void visitAccessorReferences(JsonValue& json, Visit visit)
+{
+    if (JsonValue* meshes = json.find("meshes"))
+    {
+        for (JsonValue& mesh : meshes->mArray)
+        {
+            JsonValue* primitives = mesh.find("primitives");
+            for (size_t p = 0; primitives && p < primitives->size(); ++p)
+            {
+                JsonValue& primitive = (*primitives)[p];
+                if (JsonValue* indices = primitive.find("indices"))
+                    visit(*indices);
+                if (JsonValue* attributes = primitive.find("attributes"))
+                {
+                    for (auto& attribute : attributes->mObject)
+                        visit(attribute.second);
+                }
+                if (JsonValue* targets = primitive.find("targets"))
+                {
+                    for (JsonValue& target : targets->mArray)
+                    {
+                        for (auto& attribute : target.mObject)
+                            visit(attribute.second);
+                    }
+                }
+            }
+        }
+    }
+    if (JsonValue* skins = json.find("skins"))
+    {
+        for (JsonValue& skin : skins->mArray)
+        {
+            if (JsonValue* matrices = skin.find("inverseBindMatrices"))
+                visit(*matrices);
+        }
+    }
+    if (JsonValue* animations = json.find("animations"))
+    {
+        for (JsonValue& animation : animations->mArray)
+        {
+            JsonValue* samplers = animation.find("samplers");
+            for (size_t s = 0; samplers && s < samplers->size(); ++s)
+            {
+                if (JsonValue* input = (*samplers)[s].find("input"))
+                    visit(*input);
+                if (JsonValue* output = (*samplers)[s].find("output"))
+                    visit(*output);
+            }
+        }
+    }
+}
+
+// Calls visit on every bufferView reference of the accessors and images
+template <typename Visit> static void visitBufferViewReferences(JsonValue& json, Visit visit)
+{
+    if (JsonValue* accessors = json.find("accessors"))
+    {
+        for (JsonValue& accessor : accessors->mArray)
+        {
+            if (JsonValue* view = accessor.find("bufferView"))
+                visit(*view);
+            if (JsonValue* sparse = accessor.find("sparse"))
+            {
+                for (const char* part : { "indices", "values" })
+                {
+                    JsonValue* sparsePart = sparse->find(part);
+                    if (JsonValue* view = sparsePart ? sparsePart->find("bufferView") : NULL)
+                        visit(*view);
+                }
+            }
+        }
+    }
+    if (JsonValue* images = json.find("images"))
+    {
+        for (JsonValue& image : images->mArray)
+        {
+            if (JsonValue* view = image.find("bufferView"))
+                visit(*view);
+        }
+    }
+}
+
+size_t gltfRemoveUnused(GltfDocument* pDocument)
+{
+    JsonValue& json = pDocument->mJson;
+    JsonValue* accessors = json.find("accessors");
+    JsonValue* bufferViews = json.find("bufferViews");
+    if (!accessors || !bufferViews)
+        return 0;
+
+    // Old index to new one, ~0u for dropped entries
+    std::vector<uint32_t> accessorRemap(accessors->size(), ~0u);
+    visitAccessorReferences(json, [&](JsonValue& reference) {
+        if (reference.asUint() < accessorRemap.size())
+            accessorRemap[reference.asUint()] = 0;
+    });
+    JsonValue keptAccessors = JsonValue::array();
+    for (size_t a = 0; a < accessorRemap.size(); ++a)
+    {
+        if (accessorRemap[a] == ~0u)
+            continue;
+        accessorRemap[a] = (uint32_t)keptAccessors.size();
+        keptAccessors.push((*accessors)[a]);
+    }
+    *accessors = keptAccessors;
+    visitAccessorReferences(json, [&](JsonValue& reference) { reference = JsonValue(accessorRemap[reference.asUint()]); });
+
+    std::vector<uint32_t> viewRemap(bufferViews->size(), ~0u);
+    visitBufferViewReferences(json, [&](JsonValue& reference) {
+        if (reference.asUint() < viewRemap.size())
+            viewRemap[reference.asUint()] = 0;
+    });
+
+    // The kept views in their old order, each at the next 4 byte boundary like gltfAddAccessor places them
+    std::vector<uint8_t> buffer;
+    JsonValue            keptViews = JsonValue::array();
+    for (size_t v = 0; v < viewRemap.size(); ++v)
+    {
+        if (viewRemap[v] == ~0u)
+            continue;
+        JsonValue       view = (*bufferViews)[v];
+        const JsonValue* offsetValue = view.find("byteOffset");
+        const uint64_t   offset = offsetValue ? (uint64_t)offsetValue->asNumber() : 0;
+        const uint64_t   length = (uint64_t)view.find("byteLength")->asNumber();
+        const size_t     newOffset = (buffer.size() + 3) & ~(size_t)3;
+        buffer.resize(newOffset + length);
+        if (length > 0 && offset + length <= pDocument->mBuffer.size())
+            memcpy(buffer.data() + newOffset, pDocument->mBuffer.data() + offset, length);
+        view["byteOffset"] = JsonValue((uint64_t)newOffset);
+
+        viewRemap[v] = (uint32_t)keptViews.size();
+        keptViews.push(view);
+    }
+    *bufferViews = keptViews;
+    visitBufferViewReferences(json, [&](JsonValue& reference) { reference = JsonValue(viewRemap[reference.asUint()]); });
+
+    const size_t removed = pDocument->mBuffer.size() > buffer.size() ? pDocument->mBuffer.size() - buffer.size() : 0;
+    pDocument->mBuffer.swap(buffer);
+    (*json.find("buffers"))[0]["byteLength"] = JsonValue((uint64_t)pDocument->mBuffer.size());
+    return removed;
+}
+
+std::vector<GltfPrimitive> gltfGetPrimitives(const GltfDocument& document)
+{
+    std::vector<GltfPrimitive> primitives;
+
+    const JsonValue* meshes = document.mJson.find("meshes");
+    if (!meshes)
+        return primitives;
+
+    for (uint32_t m = 0; m < meshes->size(); ++m)
+    {
+        const JsonValue& mesh = (*meshes)[m];
+        const JsonValue* meshPrimitives = mesh.find("primitives");
+        const JsonValue* name = mesh.find("name");
+        for (uint32_t p = 0; meshPrimitives && p < meshPrimitives->size(); ++p)
+        {
+            const JsonValue& primitive = (*meshPrimitives)[p];
+            // 4 = TRIANGLES, the default
+            const JsonValue* mode = primitive.find("mode");
+            if (mode && mode->asUint() != 4)
+                continue;
+
+            GltfPrimitive out;
+            out.mMeshName = name ? name->asString() : "";
+            out.mMeshIndex = m;
+            out.mPrimitiveIndex = p;
+            const JsonValue* indices = primitive.find("indices");
+            out.mIndicesAccessor = indices ? (int32_t)indices->asUint() : -1;
+            out.mPositionAccessor = -1;
+            const JsonValue* material = primitive.find("material");
+            out.mMaterial = material ? (int32_t)material->asUint() : -1;
+
+            const JsonValue* attributes = primitive.find("attributes");
+            for (size_t a = 0; attributes && a < attributes->mObject.size(); ++a)
+            {
+                GltfAttribute attribute = { attributes->mObject[a].first, attributes->mObject[a].second.asUint() };
+                if (attribute.mSemantic == "POSITION")
+                    out.mPositionAccessor = (int32_t)attribute.mAccessor;
+                out.mAttributes.push_back(attribute);
+            }
+
+            primitives.push_back(out);
+        }
+    }
+
+    return primitives;
+}
+
+void gltfReadIndices(const GltfAccessor& accessor, std::vector<uint32_t>* pOut)
+{
+    pOut->resize(accessor.mCount);
+    for (uint32_t i = 0; i < accessor.mCount; ++i)
+    {
+        const uint8_t* element = accessor.pData + (size_t)i * accessor.mStride;
+        if (accessor.mComponentType == GLTF_UNSIGNED_INT)
+        {
+            uint32_t value;
+            memcpy(&value, element, sizeof(value));
+            (*pOut)[i] = value;
+        }
+        else if (accessor.mComponentType == GLTF_UNSIGNED_SHORT)
+        {
+            uint16_t value;
+            memcpy(&value, element, sizeof(value));
+            (*pOut)[i] = value;
+        }
+        else
+        {
+            (*pOut)[i] = *element;
+        }
+    }
+}
+
+void gltfWriteIndices(const GltfAccessor& accessor, const std::vector<uint32_t>& indices)
+{
+    for (uint32_t i = 0; i < accessor.mCount && i < indices.size(); ++i)
+    {
+        uint8_t* element = accessor.pData + (size_t)i * accessor.mStride;
+        if (accessor.mComponentType == GLTF_UNSIGNED_INT)
+        {
+            const uint32_t value = indices[i];
+            memcpy(element, &value, sizeof(value));
+        }
+        else if (accessor.mComponentType == GLTF_UNSIGNED_SHORT)
+        {
+            const uint16_t value = (uint16_t)indices[i];
+            memcpy(element, &value, sizeof(value));
+        }
+        else
+        {
+            *element = (uint8_t)indices[i];
+        }
+    }
+}
+
+void gltfReadPositions(const GltfAccessor& accessor, std::vector<float>* pOut)
+{
+    pOut->resize((size_t)accessor.mCount * 3);
+    for (uint32_t i = 0; i < accessor.mCount; ++i)
+        memcpy(&(*pOut)[(size_t)i * 3], accessor.pData + (size_t)i * accessor.mStride, sizeof(float) * 3);
+}
+
+void gltfReadFloats(const GltfAccessor& accessor, std::vector<float>* pOut)
+{
+    const size_t count = accessor.mComponentCount;
+    pOut->resize((size_t)accessor.mCount * count);
+    for (uint32_t i = 0; i < accessor.mCount; ++i)
+        memcpy(&(*pOut)[(size_t)i * count], accessor.pData + (size_t)i * accessor.mStride, sizeof(float) * count);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Json.h"
+
+// Minimal glTF 2.0 access for the offline tools: the JSON document plus its single external buffer,
+// which is what FBX2glTF writes for castle.gltf. Accessors are edited in place and saved back.
+
+static const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+static const uint32_t GLTF_UNSIGNED_INT = 5125;
+static const uint32_t GLTF_FLOAT = 5126;
+// bufferView targets
+static const uint32_t GLTF_ARRAY_BUFFER = 34962;
+static const uint32_t GLTF_ELEMENT_ARRAY_BUFFER = 34963;
+
+struct GltfDocument
+{
+    JsonValue mJson;
+    std::vector<uint8_t> mBuffer;
+};
+
+// View of an accessor's elements inside GltfDocument::mBuffer
+struct GltfAccessor
+{
+    uint8_t* pData;
+    uint32_t mCount;
+    // Distance between elements, the bufferView byteStride or the packed element size
+    uint32_t mStride;
+    uint32_t mElementSize;
+    uint32_t mComponentType;
+    uint32_t mComponentCount;
+};
+
+struct GltfAttribute
+{
+    std::string mSemantic;
+    uint32_t mAccessor;
+};
+
+struct GltfPrimitive
+{
+    std::string mMeshName;
+    uint32_t mMeshIndex;
+    uint32_t mPrimitiveIndex;
+    // -1 for non-indexed primitives
+    int32_t mIndicesAccessor;
+    int32_t mPositionAccessor;
+    // -1 without a material
+    int32_t mMaterial;
+    std::vector<GltfAttribute> mAttributes;
+};
+
+bool gltfLoad(const char* pPath, GltfDocument* pOut, std::string* pError);
+
+// Writes pPath and its buffer as <pPath stem>.bin next to it, updating the buffer uri and byteLength
+bool gltfSave(GltfDocument* pDocument, const char* pPath, std::string* pError);
+
+bool gltfGetAccessor(GltfDocument* pDocument, uint32_t accessorIndex, GltfAccessor* pOut);
+
+// Appends count tightly packed elements to the buffer as a new bufferView and accessor with the componentType, type
+// and normalized flag of templateAccessor. Float accessors get their min/max. Returns the new accessor index.
+// The buffer may move, so GltfAccessor views taken before are invalid afterwards.
+uint32_t gltfAddAccessor(GltfDocument* pDocument, const JsonValue& templateAccessor, const void* pData, uint32_t count,
+                         uint32_t target);
+
+// Drops the accessors nothing refers to any more (meshes, skins, animations) and the bufferViews only they used,
+// then repacks the buffer and renumbers the references. Returns the number of bytes the buffer shrank by.
+size_t gltfRemoveUnused(GltfDocument* pDocument);
+
+// Triangle list primitives of all meshes, in mesh order
+std::vector<GltfPrimitive> gltfGetPrimitives(const GltfDocument& document);
+
+void gltfReadIndices(const GltfAccessor& accessor, std::vector<uint32_t>* pOut);
+void gltfWriteIndices(const GltfAccessor& accessor, const std::vector<uint32_t>& indices);
+
+// Float positions as tightly packed float3
+void gltfReadPositions(const GltfAccessor& accessor, std::vector<float>* pOut);
+
+// Any float accessor, mComponentCount tightly packed floats per element
+void gltfReadFloats(const GltfAccessor& accessor, std::vector<float>* pOut);
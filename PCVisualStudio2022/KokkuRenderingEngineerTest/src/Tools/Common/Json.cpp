@@ -0,0 +1,461 @@
+#include "Json.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const JsonValue* JsonValue::find(const char* key) const
+{
+    if (mType != JSON_OBJECT)
+        return NULL;
+
+    for (const std::pair<std::string, JsonValue>& member : mObject)
+    {
+        if (member.first == key)
+            return &member.second;
+    }
+    return NULL;
+}
+
+JsonValue* JsonValue::find(const char* key) { return const_cast<JsonValue*>(static_cast<const JsonValue*>(this)->find(key)); }
+
+JsonValue& JsonValue::operator[](const std::string& key)
+{
+    if (mType == JSON_NULL)
+        mType = JSON_OBJECT;
+
+    JsonValue* existing = find(key.c_str());
+    if (existing)
+        return *existing;
+
+    mObject.emplace_back(key, JsonValue());
+    return mObject.back().second;
+}
+
+struct JsonParser
+{
+    const char* pBegin;
+    const char* pCursor;
+    const char* pEnd;
+    std::string mError;
+
+    bool fail(const char* pMessage)
+    {
+        if (mError.empty())
+        {
+            char buffer[128];
+            snprintf(buffer, sizeof(buffer), "%s at byte %zu", pMessage, (size_t)(pCursor - pBegin));
+            mError = buffer;
+        }
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (pCursor < pEnd && (*pCursor == ' ' || *pCursor == '\t' || *pCursor == '\n' || *pCursor == '\r'))
+            ++pCursor;
+    }
+
+    bool match(const char* pLiteral)
+    {
+        const size_t len = strlen(pLiteral);
+        if ((size_t)(pEnd - pCursor) < len || strncmp(pCursor, pLiteral, len) != 0)
+            return false;
+        pCursor += len;
+        return true;
+    }
+
+    static void appendUtf8(std::string* pOut, uint32_t codepoint)
+    {
+        if (codepoint < 0x80)
+        {
+            pOut->push_back((char)codepoint);
+        }
+        else if (codepoint < 0x800)
+        {
+            pOut->push_back((char)(0xC0 | (codepoint >> 6)));
+            pOut->push_back((char)(0x80 | (codepoint & 0x3F)));
+        }
+        else if (codepoint < 0x10000)
+        {
+            pOut->push_back((char)(0xE0 | (codepoint >> 12)));
+            pOut->push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+            pOut->push_back((char)(0x80 | (codepoint & 0x3F)));
+        }
+        else
+        {
+            pOut->push_back((char)(0xF0 | (codepoint >> 18)));
+            pOut->push_back((char)(0x80 | ((codepoint >> 12) & 0x3F)));
+            pOut->push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+            pOut->push_back((char)(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    bool parseHex4(uint32_t* pOut)
+    {
+        if (pEnd - pCursor < 4)
+            return fail("Truncated unicode escape");
+
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const char c = *pCursor++;
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                value |= (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                value |= (uint32_t)(c - 'A' + 10);
+            else
+                return fail("Bad unicode escape");
+        }
+        *pOut = value;
+        return true;
+    }
+
+    bool parseString(std::string* pOut)
+    {
+        ++pCursor; // opening quote
+        while (pCursor < pEnd && *pCursor != '"')
+        {
+            const char c = *pCursor++;
+            if (c != '\\')
+            {
+                pOut->push_back(c);
+                continue;
+            }
+
+            if (pCursor >= pEnd)
+                return fail("Truncated escape");
+
+            const char escape = *pCursor++;
+            switch (escape)
+            {
+            case '"': pOut->push_back('"'); break;
+            case '\\': pOut->push_back('\\'); break;
+            case '/': pOut->push_back('/'); break;
+            case 'b': pOut->push_back('\b'); break;
+            case 'f': pOut->push_back('\f'); break;
+            case 'n': pOut->push_back('\n'); break;
+            case 'r': pOut->push_back('\r'); break;
+            case 't': pOut->push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t codepoint = 0;
+                if (!parseHex4(&codepoint))
+                    return false;
+                // Surrogate pair
+                if (codepoint >= 0xD800 && codepoint < 0xDC00 && match("\\u"))
+                {
+                    uint32_t low = 0;
+                    if (!parseHex4(&low))
+                        return false;
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(pOut, codepoint);
+                break;
+            }
+            default: return fail("Unknown escape");
+            }
+        }
+
+        if (pCursor >= pEnd)
+            return fail("Unterminated string");
+        ++pCursor; // closing quote
+        return true;
+    }
+
+    bool parseValue(JsonValue* pOut, int depth)
+    {
+        if (depth > 256)
+            return fail("Nesting too deep");
+
+        skipWhitespace();
+        if (pCursor >= pEnd)
+            return fail("Unexpected end of input");
+
+        const char c = *pCursor;
+        if (c == '{')
+        {
+            ++pCursor;
+            pOut->mType = JSON_OBJECT;
+            skipWhitespace();
+            if (pCursor < pEnd && *pCursor == '}')
+            {
+                ++pCursor;
+                return true;
+            }
+
+            for (;;)
+            {
+                skipWhitespace();
+                if (pCursor >= pEnd || *pCursor != '"')
+                    return fail("Expected object key");
+
+                std::string key;
+                if (!parseString(&key))
+                    return false;
+
+                skipWhitespace();
+                if (pCursor >= pEnd || *pCursor != ':')
+                    return fail("Expected ':'");
+                ++pCursor;
+
+                pOut->mObject.emplace_back(key, JsonValue());
+                if (!parseValue(&pOut->mObject.back().second, depth + 1))
+                    return false;
+
+                skipWhitespace();
+                if (pCursor < pEnd && *pCursor == ',')
+                {
+                    ++pCursor;
+                    continue;
+                }
+                if (pCursor < pEnd && *pCursor == '}')
+                {
+                    ++pCursor;
+                    return true;
+                }
+                return fail("Expected ',' or '}'");
+            }
+        }
+
+        if (c == '[')
+        {
+            ++pCursor;
+            pOut->mType = JSON_ARRAY;
+            skipWhitespace();
+            if (pCursor < pEnd && *pCursor == ']')
+            {
+                ++pCursor;
+                return true;
+            }
+
+            for (;;)
+            {
+                pOut->mArray.emplace_back();
+                if (!parseValue(&pOut->mArray.back(), depth + 1))
+                    return false;
+
+                skipWhitespace();
+                if (pCursor < pEnd && *pCursor == ',')
+                {
+                    ++pCursor;
+                    continue;
+                }
+                if (pCursor < pEnd && *pCursor == ']')
+                {
+                    ++pCursor;
+                    return true;
+                }
+                return fail("Expected ',' or ']'");
+            }
+        }
+
+        if (c == '"')
+        {
+            pOut->mType = JSON_STRING;
+            return parseString(&pOut->mString);
+        }
+
+        if (match("true"))
+        {
+            *pOut = JsonValue(true);
+            return true;
+        }
+        if (match("false"))
+        {
+            *pOut = JsonValue(false);
+            return true;
+        }
+        if (match("null"))
+        {
+            *pOut = JsonValue();
+            return true;
+        }
+
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            // strtod needs a terminated string, the token is copied to keep it from running past pEnd
+            char token[64];
+            size_t len = 0;
+            while (pCursor + len < pEnd && len < sizeof(token) - 1 && strchr("+-0123456789.eE", pCursor[len]))
+            {
+                token[len] = pCursor[len];
+                ++len;
+            }
+            token[len] = '\0';
+
+            char* tokenEnd = NULL;
+            const double value = strtod(token, &tokenEnd);
+            if (tokenEnd == token)
+                return fail("Bad number");
+
+            pCursor += tokenEnd - token;
+            *pOut = JsonValue(value);
+            return true;
+        }
+
+        return fail("Unexpected character");
+    }
+};
+
+bool jsonParse(const std::string& text, JsonValue* pOut, std::string* pError)
+{
+    JsonParser parser;
+    parser.pBegin = text.data();
+    parser.pCursor = text.data();
+    parser.pEnd = text.data() + text.size();
+
+    *pOut = JsonValue();
+    bool ok = parser.parseValue(pOut, 0);
+    if (ok)
+    {
+        parser.skipWhitespace();
+        if (parser.pCursor != parser.pEnd)
+            ok = parser.fail("Trailing characters");
+    }
+
+    if (!ok && pError)
+        *pError = parser.mError;
+    return ok;
+}
+
+static void writeNumber(std::string* pOut, double value)
+{
+    if (!isfinite(value))
+    {
+        // JSON has no inf/nan
+        pOut->append("null");
+        return;
+    }
+
+    char buffer[32];
+    if (value == floor(value) && fabs(value) < 1e15)
+    {
+        snprintf(buffer, sizeof(buffer), "%.0f", value);
+    }
+    else
+    {
+        // Shortest of the round-tripping precisions, so values read from a file are written back unchanged
+        snprintf(buffer, sizeof(buffer), "%.15g", value);
+        if (strtod(buffer, NULL) != value)
+            snprintf(buffer, sizeof(buffer), "%.17g", value);
+    }
+    pOut->append(buffer);
+}
+
+static void writeString(std::string* pOut, const std::string& value)
+{
+    pOut->push_back('"');
+    for (const char c : value)
+    {
+        switch (c)
+        {
+        case '"': pOut->append("\\\""); break;
+        case '\\': pOut->append("\\\\"); break;
+        case '\n': pOut->append("\\n"); break;
+        case '\r': pOut->append("\\r"); break;
+        case '\t': pOut->append("\\t"); break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned)c);
+                pOut->append(buffer);
+            }
+            else
+            {
+                pOut->push_back(c);
+            }
+        }
+    }
+    pOut->push_back('"');
+}
+
+static void writeValue(std::string* pOut, const JsonValue& value, int indent, int depth)
+{
+    const bool pretty = indent >= 0;
+    const auto newline = [&](int level) {
+        if (!pretty)
+            return;
+        pOut->push_back('\n');
+        pOut->append((size_t)(level * indent), ' ');
+    };
+
+    switch (value.mType)
+    {
+    case JSON_NULL: pOut->append("null"); break;
+    case JSON_BOOL: pOut->append(value.mBool ? "true" : "false"); break;
+    case JSON_NUMBER: writeNumber(pOut, value.mNumber); break;
+    case JSON_STRING: writeString(pOut, value.mString); break;
+    case JSON_ARRAY:
+        pOut->push_back('[');
+        for (size_t i = 0; i < value.mArray.size(); ++i)
+        {
+            if (i > 0)
+                pOut->push_back(',');
+            newline(depth + 1);
+            writeValue(pOut, value.mArray[i], indent, depth + 1);
+        }
+        if (!value.mArray.empty())
+            newline(depth);
+        pOut->push_back(']');
+        break;
+    case JSON_OBJECT:
+        pOut->push_back('{');
+        for (size_t i = 0; i < value.mObject.size(); ++i)
+        {
+            if (i > 0)
+                pOut->push_back(',');
+            newline(depth + 1);
+            writeString(pOut, value.mObject[i].first);
+            pOut->append(pretty ? ": " : ":");
+            writeValue(pOut, value.mObject[i].second, indent, depth + 1);
+        }
+        if (!value.mObject.empty())
+            newline(depth);
+        pOut->push_back('}');
+        break;
+    }
+}
+
+std::string jsonWrite(const JsonValue& value, int indent)
+{
+    std::string out;
+    writeValue(&out, value, indent, 0);
+    return out;
+}
+
+bool jsonReadFile(const char* pPath, JsonValue* pOut, std::string* pError)
+{
+    FILE* file = fopen(pPath, "rb");
+    if (!file)
+    {
+        if (pError)
+            *pError = std::string("Can't open ") + pPath;
+        return false;
+    }
+
+    std::string text;
+    char buffer[65536];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, read);
+    fclose(file);
+
+    return jsonParse(text, pOut, pError);
+}
+
+bool jsonWriteFile(const char* pPath, const JsonValue& value, int indent)
+{
+    FILE* file = fopen(pPath, "wb");
+    if (!file)
+        return false;
+
+    const std::string text = jsonWrite(value, indent) + "\n";
+    const bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Small JSON DOM used by the offline tools (glTF, cooked metadata, metrics).
+// Objects keep their key order so rewritten files diff cleanly against the originals.
+
+enum JsonType
+{
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+struct JsonValue
+{
+    JsonType mType = JSON_NULL;
+    bool mBool = false;
+    double mNumber = 0.0;
+    std::string mString;
+    std::vector<JsonValue> mArray;
+    std::vector<std::pair<std::string, JsonValue>> mObject;
+
+    JsonValue() {}
+    JsonValue(bool value) : mType(JSON_BOOL), mBool(value) {}
+    JsonValue(double value) : mType(JSON_NUMBER), mNumber(value) {}
+    JsonValue(int value) : mType(JSON_NUMBER), mNumber(value) {}
+    JsonValue(uint32_t value) : mType(JSON_NUMBER), mNumber(value) {}
+    JsonValue(uint64_t value) : mType(JSON_NUMBER), mNumber((double)value) {}
+    JsonValue(const char* value) : mType(JSON_STRING), mString(value) {}
+    JsonValue(const std::string& value) : mType(JSON_STRING), mString(value) {}
+
+    static JsonValue array() { JsonValue v; v.mType = JSON_ARRAY; return v; }
+    static JsonValue object() { JsonValue v; v.mType = JSON_OBJECT; return v; }
+
+    // NULL when the key is missing or this is not an object
+    const JsonValue* find(const char* key) const;
+    JsonValue* find(const char* key);
+
+    // Adds the key when missing, turning a null value into an object
+    JsonValue& operator[](const std::string& key);
+
+    size_t size() const { return mType == JSON_ARRAY ? mArray.size() : mObject.size(); }
+    const JsonValue& operator[](size_t index) const { return mArray[index]; }
+    JsonValue& operator[](size_t index) { return mArray[index]; }
+    void push(const JsonValue& value) { mType = JSON_ARRAY; mArray.push_back(value); }
+
+    double asNumber(double fallback = 0.0) const { return mType == JSON_NUMBER ? mNumber : fallback; }
+    uint32_t asUint(uint32_t fallback = 0) const { return mType == JSON_NUMBER ? (uint32_t)mNumber : fallback; }
+    const char* asString(const char* fallback = "") const { return mType == JSON_STRING ? mString.c_str() : fallback; }
+};
+
+// Returns false and fills pError (with the byte offset) on malformed input
+bool jsonParse(const std::string& text, JsonValue* pOut, std::string* pError);
+
+// indent < 0 writes everything on a single line
+std::string jsonWrite(const JsonValue& value, int indent = 2);
+
+bool jsonReadFile(const char* pPath, JsonValue* pOut, std::string* pError);
+bool jsonWriteFile(const char* pPath, const JsonValue& value, int indent = 2);
@@ -0,0 +1,469 @@
+#include "MeshOptimizer.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+VertexCacheStats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats = {};
+
+    // A vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> loadTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t v = pIndices[i];
+        if (time - loadTime[v] > cacheSize)
+        {
+            loadTime[v] = time++;
+            ++stats.mCacheMisses;
+        }
+    }
+
+    std::vector<bool> used(vertexCount, false);
+    size_t uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (!used[pIndices[i]])
+        {
+            used[pIndices[i]] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.mAcmr = indexCount ? (float)stats.mCacheMisses / (float)(indexCount / 3) : 0.0f;
+    stats.mAtvr = uniqueVertices ? (float)stats.mCacheMisses / (float)uniqueVertices : 0.0f;
+    return stats;
+}
+
+static const int OVERDRAW_GRID_SIZE = 256;
+
+static void rasterizeTriangle(float* pDepth, const float* a, const float* b, const float* c, uint64_t* pShaded)
+{
+    // Counter-clockwise triangles in (u, v) face the viewer, the rest is backface culled
+    const float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    if (area <= 0.0f)
+        return;
+
+    const int minX = std::max(0, (int)floorf(std::min(a[0], std::min(b[0], c[0]))));
+    const int maxX = std::min(OVERDRAW_GRID_SIZE - 1, (int)ceilf(std::max(a[0], std::max(b[0], c[0]))));
+    const int minY = std::max(0, (int)floorf(std::min(a[1], std::min(b[1], c[1]))));
+    const int maxY = std::min(OVERDRAW_GRID_SIZE - 1, (int)ceilf(std::max(a[1], std::max(b[1], c[1]))));
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            const float px = x + 0.5f;
+            const float py = y + 0.5f;
+            const float w0 = (c[0] - b[0]) * (py - b[1]) - (c[1] - b[1]) * (px - b[0]);
+            const float w1 = (a[0] - c[0]) * (py - c[1]) - (a[1] - c[1]) * (px - c[0]);
+            const float w2 = (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                continue;
+
+            const float depth = (w0 * a[2] + w1 * b[2] + w2 * c[2]) / area;
+            float&      stored = pDepth[y * OVERDRAW_GRID_SIZE + x];
+            if (depth < stored)
+            {
+                stored = depth;
+                ++*pShaded;
+            }
+        }
+    }
+}
+
+OverdrawStats analyzeOverdraw(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t vertexCount)
+{
+    OverdrawStats stats = {};
+
+    float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            minP[k] = std::min(minP[k], pPositions[i * 3 + k]);
+            maxP[k] = std::max(maxP[k], pPositions[i * 3 + k]);
+        }
+    }
+    const float extent = std::max(maxP[0] - minP[0], std::max(maxP[1] - minP[1], maxP[2] - minP[2]));
+    const float scale = extent > 0.0f ? (OVERDRAW_GRID_SIZE - 1) / extent : 0.0f;
+
+    std::vector<float> depth(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE);
+    std::vector<float> projected(vertexCount * 3);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (int side = 0; side < 2; ++side)
+        {
+            // Looking down -axis (side 0) or +axis (side 1); swapping u and v keeps the view basis right handed
+            const int u = side == 0 ? (axis + 1) % 3 : (axis + 2) % 3;
+            const int v = side == 0 ? (axis + 2) % 3 : (axis + 1) % 3;
+            const float depthSign = side == 0 ? -1.0f : 1.0f;
+            for (size_t i = 0; i < vertexCount; ++i)
+            {
+                const float* p = &pPositions[i * 3];
+                projected[i * 3 + 0] = (p[u] - minP[u]) * scale;
+                projected[i * 3 + 1] = (p[v] - minP[v]) * scale;
+                projected[i * 3 + 2] = depthSign * (p[axis] - minP[axis]) * scale;
+            }
+
+            std::fill(depth.begin(), depth.end(), FLT_MAX);
+            for (size_t t = 0; t + 2 < indexCount; t += 3)
+            {
+                rasterizeTriangle(depth.data(), &projected[pIndices[t + 0] * 3], &projected[pIndices[t + 1] * 3],
+                                  &projected[pIndices[t + 2] * 3], &stats.mPixelsShaded);
+            }
+
+            for (const float d : depth)
+                stats.mPixelsCovered += d != FLT_MAX ? 1 : 0;
+        }
+    }
+
+    stats.mOverdraw = stats.mPixelsCovered ? (float)stats.mPixelsShaded / (float)stats.mPixelsCovered : 0.0f;
+    return stats;
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation"
+static const int   FORSYTH_CACHE_SIZE = 32;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static float forsythVertexScore(int cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    return score + FORSYTH_VALENCE_BOOST_SCALE * powf((float)liveTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+void optimizeVertexCache(uint32_t* pDst, const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+
+    // Triangles adjacent to each vertex, compacted as triangles get emitted
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++liveTriangles[pIndices[i]];
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[pIndices[t * 3 + k]]++] = (uint32_t)t;
+    }
+
+    std::vector<int>   cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vertexScore[v] = forsythVertexScore(-1, liveTriangles[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool>  emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScore[t] = vertexScore[pIndices[t * 3 + 0]] + vertexScore[pIndices[t * 3 + 1]] + vertexScore[pIndices[t * 3 + 2]];
+    }
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cacheCount = 0;
+    size_t   inputCursor = 0;
+    size_t   outputCount = 0;
+
+    int64_t bestTriangle = -1;
+    float   bestScore = -FLT_MAX;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (triangleScore[t] > bestScore)
+        {
+            bestScore = triangleScore[t];
+            bestTriangle = (int64_t)t;
+        }
+    }
+
+    while (bestTriangle >= 0)
+    {
+        const uint32_t* tri = &pIndices[bestTriangle * 3];
+        emitted[(size_t)bestTriangle] = true;
+        pDst[outputCount++] = tri[0];
+        pDst[outputCount++] = tri[1];
+        pDst[outputCount++] = tri[2];
+
+        // New cache: the triangle's vertices first, then the old entries that are not part of it
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCount = 0;
+        for (int k = 0; k < 3; ++k)
+            newCache[newCount++] = tri[k];
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            const uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCount++] = v;
+        }
+
+        // Remove the triangle from its vertices' adjacency
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = tri[k];
+            uint32_t*      begin = &adjacency[adjacencyOffsets[v]];
+            for (uint32_t i = 0; i < liveTriangles[v]; ++i)
+            {
+                if (begin[i] == (uint32_t)bestTriangle)
+                {
+                    begin[i] = begin[liveTriangles[v] - 1];
+                    --liveTriangles[v];
+                    break;
+                }
+            }
+        }
+
+        // Entries pushed past the cache size fall out
+        for (uint32_t i = 0; i < newCount; ++i)
+            cachePosition[newCache[i]] = i < (uint32_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+
+        // Rescore everything that was or is in the cache and pick the best triangle touching it
+        bestTriangle = -1;
+        bestScore = -FLT_MAX;
+        for (uint32_t i = 0; i < newCount; ++i)
+        {
+            const uint32_t v = newCache[i];
+            const float    newScore = forsythVertexScore(cachePosition[v], liveTriangles[v]);
+            const float    delta = newScore - vertexScore[v];
+            vertexScore[v] = newScore;
+
+            const uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; ++j)
+            {
+                const uint32_t t = begin[j];
+                triangleScore[t] += delta;
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = newCount < (uint32_t)FORSYTH_CACHE_SIZE ? newCount : (uint32_t)FORSYTH_CACHE_SIZE;
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        // Nothing left around the cache, continue with the next triangle in input order
+        if (bestTriangle < 0)
+        {
+            while (inputCursor < triangleCount && emitted[inputCursor])
+                ++inputCursor;
+            if (inputCursor < triangleCount)
+                bestTriangle = (int64_t)inputCursor;
+        }
+    }
+}
+
+// Misses of a triangle in a FIFO cache, see analyzeVertexCache
+static uint32_t simulateTriangle(const uint32_t* tri, std::vector<uint32_t>& loadTime, uint32_t* pTime, uint32_t cacheSize)
+{
+    uint32_t misses = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (*pTime - loadTime[tri[k]] > cacheSize)
+        {
+            loadTime[tri[k]] = (*pTime)++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+void optimizeOverdraw(uint32_t* pDst, const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t vertexCount,
+                      float threshold)
+{
+    const uint32_t cacheSize = 16;
+    const size_t   triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Hard boundaries: triangles where the cache restarts (all three vertices miss), moving
+    // the clusters between them around doesn't change the cache behaviour
+    std::vector<size_t> hardBoundaries;
+    {
+        std::vector<uint32_t> loadTime(vertexCount, 0);
+        uint32_t              time = cacheSize + 1;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            if (simulateTriangle(&pIndices[t * 3], loadTime, &time, cacheSize) == 3 || t == 0)
+                hardBoundaries.push_back(t);
+        }
+        hardBoundaries.push_back(triangleCount);
+    }
+
+    // Soft boundaries: split hard clusters further as long as every piece stays within threshold of the cluster's ACMR
+    std::vector<size_t> clusters;
+    {
+        std::vector<uint32_t> loadTime(vertexCount, 0);
+        uint32_t              time = cacheSize + 1;
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+        {
+            const size_t begin = hardBoundaries[h];
+            const size_t end = hardBoundaries[h + 1];
+
+            time += cacheSize + 1;
+            uint32_t clusterMisses = 0;
+            for (size_t t = begin; t < end; ++t)
+                clusterMisses += simulateTriangle(&pIndices[t * 3], loadTime, &time, cacheSize);
+            const float clusterThreshold = threshold * (float)clusterMisses / (float)(end - begin);
+
+            size_t start = begin;
+            while (start < end)
+            {
+                clusters.push_back(start);
+
+                time += cacheSize + 1;
+                uint32_t misses = 0;
+                size_t   split = end;
+                for (size_t t = start; t < end; ++t)
+                {
+                    misses += simulateTriangle(&pIndices[t * 3], loadTime, &time, cacheSize);
+                    if ((float)misses / (float)(t - start + 1) <= clusterThreshold)
+                    {
+                        split = t + 1;
+                        break;
+                    }
+                }
+                start = split;
+            }
+        }
+        clusters.push_back(triangleCount);
+    }
+
+    // Area weighted centroid of the whole mesh
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+
+    struct Cluster
+    {
+        size_t mBegin;
+        size_t mEnd;
+        float  mSortKey;
+    };
+    std::vector<Cluster> sorted(clusters.size() - 1);
+    std::vector<float>   clusterCentroid(sorted.size() * 3);
+    std::vector<float>   clusterNormal(sorted.size() * 3);
+
+    for (size_t c = 0; c < sorted.size(); ++c)
+    {
+        double centroid[3] = { 0.0, 0.0, 0.0 };
+        double normal[3] = { 0.0, 0.0, 0.0 };
+        double area = 0.0;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const float* a = &pPositions[pIndices[t * 3 + 0] * 3];
+            const float* b = &pPositions[pIndices[t * 3 + 1] * 3];
+            const float* p = &pPositions[pIndices[t * 3 + 2] * 3];
+            const float  e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float  e1[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+            const float  n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            const double triangleArea = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                centroid[k] += triangleArea * (a[k] + b[k] + p[k]) / 3.0;
+                normal[k] += n[k];
+            }
+            area += triangleArea;
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            meshCentroid[k] += centroid[k];
+            clusterCentroid[c * 3 + k] = area > 0.0 ? (float)(centroid[k] / area) : 0.0f;
+        }
+        meshArea += area;
+
+        const double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int k = 0; k < 3; ++k)
+            clusterNormal[c * 3 + k] = length > 0.0 ? (float)(normal[k] / length) : 0.0f;
+
+        sorted[c].mBegin = clusters[c];
+        sorted[c].mEnd = clusters[c + 1];
+    }
+
+    for (int k = 0; k < 3; ++k)
+        meshCentroid[k] = meshArea > 0.0 ? meshCentroid[k] / meshArea : 0.0;
+
+    // Clusters facing away from the mesh center are more likely to occlude the rest, so they go first
+    for (size_t c = 0; c < sorted.size(); ++c)
+    {
+        float key = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            key += (clusterCentroid[c * 3 + k] - (float)meshCentroid[k]) * clusterNormal[c * 3 + k];
+        sorted[c].mSortKey = key;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.mSortKey > b.mSortKey; });
+
+    size_t outputCount = 0;
+    for (const Cluster& cluster : sorted)
+    {
+        const size_t count = (cluster.mEnd - cluster.mBegin) * 3;
+        memcpy(&pDst[outputCount], &pIndices[cluster.mBegin * 3], count * sizeof(uint32_t));
+        outputCount += count;
+    }
+}
+
+size_t optimizeVertexFetchRemap(uint32_t* pRemap, const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    const uint32_t unused = ~0u;
+    for (size_t v = 0; v < vertexCount; ++v)
+        pRemap[v] = unused;
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (pRemap[pIndices[i]] == unused)
+            pRemap[pIndices[i]] = next++;
+    }
+
+    const size_t referenced = next;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (pRemap[v] == unused)
+            pRemap[v] = next++;
+    }
+    return referenced;
+}
+
+void remapIndices(uint32_t* pIndices, size_t indexCount, const uint32_t* pRemap)
+{
+    for (size_t i = 0; i < indexCount; ++i)
+        pIndices[i] = pRemap[pIndices[i]];
+}
+
+void remapVertices(void* pDst, const void* pSrc, size_t vertexCount, size_t vertexSize, const uint32_t* pRemap)
+{
+    for (size_t v = 0; v < vertexCount; ++v)
+        memcpy((uint8_t*)pDst + pRemap[v] * vertexSize, (const uint8_t*)pSrc + v * vertexSize, vertexSize);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Index/vertex reordering and the metrics used to judge it. All functions work on 32-bit triangle lists
+// and tightly packed float3 positions, one mesh (glTF primitive) at a time.
+
+struct VertexCacheStats
+{
+    uint32_t mCacheMisses;
+    // Average cache miss ratio: transformed vertices per triangle (0.5 is the ideal for regular grids, 3 the worst)
+    float mAcmr;
+    // Average transformed vertex ratio: transformed vertices per unique vertex (1 is the ideal)
+    float mAtvr;
+};
+
+struct OverdrawStats
+{
+    uint64_t mPixelsCovered;
+    uint64_t mPixelsShaded;
+    // Shaded / covered pixels, 1 means no overdraw
+    float mOverdraw;
+};
+
+// FIFO post-transform cache simulation
+VertexCacheStats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize);
+
+// Rasterizes the mesh in submission order from the six axis directions into a small depth buffer
+// and counts how many fragments pass the depth test per covered pixel
+OverdrawStats analyzeOverdraw(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t vertexCount);
+
+// Forsyth's linear-speed vertex cache optimization. pDst must not alias pIndices.
+void optimizeVertexCache(uint32_t* pDst, const uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+
+// Splits a cache optimized index buffer into clusters that can be moved without hurting the cache
+// (ACMR may grow up to threshold times) and sorts them so outward facing clusters draw first.
+// pDst must not alias pIndices.
+void optimizeOverdraw(uint32_t* pDst, const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t vertexCount,
+                      float threshold);
+
+// Builds pRemap[oldVertex] = newVertex numbering vertices in first use order, unreferenced ones last.
+// Returns the number of referenced vertices.
+size_t optimizeVertexFetchRemap(uint32_t* pRemap, const uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+
+void remapIndices(uint32_t* pIndices, size_t indexCount, const uint32_t* pRemap);
+// Tightly packed vertices of vertexSize bytes, pDst must not alias pSrc
+void remapVertices(void* pDst, const void* pSrc, size_t vertexCount, size_t vertexSize, const uint32_t* pRemap);
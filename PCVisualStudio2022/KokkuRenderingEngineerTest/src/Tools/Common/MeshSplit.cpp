@@ -0,0 +1,48 @@
+#include "MeshSplit.h"
+
+void splitMesh(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t maxVertices, std::vector<MeshChunk>* pOut)
+{
+    pOut->clear();
+    if (maxVertices > MESH_SPLIT_MAX_VERTICES)
+        maxVertices = MESH_SPLIT_MAX_VERTICES;
+    if (maxVertices < 3 || indexCount < 3)
+        return;
+
+    // Chunk that last used each vertex and its index there, so starting a chunk needs no clearing
+    std::vector<uint32_t> vertexChunk(vertexCount, UINT32_MAX);
+    std::vector<uint16_t> vertexLocal(vertexCount, 0);
+
+    pOut->emplace_back();
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        uint32_t chunkIndex = (uint32_t)pOut->size() - 1;
+
+        uint32_t newVertices = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t v = pIndices[i + k];
+            const bool repeated = (k > 0 && v == pIndices[i]) || (k > 1 && v == pIndices[i + 1]);
+            if (vertexChunk[v] != chunkIndex && !repeated)
+                ++newVertices;
+        }
+
+        if (pOut->back().mVertices.size() + newVertices > maxVertices)
+        {
+            pOut->emplace_back();
+            ++chunkIndex;
+        }
+
+        MeshChunk& chunk = pOut->back();
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t v = pIndices[i + k];
+            if (vertexChunk[v] != chunkIndex)
+            {
+                vertexChunk[v] = chunkIndex;
+                vertexLocal[v] = (uint16_t)chunk.mVertices.size();
+                chunk.mVertices.push_back(v);
+            }
+            chunk.mIndices.push_back(vertexLocal[v]);
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Splits triangle lists whose vertices don't fit 16-bit indices into chunks that do, so large meshes keep the
+// smaller index buffer. Triangles keep their order, so a cache optimized mesh stays cache friendly per chunk.
+
+// 0xFFFF stays free, it is the primitive restart value of 16-bit index buffers
+static const uint32_t MESH_SPLIT_MAX_VERTICES = 0xFFFF;
+
+struct MeshChunk
+{
+    // Triangle list into mVertices
+    std::vector<uint16_t> mIndices;
+    // Source vertex of each chunk vertex, in first use order
+    std::vector<uint32_t> mVertices;
+};
+
+// Starts a new chunk whenever the next triangle would take the current one past maxVertices (at most
+// MESH_SPLIT_MAX_VERTICES). Vertices used by several chunks are duplicated into each of them.
+void splitMesh(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t maxVertices, std::vector<MeshChunk>* pOut);
@@ -0,0 +1,426 @@
+// Offline mesh optimization for the castle (or any single-buffer glTF).
+//
+//   KokkuMeshCooker <input.gltf> <output.gltf> [--cache-size N] [--overdraw-threshold T] [--no-overdraw] [--split-16bit]
+//   KokkuMeshCooker --synthetic <triangles> <output.gltf> [options]
+//
+// Per triangle list primitive: reorders triangles for the post-transform vertex cache, then clusters
+// them to reduce overdraw, then renumbers vertices in first use order for fetch locality.
+// Accessor counts and the buffer layout stay the same, so the output can go through AssetPipelineCMD
+// exactly like the FBX2glTF output did.
+//
+// --split-16bit moves primitives with 32-bit indices to 16-bit ones: meshes with more vertices than that are split
+// into chunks of at most 65535 vertices, appended to the mesh as extra primitives with their own vertex streams and
+// the material of the primitive they came from. The replaced 32-bit streams are dropped from the output buffer.
+// --synthetic replaces the input with a generated grid of at least that many triangles and 32-bit indices, which
+// exercises both index widths at sizes no real asset here has.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../Common/Gltf.h"
+#include "../Common/MeshOptimizer.h"
+#include "../Common/MeshSplit.h"
+
+struct CookerOptions
+{
+    const char* pInput = NULL;
+    const char* pOutput = NULL;
+    uint32_t mCacheSize = 16;
+    float mOverdrawThreshold = 1.05f;
+    bool mOverdraw = true;
+    bool mSplit16 = false;
+    // Triangles of the generated input, 0 reads pInput
+    uint32_t mSyntheticTriangles = 0;
+};
+
+struct MeshMetrics
+{
+    VertexCacheStats mCache;
+    OverdrawStats mOverdraw;
+};
+
+static void printUsage()
+{
+    printf("Usage: KokkuMeshCooker <input.gltf> <output.gltf> [--cache-size N] [--overdraw-threshold T] [--no-overdraw] [--split-16bit]\n"
+           "       KokkuMeshCooker --synthetic <triangles> <output.gltf> [options]\n");
+}
+
+static bool parseOptions(int argc, char** argv, CookerOptions* pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+            pOptions->mCacheSize = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--overdraw-threshold") == 0 && i + 1 < argc)
+            pOptions->mOverdrawThreshold = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--no-overdraw") == 0)
+            pOptions->mOverdraw = false;
+        else if (strcmp(argv[i], "--split-16bit") == 0)
+            pOptions->mSplit16 = true;
+        else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc)
+            pOptions->mSyntheticTriangles = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (!pOptions->pInput && !pOptions->mSyntheticTriangles)
+            pOptions->pInput = argv[i];
+        else if (!pOptions->pOutput)
+            pOptions->pOutput = argv[i];
+        else
+            return false;
+    }
+    return (pOptions->pInput || pOptions->mSyntheticTriangles) && pOptions->pOutput && pOptions->mCacheSize > 0;
+}
+
+static MeshMetrics measure(const std::vector<uint32_t>& indices, const std::vector<float>& positions, uint32_t cacheSize)
+{
+    MeshMetrics metrics;
+    metrics.mCache = analyzeVertexCache(indices.data(), indices.size(), positions.size() / 3, cacheSize);
+    metrics.mOverdraw = analyzeOverdraw(indices.data(), indices.size(), positions.data(), positions.size() / 3);
+    return metrics;
+}
+
+static void printMetrics(const char* pName, uint32_t triangles, uint32_t vertices, const MeshMetrics& before, const MeshMetrics& after)
+{
+    printf("%-28s %8u %8u   %6.3f -> %6.3f   %6.3f -> %6.3f   %6.3f -> %6.3f\n", pName, triangles, vertices, before.mCache.mAcmr,
+           after.mCache.mAcmr, before.mCache.mAtvr, after.mCache.mAtvr, before.mOverdraw.mOverdraw, after.mOverdraw.mOverdraw);
+}
+
+// Applies pRemap to every attribute of the primitive
+static bool remapAttributes(GltfDocument* pDocument, const GltfPrimitive& primitive, const std::vector<uint32_t>& remap)
+{
+    for (const GltfAttribute& attribute : primitive.mAttributes)
+    {
+        GltfAccessor accessor;
+        if (!gltfGetAccessor(pDocument, attribute.mAccessor, &accessor) || accessor.mCount != remap.size())
+            return false;
+
+        std::vector<uint8_t> packed((size_t)accessor.mCount * accessor.mElementSize);
+        for (uint32_t v = 0; v < accessor.mCount; ++v)
+            memcpy(&packed[(size_t)v * accessor.mElementSize], accessor.pData + (size_t)v * accessor.mStride, accessor.mElementSize);
+
+        std::vector<uint8_t> remapped(packed.size());
+        remapVertices(remapped.data(), packed.data(), accessor.mCount, accessor.mElementSize, remap.data());
+
+        for (uint32_t v = 0; v < accessor.mCount; ++v)
+            memcpy(accessor.pData + (size_t)v * accessor.mStride, &remapped[(size_t)v * accessor.mElementSize], accessor.mElementSize);
+    }
+    return true;
+}
+
+// Wavy grid of at least triangleCount triangles with float3 positions and normals, float2 UVs and 32-bit indices,
+// rows of quads in scan order like a naive exporter would write them. Its material is named "Synthetic", for
+// KokkuSceneCooker's job file.
+static void buildSyntheticMesh(uint32_t triangleCount, GltfDocument* pOut)
+{
+    const uint32_t quads = (triangleCount + 1) / 2;
+    const uint32_t columns = (uint32_t)ceil(sqrt((double)quads));
+    const uint32_t rows = (quads + columns - 1) / columns;
+    const uint32_t vertexCount = (columns + 1) * (rows + 1);
+
+    std::vector<float> positions((size_t)vertexCount * 3);
+    std::vector<float> normals((size_t)vertexCount * 3);
+    std::vector<float> uvs((size_t)vertexCount * 2);
+    for (uint32_t y = 0; y <= rows; ++y)
+    {
+        for (uint32_t x = 0; x <= columns; ++x)
+        {
+            const size_t v = (size_t)y * (columns + 1) + x;
+            const float  u = (float)x / (float)columns;
+            const float  w = (float)y / (float)rows;
+            // Height and its derivatives, so the overdraw analysis sees some depth complexity
+            const float height = 0.1f * sinf(u * 25.0f) * cosf(w * 25.0f);
+            const float dx = 2.5f * cosf(u * 25.0f) * cosf(w * 25.0f);
+            const float dz = -2.5f * sinf(u * 25.0f) * sinf(w * 25.0f);
+            const float length = sqrtf(dx * dx + 1.0f + dz * dz);
+            positions[v * 3 + 0] = u;
+            positions[v * 3 + 1] = height;
+            positions[v * 3 + 2] = w;
+            normals[v * 3 + 0] = -dx / length;
+            normals[v * 3 + 1] = 1.0f / length;
+            normals[v * 3 + 2] = -dz / length;
+            uvs[v * 2 + 0] = u;
+            uvs[v * 2 + 1] = w;
+        }
+    }
+
+    std::vector<uint32_t> indices;
+    indices.reserve((size_t)columns * rows * 6);
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        for (uint32_t x = 0; x < columns; ++x)
+        {
+            const uint32_t v = y * (columns + 1) + x;
+            const uint32_t quad[6] = { v, v + columns + 1, v + 1, v + 1, v + columns + 1, v + columns + 2 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    JsonValue& json = pOut->mJson;
+    json = JsonValue::object();
+    json["asset"]["version"] = JsonValue("2.0");
+    json["asset"]["generator"] = JsonValue("KokkuMeshCooker --synthetic");
+    json["scene"] = JsonValue(0);
+    JsonValue scene = JsonValue::object();
+    scene["nodes"].push(JsonValue(0));
+    json["scenes"].push(scene);
+    JsonValue node = JsonValue::object();
+    node["mesh"] = JsonValue(0);
+    json["nodes"].push(node);
+    JsonValue buffer = JsonValue::object();
+    buffer["byteLength"] = JsonValue(0);
+    json["buffers"].push(buffer);
+    pOut->mBuffer.clear();
+
+    JsonValue vec3 = JsonValue::object();
+    vec3["componentType"] = JsonValue(GLTF_FLOAT);
+    vec3["type"] = JsonValue("VEC3");
+    JsonValue vec2 = vec3;
+    vec2["type"] = JsonValue("VEC2");
+    JsonValue scalar = JsonValue::object();
+    scalar["componentType"] = JsonValue(GLTF_UNSIGNED_INT);
+    scalar["type"] = JsonValue("SCALAR");
+
+    JsonValue material = JsonValue::object();
+    material["name"] = JsonValue("Synthetic");
+    json["materials"].push(material);
+
+    JsonValue primitive = JsonValue::object();
+    primitive["attributes"]["POSITION"] = JsonValue(gltfAddAccessor(pOut, vec3, positions.data(), vertexCount, GLTF_ARRAY_BUFFER));
+    primitive["attributes"]["NORMAL"] = JsonValue(gltfAddAccessor(pOut, vec3, normals.data(), vertexCount, GLTF_ARRAY_BUFFER));
+    primitive["attributes"]["TEXCOORD_0"] = JsonValue(gltfAddAccessor(pOut, vec2, uvs.data(), vertexCount, GLTF_ARRAY_BUFFER));
+    primitive["indices"] =
+        JsonValue(gltfAddAccessor(pOut, scalar, indices.data(), (uint32_t)indices.size(), GLTF_ELEMENT_ARRAY_BUFFER));
+    primitive["mode"] = JsonValue(4);
+    primitive["material"] = JsonValue(0);
+
+    JsonValue mesh = JsonValue::object();
+    mesh["name"] = JsonValue("Synthetic");
+    mesh["primitives"].push(primitive);
+    json["meshes"].push(mesh);
+}
+
+// Moves the primitive to 16-bit indices, splitting it into chunks of at most maxVertices vertices. Chunk 0 replaces
+// the primitive's streams, the others are appended to its mesh so the primitive indices the app uses stay put.
+// Every chunk is a copy of the source primitive, so it keeps its material. The old accessors are left
+// unreferenced until gltfRemoveUnused. Returns the number of chunks, 0 on failure.
+static size_t splitPrimitive(GltfDocument* pDocument, const GltfPrimitive& primitive, const std::vector<uint32_t>& indices,
+                             size_t vertexCount, uint32_t maxVertices, size_t* pChunkVertices)
+{
+    std::vector<MeshChunk> chunks;
+    splitMesh(indices.data(), indices.size(), vertexCount, maxVertices, &chunks);
+
+    // Every source triangle has to come out of exactly one chunk, in order
+    size_t triangle = 0;
+    *pChunkVertices = 0;
+    for (const MeshChunk& chunk : chunks)
+    {
+        if (chunk.mVertices.size() > maxVertices)
+            return 0;
+        for (size_t i = 0; i < chunk.mIndices.size(); ++i, ++triangle)
+        {
+            if (chunk.mVertices[chunk.mIndices[i]] != indices[triangle])
+                return 0;
+        }
+        *pChunkVertices += chunk.mVertices.size();
+    }
+    if (triangle != indices.size())
+        return 0;
+
+    JsonValue indexTemplate = JsonValue::object();
+    indexTemplate["componentType"] = JsonValue(GLTF_UNSIGNED_SHORT);
+    indexTemplate["type"] = JsonValue("SCALAR");
+
+    // Copied, the meshes array is only written once all accessors of a chunk exist
+    const JsonValue source = (*pDocument->mJson.find("meshes"))[primitive.mMeshIndex]["primitives"][primitive.mPrimitiveIndex];
+
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        const MeshChunk& chunk = chunks[c];
+        JsonValue chunkPrimitive = source;
+
+        // A single chunk in first use order is the vertex buffer as is, only the indices shrink
+        bool identity = chunk.mVertices.size() == vertexCount;
+        for (size_t v = 0; identity && v < chunk.mVertices.size(); ++v)
+            identity = chunk.mVertices[v] == v;
+
+        if (!identity)
+        {
+            JsonValue& attributes = chunkPrimitive["attributes"];
+            for (const GltfAttribute& attribute : primitive.mAttributes)
+            {
+                // Taken again every time, adding an accessor moves the buffer
+                GltfAccessor accessor;
+                if (!gltfGetAccessor(pDocument, attribute.mAccessor, &accessor))
+                    return 0;
+                std::vector<uint8_t> gathered(chunk.mVertices.size() * accessor.mElementSize);
+                for (size_t v = 0; v < chunk.mVertices.size(); ++v)
+                    memcpy(&gathered[v * accessor.mElementSize], accessor.pData + (size_t)chunk.mVertices[v] * accessor.mStride,
+                           accessor.mElementSize);
+
+                const JsonValue attributeTemplate = (*pDocument->mJson.find("accessors"))[attribute.mAccessor];
+                attributes[attribute.mSemantic] = JsonValue(gltfAddAccessor(pDocument, attributeTemplate, gathered.data(),
+                                                                            (uint32_t)chunk.mVertices.size(), GLTF_ARRAY_BUFFER));
+            }
+        }
+
+        chunkPrimitive["indices"] = JsonValue(gltfAddAccessor(pDocument, indexTemplate, chunk.mIndices.data(),
+                                                              (uint32_t)chunk.mIndices.size(), GLTF_ELEMENT_ARRAY_BUFFER));
+
+        JsonValue& meshPrimitives = (*pDocument->mJson.find("meshes"))[primitive.mMeshIndex]["primitives"];
+        if (c == 0)
+            meshPrimitives[primitive.mPrimitiveIndex] = chunkPrimitive;
+        else
+            meshPrimitives.push(chunkPrimitive);
+    }
+    return chunks.size();
+}
+
+int main(int argc, char** argv)
+{
+    CookerOptions options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    GltfDocument document;
+    std::string  error;
+    if (options.mSyntheticTriangles)
+        buildSyntheticMesh(options.mSyntheticTriangles, &document);
+    else if (!gltfLoad(options.pInput, &document, &error))
+    {
+        fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    const std::vector<GltfPrimitive> primitives = gltfGetPrimitives(document);
+
+    // Reordering a vertex stream shared by several primitives would break the others
+    std::vector<uint32_t> accessorUsers(document.mJson.find("accessors")->size(), 0);
+    for (const GltfPrimitive& primitive : primitives)
+    {
+        for (const GltfAttribute& attribute : primitive.mAttributes)
+            ++accessorUsers[attribute.mAccessor];
+    }
+
+    printf("cache size %u, overdraw threshold %.2f\n\n", options.mCacheSize, options.mOverdrawThreshold);
+    printf("%-28s %8s %8s   %-16s   %-16s   %-16s\n", "mesh", "tris", "verts", "ACMR", "ATVR", "overdraw");
+
+    bool        split = false;
+    MeshMetrics totalBefore = {};
+    MeshMetrics totalAfter = {};
+    uint64_t    totalTriangles = 0;
+    uint64_t    totalVertices = 0;
+
+    for (const GltfPrimitive& primitive : primitives)
+    {
+        GltfAccessor indexAccessor;
+        GltfAccessor positionAccessor;
+        if (primitive.mIndicesAccessor < 0 || primitive.mPositionAccessor < 0 ||
+            !gltfGetAccessor(&document, (uint32_t)primitive.mIndicesAccessor, &indexAccessor) ||
+            !gltfGetAccessor(&document, (uint32_t)primitive.mPositionAccessor, &positionAccessor) ||
+            positionAccessor.mComponentType != GLTF_FLOAT)
+        {
+            printf("%-28s skipped (needs indices and float positions)\n", primitive.mMeshName.c_str());
+            continue;
+        }
+
+        bool shared = false;
+        for (const GltfAttribute& attribute : primitive.mAttributes)
+            shared = shared || accessorUsers[attribute.mAccessor] > 1;
+        if (shared)
+        {
+            printf("%-28s skipped (vertex streams shared with another primitive)\n", primitive.mMeshName.c_str());
+            continue;
+        }
+
+        std::vector<uint32_t> indices;
+        std::vector<float>    positions;
+        gltfReadIndices(indexAccessor, &indices);
+        gltfReadPositions(positionAccessor, &positions);
+        indices.resize(indices.size() / 3 * 3);
+
+        const size_t vertexCount = positionAccessor.mCount;
+        const MeshMetrics before = measure(indices, positions, options.mCacheSize);
+
+        std::vector<uint32_t> optimized(indices.size());
+        optimizeVertexCache(optimized.data(), indices.data(), indices.size(), vertexCount);
+        if (options.mOverdraw)
+        {
+            optimizeOverdraw(indices.data(), optimized.data(), optimized.size(), positions.data(), vertexCount, options.mOverdrawThreshold);
+            optimized.swap(indices);
+        }
+
+        std::vector<uint32_t> remap(vertexCount);
+        optimizeVertexFetchRemap(remap.data(), optimized.data(), optimized.size(), vertexCount);
+        remapIndices(optimized.data(), optimized.size(), remap.data());
+        if (!remapAttributes(&document, primitive, remap))
+        {
+            fprintf(stderr, "error: %s has attributes with mismatching counts\n", primitive.mMeshName.c_str());
+            return 1;
+        }
+        gltfWriteIndices(indexAccessor, optimized);
+
+        std::vector<float> remappedPositions(positions.size());
+        remapVertices(remappedPositions.data(), positions.data(), vertexCount, sizeof(float) * 3, remap.data());
+        const MeshMetrics after = measure(optimized, remappedPositions, options.mCacheSize);
+
+        printMetrics(primitive.mMeshName.c_str(), (uint32_t)(optimized.size() / 3), (uint32_t)vertexCount, before, after);
+
+        if (options.mSplit16 && (indexAccessor.mComponentType != GLTF_UNSIGNED_SHORT || vertexCount > MESH_SPLIT_MAX_VERTICES))
+        {
+            size_t       chunkVertices = 0;
+            const size_t chunkCount =
+                splitPrimitive(&document, primitive, optimized, vertexCount, MESH_SPLIT_MAX_VERTICES, &chunkVertices);
+            if (chunkCount == 0)
+            {
+                fprintf(stderr, "error: splitting %s lost or broke triangles\n", primitive.mMeshName.c_str());
+                return 1;
+            }
+            printf("%-28s 16-bit indices, %zu chunk(s), %zu vertices (+%.1f%% duplicated on chunk borders)\n", "",
+                   chunkCount, chunkVertices, 100.0 * ((double)chunkVertices - (double)vertexCount) / (double)vertexCount);
+            split = true;
+        }
+
+        totalBefore.mCache.mCacheMisses += before.mCache.mCacheMisses;
+        totalAfter.mCache.mCacheMisses += after.mCache.mCacheMisses;
+        totalBefore.mOverdraw.mPixelsShaded += before.mOverdraw.mPixelsShaded;
+        totalBefore.mOverdraw.mPixelsCovered += before.mOverdraw.mPixelsCovered;
+        totalAfter.mOverdraw.mPixelsShaded += after.mOverdraw.mPixelsShaded;
+        totalAfter.mOverdraw.mPixelsCovered += after.mOverdraw.mPixelsCovered;
+        totalTriangles += optimized.size() / 3;
+        totalVertices += vertexCount;
+    }
+
+    if (totalTriangles > 0)
+    {
+        // Totals weight every mesh by its size, overdraw is per mesh (meshes are rasterized separately)
+        for (MeshMetrics* metrics : { &totalBefore, &totalAfter })
+        {
+            metrics->mCache.mAcmr = (float)metrics->mCache.mCacheMisses / (float)totalTriangles;
+            metrics->mCache.mAtvr = (float)metrics->mCache.mCacheMisses / (float)totalVertices;
+            metrics->mOverdraw.mOverdraw = metrics->mOverdraw.mPixelsCovered
+                                               ? (float)metrics->mOverdraw.mPixelsShaded / (float)metrics->mOverdraw.mPixelsCovered
+                                               : 0.0f;
+        }
+        printf("\n");
+        printMetrics("total", (uint32_t)totalTriangles, (uint32_t)totalVertices, totalBefore, totalAfter);
+    }
+
+    // The streams the chunks replaced would otherwise still be written, and loaded by AssetPipelineCMD
+    if (split)
+        printf("\nremoved the replaced streams, %zu bytes\n", gltfRemoveUnused(&document));
+
+    if (!gltfSave(&document, options.pOutput, &error))
+    {
+        fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    printf("\nwrote %s\n", options.pOutput);
+    return 0;
+}
@@ -0,0 +1,345 @@
+// Compares two metrics exports of the app (--metrics, CSV or JSON) column by column, for gating builds on them.
+//
+//   KokkuMetricsCompare <baseline> <candidate> [--columns a,b,...] [--alpha A] [--threshold T] [--skip N]
+//
+// A column regressed when the candidate's mean is higher with a one-sided Welch's t-test p-value below --alpha
+// (default 0.001) and by more than --threshold of the baseline mean (default 0.05). Consecutive frames are not
+// independent samples, so the p-value alone flags tiny changes on long runs, the threshold keeps them out.
+// The default columns are the *_ms ones, --columns picks any others (pipeline statistics for instance).
+// --skip drops the first N frames of both runs on top of the warmup the app already left out.
+// Exits with 1 when a column regressed and 2 on bad input, so a CI step fails either way.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../Common/Json.h"
+
+struct CompareOptions
+{
+    const char* pBaseline = NULL;
+    const char* pCandidate = NULL;
+    // Comma separated, empty picks every *_ms column
+    std::string mColumns;
+    double mAlpha = 0.001;
+    double mThreshold = 0.05;
+    uint32_t mSkip = 0;
+};
+
+// One column per name, one value per frame
+struct MetricsRun
+{
+    std::vector<std::string> mNames;
+    std::vector<std::vector<double>> mColumns;
+};
+
+struct ColumnStats
+{
+    size_t mCount = 0;
+    double mMean = 0.0;
+    double mVariance = 0.0;
+    double mP99 = 0.0;
+};
+
+static void printUsage()
+{
+    printf("Usage: KokkuMetricsCompare <baseline> <candidate> [--columns a,b,...] [--alpha A] [--threshold T] [--skip N]\n");
+}
+
+static bool parseOptions(int argc, char** argv, CompareOptions* pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc)
+            pOptions->mColumns = argv[++i];
+        else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+            pOptions->mAlpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            pOptions->mThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+            pOptions->mSkip = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (!pOptions->pBaseline)
+            pOptions->pBaseline = argv[i];
+        else if (!pOptions->pCandidate)
+            pOptions->pCandidate = argv[i];
+        else
+            return false;
+    }
+    return pOptions->pBaseline && pOptions->pCandidate && pOptions->mAlpha > 0.0 && pOptions->mAlpha < 1.0;
+}
+
+static std::vector<std::string> split(const std::string& text, char separator)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;)
+    {
+        const size_t end = text.find(separator, start);
+        parts.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        if (end == std::string::npos)
+            return parts;
+        start = end + 1;
+    }
+}
+
+static bool readText(const char* pPath, std::string* pOut)
+{
+    FILE* file = fopen(pPath, "rb");
+    if (!file)
+        return false;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        pOut->append(buffer, read);
+    fclose(file);
+    return true;
+}
+
+static bool parseCsv(const std::string& text, MetricsRun* pOut, std::string* pError)
+{
+    std::vector<std::string> lines = split(text, '\n');
+    for (std::string& line : lines)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+    }
+    if (lines.empty() || lines[0].empty())
+    {
+        *pError = "no header row";
+        return false;
+    }
+
+    pOut->mNames = split(lines[0], ',');
+    pOut->mColumns.assign(pOut->mNames.size(), std::vector<double>());
+    for (size_t l = 1; l < lines.size(); ++l)
+    {
+        if (lines[l].empty())
+            continue;
+        const std::vector<std::string> fields = split(lines[l], ',');
+        if (fields.size() != pOut->mNames.size())
+        {
+            *pError = "line " + std::to_string(l + 1) + " has " + std::to_string(fields.size()) + " fields";
+            return false;
+        }
+        for (size_t c = 0; c < fields.size(); ++c)
+            pOut->mColumns[c].push_back(strtod(fields[c].c_str(), NULL));
+    }
+    return true;
+}
+
+static bool parseJson(const std::string& text, MetricsRun* pOut, std::string* pError)
+{
+    JsonValue root;
+    if (!jsonParse(text, &root, pError))
+        return false;
+    const JsonValue* columns = root.find("columns");
+    const JsonValue* frames = root.find("frames");
+    if (!columns || columns->mType != JSON_ARRAY || !frames || frames->mType != JSON_ARRAY)
+    {
+        *pError = "expected \"columns\" and \"frames\" arrays";
+        return false;
+    }
+
+    for (size_t c = 0; c < columns->size(); ++c)
+        pOut->mNames.push_back((*columns)[c].asString());
+    pOut->mColumns.assign(pOut->mNames.size(), std::vector<double>());
+    for (size_t f = 0; f < frames->size(); ++f)
+    {
+        const JsonValue& frame = (*frames)[f];
+        if (frame.mType != JSON_ARRAY || frame.size() != pOut->mNames.size())
+        {
+            *pError = "frame " + std::to_string(f) + " doesn't match the columns";
+            return false;
+        }
+        for (size_t c = 0; c < frame.size(); ++c)
+            pOut->mColumns[c].push_back(frame[c].asNumber());
+    }
+    return true;
+}
+
+static bool loadRun(const char* pPath, uint32_t skip, MetricsRun* pOut)
+{
+    std::string text;
+    std::string error;
+    if (!readText(pPath, &text))
+        error = "can't read the file";
+    else
+    {
+        // The export writes JSON as an object, whatever the file is called
+        const size_t first = text.find_first_not_of(" \t\r\n");
+        const bool json = first != std::string::npos && text[first] == '{';
+        if ((json ? parseJson(text, pOut, &error) : parseCsv(text, pOut, &error)))
+        {
+            for (std::vector<double>& column : pOut->mColumns)
+                column.erase(column.begin(), column.begin() + std::min<size_t>(skip, column.size()));
+            return true;
+        }
+    }
+    fprintf(stderr, "error: %s: %s\n", pPath, error.c_str());
+    return false;
+}
+
+static const std::vector<double>* findColumn(const MetricsRun& run, const std::string& name)
+{
+    for (size_t c = 0; c < run.mNames.size(); ++c)
+    {
+        if (run.mNames[c] == name)
+            return &run.mColumns[c];
+    }
+    return NULL;
+}
+
+static ColumnStats computeStats(const std::vector<double>& values)
+{
+    ColumnStats stats;
+    stats.mCount = values.size();
+    if (values.empty())
+        return stats;
+
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    stats.mMean = sum / values.size();
+
+    double squares = 0.0;
+    for (double value : values)
+        squares += (value - stats.mMean) * (value - stats.mMean);
+    stats.mVariance = values.size() > 1 ? squares / (values.size() - 1) : 0.0;
+
+    std::vector<double> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    stats.mP99 = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99))];
+    return stats;
+}
+
+// Continued fraction of the regularized incomplete beta function (modified Lentz), converges for x < (a + 1) / (a + b + 2)
+static double betaContinuedFraction(double a, double b, double x)
+{
+    const double tiny = 1e-300;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    d = 1.0 / (fabs(d) < tiny ? tiny : d);
+    double result = d;
+    for (int m = 1; m <= 300; ++m)
+    {
+        const double even = m * (b - m) * x / ((a + 2.0 * m - 1.0) * (a + 2.0 * m));
+        d = 1.0 + even * d;
+        c = 1.0 + even / c;
+        d = 1.0 / (fabs(d) < tiny ? tiny : d);
+        c = fabs(c) < tiny ? tiny : c;
+        result *= d * c;
+
+        const double odd = -(a + m) * (a + b + m) * x / ((a + 2.0 * m) * (a + 2.0 * m + 1.0));
+        d = 1.0 + odd * d;
+        c = 1.0 + odd / c;
+        d = 1.0 / (fabs(d) < tiny ? tiny : d);
+        c = fabs(c) < tiny ? tiny : c;
+        const double step = d * c;
+        result *= step;
+        if (fabs(step - 1.0) < 1e-12)
+            break;
+    }
+    return result;
+}
+
+static double incompleteBeta(double a, double b, double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    if (x >= 1.0)
+        return 1.0;
+    const double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0))
+        return front * betaContinuedFraction(a, b, x) / a;
+    return 1.0 - front * betaContinuedFraction(b, a, 1.0 - x) / b;
+}
+
+// One-sided p-value of Welch's t-test for the candidate mean being higher than the baseline's
+static double welchPValue(const ColumnStats& baseline, const ColumnStats& candidate)
+{
+    const double baselineError = baseline.mVariance / baseline.mCount;
+    const double candidateError = candidate.mVariance / candidate.mCount;
+    const double error = baselineError + candidateError;
+    // Constant columns (counters of a fixed camera): any increase is certain
+    if (error <= 0.0)
+        return candidate.mMean > baseline.mMean ? 0.0 : 1.0;
+
+    const double t = (candidate.mMean - baseline.mMean) / sqrt(error);
+    const double df = error * error /
+                      (baselineError * baselineError / (baseline.mCount - 1) + candidateError * candidateError / (candidate.mCount - 1));
+    // Upper tail of Student's t with df degrees of freedom
+    const double tail = 0.5 * incompleteBeta(0.5 * df, 0.5, df / (df + t * t));
+    return t > 0.0 ? tail : 1.0 - tail;
+}
+
+int main(int argc, char** argv)
+{
+    CompareOptions options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    MetricsRun baseline;
+    MetricsRun candidate;
+    if (!loadRun(options.pBaseline, options.mSkip, &baseline) || !loadRun(options.pCandidate, options.mSkip, &candidate))
+        return 2;
+
+    std::vector<std::string> columns;
+    if (!options.mColumns.empty())
+        columns = split(options.mColumns, ',');
+    else
+    {
+        for (const std::string& name : baseline.mNames)
+        {
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "_ms") == 0)
+                columns.push_back(name);
+        }
+    }
+
+    printf("alpha %g, threshold %.1f%%\n\n", options.mAlpha, options.mThreshold * 100.0);
+    printf("%-26s %20s %20s %10s %10s %9s\n", "column", "baseline avg (p99)", "candidate avg (p99)", "change", "p", "");
+
+    uint32_t regressions = 0;
+    for (const std::string& name : columns)
+    {
+        const std::vector<double>* baselineValues = findColumn(baseline, name);
+        const std::vector<double>* candidateValues = findColumn(candidate, name);
+        if (!baselineValues || !candidateValues)
+        {
+            fprintf(stderr, "error: column %s is missing from %s\n", name.c_str(), baselineValues ? options.pCandidate : options.pBaseline);
+            return 2;
+        }
+        if (baselineValues->size() < 2 || candidateValues->size() < 2)
+        {
+            fprintf(stderr, "error: column %s needs at least 2 frames in each run\n", name.c_str());
+            return 2;
+        }
+
+        const ColumnStats before = computeStats(*baselineValues);
+        const ColumnStats after = computeStats(*candidateValues);
+        const double      p = welchPValue(before, after);
+        const double      change = before.mMean != 0.0 ? (after.mMean - before.mMean) / fabs(before.mMean) : (after.mMean > 0.0 ? INFINITY : 0.0);
+        const bool        regressed = p < options.mAlpha && change > options.mThreshold;
+        // Same test the other way round, only for the report
+        const bool improved = welchPValue(after, before) < options.mAlpha && -change > options.mThreshold;
+        regressions += regressed ? 1 : 0;
+
+        char beforeText[32];
+        char afterText[32];
+        snprintf(beforeText, sizeof(beforeText), "%.4g (%.4g)", before.mMean, before.mP99);
+        snprintf(afterText, sizeof(afterText), "%.4g (%.4g)", after.mMean, after.mP99);
+        printf("%-26s %20s %20s %+9.2f%% %10.2g %9s\n", name.c_str(), beforeText, afterText, change * 100.0, p,
+               regressed ? "REGRESSED" : (improved ? "improved" : ""));
+    }
+
+    printf("\n%zu vs %zu frames, %u of %zu columns regressed\n", baseline.mColumns.empty() ? 0 : baseline.mColumns[0].size(),
+           candidate.mColumns.empty() ? 0 : candidate.mColumns[0].size(), regressions, columns.size());
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+// Offline cooking of the castle geometry into castle.kscene, the format CastleScene memory maps (see CookedScene.h).
+//
+//   KokkuSceneCooker <input.gltf> <materials.json> <output.kscene>
+//
+// Every triangle list primitive becomes one draw, in mesh order like AssetPipelineCMD writes castle.bin. Vertices
+// are converted to the layout the app draws with (float3 position, octahedral R16G16_UNORM normal, R16G16_SFLOAT uv,
+// R8G8B8A8_SNORM tangent) and concatenated, indices stay relative to each draw's vertex offset and are 16-bit when
+// every draw fits. The tangents are generated here (Tangents.h), the glTF export has none.
+// The glTF materials carry no textures of their own, the job file names them per material:
+//   { "materials": { "Castle_Exterior_Tex": { "albedo": "Castle Exterior Texture.dds", "bump": "..." }, ... } }
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../Common/Gltf.h"
+#include "../Common/Json.h"
+#include "CookedScene.h"
+#include "Tangents.h"
+
+static void printUsage() { printf("Usage: KokkuSceneCooker <input.gltf> <materials.json> <output.kscene>\n"); }
+
+static uint16_t toUnorm16(float value) { return (uint16_t)(fminf(fmaxf(value, 0.0f), 1.0f) * 65535.0f + 0.5f); }
+
+// Round to nearest even, subnormals flushed to zero which no uv needs
+static uint16_t toHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int32_t  exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t       mantissa = bits & 0x7FFFFF;
+
+    if (exponent <= 0)
+        return (uint16_t)sign;
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7C00);
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return (uint16_t)half;
+}
+
+// Same mapping as encodeDir in The-Forge's shader library, decodeDir in the castle shaders undoes it
+static uint32_t encodeNormal(const float* pNormal)
+{
+    const float sum = fabsf(pNormal[0]) + fabsf(pNormal[1]) + fabsf(pNormal[2]);
+    float x = sum > 0.0f ? pNormal[0] / sum : 0.0f;
+    float y = sum > 0.0f ? pNormal[1] / sum : 0.0f;
+    if (pNormal[2] < 0.0f)
+    {
+        const float wrappedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float wrappedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = wrappedX;
+        y = wrappedY;
+    }
+    return (uint32_t)toUnorm16(x * 0.5f + 0.5f) | ((uint32_t)toUnorm16(y * 0.5f + 0.5f) << 16);
+}
+
+static bool copyName(const char* pValue, char* pOut)
+{
+    if (strlen(pValue) >= COOKED_SCENE_NAME_SIZE)
+        return false;
+    strcpy(pOut, pValue);
+    return true;
+}
+
+// Appends size bytes at the next COOKED_SCENE_ALIGNMENT boundary
+static CookedSceneBlob appendBlob(std::vector<uint8_t>* pFile, const void* pData, size_t size)
+{
+    const size_t offset = (pFile->size() + COOKED_SCENE_ALIGNMENT - 1) / COOKED_SCENE_ALIGNMENT * COOKED_SCENE_ALIGNMENT;
+    pFile->resize(offset + size);
+    if (size > 0)
+        memcpy(pFile->data() + offset, pData, size);
+    return { offset, size };
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        printUsage();
+        return 1;
+    }
+
+    GltfDocument document;
+    JsonValue    job;
+    std::string  error;
+    if (!gltfLoad(argv[1], &document, &error) || !jsonReadFile(argv[2], &job, &error))
+    {
+        fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    const JsonValue* materialTextures = job.find("materials");
+    const JsonValue* materials = document.mJson.find("materials");
+
+    std::vector<float>               positions;
+    std::vector<uint32_t>            normals;
+    std::vector<uint32_t>            uvs;
+    std::vector<uint32_t>            tangents;
+    std::vector<uint32_t>            indices;
+    std::vector<CookedSceneDraw>     draws;
+    std::vector<CookedSceneBounds>   bounds;
+    std::vector<CookedSceneMaterial> drawMaterials;
+    uint32_t                         maxLocalVertex = 0;
+
+    for (const GltfPrimitive& primitive : gltfGetPrimitives(document))
+    {
+        int32_t normalAccessor = -1;
+        int32_t uvAccessor = -1;
+        for (const GltfAttribute& attribute : primitive.mAttributes)
+        {
+            if (attribute.mSemantic == "NORMAL")
+                normalAccessor = (int32_t)attribute.mAccessor;
+            else if (attribute.mSemantic == "TEXCOORD_0")
+                uvAccessor = (int32_t)attribute.mAccessor;
+        }
+
+        GltfAccessor indexAccessor;
+        GltfAccessor positionAccessor;
+        GltfAccessor normalView;
+        GltfAccessor uvView;
+        if (primitive.mIndicesAccessor < 0 || primitive.mPositionAccessor < 0 || normalAccessor < 0 || uvAccessor < 0 ||
+            !gltfGetAccessor(&document, (uint32_t)primitive.mIndicesAccessor, &indexAccessor) ||
+            !gltfGetAccessor(&document, (uint32_t)primitive.mPositionAccessor, &positionAccessor) ||
+            !gltfGetAccessor(&document, (uint32_t)normalAccessor, &normalView) || !gltfGetAccessor(&document, (uint32_t)uvAccessor, &uvView) ||
+            positionAccessor.mComponentType != GLTF_FLOAT || normalView.mComponentType != GLTF_FLOAT ||
+            uvView.mComponentType != GLTF_FLOAT || normalView.mCount != positionAccessor.mCount || uvView.mCount != positionAccessor.mCount)
+        {
+            fprintf(stderr, "error: %s needs indices and float POSITION, NORMAL and TEXCOORD_0\n", primitive.mMeshName.c_str());
+            return 1;
+        }
+
+        CookedSceneMaterial material = {};
+        const char* materialName = "";
+        if (primitive.mMaterial >= 0 && materials && (uint32_t)primitive.mMaterial < materials->size())
+        {
+            const JsonValue* name = (*materials)[(uint32_t)primitive.mMaterial].find("name");
+            materialName = name ? name->asString() : "";
+        }
+        const JsonValue* textures = materialTextures ? materialTextures->find(materialName) : NULL;
+        const JsonValue* albedo = textures ? textures->find("albedo") : NULL;
+        const JsonValue* bump = textures ? textures->find("bump") : NULL;
+        if (!albedo || !bump)
+        {
+            fprintf(stderr, "error: no textures for material \"%s\" of %s in %s\n", materialName, primitive.mMeshName.c_str(), argv[2]);
+            return 1;
+        }
+        if (!copyName(materialName, material.mName) || !copyName(albedo->asString(), material.mAlbedo) ||
+            !copyName(bump->asString(), material.mBump))
+        {
+            fprintf(stderr, "error: names of material \"%s\" are too long\n", materialName);
+            return 1;
+        }
+
+        std::vector<uint32_t> drawIndices;
+        std::vector<float>    drawPositions;
+        std::vector<float>    drawNormals;
+        std::vector<float>    drawUvs;
+        gltfReadIndices(indexAccessor, &drawIndices);
+        gltfReadPositions(positionAccessor, &drawPositions);
+        gltfReadFloats(normalView, &drawNormals);
+        gltfReadFloats(uvView, &drawUvs);
+        drawIndices.resize(drawIndices.size() / 3 * 3);
+
+        const uint32_t vertexOffset = (uint32_t)(positions.size() / 3);
+        const uint32_t vertexCount = positionAccessor.mCount;
+        CookedSceneDraw draw = { (uint32_t)drawIndices.size(), 1, (uint32_t)indices.size(), vertexOffset, 0 };
+
+        // Bounds of the referenced vertices only, the same the app computed from the castle.bin shadow copy
+        CookedSceneBounds box = { { 1e30f, 1e30f, 1e30f }, { -1e30f, -1e30f, -1e30f } };
+        for (uint32_t index : drawIndices)
+        {
+            if (index >= vertexCount)
+            {
+                fprintf(stderr, "error: %s has an index out of range\n", primitive.mMeshName.c_str());
+                return 1;
+            }
+            maxLocalVertex = index > maxLocalVertex ? index : maxLocalVertex;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                box.mMin[c] = fminf(box.mMin[c], drawPositions[(size_t)index * 3 + c]);
+                box.mMax[c] = fmaxf(box.mMax[c], drawPositions[(size_t)index * 3 + c]);
+            }
+        }
+
+        std::vector<float> drawTangents((size_t)vertexCount * 4);
+        tangentsGenerate(drawIndices.data(), (uint32_t)drawIndices.size(), drawPositions.data(), drawNormals.data(), drawUvs.data(),
+                         vertexCount, drawTangents.data());
+
+        positions.insert(positions.end(), drawPositions.begin(), drawPositions.end());
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            normals.push_back(encodeNormal(&drawNormals[(size_t)v * 3]));
+            uvs.push_back((uint32_t)toHalf(drawUvs[(size_t)v * 2]) | ((uint32_t)toHalf(drawUvs[(size_t)v * 2 + 1]) << 16));
+            tangents.push_back(tangentEncode(&drawTangents[(size_t)v * 4]));
+        }
+        indices.insert(indices.end(), drawIndices.begin(), drawIndices.end());
+        draws.push_back(draw);
+        bounds.push_back(box);
+        drawMaterials.push_back(material);
+
+        printf("%-28s %8u tris %8u verts  %s\n", primitive.mMeshName.c_str(), draw.mIndexCount / 3, vertexCount, material.mAlbedo);
+    }
+
+    if (draws.empty())
+    {
+        fprintf(stderr, "error: %s has no triangle list primitives\n", argv[1]);
+        return 1;
+    }
+
+    // 0xFFFF stays free for primitive restart, like the mesh splitting
+    const bool     indices16 = maxLocalVertex < 0xFFFF;
+    std::vector<uint16_t> shortIndices;
+    if (indices16)
+        shortIndices.assign(indices.begin(), indices.end());
+
+    CookedSceneHeader header = {};
+    header.mMagic = COOKED_SCENE_MAGIC;
+    header.mVersion = COOKED_SCENE_VERSION;
+    header.mVertexCount = (uint32_t)(positions.size() / 3);
+    header.mIndexCount = (uint32_t)indices.size();
+    header.mIndexSize = indices16 ? 2 : 4;
+    header.mDrawCount = (uint32_t)draws.size();
+
+    std::vector<uint8_t> file(sizeof(header));
+    header.mVertexStreams[COOKED_SCENE_STREAM_POSITION] = appendBlob(&file, positions.data(), positions.size() * sizeof(float));
+    header.mVertexStreams[COOKED_SCENE_STREAM_NORMAL] = appendBlob(&file, normals.data(), normals.size() * sizeof(uint32_t));
+    header.mVertexStreams[COOKED_SCENE_STREAM_TEXCOORD] = appendBlob(&file, uvs.data(), uvs.size() * sizeof(uint32_t));
+    header.mVertexStreams[COOKED_SCENE_STREAM_TANGENT] = appendBlob(&file, tangents.data(), tangents.size() * sizeof(uint32_t));
+    header.mIndices = indices16 ? appendBlob(&file, shortIndices.data(), shortIndices.size() * sizeof(uint16_t))
+                                : appendBlob(&file, indices.data(), indices.size() * sizeof(uint32_t));
+    header.mDraws = appendBlob(&file, draws.data(), draws.size() * sizeof(CookedSceneDraw));
+    header.mBounds = appendBlob(&file, bounds.data(), bounds.size() * sizeof(CookedSceneBounds));
+    header.mMaterials = appendBlob(&file, drawMaterials.data(), drawMaterials.size() * sizeof(CookedSceneMaterial));
+    // The end is aligned too, so a mapping never has to read past the last page of the file
+    file.resize((file.size() + COOKED_SCENE_ALIGNMENT - 1) / COOKED_SCENE_ALIGNMENT * COOKED_SCENE_ALIGNMENT);
+    header.mFileSize = file.size();
+    memcpy(file.data(), &header, sizeof(header));
+
+    // The app's own reader has the last word
+    CookedScene parsed;
+    if (const char* parseError = cookedSceneParse(file.data(), file.size(), &parsed))
+    {
+        fprintf(stderr, "error: cooked scene does not parse back: %s\n", parseError);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[3], "wb");
+    if (!out || fwrite(file.data(), 1, file.size(), out) != file.size())
+    {
+        fprintf(stderr, "error: can't write %s\n", argv[3]);
+        if (out)
+            fclose(out);
+        return 1;
+    }
+    fclose(out);
+
+    printf("\n%u draws, %u vertices, %u %u-bit indices, %zu bytes\nwrote %s\n", header.mDrawCount, header.mVertexCount, header.mIndexCount,
+           header.mIndexSize * 8, file.size(), argv[3]);
+    return 0;
+}
@@ -0,0 +1,459 @@
+// Offline texture cooking for the castle materials.
+//
+//   KokkuTextureCooker <textures.json> <output dir>
+//
+// The job file lists every source texture with its usage:
+//   { "textures": [ { "source": "Castle Exterior Texture.dds", "usage": "albedo", "format": "bc1" }, ... ] }
+// - albedo: color data, sRGB, BC1 (default) or BC7
+// - height: single channel (red) data, linear, BC4
+// - normal: tangent space xy, linear, BC5
+// - bump: height map (red), baked to a tangent space normal map and cooked like one. "depth" (default 4) is how
+//   many texels the full height range spans. x follows +u (right), y +v (down the image), the directions the
+//   tangent frames of the castle vertices (Tangents.h) take.
+// An optional "array": "<file>.dds" packs the texture into that 2D texture array, one layer per texture in job
+// order. The layers of an array must share the usage's format, the size and the mip count.
+//
+// Mip chains are rebuilt from the top level (in linear light for sRGB data, renormalized for normals),
+// compressed and written as DX10 DDS files next to CookedTextures.meta, which tells the app the
+// format and color space of each file, and the array and layer of each packed texture.
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../Common/BlockCompression.h"
+#include "../Common/Dds.h"
+#include "../Common/Json.h"
+
+enum TextureUsage
+{
+    TEXTURE_USAGE_ALBEDO,
+    TEXTURE_USAGE_HEIGHT,
+    TEXTURE_USAGE_NORMAL,
+    TEXTURE_USAGE_BUMP,
+};
+
+struct TextureJob
+{
+    std::string  mSource;
+    TextureUsage mUsage;
+    DxgiFormat   mFormat;
+    // Bump maps only, texels of the full height range
+    float mDepth;
+    // Empty when the texture gets its own file
+    std::string mArray;
+};
+
+struct TextureArray
+{
+    std::string           mName;
+    std::vector<DdsImage> mLayers;
+};
+
+struct CookResult
+{
+    DxgiFormat mSourceFormat;
+    size_t     mSourceSize;
+    size_t     mCookedSize;
+    // Top level against the decoded source
+    double mPsnr;
+};
+
+static const char* gManifestName = "CookedTextures.meta";
+
+static void printUsage() { printf("Usage: KokkuTextureCooker <textures.json> <output dir>\n"); }
+
+static std::string directoryOf(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static bool parseJob(const JsonValue& entry, TextureJob* pJob, std::string* pError)
+{
+    const JsonValue* source = entry.find("source");
+    const JsonValue* usage = entry.find("usage");
+    const JsonValue* format = entry.find("format");
+    const JsonValue* array = entry.find("array");
+    const JsonValue* depth = entry.find("depth");
+    if (!source || !usage)
+    {
+        *pError = "every texture needs a source and a usage";
+        return false;
+    }
+    pJob->mSource = source->asString();
+    pJob->mArray = array ? array->asString() : "";
+    pJob->mDepth = depth ? (float)depth->asNumber() : 4.0f;
+
+    const std::string usageName = usage->asString();
+    const std::string formatName = format ? format->asString() : "";
+    if (usageName == "albedo")
+    {
+        pJob->mUsage = TEXTURE_USAGE_ALBEDO;
+        if (formatName.empty() || formatName == "bc1")
+            pJob->mFormat = DXGI_FORMAT_BC1_UNORM_SRGB;
+        else if (formatName == "bc7")
+            pJob->mFormat = DXGI_FORMAT_BC7_UNORM_SRGB;
+        else
+            pJob->mFormat = DXGI_FORMAT_UNKNOWN;
+    }
+    else if (usageName == "height")
+    {
+        pJob->mUsage = TEXTURE_USAGE_HEIGHT;
+        pJob->mFormat = formatName.empty() || formatName == "bc4" ? DXGI_FORMAT_BC4_UNORM : DXGI_FORMAT_UNKNOWN;
+    }
+    else if (usageName == "normal")
+    {
+        pJob->mUsage = TEXTURE_USAGE_NORMAL;
+        pJob->mFormat = formatName.empty() || formatName == "bc5" ? DXGI_FORMAT_BC5_UNORM : DXGI_FORMAT_UNKNOWN;
+    }
+    else if (usageName == "bump")
+    {
+        pJob->mUsage = TEXTURE_USAGE_BUMP;
+        pJob->mFormat = formatName.empty() || formatName == "bc5" ? DXGI_FORMAT_BC5_UNORM : DXGI_FORMAT_UNKNOWN;
+    }
+    else
+    {
+        *pError = pJob->mSource + ": unknown usage '" + usageName + "'";
+        return false;
+    }
+
+    if (pJob->mFormat == DXGI_FORMAT_UNKNOWN)
+    {
+        *pError = pJob->mSource + ": format '" + formatName + "' doesn't fit usage '" + usageName + "'";
+        return false;
+    }
+    return true;
+}
+
+static float srgbToLinear(float value) { return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f); }
+
+static float linearToSrgb(float value) { return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f; }
+
+static uint8_t toUnorm8(float value) { return (uint8_t)(fminf(fmaxf(value, 0.0f), 1.0f) * 255.0f + 0.5f); }
+
+// 2x2 box filter. Odd sizes clamp the second tap, which is enough for the power of two castle textures.
+static void downsample(const std::vector<uint8_t>& src, uint32_t width, uint32_t height, TextureUsage usage, std::vector<uint8_t>* pDst)
+{
+    static float gSrgbToLinear[256];
+    if (gSrgbToLinear[255] == 0.0f)
+    {
+        for (int i = 0; i < 256; ++i)
+            gSrgbToLinear[i] = srgbToLinear(i / 255.0f);
+    }
+
+    const uint32_t dstWidth = width > 1 ? width / 2 : 1;
+    const uint32_t dstHeight = height > 1 ? height / 2 : 1;
+    pDst->assign((size_t)dstWidth * dstHeight * 4, 0);
+
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const uint32_t x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+            const uint32_t y0 = y * 2, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+            const uint8_t* taps[4] = { &src[((size_t)y0 * width + x0) * 4], &src[((size_t)y0 * width + x1) * 4],
+                                       &src[((size_t)y1 * width + x0) * 4], &src[((size_t)y1 * width + x1) * 4] };
+            uint8_t* out = &(*pDst)[((size_t)y * dstWidth + x) * 4];
+
+            if (usage == TEXTURE_USAGE_ALBEDO)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    const float sum = gSrgbToLinear[taps[0][c]] + gSrgbToLinear[taps[1][c]] + gSrgbToLinear[taps[2][c]] +
+                                      gSrgbToLinear[taps[3][c]];
+                    out[c] = toUnorm8(linearToSrgb(sum * 0.25f));
+                }
+                out[3] = (uint8_t)((taps[0][3] + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+            }
+            else if (usage == TEXTURE_USAGE_NORMAL)
+            {
+                float n[3] = {};
+                for (int t = 0; t < 4; ++t)
+                {
+                    const float nx = taps[t][0] / 127.5f - 1.0f;
+                    const float ny = taps[t][1] / 127.5f - 1.0f;
+                    n[0] += nx;
+                    n[1] += ny;
+                    n[2] += sqrtf(fmaxf(1.0f - nx * nx - ny * ny, 0.0f));
+                }
+                const float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                const float scale = len > 0.0f ? 1.0f / len : 0.0f;
+                out[0] = toUnorm8(n[0] * scale * 0.5f + 0.5f);
+                out[1] = toUnorm8(n[1] * scale * 0.5f + 0.5f);
+                out[2] = 0;
+                out[3] = 255;
+            }
+            else
+            {
+                for (int c = 0; c < 4; ++c)
+                    out[c] = (uint8_t)((taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c] + 2) / 4);
+            }
+        }
+    }
+}
+
+// Peak signal to noise ratio over the channels the usage cares about, INFINITY when identical
+static double computePsnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, TextureUsage usage)
+{
+    const uint32_t channels = usage == TEXTURE_USAGE_ALBEDO ? 3 : (usage == TEXTURE_USAGE_NORMAL ? 2 : 1);
+    double         squaredError = 0.0;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            const double d = (double)a[i + c] - (double)b[i + c];
+            squaredError += d * d;
+        }
+    }
+    const double mse = squaredError / (double)(a.size() / 4 * channels);
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+// Central differences of the red channel, wrapping around the borders like the tiling castle textures. The slope
+// per texel is the height difference times depth, the normal stands on it.
+static void bakeNormals(std::vector<uint8_t>* pTexels, uint32_t width, uint32_t height, float depth)
+{
+    const std::vector<uint8_t> heights = *pTexels;
+    const float scale = depth / (2.0f * 255.0f);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t left = (x + width - 1) % width, right = (x + 1) % width;
+            const uint32_t up = (y + height - 1) % height, down = (y + 1) % height;
+            const float dx = ((float)heights[((size_t)y * width + right) * 4] - (float)heights[((size_t)y * width + left) * 4]) * scale;
+            const float dy = ((float)heights[((size_t)down * width + x) * 4] - (float)heights[((size_t)up * width + x) * 4]) * scale;
+            const float invLength = 1.0f / sqrtf(dx * dx + dy * dy + 1.0f);
+
+            uint8_t* out = &(*pTexels)[((size_t)y * width + x) * 4];
+            out[0] = toUnorm8(-dx * invLength * 0.5f + 0.5f);
+            out[1] = toUnorm8(-dy * invLength * 0.5f + 0.5f);
+            out[2] = 0;
+            out[3] = 255;
+        }
+    }
+}
+
+static size_t imageSize(const DdsImage& image)
+{
+    size_t size = 0;
+    for (const std::vector<uint8_t>& level : image.mLevels)
+        size += level.size();
+    return size;
+}
+
+// Same bits, only the color space tag differs
+static bool sameEncoding(DxgiFormat a, DxgiFormat b)
+{
+    return ddsBlockSize(a) != 0 && ddsBlockSize(a) == ddsBlockSize(b) &&
+           strncmp(ddsFormatName(a), ddsFormatName(b), 3) == 0;
+}
+
+static bool cookTexture(const TextureJob& job, const std::string& sourcePath, DdsImage* pCooked, CookResult* pResult,
+                        std::string* pError)
+{
+    DdsImage source;
+    if (!ddsLoad(sourcePath.c_str(), &source, pError))
+        return false;
+    pResult->mSourceFormat = source.mFormat;
+    pResult->mSourceSize = imageSize(source);
+
+    std::vector<uint8_t> texels;
+    if (!imageDecompress(source.mFormat, source.mLevels[0].data(), source.mWidth, source.mHeight, &texels))
+    {
+        *pError = sourcePath + ": can't decode " + ddsFormatName(source.mFormat);
+        return false;
+    }
+
+    // From here on a bump map is a normal map, the mips filter the normals rather than the heights
+    TextureUsage usage = job.mUsage;
+    if (usage == TEXTURE_USAGE_BUMP)
+    {
+        bakeNormals(&texels, source.mWidth, source.mHeight, job.mDepth);
+        usage = TEXTURE_USAGE_NORMAL;
+    }
+
+    pCooked->mFormat = job.mFormat;
+    pCooked->mWidth = source.mWidth;
+    pCooked->mHeight = source.mHeight;
+    pCooked->mLevels.clear();
+
+    uint32_t width = source.mWidth;
+    uint32_t height = source.mHeight;
+    const uint32_t mipCount = ddsMipCount(width, height);
+    for (uint32_t level = 0; level < mipCount; ++level)
+    {
+        pCooked->mLevels.emplace_back();
+        // The top level keeps the source blocks when they are already in the target encoding, so
+        // re-cooking doesn't add another round of compression error
+        if (level == 0 && sameEncoding(source.mFormat, job.mFormat))
+            pCooked->mLevels.back() = source.mLevels[0];
+        else
+            imageCompress(job.mFormat, texels.data(), width, height, &pCooked->mLevels.back());
+
+        if (level == 0)
+        {
+            std::vector<uint8_t> decoded;
+            imageDecompress(job.mFormat, pCooked->mLevels[0].data(), width, height, &decoded);
+            pResult->mPsnr = computePsnr(texels, decoded, usage);
+        }
+
+        if (level + 1 < mipCount)
+        {
+            std::vector<uint8_t> next;
+            downsample(texels, width, height, usage, &next);
+            texels.swap(next);
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+    }
+
+    pResult->mCookedSize = imageSize(*pCooked);
+    return true;
+}
+
+// Appends image as the next layer of the array called name, returns the layer or -1 when it doesn't fit the others
+static int addArrayLayer(std::vector<TextureArray>* pArrays, const std::string& name, const DdsImage& image)
+{
+    TextureArray* pArray = NULL;
+    for (TextureArray& array : *pArrays)
+    {
+        if (array.mName == name)
+            pArray = &array;
+    }
+    if (!pArray)
+    {
+        pArrays->push_back({ name, {} });
+        pArray = &pArrays->back();
+    }
+
+    if (!pArray->mLayers.empty())
+    {
+        const DdsImage& first = pArray->mLayers[0];
+        if (image.mFormat != first.mFormat || image.mWidth != first.mWidth || image.mHeight != first.mHeight ||
+            image.mLevels.size() != first.mLevels.size())
+            return -1;
+    }
+    pArray->mLayers.push_back(image);
+    return (int)pArray->mLayers.size() - 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    JsonValue   jobFile;
+    std::string error;
+    if (!jsonReadFile(argv[1], &jobFile, &error))
+    {
+        fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    const JsonValue* textures = jobFile.find("textures");
+    if (!textures || textures->mType != JSON_ARRAY)
+    {
+        fprintf(stderr, "error: %s has no \"textures\" array\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<TextureJob> jobs(textures->size());
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        if (!parseJob((*textures)[i], &jobs[i], &error))
+        {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    const std::string sourceDir = directoryOf(argv[1]);
+    std::string       outputDir = argv[2];
+    if (!outputDir.empty() && outputDir.back() != '/' && outputDir.back() != '\\')
+        outputDir += '/';
+
+    std::string manifest = "# Written by KokkuTextureCooker, one line per texture:\n"
+                           "# file<TAB>format<TAB>colorspace<TAB>width<TAB>height<TAB>mips[<TAB>array<TAB>layer]\n";
+
+    std::vector<TextureArray> arrays;
+
+    printf("%-36s %-8s %-10s %9s   %-10s %9s %5s %8s\n", "texture", "usage", "source", "bytes", "cooked", "bytes", "mips", "PSNR");
+    for (const TextureJob& job : jobs)
+    {
+        DdsImage   cooked;
+        CookResult result = {};
+        if (!cookTexture(job, sourceDir + job.mSource, &cooked, &result, &error) ||
+            (job.mArray.empty() && !ddsSave((outputDir + job.mSource).c_str(), cooked, &error)))
+        {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+
+        int layer = -1;
+        if (!job.mArray.empty() && (layer = addArrayLayer(&arrays, job.mArray, cooked)) < 0)
+        {
+            fprintf(stderr, "error: %s: format, size or mips differ from the other layers of %s\n", job.mSource.c_str(),
+                    job.mArray.c_str());
+            return 1;
+        }
+
+        static const char* gUsageNames[] = { "albedo", "height", "normal", "bump" };
+        char psnrText[16];
+        if (isinf(result.mPsnr))
+            snprintf(psnrText, sizeof(psnrText), "lossless");
+        else
+            snprintf(psnrText, sizeof(psnrText), "%.2f dB", result.mPsnr);
+        printf("%-36s %-8s %-10s %9zu   %-10s %9zu %5zu %8s\n", job.mSource.c_str(), gUsageNames[job.mUsage],
+               ddsFormatName(result.mSourceFormat), result.mSourceSize, ddsFormatName(cooked.mFormat), result.mCookedSize,
+               cooked.mLevels.size(), psnrText);
+
+        char line[512];
+        snprintf(line, sizeof(line), "%s\t%s\t%s\t%u\t%u\t%zu", job.mSource.c_str(), ddsFormatName(cooked.mFormat),
+                 ddsIsSrgb(cooked.mFormat) ? "srgb" : "linear", cooked.mWidth, cooked.mHeight, cooked.mLevels.size());
+        manifest += line;
+        if (layer >= 0)
+        {
+            snprintf(line, sizeof(line), "\t%s\t%d", job.mArray.c_str(), layer);
+            manifest += line;
+        }
+        manifest += '\n';
+    }
+
+    for (const TextureArray& array : arrays)
+    {
+        const DdsImage& first = array.mLayers[0];
+        if (!ddsSaveArray((outputDir + array.mName).c_str(), array.mLayers.data(), (uint32_t)array.mLayers.size(), &error))
+        {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        printf("%-36s %zu layers\n", array.mName.c_str(), array.mLayers.size());
+
+        char line[512];
+        snprintf(line, sizeof(line), "%s\t%s\t%s\t%u\t%u\t%zu\n", array.mName.c_str(), ddsFormatName(first.mFormat),
+                 ddsIsSrgb(first.mFormat) ? "srgb" : "linear", first.mWidth, first.mHeight, first.mLevels.size());
+        manifest += line;
+    }
+
+    const std::string manifestPath = outputDir + gManifestName;
+    FILE*             file = fopen(manifestPath.c_str(), "wb");
+    if (!file || fwrite(manifest.data(), 1, manifest.size(), file) != manifest.size())
+    {
+        fprintf(stderr, "error: can't write %s\n", manifestPath.c_str());
+        if (file)
+            fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    printf("\nwrote %s\n", manifestPath.c_str());
+    return 0;
+}